@@ -0,0 +1,191 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The receiving end of bulk transfers. See
+ * bulk_receiver.h.
+ *
+ * Notes:
+ *     - Only the Zigbee task calls these functions, so there is no
+ *       lock.
+ *     - One transfer at a time. A fragment of a new transfer drops
+ *       whatever was left of the old one.
+ *     - Acknowledgements go out every half window of fragments, on
+ *       the last fragment, and on anything out of order or seen
+ *       before, so a loss is reported as soon as it shows. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "bulk_receiver.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "BULK_RECEIVER";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static bulk_receiver_handler_t s_handler = NULL;
+
+static uint8_t s_buffer[BULK_MAX_SIZE];
+static bool s_active = false;
+static bool s_complete = false;
+static uint8_t s_transfer_id;
+static uint16_t s_src_short_addr;
+static uint16_t s_fragments;
+static uint16_t s_length;
+/* Bit n set for fragment n. */
+static uint64_t s_received;
+/* In order fragments since the last acknowledgement. */
+static uint8_t s_unacked;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * send_ack()
+ *------------------------------------------------------------*/
+
+static void send_ack(void)
+{
+    uint16_t first_missing = 0;
+    while (first_missing < s_fragments && (s_received & (1ULL << first_missing)))
+    {
+        first_missing++;
+    }
+    uint16_t bitmap = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        uint32_t fragment = first_missing + 1 + i;
+        if (fragment < s_fragments && (s_received & (1ULL << fragment)))
+        {
+            bitmap |= 1U << i;
+        }
+    }
+
+    uint8_t frame[BULK_HEADER_SIZE] = {
+        BULK_FRAME_ACK,
+        s_transfer_id,
+        (uint8_t)(first_missing), (uint8_t)(first_missing >> 8),
+        (uint8_t)(bitmap), (uint8_t)(bitmap >> 8),
+    };
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = s_src_short_addr,
+        .dst_endpoint = BULK_ENDPOINT,
+        .profile_id = BULK_PROFILE_ID,
+        .cluster_id = BULK_CLUSTER_ID,
+        .src_endpoint = BULK_ENDPOINT,
+        .asdu_length = sizeof(frame),
+        .asdu = frame,
+    };
+    if (esp_zb_aps_data_request(&req) != ESP_OK)
+    {
+        /* The leader sends the window again and we try again. */
+        ESP_LOGW(TAG, "Failed to send acknowledgement");
+    }
+    s_unacked = 0;
+}
+
+/*--------------------------------------------------------------
+ * bulk_receiver_init()
+ *------------------------------------------------------------*/
+
+esp_err_t bulk_receiver_init(bulk_receiver_handler_t handler)
+{
+    ESP_RETURN_ON_FALSE(handler, ESP_ERR_INVALID_ARG, TAG, "No handler");
+    s_handler = handler;
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * bulk_receiver_handle_indication()
+ *------------------------------------------------------------*/
+
+bool bulk_receiver_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != BULK_PROFILE_ID || ind->cluster_id != BULK_CLUSTER_ID || ind->dst_endpoint != BULK_ENDPOINT)
+    {
+        return false;
+    }
+    const uint8_t *frame = ind->asdu;
+    if (ind->asdu_length < BULK_HEADER_SIZE || frame[0] != BULK_FRAME_DATA)
+    {
+        return true;
+    }
+    uint8_t transfer_id = frame[1];
+    uint16_t fragment = frame[2] | (frame[3] << 8);
+    uint16_t fragments = frame[4] | (frame[5] << 8);
+    uint16_t size = ind->asdu_length - BULK_HEADER_SIZE;
+    if (fragments == 0 || fragments > BULK_MAX_FRAGMENTS || fragment >= fragments || size > BULK_FRAGMENT_SIZE ||
+        (fragment + 1 < fragments && size != BULK_FRAGMENT_SIZE))
+    {
+        ESP_LOGW(TAG, "Invalid fragment %u of %u (%u bytes)", fragment, fragments, size);
+        return true;
+    }
+
+    /* A new transfer. */
+    if (!s_active || transfer_id != s_transfer_id || ind->src_short_addr != s_src_short_addr)
+    {
+        s_active = true;
+        s_complete = false;
+        s_transfer_id = transfer_id;
+        s_src_short_addr = ind->src_short_addr;
+        s_fragments = fragments;
+        s_length = 0;
+        s_received = 0;
+        s_unacked = 0;
+    }
+
+    uint64_t bit = 1ULL << fragment;
+    uint64_t below = bit - 1;
+    bool in_order = (s_received & below) == below && !(s_received & bit);
+    if (!(s_received & bit))
+    {
+        memcpy(&s_buffer[fragment * BULK_FRAGMENT_SIZE], &frame[BULK_HEADER_SIZE], size);
+        s_received |= bit;
+        if (fragment + 1 == fragments)
+        {
+            s_length = fragment * BULK_FRAGMENT_SIZE + size;
+        }
+    }
+
+    uint64_t all = fragments >= 64 ? UINT64_MAX : (1ULL << fragments) - 1;
+    if (s_received == all && !s_complete)
+    {
+        s_complete = true;
+        send_ack();
+        s_handler(s_src_short_addr, s_buffer, s_length);
+    }
+    else if (s_complete || !in_order || ++s_unacked >= BULK_WINDOW / 2)
+    {
+        /* Also when complete: the last acknowledgement got lost. */
+        send_ack();
+    }
+    return true;
+}
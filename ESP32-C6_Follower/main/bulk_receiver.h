@@ -0,0 +1,77 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The receiving end of the leader's bulk transfers.
+ * Fragments sent as raw APS frames on a private profile are put back
+ * together, what arrived is acknowledged, and a finished payload is
+ * handed to a handler. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Bulk transfer frames, must match zb_bulk.h on the leader. */
+#define BULK_ENDPOINT 200
+#define BULK_PROFILE_ID 0xC0B5
+#define BULK_CLUSTER_ID 0x0001
+#define BULK_FRAME_DATA 0
+#define BULK_FRAME_ACK 1
+#define BULK_HEADER_SIZE 6
+#define BULK_FRAGMENT_SIZE 64
+#define BULK_MAX_FRAGMENTS 64
+#define BULK_MAX_SIZE (BULK_FRAGMENT_SIZE * BULK_MAX_FRAGMENTS)
+#define BULK_WINDOW 8
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+/* Called in the Zigbee task with a whole payload. */
+typedef void (*bulk_receiver_handler_t)(uint16_t src_short_addr, const uint8_t *data, uint16_t length);
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * bulk_receiver_init()
+ *------------------------------------------------------------*/
+
+esp_err_t bulk_receiver_init(bulk_receiver_handler_t handler);
+
+/*--------------------------------------------------------------
+ * bulk_receiver_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take bulk fragments out of the incoming APS frames. Call it
+ * from the handler registered with
+ * esp_zb_aps_data_indication_handler_register().
+ *
+ * @return true if the frame was for us.
+ */
+bool bulk_receiver_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -22,10 +22,12 @@
  * INCLUDES
  *############################################################*/
 
+#include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_check.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 #include "ha/esp_zigbee_ha_standard.h"
 #include "esp_zb_light.h"
@@ -92,6 +94,7 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
             else
             {
                 ESP_LOGI(TAG, "Device rebooted");
+                light_sync_start();
             }
         }
         else
@@ -109,6 +112,7 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
                      extended_pan_id[7], extended_pan_id[6], extended_pan_id[5], extended_pan_id[4],
                      extended_pan_id[3], extended_pan_id[2], extended_pan_id[1], extended_pan_id[0],
                      esp_zb_get_pan_id(), esp_zb_get_current_channel(), esp_zb_get_short_address());
+            light_sync_start();
         }
         else
         {
@@ -129,6 +133,9 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
 
 static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t *message)
 {
+    /* Start of the follower's part of the leader's latency
+     * measurement. */
+    int64_t received_us = esp_timer_get_time();
     esp_err_t ret = ESP_OK;
     bool light_state = 0;
 
@@ -146,12 +153,91 @@ static esp_err_t zb_attribute_handler(const esp_zb_zcl_set_attr_value_message_t
                 light_state = message->attribute.data.value ? *(bool *)message->attribute.data.value : light_state;
                 ESP_LOGI(TAG, "Light sets to %s", light_state ? "On" : "Off");
                 light_driver_set_power(light_state);
+                light_latency_report(received_us, light_driver_get_refreshed_us());
+                light_stress_count();
             }
         }
     }
     return ret;
 }
 
+/*--------------------------------------------------------------
+ * zb_custom_cluster_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_custom_cluster_handler(const esp_zb_zcl_custom_cluster_command_message_t *message)
+{
+    led_effect_params_t params;
+    uint8_t effect_type = 0;
+
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
+                        message->info.status);
+    if (message->info.dst_endpoint != HA_ESP_LIGHT_ENDPOINT || message->info.cluster != LED_EFFECTS_CLUSTER_ID)
+    {
+        return ESP_OK;
+    }
+    if (message->info.command.id == LED_EFFECTS_CMD_START_ID)
+    {
+        /* The payload is an octet string, so the first byte is its length. */
+        const uint8_t *value = (const uint8_t *)message->data.value;
+        ESP_RETURN_ON_FALSE(value && message->data.size > 0, ESP_ERR_INVALID_SIZE, TAG, "Empty effect payload");
+        uint16_t length = value[0] < message->data.size - 1 ? value[0] : message->data.size - 1;
+        ESP_RETURN_ON_ERROR(led_effects_params_from_bytes(value + 1, length, &params), TAG, "Invalid effect payload");
+        ESP_LOGI(TAG, "Light effect sets to %s", led_effects_type_to_string(params.type));
+        light_driver_set_effect(&params);
+        effect_type = (uint8_t)params.type;
+        esp_zb_zcl_set_attribute_val(HA_ESP_LIGHT_ENDPOINT, LED_EFFECTS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                     LED_EFFECTS_ATTR_TYPE_ID, &effect_type, false);
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_store_scene_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_store_scene_handler(const esp_zb_zcl_store_scene_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
+                        message->info.status);
+    if (message->info.dst_endpoint != HA_ESP_LIGHT_ENDPOINT)
+    {
+        return ESP_OK;
+    }
+    return light_scenes_store(message->group_id, message->scene_id);
+}
+
+/*--------------------------------------------------------------
+ * zb_recall_scene_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_recall_scene_handler(const esp_zb_zcl_recall_scene_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
+                        message->info.status);
+    if (message->info.dst_endpoint != HA_ESP_LIGHT_ENDPOINT)
+    {
+        return ESP_OK;
+    }
+    /* The whole state comes from our own table, which also has the
+     * effect, so the stack's field set is not needed. */
+    ESP_RETURN_ON_ERROR(light_scenes_recall(message->group_id, message->scene_id), TAG, "Failed to recall scene");
+
+    /* Keep the attributes in step with the light. */
+    bool power = light_driver_get_power();
+    led_effect_params_t params;
+    light_driver_get_effect(&params);
+    uint8_t effect_type = (uint8_t)params.type;
+    esp_zb_zcl_set_attribute_val(HA_ESP_LIGHT_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID, &power, false);
+    esp_zb_zcl_set_attribute_val(HA_ESP_LIGHT_ENDPOINT, LED_EFFECTS_CLUSTER_ID, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 LED_EFFECTS_ATTR_TYPE_ID, &effect_type, false);
+    return ESP_OK;
+}
+
 /*--------------------------------------------------------------
  * zb_action_handler()
  *------------------------------------------------------------*/
@@ -164,6 +250,18 @@ static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id,
     case ESP_ZB_CORE_SET_ATTR_VALUE_CB_ID:
         ret = zb_attribute_handler((esp_zb_zcl_set_attr_value_message_t *)message);
         break;
+    case ESP_ZB_CORE_CMD_CUSTOM_CLUSTER_REQ_CB_ID:
+        ret = zb_custom_cluster_handler((esp_zb_zcl_custom_cluster_command_message_t *)message);
+        break;
+    case ESP_ZB_CORE_SCENES_STORE_SCENE_CB_ID:
+        ret = zb_store_scene_handler((esp_zb_zcl_store_scene_message_t *)message);
+        break;
+    case ESP_ZB_CORE_SCENES_RECALL_SCENE_CB_ID:
+        ret = zb_recall_scene_handler((esp_zb_zcl_recall_scene_message_t *)message);
+        break;
+    case ESP_ZB_CORE_OTA_UPGRADE_VALUE_CB_ID:
+        ret = light_ota_handle_value((esp_zb_zcl_ota_upgrade_value_message_t *)message);
+        break;
     default:
         ESP_LOGW(TAG, "Receive Zigbee action(0x%x) callback", callback_id);
         break;
@@ -171,6 +269,47 @@ static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id,
     return ret;
 }
 
+/*--------------------------------------------------------------
+ * zb_aps_data_indication_handler()
+ *------------------------------------------------------------*/
+
+/* Returns true for frames the stack should not look at. */
+static bool zb_aps_data_indication_handler(esp_zb_apsde_data_ind_t ind)
+{
+    /* Time sync first, it takes the receive time. */
+    return light_sync_handle_indication(&ind) || bulk_receiver_handle_indication(&ind) || light_latency_handle_indication(&ind) || light_stress_handle_indication(&ind) ||
+           light_link_handle_indication(&ind);
+}
+
+/*--------------------------------------------------------------
+ * bulk_handler()
+ *------------------------------------------------------------*/
+
+static void bulk_handler(uint16_t src_short_addr, const uint8_t *data, uint16_t length)
+{
+    /* Nothing consumes bulk payloads yet. The checksum lets the
+     * sender check they arrived whole. */
+    uint32_t checksum = 0;
+    for (uint16_t i = 0; i < length; i++)
+    {
+        checksum += data[i];
+    }
+    ESP_LOGI(TAG, "Received %u bytes from 0x%04hx (checksum 0x%08" PRIx32 ")", length, src_short_addr, checksum);
+}
+
+/*--------------------------------------------------------------
+ * sync_on_off()
+ *------------------------------------------------------------*/
+
+/* Carries out a synchronized action, see light_sync.h. */
+static int64_t sync_on_off(bool on)
+{
+    light_driver_set_power(on);
+    esp_zb_zcl_set_attribute_val(HA_ESP_LIGHT_ENDPOINT, ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID, &on, false);
+    return light_driver_get_refreshed_us();
+}
+
 /*--------------------------------------------------------------
  * esp_zb_task()
  *------------------------------------------------------------*/
@@ -179,6 +318,8 @@ static void esp_zb_task(void *pvParameters)
 {
     /* initialize Zigbee stack */
     esp_zb_cfg_t zb_nwk_cfg = ESP_ZB_ZED_CONFIG();
+    /* ED_KEEP_ALIVE, or what the leader last said, see light_link.h. */
+    zb_nwk_cfg.nwk_cfg.zed_cfg.keep_alive = light_link_keep_alive_ms();
     esp_zb_init(&zb_nwk_cfg);
     esp_zb_on_off_light_cfg_t light_cfg = ESP_ZB_DEFAULT_ON_OFF_LIGHT_CONFIG();
     esp_zb_ep_list_t *esp_zb_on_off_light_ep = esp_zb_on_off_light_ep_create(HA_ESP_LIGHT_ENDPOINT, &light_cfg);
@@ -188,8 +329,36 @@ static void esp_zb_task(void *pvParameters)
     };
 
     esp_zcl_utility_add_ep_basic_manufacturer_info(esp_zb_on_off_light_ep, HA_ESP_LIGHT_ENDPOINT, &info);
+    uint8_t effect_type = LED_EFFECT_NONE;
+    esp_zb_attribute_list_t *effects_cluster = esp_zb_zcl_attr_list_create(LED_EFFECTS_CLUSTER_ID);
+    esp_zb_custom_cluster_add_custom_attr(effects_cluster, LED_EFFECTS_ATTR_TYPE_ID, ESP_ZB_ZCL_ATTR_TYPE_U8,
+                                          ESP_ZB_ZCL_ATTR_ACCESS_READ_ONLY | ESP_ZB_ZCL_ATTR_ACCESS_REPORTING, &effect_type);
+    esp_zb_cluster_list_add_custom_cluster(esp_zb_ep_list_get_ep(esp_zb_on_off_light_ep, HA_ESP_LIGHT_ENDPOINT), effects_cluster,
+                                           ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    /* The client of the leader's OTA upgrade cluster, see light_ota.h.
+     * The server is found by the image notify. */
+    esp_zb_ota_cluster_cfg_t ota_cfg = {
+        .ota_upgrade_file_version = LIGHT_OTA_FILE_VERSION,
+        .ota_upgrade_manufacturer = LIGHT_OTA_MANUFACTURER_CODE,
+        .ota_upgrade_image_type = LIGHT_OTA_IMAGE_TYPE,
+        .ota_upgrade_downloaded_file_ver = LIGHT_OTA_FILE_VERSION,
+    };
+    esp_zb_attribute_list_t *ota_cluster = esp_zb_ota_cluster_create(&ota_cfg);
+    esp_zb_zcl_ota_upgrade_client_variable_t ota_client_variable = {
+        .timer_query = LIGHT_OTA_QUERY_INTERVAL_MIN,
+        .hw_version = LIGHT_OTA_HW_VERSION,
+        .max_data_size = LIGHT_OTA_BLOCK_SIZE,
+    };
+    uint16_t ota_server_addr = ESP_ZB_ZCL_OTA_UPGRADE_SERVER_ADDR_DEF_VALUE;
+    uint8_t ota_server_endpoint = ESP_ZB_ZCL_OTA_UPGRADE_SERVER_ENDPOINT_DEF_VALUE;
+    esp_zb_ota_cluster_add_attr(ota_cluster, ESP_ZB_ZCL_ATTR_OTA_UPGRADE_CLIENT_DATA_ID, &ota_client_variable);
+    esp_zb_ota_cluster_add_attr(ota_cluster, ESP_ZB_ZCL_ATTR_OTA_UPGRADE_SERVER_ADDR_ID, &ota_server_addr);
+    esp_zb_ota_cluster_add_attr(ota_cluster, ESP_ZB_ZCL_ATTR_OTA_UPGRADE_SERVER_ENDPOINT_ID, &ota_server_endpoint);
+    esp_zb_cluster_list_add_ota_cluster(esp_zb_ep_list_get_ep(esp_zb_on_off_light_ep, HA_ESP_LIGHT_ENDPOINT), ota_cluster,
+                                        ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
     esp_zb_device_register(esp_zb_on_off_light_ep);
     esp_zb_core_action_handler_register(zb_action_handler);
+    esp_zb_aps_data_indication_handler_register(zb_aps_data_indication_handler);
     esp_zb_set_primary_network_channel_set(ESP_ZB_PRIMARY_CHANNEL_MASK);
     ESP_ERROR_CHECK(esp_zb_start(false));
     esp_zb_stack_main_loop();
@@ -206,6 +375,10 @@ void app_main(void)
         .host_config = ESP_ZB_DEFAULT_HOST_CONFIG(),
     };
     ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(light_scenes_init());
+    ESP_ERROR_CHECK(light_link_init(ED_KEEP_ALIVE));
+    ESP_ERROR_CHECK(bulk_receiver_init(bulk_handler));
+    ESP_ERROR_CHECK(light_sync_init(sync_on_off));
     ESP_ERROR_CHECK(esp_zb_platform_config(&config));
     xTaskCreate(esp_zb_task, "Zigbee_main", 4096, NULL, 5, NULL);
 }
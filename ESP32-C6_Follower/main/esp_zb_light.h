@@ -22,8 +22,15 @@
  * INCLUDES
  *############################################################*/
 
+#include "bulk_receiver.h"
 #include "esp_zigbee_core.h"
 #include "light_driver.h"
+#include "light_latency.h"
+#include "light_link.h"
+#include "light_ota.h"
+#include "light_scenes.h"
+#include "light_stress.h"
+#include "light_sync.h"
 #include "zcl_utility.h"
 
 /*##############################################################
@@ -37,6 +44,11 @@
 #define HA_ESP_LIGHT_ENDPOINT 10                                         /* esp light bulb device endpoint, used to process light controlling commands */
 #define ESP_ZB_PRIMARY_CHANNEL_MASK ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK /* Zigbee primary channel mask use in the example */
 
+/* LED effects cluster (manufacturer-specific, must match the leader) */
+#define LED_EFFECTS_CLUSTER_ID 0xFC00   /* private cluster carrying LED effect commands */
+#define LED_EFFECTS_CMD_START_ID 0x00   /* payload: octet string of led_effects_params_to_bytes() */
+#define LED_EFFECTS_ATTR_TYPE_ID 0x0000 /* the effect that is currently selected */
+
 /* Basic manufacturer information */
 #define ESP_MANUFACTURER_NAME "\x09" \
                               "ESPRESSIF"             /* Customized manufacturer name */
@@ -46,6 +46,7 @@
  *############################################################*/
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "led_strip.h"
 #include "light_driver.h"
 
@@ -54,7 +55,11 @@
  *############################################################*/
 
 static led_strip_handle_t s_led_strip;
-static uint8_t s_red = 8, s_green = 8, s_blue = 8;
+static uint8_t s_red = 255, s_green = 255, s_blue = 255;
+static bool s_power = false;
+static led_effect_params_t s_effect = {.type = LED_EFFECT_NONE};
+/* When the strip last showed a new power state. */
+static int64_t s_refreshed_us = 0;
 
 /*##############################################################
  * FUNCTIONS
@@ -66,8 +71,58 @@ static uint8_t s_red = 8, s_green = 8, s_blue = 8;
 
 void light_driver_set_power(bool power)
 {
+    s_power = power;
+    if (power && s_effect.type != LED_EFFECT_NONE)
+    {
+        /* The render task draws the first frame right after, close
+         * enough for timing. */
+        ESP_ERROR_CHECK(led_effects_start(&s_effect));
+        s_refreshed_us = esp_timer_get_time();
+        return;
+    }
+    /* Stop any effect before drawing on the strip directly. */
+    led_effects_stop();
     ESP_ERROR_CHECK(led_strip_set_pixel(s_led_strip, 0, s_red * power, s_green * power, s_blue * power));
     ESP_ERROR_CHECK(led_strip_refresh(s_led_strip));
+    s_refreshed_us = esp_timer_get_time();
+}
+
+/*--------------------------------------------------------------
+ * light_driver_set_effect()
+ *------------------------------------------------------------*/
+
+void light_driver_set_effect(const led_effect_params_t *params)
+{
+    s_effect = *params;
+    /* Only show the effect if the light is on. */
+    light_driver_set_power(s_power);
+}
+
+/*--------------------------------------------------------------
+ * light_driver_get_power()
+ *------------------------------------------------------------*/
+
+bool light_driver_get_power(void)
+{
+    return s_power;
+}
+
+/*--------------------------------------------------------------
+ * light_driver_get_effect()
+ *------------------------------------------------------------*/
+
+void light_driver_get_effect(led_effect_params_t *params)
+{
+    *params = s_effect;
+}
+
+/*--------------------------------------------------------------
+ * light_driver_get_refreshed_us()
+ *------------------------------------------------------------*/
+
+int64_t light_driver_get_refreshed_us(void)
+{
+    return s_refreshed_us;
 }
 
 /*--------------------------------------------------------------
@@ -84,5 +139,14 @@ void light_driver_init(bool power)
         .resolution_hz = 10 * 1000 * 1000, // 10MHz
     };
     ESP_ERROR_CHECK(led_strip_new_rmt_device(&led_strip_conf, &rmt_conf, &s_led_strip));
+    ESP_ERROR_CHECK(led_strip_set_gamma(s_led_strip, LIGHT_STRIP_GAMMA));
+    ESP_ERROR_CHECK(led_strip_set_brightness(s_led_strip, LIGHT_STRIP_BRIGHTNESS));
+    led_effects_config_t effects_conf = {
+        .strip = s_led_strip,
+        .led_count = CONFIG_EXAMPLE_STRIP_LED_NUMBER,
+        .fps = LIGHT_EFFECTS_FPS,
+        .task_priority = LIGHT_EFFECTS_TASK_PRIORITY,
+    };
+    ESP_ERROR_CHECK(led_effects_init(&effects_conf));
     light_driver_set_power(power);
 }
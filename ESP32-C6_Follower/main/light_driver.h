@@ -48,6 +48,9 @@
  *############################################################*/
 
 #include <stdbool.h>
+#include <stdint.h>
+
+#include "led_effects.h"
 
 #ifdef __cplusplus
 extern "C"
@@ -65,6 +68,14 @@ extern "C"
 /* LED strip configuration */
 #define CONFIG_EXAMPLE_STRIP_LED_GPIO 8
 #define CONFIG_EXAMPLE_STRIP_LED_NUMBER 1
+/* Applied by the LED strip driver while encoding, so colours stay
+ * linear and full scale. */
+#define LIGHT_STRIP_BRIGHTNESS 8
+#define LIGHT_STRIP_GAMMA 2.2f
+
+/* LED effects configuration */
+#define LIGHT_EFFECTS_FPS LED_EFFECTS_DEFAULT_FPS
+#define LIGHT_EFFECTS_TASK_PRIORITY 4
 
 /*##############################################################
  * FUNCTION PROTOTYPES
@@ -81,6 +92,43 @@ extern "C"
  */
 void light_driver_set_power(bool power);
 
+/*--------------------------------------------------------------
+ * light_driver_set_effect()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Run an LED effect. The effect is remembered, so turning the
+ * light off and on again resumes it.
+ *
+ * @param  params  The effect to run, or LED_EFFECT_NONE for a static light
+ */
+void light_driver_set_effect(const led_effect_params_t *params);
+
+/*--------------------------------------------------------------
+ * light_driver_get_power()
+ *------------------------------------------------------------*/
+
+bool light_driver_get_power(void);
+
+/*--------------------------------------------------------------
+ * light_driver_get_effect()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Get the remembered effect, even if the light is off.
+ */
+void light_driver_get_effect(led_effect_params_t *params);
+
+/*--------------------------------------------------------------
+ * light_driver_get_refreshed_us()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Get when light_driver_set_power() last finished refreshing
+ * the strip, in esp_timer_get_time() microseconds.
+ */
+int64_t light_driver_get_refreshed_us(void);
+
 /*--------------------------------------------------------------
  * light_driver_init()
  *------------------------------------------------------------*/
@@ -0,0 +1,99 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of the latency measurement. See
+ * light_latency.h.
+ *
+ * Notes:
+ *     - Only the Zigbee task calls these functions, so there is no
+ *       lock.
+ *     - Reports go without an APS acknowledgement. A lost report is
+ *       counted as lost by the leader, retrying it would only skew
+ *       the numbers. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_log.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "bulk_receiver.h"
+#include "light_latency.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "LIGHT_LATENCY";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static bool s_enabled = false;
+static uint16_t s_leader_short_addr;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_latency_handle_indication()
+ *------------------------------------------------------------*/
+
+bool light_latency_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != BULK_PROFILE_ID || ind->cluster_id != LATENCY_CLUSTER_ID || ind->dst_endpoint != BULK_ENDPOINT)
+    {
+        return false;
+    }
+    if (ind->asdu_length >= 2 && ind->asdu[0] == LATENCY_FRAME_MODE)
+    {
+        s_enabled = ind->asdu[1] != 0;
+        s_leader_short_addr = ind->src_short_addr;
+        ESP_LOGI(TAG, "Latency reports %s", s_enabled ? "on" : "off");
+    }
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * light_latency_report()
+ *------------------------------------------------------------*/
+
+void light_latency_report(int64_t received_us, int64_t refreshed_us)
+{
+    if (!s_enabled || refreshed_us < received_us)
+    {
+        return;
+    }
+    uint32_t latency_us = (uint32_t)(refreshed_us - received_us);
+    uint8_t frame[] = {
+        LATENCY_FRAME_REPORT,
+        (uint8_t)(latency_us), (uint8_t)(latency_us >> 8), (uint8_t)(latency_us >> 16), (uint8_t)(latency_us >> 24),
+    };
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = s_leader_short_addr,
+        .dst_endpoint = BULK_ENDPOINT,
+        .profile_id = BULK_PROFILE_ID,
+        .cluster_id = LATENCY_CLUSTER_ID,
+        .src_endpoint = BULK_ENDPOINT,
+        .asdu_length = sizeof(frame),
+        .asdu = frame,
+    };
+    if (esp_zb_aps_data_request(&req) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to send latency report");
+    }
+}
@@ -0,0 +1,67 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of the leader's latency
+ * measurement. While the leader asks for it, the time from receiving
+ * each on/off command to the LED refresh is reported back. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* On the bulk endpoint and profile (bulk_receiver.h). Must match
+ * zb_latency.h on the leader. */
+#define LATENCY_CLUSTER_ID 0x0002
+#define LATENCY_FRAME_MODE 0
+#define LATENCY_FRAME_REPORT 1
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_latency_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take the leader's latency mode frames out of the incoming
+ * APS frames.
+ *
+ * @return true if the frame was for us.
+ */
+bool light_latency_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * light_latency_report()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Report one command to the leader, if it asked for reports.
+ *
+ * @param received_us When the command was received.
+ * @param refreshed_us When the LED showed it.
+ */
+void light_latency_report(int64_t received_us, int64_t refreshed_us);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
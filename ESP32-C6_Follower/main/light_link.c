@@ -0,0 +1,172 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of background frame tuning. See
+ * light_link.h.
+ *
+ * Notes:
+ *     - Only the Zigbee task calls these functions after
+ *       light_link_init(), so there is no lock.
+ *     - esp-zigbee-lib only takes the keep-alive in esp_zb_init().
+ *       It hands it to ZBOSS's zb_set_keepalive_timeout() in system
+ *       timer units, microseconds on this target, and that is what
+ *       is called here to change it on the fly. The new interval
+ *       is used from the next keep-alive ZBOSS schedules. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "bulk_receiver.h"
+#include "light_link.h"
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/* Declared in ZBOSS's zboss_api.h, which the rest of the project
+ * keeps out of sight behind the esp-zigbee-lib API. */
+extern void zb_set_keepalive_timeout(unsigned int to);
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "LIGHT_LINK";
+static const char *NVS_NAMESPACE = "light";
+static const char *NVS_KEY = "keep_alive";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static uint32_t s_keep_alive_ms;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * keep_alive_save()
+ *------------------------------------------------------------*/
+
+static esp_err_t keep_alive_save(uint32_t keep_alive_ms)
+{
+    nvs_handle_t handle;
+    ESP_RETURN_ON_ERROR(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle), TAG, "Failed to open NVS");
+    esp_err_t err = nvs_set_u32(handle, NVS_KEY, keep_alive_ms);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to save the keep-alive");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * light_link_init()
+ *------------------------------------------------------------*/
+
+esp_err_t light_link_init(uint32_t default_keep_alive_ms)
+{
+    s_keep_alive_ms = default_keep_alive_ms;
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        /* Nothing saved yet. */
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to open NVS");
+
+    uint32_t keep_alive_ms = 0;
+    err = nvs_get_u32(handle, NVS_KEY, &keep_alive_ms);
+    nvs_close(handle);
+    if (err == ESP_OK && keep_alive_ms >= LIGHT_LINK_MIN_KEEP_ALIVE_MS && keep_alive_ms <= LIGHT_LINK_MAX_KEEP_ALIVE_MS)
+    {
+        s_keep_alive_ms = keep_alive_ms;
+        ESP_LOGI(TAG, "Keep-alive %" PRIu32 " ms, as the leader last said", s_keep_alive_ms);
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * light_link_keep_alive_ms()
+ *------------------------------------------------------------*/
+
+uint32_t light_link_keep_alive_ms(void)
+{
+    return s_keep_alive_ms;
+}
+
+/*--------------------------------------------------------------
+ * light_link_handle_indication()
+ *------------------------------------------------------------*/
+
+bool light_link_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != BULK_PROFILE_ID || ind->cluster_id != LINK_CLUSTER_ID || ind->dst_endpoint != BULK_ENDPOINT)
+    {
+        return false;
+    }
+    if (ind->asdu_length < LINK_FRAME_SIZE || ind->asdu[0] != LINK_FRAME_KEEP_ALIVE)
+    {
+        return true;
+    }
+
+    const uint8_t *bytes = &ind->asdu[1];
+    uint32_t keep_alive_ms = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    keep_alive_ms = keep_alive_ms < LIGHT_LINK_MIN_KEEP_ALIVE_MS ? LIGHT_LINK_MIN_KEEP_ALIVE_MS : keep_alive_ms;
+    keep_alive_ms = keep_alive_ms > LIGHT_LINK_MAX_KEEP_ALIVE_MS ? LIGHT_LINK_MAX_KEEP_ALIVE_MS : keep_alive_ms;
+    if (keep_alive_ms != s_keep_alive_ms)
+    {
+        zb_set_keepalive_timeout(keep_alive_ms * 1000);
+        keep_alive_save(keep_alive_ms);
+        ESP_LOGI(TAG, "Keep-alive %" PRIu32 " ms, was %" PRIu32 " ms", keep_alive_ms, s_keep_alive_ms);
+        s_keep_alive_ms = keep_alive_ms;
+    }
+
+    uint8_t frame[] = {
+        LINK_FRAME_APPLIED,
+        (uint8_t)(keep_alive_ms), (uint8_t)(keep_alive_ms >> 8), (uint8_t)(keep_alive_ms >> 16), (uint8_t)(keep_alive_ms >> 24),
+    };
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = ind->src_short_addr,
+        .dst_endpoint = BULK_ENDPOINT,
+        .profile_id = BULK_PROFILE_ID,
+        .cluster_id = LINK_CLUSTER_ID,
+        .src_endpoint = BULK_ENDPOINT,
+        .asdu_length = sizeof(frame),
+        .asdu = frame,
+        /* A lost answer has the leader ask again. */
+        .tx_options = ESP_ZB_APSDE_TX_OPT_ACK_TX,
+    };
+    if (esp_zb_aps_data_request(&req) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to answer the keep-alive");
+    }
+    return true;
+}
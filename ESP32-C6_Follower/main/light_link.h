@@ -0,0 +1,84 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of background frame tuning. The
+ * leader tells the light how often to send its keep-alive to its
+ * parent. The light applies it at once, keeps it for the next boot
+ * and answers with what it applied. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* On the bulk endpoint and profile (bulk_receiver.h). Must match
+ * zb_link_tuning.h on the leader, which describes the frames. */
+#define LINK_CLUSTER_ID 0x0005
+#define LINK_FRAME_KEEP_ALIVE 0
+#define LINK_FRAME_APPLIED 1
+#define LINK_FRAME_SIZE 5
+
+/* Keep-alive intervals the light takes. The most stays well inside
+ * the end device timeout, past which the parent forgets the light. */
+#define LIGHT_LINK_MIN_KEEP_ALIVE_MS 1000
+#define LIGHT_LINK_MAX_KEEP_ALIVE_MS (60 * 1000)
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_link_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Load the keep-alive saved by the last boot, if any. Call
+ * after nvs_flash_init().
+ *
+ * @param default_keep_alive_ms Used until the leader says otherwise.
+ */
+esp_err_t light_link_init(uint32_t default_keep_alive_ms);
+
+/*--------------------------------------------------------------
+ * light_link_keep_alive_ms()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief The keep-alive to start the stack with.
+ */
+uint32_t light_link_keep_alive_ms(void);
+
+/*--------------------------------------------------------------
+ * light_link_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Apply the keep-alive the leader sends among the incoming
+ * APS frames.
+ *
+ * @return true if the frame was for us.
+ */
+bool light_link_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,187 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's OTA upgrade client. See light_ota.h.
+ *
+ * Notes:
+ *     - Only the Zigbee task calls these functions, so there is no
+ *       lock.
+ *     - The stack has already taken the OTA header off, the blocks
+ *       start with the first tag. Tags other than the upgrade image
+ *       are skipped.
+ *     - esp_ota_end() checks the image, so a broken transfer never
+ *       gets booted. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "light_ota.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "LIGHT_OTA";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static const esp_partition_t *s_partition = NULL;
+static esp_ota_handle_t s_handle = 0;
+static int64_t s_start_us;
+
+/* The tag being read. */
+static uint8_t s_tag_header[LIGHT_OTA_TAG_HEADER_SIZE];
+static uint8_t s_tag_header_length;
+static uint16_t s_tag_id;
+static uint32_t s_tag_left;
+
+/* Of the upgrade image tag. */
+static uint32_t s_image_size;
+static uint32_t s_image_written;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * ota_receive()
+ *------------------------------------------------------------*/
+
+static esp_err_t ota_receive(const uint8_t *payload, uint16_t size)
+{
+    while (size > 0)
+    {
+        if (s_tag_header_length < LIGHT_OTA_TAG_HEADER_SIZE)
+        {
+            s_tag_header[s_tag_header_length++] = *payload++;
+            size--;
+            if (s_tag_header_length == LIGHT_OTA_TAG_HEADER_SIZE)
+            {
+                s_tag_id = s_tag_header[0] | (s_tag_header[1] << 8);
+                s_tag_left = s_tag_header[2] | (s_tag_header[3] << 8) | (s_tag_header[4] << 16) | ((uint32_t)s_tag_header[5] << 24);
+                if (s_tag_id == LIGHT_OTA_TAG_UPGRADE_IMAGE)
+                {
+                    s_image_size = s_tag_left;
+                }
+            }
+            continue;
+        }
+
+        uint16_t length = size < s_tag_left ? size : (uint16_t)s_tag_left;
+        if (s_tag_id == LIGHT_OTA_TAG_UPGRADE_IMAGE)
+        {
+            ESP_RETURN_ON_ERROR(esp_ota_write(s_handle, payload, length), TAG, "Failed to write the image");
+            s_image_written += length;
+        }
+        payload += length;
+        size -= length;
+        s_tag_left -= length;
+        if (s_tag_left == 0)
+        {
+            s_tag_header_length = 0;
+        }
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * ota_abort()
+ *------------------------------------------------------------*/
+
+static void ota_abort(void)
+{
+    if (s_handle)
+    {
+        esp_ota_abort(s_handle);
+        s_handle = 0;
+    }
+}
+
+/*--------------------------------------------------------------
+ * light_ota_handle_value()
+ *------------------------------------------------------------*/
+
+esp_err_t light_ota_handle_value(const esp_zb_zcl_ota_upgrade_value_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
+                        message->info.status);
+    esp_err_t ret = ESP_OK;
+    switch (message->upgrade_status)
+    {
+    case ESP_ZB_ZCL_OTA_UPGRADE_STATUS_START:
+        ota_abort();
+        s_partition = esp_ota_get_next_update_partition(NULL);
+        ESP_RETURN_ON_FALSE(s_partition, ESP_ERR_NOT_FOUND, TAG, "No partition to update");
+        ESP_RETURN_ON_ERROR(esp_ota_begin(s_partition, OTA_WITH_SEQUENTIAL_WRITES, &s_handle), TAG, "Failed to begin the update");
+        s_start_us = esp_timer_get_time();
+        s_tag_header_length = 0;
+        s_image_size = 0;
+        s_image_written = 0;
+        ESP_LOGI(TAG, "Upgrade to version 0x%08" PRIx32 " started, %" PRIu32 " bytes", message->ota_header.file_version,
+                 message->ota_header.image_size);
+        break;
+    case ESP_ZB_ZCL_OTA_UPGRADE_STATUS_RECEIVE:
+        ESP_RETURN_ON_FALSE(s_handle, ESP_ERR_INVALID_STATE, TAG, "Upgrade not started");
+        if (message->payload_size && message->payload)
+        {
+            ret = ota_receive(message->payload, message->payload_size);
+        }
+        break;
+    case ESP_ZB_ZCL_OTA_UPGRADE_STATUS_APPLY:
+        ESP_LOGI(TAG, "Applying the upgrade");
+        break;
+    case ESP_ZB_ZCL_OTA_UPGRADE_STATUS_CHECK:
+        ret = s_image_size > 0 && s_image_written == s_image_size ? ESP_OK : ESP_ERR_INVALID_SIZE;
+        ESP_LOGI(TAG, "Received %" PRIu32 " of %" PRIu32 " image bytes in %" PRId64 " ms", s_image_written, s_image_size,
+                 (esp_timer_get_time() - s_start_us) / 1000);
+        break;
+    case ESP_ZB_ZCL_OTA_UPGRADE_STATUS_FINISH:
+        ESP_RETURN_ON_FALSE(s_handle, ESP_ERR_INVALID_STATE, TAG, "Upgrade not started");
+        ret = esp_ota_end(s_handle);
+        s_handle = 0;
+        ESP_RETURN_ON_ERROR(ret, TAG, "The image failed its check");
+        ESP_RETURN_ON_ERROR(esp_ota_set_boot_partition(s_partition), TAG, "Failed to set the boot partition");
+        ESP_LOGI(TAG, "Upgrade done in %" PRId64 " ms, restarting", (esp_timer_get_time() - s_start_us) / 1000);
+        esp_restart();
+        break;
+    case ESP_ZB_ZCL_OTA_UPGRADE_STATUS_ABORT:
+        ESP_LOGW(TAG, "Upgrade aborted after %" PRIu32 " image bytes", s_image_written);
+        ota_abort();
+        break;
+    default:
+        ESP_LOGI(TAG, "OTA status %d", message->upgrade_status);
+        break;
+    }
+    if (ret != ESP_OK)
+    {
+        ota_abort();
+    }
+    return ret;
+}
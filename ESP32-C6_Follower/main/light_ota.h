@@ -0,0 +1,69 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's OTA upgrade client. The leader serves
+ * follower images (zb_ota_server.h on the leader), this writes one
+ * to the other app partition as it arrives, checks it, and boots
+ * it. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* The follower image. Must match zb_ota_server.h on the leader. */
+#define LIGHT_OTA_MANUFACTURER_CODE 0x131B
+#define LIGHT_OTA_IMAGE_TYPE 0x1011
+/* The version of this firmware. Raise it for every image sent out,
+ * the leader only offers an image to lights running another
+ * version. */
+#define LIGHT_OTA_FILE_VERSION 0x00000001
+#define LIGHT_OTA_HW_VERSION 0x0001
+
+/* Image bytes asked for at a time. Like a bulk fragment
+ * (bulk_receiver.h), this keeps a block within one 802.15.4 frame. */
+#define LIGHT_OTA_BLOCK_SIZE 64
+/* Minutes between asking the leader for a new image, besides when
+ * it says it has one. */
+#define LIGHT_OTA_QUERY_INTERVAL_MIN 60
+
+/* After the OTA header, the image is a list of tags: an ID (2) and a
+ * length (4), little-endian, then that many bytes. The firmware is
+ * the upgrade image tag. */
+#define LIGHT_OTA_TAG_HEADER_SIZE 6
+#define LIGHT_OTA_TAG_UPGRADE_IMAGE 0x0000
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_ota_handle_value()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Follow an upgrade through. Call it for
+ * ESP_ZB_CORE_OTA_UPGRADE_VALUE_CB_ID. Restarts into the new image
+ * once it is complete.
+ */
+esp_err_t light_ota_handle_value(const esp_zb_zcl_ota_upgrade_value_message_t *message);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,172 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's scene table. See light_scenes.h.
+ *
+ * Notes:
+ *     - Only the Zigbee task calls these functions, so there is no
+ *       lock.
+ *     - The table is one NVS blob, rewritten on every store. Scenes
+ *       are stored rarely and recalled often, and recalling never
+ *       writes. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <stdbool.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "light_driver.h"
+#include "light_scenes.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool in_use;
+    uint16_t group_id;
+    uint8_t scene_id;
+    bool power;
+    led_effect_params_t effect;
+} light_scene_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "LIGHT_SCENES";
+static const char *NVS_NAMESPACE = "light";
+static const char *NVS_KEY = "scenes";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static light_scene_t s_scenes[LIGHT_SCENES_CAPACITY];
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * find_scene()
+ *------------------------------------------------------------*/
+
+static light_scene_t *find_scene(uint16_t group_id, uint8_t scene_id)
+{
+    for (int i = 0; i < LIGHT_SCENES_CAPACITY; i++)
+    {
+        light_scene_t *scene = &s_scenes[i];
+        if (scene->in_use && scene->group_id == group_id && scene->scene_id == scene_id)
+        {
+            return scene;
+        }
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------
+ * light_scenes_init()
+ *------------------------------------------------------------*/
+
+esp_err_t light_scenes_init(void)
+{
+    memset(s_scenes, 0, sizeof(s_scenes));
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        /* Nothing saved yet. */
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to open NVS");
+
+    size_t size = sizeof(s_scenes);
+    err = nvs_get_blob(handle, NVS_KEY, s_scenes, &size);
+    nvs_close(handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ESP_OK;
+    }
+    if (err != ESP_OK || size != sizeof(s_scenes))
+    {
+        /* Saved by a different layout. Start over rather than apply
+         * garbage. */
+        memset(s_scenes, 0, sizeof(s_scenes));
+        ESP_LOGW(TAG, "Discarded saved scenes (%s)", esp_err_to_name(err));
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * light_scenes_store()
+ *------------------------------------------------------------*/
+
+esp_err_t light_scenes_store(uint16_t group_id, uint8_t scene_id)
+{
+    light_scene_t *scene = find_scene(group_id, scene_id);
+    for (int i = 0; scene == NULL && i < LIGHT_SCENES_CAPACITY; i++)
+    {
+        if (!s_scenes[i].in_use)
+        {
+            scene = &s_scenes[i];
+        }
+    }
+    ESP_RETURN_ON_FALSE(scene, ESP_ERR_NO_MEM, TAG, "Scene table full");
+
+    scene->in_use = true;
+    scene->group_id = group_id;
+    scene->scene_id = scene_id;
+    scene->power = light_driver_get_power();
+    light_driver_get_effect(&scene->effect);
+
+    nvs_handle_t handle;
+    ESP_RETURN_ON_ERROR(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle), TAG, "Failed to open NVS");
+    esp_err_t err = nvs_set_blob(handle, NVS_KEY, s_scenes, sizeof(s_scenes));
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to save scenes");
+    ESP_LOGI(TAG, "Stored scene %u of group 0x%04x (%s, %s)", scene_id, group_id, scene->power ? "on" : "off",
+             led_effects_type_to_string(scene->effect.type));
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * light_scenes_recall()
+ *------------------------------------------------------------*/
+
+esp_err_t light_scenes_recall(uint16_t group_id, uint8_t scene_id)
+{
+    light_scene_t *scene = find_scene(group_id, scene_id);
+    ESP_RETURN_ON_FALSE(scene, ESP_ERR_NOT_FOUND, TAG, "No scene %u of group 0x%04x", scene_id, group_id);
+    /* Set the effect first, so the light comes on with it. */
+    light_driver_set_effect(&scene->effect);
+    light_driver_set_power(scene->power);
+    ESP_LOGI(TAG, "Recalled scene %u of group 0x%04x", scene_id, group_id);
+    return ESP_OK;
+}
@@ -0,0 +1,72 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's scene table. The stack's scenes cluster
+ * only keeps attributes of standard clusters, so it cannot recall an
+ * LED effect. This table keeps the whole light state (power and
+ * effect) per scene, and is applied when the leader stores or
+ * recalls a scene. It is saved to NVS, like the stack's own scenes. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define LIGHT_SCENES_CAPACITY 16
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_scenes_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Load the saved scenes. Call after nvs_flash_init().
+ */
+esp_err_t light_scenes_init(void);
+
+/*--------------------------------------------------------------
+ * light_scenes_store()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Save the current light state as a scene, replacing it if it
+ * exists.
+ *
+ * @return ESP_ERR_NO_MEM if the table is full.
+ */
+esp_err_t light_scenes_store(uint16_t group_id, uint8_t scene_id);
+
+/*--------------------------------------------------------------
+ * light_scenes_recall()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Apply a scene to the light.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no such scene.
+ */
+esp_err_t light_scenes_recall(uint16_t group_id, uint8_t scene_id);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
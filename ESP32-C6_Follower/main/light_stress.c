@@ -0,0 +1,99 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of the capacity test. See
+ * light_stress.h.
+ *
+ * Notes:
+ *     - Only the Zigbee task calls these functions, so there is no
+ *       lock.
+ *     - The count is never reset, the leader takes the difference.
+ *       A reset could arrive after the first commands of a run. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <stdint.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_log.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "bulk_receiver.h"
+#include "light_stress.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "LIGHT_STRESS";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static uint32_t s_count = 0;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_stress_handle_indication()
+ *------------------------------------------------------------*/
+
+bool light_stress_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != BULK_PROFILE_ID || ind->cluster_id != STRESS_CLUSTER_ID || ind->dst_endpoint != BULK_ENDPOINT)
+    {
+        return false;
+    }
+    if (ind->asdu_length < 1 || ind->asdu[0] != STRESS_FRAME_QUERY)
+    {
+        return true;
+    }
+    uint8_t frame[] = {
+        STRESS_FRAME_COUNT,
+        (uint8_t)(s_count), (uint8_t)(s_count >> 8), (uint8_t)(s_count >> 16), (uint8_t)(s_count >> 24),
+    };
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = ind->src_short_addr,
+        .dst_endpoint = BULK_ENDPOINT,
+        .profile_id = BULK_PROFILE_ID,
+        .cluster_id = STRESS_CLUSTER_ID,
+        .src_endpoint = BULK_ENDPOINT,
+        .asdu_length = sizeof(frame),
+        .asdu = frame,
+        /* A lost count leaves the light out of the whole run. */
+        .tx_options = ESP_ZB_APSDE_TX_OPT_ACK_TX,
+    };
+    if (esp_zb_aps_data_request(&req) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to send the count");
+    }
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * light_stress_count()
+ *------------------------------------------------------------*/
+
+void light_stress_count(void)
+{
+    s_count++;
+}
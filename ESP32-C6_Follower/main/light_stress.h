@@ -0,0 +1,63 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of the leader's capacity test. The
+ * light counts every on/off command it receives and reports the
+ * count when the leader asks, before and after a run. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* On the bulk endpoint and profile (bulk_receiver.h). Must match
+ * zb_stress.h on the leader. */
+#define STRESS_CLUSTER_ID 0x0003
+#define STRESS_FRAME_QUERY 0
+#define STRESS_FRAME_COUNT 1
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_stress_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Answer the leader's counter queries among the incoming APS
+ * frames.
+ *
+ * @return true if the frame was for us.
+ */
+bool light_stress_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * light_stress_count()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Count one on/off command.
+ */
+void light_stress_count(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
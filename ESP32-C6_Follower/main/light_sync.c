@@ -0,0 +1,437 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of the shared time base. See
+ * light_sync.h.
+ *
+ * Notes:
+ *     - The leader's clock is modelled as ours plus an offset, which
+ *       grows by the measured drift. Both are taken from the exchange
+ *       with the shortest round trip of a round, and the drift from
+ *       how far the offset moved since the round before.
+ *     - Rounds and scheduled actions come in on the Zigbee task. The
+ *       action itself is carried out by a task of our own, woken by a
+ *       one-shot esp_timer, so it does not wait on the Zigbee task's
+ *       other work. The clock and the pending action are shared
+ *       between the two, so they have a lock. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "bulk_receiver.h"
+#include "light_sync.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool synced;
+    /* Leader time minus ours at `ref_us`, our time. */
+    int64_t offset_us;
+    int64_t ref_us;
+    /* How much faster the leader's clock runs, in parts per billion. */
+    int32_t drift_ppb;
+    /* Half the shortest round trip, as far as the offset may be off. */
+    uint32_t error_us;
+} sync_clock_t;
+
+typedef struct
+{
+    uint16_t action_id;
+    bool on;
+    uint8_t status;
+    /* When to carry it out, our time. */
+    int64_t at_us;
+} action_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "LIGHT_SYNC";
+
+/* The leader is the coordinator. */
+static const uint16_t LEADER_SHORT_ADDR = 0x0000;
+
+/* Time to the next round when a round got no answer. */
+static const uint32_t RETRY_MS = 1000;
+
+/* The least time between rounds to measure drift over. */
+static const int64_t DRIFT_MIN_SPAN_US = 10 * 1000 * 1000;
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* Guards the clock and the pending action. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static sync_clock_t s_clock;
+static action_t s_action;
+
+static light_sync_on_off_cb_t s_on_off;
+static TaskHandle_t s_task;
+static esp_timer_handle_t s_timer;
+
+/* The round in progress. Only the Zigbee task touches these. */
+static uint32_t s_samples_sent;
+static int64_t s_request_us;
+static int64_t s_best_rtt_us;
+static int64_t s_best_offset_us;
+static int64_t s_best_local_us;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * read_u16()
+ *------------------------------------------------------------*/
+
+static uint16_t read_u16(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+/*--------------------------------------------------------------
+ * read_u32()
+ *------------------------------------------------------------*/
+
+static uint32_t read_u32(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/*--------------------------------------------------------------
+ * read_u64()
+ *------------------------------------------------------------*/
+
+static uint64_t read_u64(const uint8_t *bytes)
+{
+    return read_u32(bytes) | ((uint64_t)read_u32(bytes + 4) << 32);
+}
+
+/*--------------------------------------------------------------
+ * write_u32()
+ *------------------------------------------------------------*/
+
+static void write_u32(uint8_t *bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/*--------------------------------------------------------------
+ * write_u64()
+ *------------------------------------------------------------*/
+
+static void write_u64(uint8_t *bytes, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/*--------------------------------------------------------------
+ * to_leader()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. */
+static int64_t to_leader(int64_t local_us)
+{
+    return local_us + s_clock.offset_us + (local_us - s_clock.ref_us) * s_clock.drift_ppb / 1000000000;
+}
+
+/*--------------------------------------------------------------
+ * to_local()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. The drift term is worked out from
+ * the leader's time instead of ours, which is off by far less than a
+ * microsecond. */
+static int64_t to_local(int64_t leader_us)
+{
+    int64_t local_us = leader_us - s_clock.offset_us;
+    return local_us - (local_us - s_clock.ref_us) * s_clock.drift_ppb / 1000000000;
+}
+
+/*--------------------------------------------------------------
+ * send_frame()
+ *------------------------------------------------------------*/
+
+static esp_err_t send_frame(uint8_t *frame, uint32_t size, uint8_t tx_options)
+{
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = LEADER_SHORT_ADDR,
+        .dst_endpoint = BULK_ENDPOINT,
+        .profile_id = BULK_PROFILE_ID,
+        .cluster_id = SYNC_CLUSTER_ID,
+        .src_endpoint = BULK_ENDPOINT,
+        .asdu_length = size,
+        .asdu = frame,
+        .tx_options = tx_options,
+    };
+    return esp_zb_aps_data_request(&req);
+}
+
+/*--------------------------------------------------------------
+ * round_end()
+ *------------------------------------------------------------*/
+
+/* Take the best exchange of the round into the clock. */
+static void round_end(void)
+{
+    if (s_best_rtt_us == INT64_MAX)
+    {
+        ESP_LOGW(TAG, "No answer from the leader");
+        return;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    int64_t span_us = s_best_local_us - s_clock.ref_us;
+    bool drift_measured = false;
+    if (s_clock.synced && span_us >= DRIFT_MIN_SPAN_US)
+    {
+        int64_t drift_ppb = (s_best_offset_us - s_clock.offset_us) * 1000000000 / span_us;
+        if (drift_ppb >= -LIGHT_SYNC_MAX_DRIFT_PPB && drift_ppb <= LIGHT_SYNC_MAX_DRIFT_PPB)
+        {
+            /* Averaged with the last, so one unlucky round moves it
+             * only half as far. */
+            s_clock.drift_ppb = s_clock.drift_ppb ? (int32_t)((s_clock.drift_ppb + drift_ppb) / 2) : (int32_t)drift_ppb;
+            drift_measured = true;
+        }
+    }
+    s_clock.offset_us = s_best_offset_us;
+    s_clock.ref_us = s_best_local_us;
+    s_clock.error_us = (uint32_t)(s_best_rtt_us / 2);
+    s_clock.synced = true;
+    sync_clock_t clock = s_clock;
+    taskEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "SYNC offset_us=%" PRId64 " drift_ppb=%" PRId32 "%s error_us=%" PRIu32, clock.offset_us, clock.drift_ppb,
+             drift_measured ? "" : " (kept)", clock.error_us);
+}
+
+/*--------------------------------------------------------------
+ * sync_request_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, and schedules itself again. */
+static void sync_request_cb(uint8_t param)
+{
+    if (s_samples_sent == LIGHT_SYNC_SAMPLES)
+    {
+        bool answered = s_best_rtt_us != INT64_MAX;
+        round_end();
+        s_samples_sent = 0;
+        esp_zb_scheduler_alarm(sync_request_cb, 0, answered ? LIGHT_SYNC_PERIOD_MS : RETRY_MS);
+        return;
+    }
+    if (s_samples_sent == 0)
+    {
+        s_best_rtt_us = INT64_MAX;
+    }
+
+    uint8_t frame[SYNC_REQUEST_SIZE];
+    frame[0] = SYNC_FRAME_REQUEST;
+    s_request_us = esp_timer_get_time();
+    write_u64(&frame[1], (uint64_t)s_request_us);
+    /* No APS retries, a resent request would make the round trip look
+     * longer than it was. */
+    if (send_frame(frame, sizeof(frame), 0) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to send time request");
+    }
+    s_samples_sent++;
+    esp_zb_scheduler_alarm(sync_request_cb, 0, LIGHT_SYNC_SAMPLE_PERIOD_MS);
+}
+
+/*--------------------------------------------------------------
+ * handle_response()
+ *------------------------------------------------------------*/
+
+static void handle_response(const uint8_t *frame, int64_t received_us)
+{
+    int64_t t1 = (int64_t)read_u64(&frame[1]);
+    int64_t t2 = (int64_t)read_u64(&frame[9]);
+    int64_t t3 = (int64_t)read_u64(&frame[17]);
+    int64_t t4 = received_us;
+    /* Only the answer to the last request, one to an earlier one has
+     * waited through the request after it. */
+    if (t1 != s_request_us)
+    {
+        return;
+    }
+    int64_t rtt_us = (t4 - t1) - (t3 - t2);
+    if (rtt_us < 0 || rtt_us >= s_best_rtt_us)
+    {
+        return;
+    }
+    s_best_rtt_us = rtt_us;
+    s_best_offset_us = ((t2 - t1) + (t3 - t4)) / 2;
+    s_best_local_us = (t1 + t4) / 2;
+}
+
+/*--------------------------------------------------------------
+ * handle_schedule()
+ *------------------------------------------------------------*/
+
+static void handle_schedule(const uint8_t *frame, int64_t received_us)
+{
+    if (frame[11] != SYNC_ACTION_ON_OFF)
+    {
+        return;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_action.action_id = read_u16(&frame[1]);
+    s_action.on = frame[12] != 0;
+    if (s_clock.synced)
+    {
+        s_action.at_us = to_local((int64_t)read_u64(&frame[3]));
+        s_action.status = SYNC_STATUS_OK;
+    }
+    else
+    {
+        /* Nothing to time it by, so now. */
+        s_action.at_us = received_us;
+        s_action.status = SYNC_STATUS_NOT_SYNCED;
+    }
+    int64_t delay_us = s_action.at_us - esp_timer_get_time();
+    taskEXIT_CRITICAL(&s_lock);
+
+    /* Replaces an action still waiting, if any. */
+    esp_timer_stop(s_timer);
+    esp_timer_start_once(s_timer, delay_us > 0 ? (uint64_t)delay_us : 1);
+}
+
+/*--------------------------------------------------------------
+ * action_timer_cb()
+ *------------------------------------------------------------*/
+
+static void action_timer_cb(void *arg)
+{
+    xTaskNotifyGive(s_task);
+}
+
+/*--------------------------------------------------------------
+ * action_task()
+ *------------------------------------------------------------*/
+
+static void action_task(void *pvParameters)
+{
+    while (true)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        esp_zb_lock_acquire(portMAX_DELAY);
+        taskENTER_CRITICAL(&s_lock);
+        action_t action = s_action;
+        taskEXIT_CRITICAL(&s_lock);
+        int64_t executed_us = s_on_off(action.on);
+
+        taskENTER_CRITICAL(&s_lock);
+        int64_t executed_leader_us = s_clock.synced ? to_leader(executed_us) : 0;
+        uint32_t error_us = s_clock.error_us;
+        taskEXIT_CRITICAL(&s_lock);
+        int32_t late_us = (int32_t)(executed_us - action.at_us);
+
+        uint8_t frame[SYNC_EXECUTED_SIZE];
+        frame[0] = SYNC_FRAME_EXECUTED;
+        frame[1] = (uint8_t)action.action_id;
+        frame[2] = (uint8_t)(action.action_id >> 8);
+        write_u64(&frame[3], (uint64_t)executed_leader_us);
+        write_u32(&frame[11], (uint32_t)late_us);
+        write_u32(&frame[15], error_us);
+        frame[19] = action.status;
+        esp_err_t err = send_frame(frame, sizeof(frame), ESP_ZB_APSDE_TX_OPT_ACK_TX);
+        esp_zb_lock_release();
+
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Failed to report action %u", action.action_id);
+        }
+        ESP_LOGI(TAG, "SYNC_EXECUTED id=%u on=%d late_us=%" PRId32 " error_us=%" PRIu32 "%s", action.action_id, action.on, late_us,
+                 error_us, action.status == SYNC_STATUS_OK ? "" : " not_synced");
+    }
+}
+
+/*--------------------------------------------------------------
+ * light_sync_init()
+ *------------------------------------------------------------*/
+
+esp_err_t light_sync_init(light_sync_on_off_cb_t on_off)
+{
+    ESP_RETURN_ON_FALSE(on_off, ESP_ERR_INVALID_ARG, TAG, "No on/off callback");
+    s_on_off = on_off;
+    BaseType_t created = xTaskCreate(action_task, "light_sync", LIGHT_SYNC_TASK_STACK_DEPTH, NULL, LIGHT_SYNC_TASK_PRIORITY, &s_task);
+    ESP_RETURN_ON_FALSE(created == pdPASS, ESP_ERR_NO_MEM, TAG, "Failed to create the sync task");
+    return esp_timer_create(&(esp_timer_create_args_t){.callback = &action_timer_cb, .name = "light_sync"}, &s_timer);
+}
+
+/*--------------------------------------------------------------
+ * light_sync_start()
+ *------------------------------------------------------------*/
+
+void light_sync_start(void)
+{
+    esp_zb_scheduler_alarm_cancel(sync_request_cb, 0);
+    s_samples_sent = 0;
+    sync_request_cb(0);
+}
+
+/*--------------------------------------------------------------
+ * light_sync_handle_indication()
+ *------------------------------------------------------------*/
+
+bool light_sync_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    int64_t received_us = esp_timer_get_time();
+    if (ind->profile_id != BULK_PROFILE_ID || ind->cluster_id != SYNC_CLUSTER_ID || ind->dst_endpoint != BULK_ENDPOINT)
+    {
+        return false;
+    }
+    if (ind->asdu_length == SYNC_RESPONSE_SIZE && ind->asdu[0] == SYNC_FRAME_RESPONSE)
+    {
+        handle_response(ind->asdu, received_us);
+    }
+    else if (ind->asdu_length == SYNC_SCHEDULE_SIZE && ind->asdu[0] == SYNC_FRAME_SCHEDULE)
+    {
+        handle_schedule(ind->asdu, received_us);
+    }
+    return true;
+}
@@ -0,0 +1,112 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The light's half of the shared time base. The light
+ * keeps an estimate of the leader's clock from request and response
+ * exchanges, four timestamps each, and carries out the actions the
+ * leader schedules at the leader's time, then reports when it really
+ * did. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* On the bulk endpoint and profile (bulk_receiver.h). Must match
+ * zb_time_sync.h on the leader, which describes the frames. */
+#define SYNC_CLUSTER_ID 0x0004
+#define SYNC_FRAME_REQUEST 0
+#define SYNC_REQUEST_SIZE 9
+#define SYNC_FRAME_RESPONSE 1
+#define SYNC_RESPONSE_SIZE 25
+#define SYNC_FRAME_SCHEDULE 2
+#define SYNC_SCHEDULE_SIZE 13
+#define SYNC_FRAME_EXECUTED 3
+#define SYNC_EXECUTED_SIZE 20
+#define SYNC_ACTION_ON_OFF 0
+#define SYNC_STATUS_OK 0
+#define SYNC_STATUS_NOT_SYNCED 1
+
+/* Exchanges per round, of which the one with the shortest round trip
+ * is used, since it was held up least. */
+#define LIGHT_SYNC_SAMPLES 8
+#define LIGHT_SYNC_SAMPLE_PERIOD_MS 100
+/* Time between rounds. The clocks drift apart by some parts per
+ * million, which is measured and made up for in between. */
+#define LIGHT_SYNC_PERIOD_MS (60 * 1000)
+/* Drift outside this is taken as a bad measurement. */
+#define LIGHT_SYNC_MAX_DRIFT_PPB 200000
+
+/* Above the Zigbee task, so an action waits for nothing but the
+ * Zigbee lock. */
+#define LIGHT_SYNC_TASK_PRIORITY 6
+#define LIGHT_SYNC_TASK_STACK_DEPTH 3072
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+/* Switch the light on or off, and return when the LEDs showed it, in
+ * esp_timer_get_time() microseconds. Called with the Zigbee lock
+ * held. */
+typedef int64_t (*light_sync_on_off_cb_t)(bool on);
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * light_sync_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Create the task that carries out actions.
+ */
+esp_err_t light_sync_init(light_sync_on_off_cb_t on_off);
+
+/*--------------------------------------------------------------
+ * light_sync_start()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Start keeping in step with the leader, once on the network.
+ * Must be called from the Zigbee task.
+ */
+void light_sync_start(void);
+
+/*--------------------------------------------------------------
+ * light_sync_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take time responses and scheduled actions out of the
+ * incoming APS frames. Call it from the handler registered with
+ * esp_zb_aps_data_indication_handler_register(), as early as
+ * possible, since the receive time is taken here.
+ *
+ * @return true if the frame was for us.
+ */
+bool light_sync_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
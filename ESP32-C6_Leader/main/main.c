@@ -15,6 +15,7 @@
  *============================================================*/
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 /*==============================================================
@@ -26,6 +27,7 @@
 #include "esp_flash.h"
 #include "esp_log.h"
 #include "esp_task_wdt.h"
+#include "esp_timer.h"
 #include "led_strip.h"
 #include "sdkconfig.h"
 
@@ -36,6 +38,12 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+/*==============================================================
+ * LED effects.
+ *============================================================*/
+
+#include "led_effects.h"
+
 /*==============================================================
  * Zigbee.
  *============================================================*/
@@ -62,12 +70,35 @@
  *============================================================*/
 
 #define LED_STRIP_GPIO GPIO_NUM_8
+#define LED_STRIP_LED_COUNT 1 /* At least one LED on board. */
+/* Applied by the LED strip driver while encoding, so colours can be
+ * set at full scale. */
+#define LED_STRIP_BRIGHTNESS 16
+#define LED_STRIP_GAMMA 2.2f
+/* The ESP32-C6 RMT has no DMA, the driver falls back to refilling the
+ * channel memory from an interrupt. Long strips on targets with RMT
+ * DMA (e.g. ESP32-S3) should set this. */
+#define LED_STRIP_WITH_DMA false
+/* Without DMA the channel sends from its own memory, 48 symbols on the
+ * ESP32-C6. A frame is 24 symbols per LED and 1 for the reset code, so
+ * the on-board LED fits whole: the frame goes out with no refill
+ * interrupt, and so cannot underrun (leader_strip_stats reports 0
+ * refills). A longer strip would be refilled every 24 symbols (29 us);
+ * 96 gives it the memory of both TX channels and halves that. */
+#define LED_STRIP_MEM_BLOCK_SYMBOLS 48
+_Static_assert(LED_STRIP_WITH_DMA || LED_STRIP_LED_COUNT * 24 + 1 <= LED_STRIP_MEM_BLOCK_SYMBOLS,
+               "Frame no longer fits in the channel memory, check leader_strip_stats for underruns");
+#define LED_EFFECTS_TASK_PRIORITY configMAX_PRIORITIES - 8
 
 /*==============================================================
  * UART.
  *============================================================*/
 
 #define UART_RX_BUFFER_SIZE 1024
+/* Commands end with a pause, frames of an OTA upload are put back
+ * together, so those can be read without waiting for one. */
+#define UART_RX_TIMEOUT_MS 100
+#define UART_RX_UPLOAD_TIMEOUT_MS 10
 #define UART_RX_PIN GPIO_NUM_17
 #define UART_RX_TASK_PRIORITY configMAX_PRIORITIES - 1
 #define UART_TX_PIN GPIO_NUM_4
@@ -153,6 +184,8 @@ static void green_task(void *pvParameter);
 
 static void uart_configure(void);
 static void uart_rx_task(void *arg);
+static const char *command_arguments(const char *string, const char *command);
+static void ota_upload_done(void);
 
 /*==============================================================
  * Rust.
@@ -340,13 +373,23 @@ static void led_strip_configure(void)
     /* LED strip initialization with the GPIO and pixels number. */
     led_strip_config_t strip_config = {
         .strip_gpio_num = LED_STRIP_GPIO,
-        .max_leds = 1, /* At least one LED on board. */
+        .max_leds = LED_STRIP_LED_COUNT,
     };
     led_strip_rmt_config_t rmt_config = {
         .resolution_hz = 10 * 1000 * 1000, /* 10 MHz. */
-        .flags.with_dma = false,
+        .mem_block_symbols = LED_STRIP_WITH_DMA ? 0 : LED_STRIP_MEM_BLOCK_SYMBOLS,
+        .flags.with_dma = LED_STRIP_WITH_DMA,
     };
     ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip.handle));
+    ESP_ERROR_CHECK(led_strip_set_gamma(led_strip.handle, LED_STRIP_GAMMA));
+    ESP_ERROR_CHECK(led_strip_set_brightness(led_strip.handle, LED_STRIP_BRIGHTNESS));
+    led_effects_config_t effects_config = {
+        .strip = led_strip.handle,
+        .led_count = LED_STRIP_LED_COUNT,
+        .fps = LED_EFFECTS_DEFAULT_FPS,
+        .task_priority = LED_EFFECTS_TASK_PRIORITY,
+    };
+    ESP_ERROR_CHECK(led_effects_init(&effects_config));
     /* Turn the LED off. */
     led_strip.state = OFF;
     led_strip_clear(led_strip.handle);
@@ -358,29 +401,31 @@ static void led_strip_configure(void)
 
 static void led_strip_update(void)
 {
+    /* A static colour replaces whatever effect is running. */
+    led_effects_stop();
     switch (led_strip.state)
     {
     case RED:
         ESP_LOGI(TAG, "Turning the LED red.");
         /* Set the LED pixel using RGB from 0 (0%) to 255 (100%) for
-         * each color. */
-        led_strip_set_pixel(led_strip.handle, 0, 16, 0, 0);
+         * each color. Brightness and gamma are applied by the driver. */
+        led_strip_set_pixel(led_strip.handle, 0, 255, 0, 0);
         /* Refresh the strip to send data. */
         led_strip_refresh(led_strip.handle);
         break;
     case YELLOW:
         ESP_LOGI(TAG, "Turning the LED yellow.");
-        led_strip_set_pixel(led_strip.handle, 0, 16, 8, 0);
+        led_strip_set_pixel(led_strip.handle, 0, 255, 186, 0);
         led_strip_refresh(led_strip.handle);
         break;
     case GREEN:
         ESP_LOGI(TAG, "Turning the LED green.");
-        led_strip_set_pixel(led_strip.handle, 0, 0, 16, 0);
+        led_strip_set_pixel(led_strip.handle, 0, 0, 255, 0);
         led_strip_refresh(led_strip.handle);
         break;
     case BLUE:
         ESP_LOGI(TAG, "Turning the LED blue.");
-        led_strip_set_pixel(led_strip.handle, 0, 0, 0, 16);
+        led_strip_set_pixel(led_strip.handle, 0, 0, 0, 255);
         led_strip_refresh(led_strip.handle);
         break;
     case OFF:
@@ -418,6 +463,40 @@ static void uart_configure(void)
     uart_set_pin(UART_NUM_1, UART_TX_PIN, UART_RX_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
 }
 
+/*--------------------------------------------------------------
+ * command_arguments()
+ *------------------------------------------------------------*/
+
+/* If `string` is `command`, optionally followed by a space and some
+ * arguments, return the arguments (maybe ""). Otherwise return NULL. */
+static const char *command_arguments(const char *string, const char *command)
+{
+    size_t length = strlen(command);
+    if (strncmp(string, command, length) != 0)
+    {
+        return NULL;
+    }
+    if (string[length] == '\0')
+    {
+        return &string[length];
+    }
+    if (string[length] == ' ')
+    {
+        return &string[length + 1];
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------
+ * ota_upload_done()
+ *------------------------------------------------------------*/
+
+/* The followers are offered an image as soon as it is staged. */
+static void ota_upload_done(void)
+{
+    zigbee_ota_notify();
+}
+
 /*--------------------------------------------------------------
  * uart_rx_task()
  *------------------------------------------------------------*/
@@ -427,7 +506,9 @@ static void uart_rx_task(void *arg)
     /* Initialize variables. */
     static const char *UART_RX_TASK_TAG = "UART_RX_TASK";
     esp_log_level_set(UART_RX_TASK_TAG, ESP_LOG_INFO);
-    uint8_t *data = (uint8_t *)malloc(UART_RX_BUFFER_SIZE + 1);
+    /* Static, so the only buffer this task needs never comes from the
+     * heap. */
+    static uint8_t data[UART_RX_BUFFER_SIZE + 1];
 
     /* Loop forever. */
     for (;;)
@@ -437,9 +518,18 @@ static void uart_rx_task(void *arg)
         {
             ESP_LOGI(UART_RX_TASK_TAG, "Checking if there is received data.");
         }
-        const int rx_bytes = uart_read_bytes(UART_NUM_1, data, UART_RX_BUFFER_SIZE, pdMS_TO_TICKS(100));
+        const uint32_t timeout_ms = zb_ota_upload_active() ? UART_RX_UPLOAD_TIMEOUT_MS : UART_RX_TIMEOUT_MS;
+        const int rx_bytes = uart_read_bytes(UART_NUM_1, data, UART_RX_BUFFER_SIZE, pdMS_TO_TICKS(timeout_ms));
+        if (rx_bytes > 0 && zb_ota_upload_feed(data, rx_bytes))
+        {
+            /* Part of an OTA upload, not a command. */
+            continue;
+        }
         if (rx_bytes > 0)
         {
+            /* For commands that measure their own latency. */
+            const int64_t received_us = esp_timer_get_time();
+
             /* Idk what this does. It seems to set the end of what was read
              * to `0`, but why? */
             data[rx_bytes] = 0;
@@ -464,6 +554,7 @@ static void uart_rx_task(void *arg)
             }
 
             /* Determine what was read and then do something. */
+            const char *arguments = NULL;
             if (strcmp(data_string, "leader_red_task") == 0)
             {
                 vTaskResume(red_task_handle);
@@ -476,14 +567,352 @@ static void uart_rx_task(void *arg)
             {
                 vTaskResume(green_task_handle);
             }
-            else if (strcmp(data_string, "follower_toggle_led") == 0)
+            else if ((arguments = command_arguments(data_string, "follower_toggle_led")) != NULL)
+            {
+                /* No ID toggles every bound follower. */
+                if (arguments[0] == '\0')
+                {
+                    follower_toggle_led();
+                }
+                else
+                {
+                    follower_toggle_led_by_id((uint16_t)strtoul(arguments, NULL, 10));
+                }
+            }
+            else if ((arguments = command_arguments(data_string, "follower_on")) != NULL)
+            {
+                follower_set_led_by_id((uint16_t)strtoul(arguments, NULL, 10), true);
+            }
+            else if ((arguments = command_arguments(data_string, "follower_off")) != NULL)
+            {
+                follower_set_led_by_id((uint16_t)strtoul(arguments, NULL, 10), false);
+            }
+            else if ((arguments = command_arguments(data_string, "follower_state")) != NULL)
+            {
+                follower_state((uint16_t)strtoul(arguments, NULL, 10));
+            }
+            else if (strcmp(data_string, "follower_list") == 0)
+            {
+                follower_list();
+            }
+            else if ((arguments = command_arguments(data_string, "follower_toggle_group")) != NULL)
+            {
+                follower_toggle_group((uint8_t)strtoul(arguments, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "follower_group_add")) != NULL)
+            {
+                /* "<id> <group>". */
+                char *group = NULL;
+                uint16_t id = (uint16_t)strtoul(arguments, &group, 10);
+                follower_group_add(id, (uint8_t)strtoul(group, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "follower_group_remove")) != NULL)
+            {
+                /* "<id> <group>". */
+                char *group = NULL;
+                uint16_t id = (uint16_t)strtoul(arguments, &group, 10);
+                follower_group_remove(id, (uint8_t)strtoul(group, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_group_bench") == 0)
+            {
+                follower_group_benchmark();
+            }
+            else if ((arguments = command_arguments(data_string, "leader_fanout_bench")) != NULL)
+            {
+                /* "[<rounds>]". */
+                follower_fanout_benchmark((uint32_t)strtoul(arguments, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "leader_fanout_slot")) != NULL)
+            {
+                /* "<ms>", 0 to adapt. */
+                zigbee_fanout_slot((uint16_t)strtoul(arguments, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_fanout_status") == 0)
+            {
+                zb_fanout_stats_t stats;
+                zb_fanout_get_stats(&stats);
+                ESP_LOGI(UART_RX_TASK_TAG, "FANOUT_STATUS slot_ms=%u adaptive=%d loss_pct=%u scheduled=%u max_scheduled=%u fanouts=%" PRIu32 " commands=%" PRIu32 " dropped=%" PRIu32,
+                         stats.slot_ms, stats.adaptive, stats.loss_pct, stats.scheduled, stats.max_scheduled, stats.fanouts, stats.commands, stats.dropped);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_scene_store")) != NULL)
+            {
+                /* "<group> <scene>". */
+                char *scene = NULL;
+                uint8_t group = (uint8_t)strtoul(arguments, &scene, 10);
+                follower_scene_store(group, (uint8_t)strtoul(scene, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "leader_scene_recall")) != NULL)
+            {
+                /* "<group> <scene>". */
+                char *scene = NULL;
+                uint8_t group = (uint8_t)strtoul(arguments, &scene, 10);
+                follower_scene_recall(group, (uint8_t)strtoul(scene, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_scene_list") == 0)
+            {
+                follower_scenes_list();
+            }
+            else if ((arguments = command_arguments(data_string, "follower_scene_list")) != NULL)
+            {
+                /* "<id> <group>". */
+                char *group = NULL;
+                uint16_t id = (uint16_t)strtoul(arguments, &group, 10);
+                follower_scene_membership(id, (uint8_t)strtoul(group, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_channel_scan") == 0)
+            {
+                zigbee_channel_scan();
+            }
+            else if ((arguments = command_arguments(data_string, "leader_channel_change")) != NULL)
+            {
+                zigbee_channel_change((uint8_t)strtoul(arguments, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "leader_permit_join")) != NULL)
+            {
+                /* No time opens the network for 180 s. */
+                zigbee_permit_join(arguments[0] == '\0' ? 180 : (uint8_t)strtoul(arguments, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_forget_followers") == 0)
+            {
+                follower_registry_erase_saved();
+            }
+            else if ((arguments = command_arguments(data_string, "leader_ota_upload")) != NULL)
+            {
+                /* "<bytes>", then the image as frames, see zb_ota_upload.h. */
+                zb_ota_upload_begin((uint32_t)strtoul(arguments, NULL, 10), ota_upload_done);
+            }
+            else if (strcmp(data_string, "leader_ota_notify") == 0)
+            {
+                zigbee_ota_notify();
+            }
+            else if (strcmp(data_string, "leader_ota_status") == 0)
+            {
+                zb_ota_server_stats_t stats;
+                zb_ota_server_get_stats(&stats);
+                ESP_LOGI(UART_RX_TASK_TAG, "OTA_STATUS ready=%d bytes=%" PRIu32 " version=0x%08" PRIx32 " active=%u max_concurrent=%u done=%u aborted=%u resent=%" PRIu32,
+                         stats.ready, stats.size, stats.file_version, stats.active, stats.max_active, stats.finished, stats.aborted, stats.resent);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_commission_limit")) != NULL)
+            {
+                zigbee_commission_concurrency((uint8_t)strtoul(arguments, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_commission_status") == 0)
+            {
+                zb_commission_stats_t stats;
+                zb_commission_get_stats(&stats);
+                ESP_LOGI(UART_RX_TASK_TAG, "COMMISSION_STATUS queued=%u max_queued=%u refused=%u in_flight=%u concurrency=%u commissioned=%u failed=%u retries=%u",
+                         stats.queued, stats.max_queued, stats.refused, stats.in_flight, stats.concurrency, stats.commissioned, stats.failed, stats.retries);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_zb_profile")) != NULL)
+            {
+                /* "<small|medium|large>", used from the next boot. */
+                zb_resources_set_profile(zb_resources_profile_from_string(arguments));
+            }
+            else if (strcmp(data_string, "leader_zb_resources") == 0)
+            {
+                zigbee_resources_log();
+            }
+            else if ((arguments = command_arguments(data_string, "leader_link_tuning")) != NULL)
+            {
+                /* "[on|off]", nothing to log how it stands. */
+                if (arguments[0] != '\0')
+                {
+                    zigbee_link_tuning(strcmp(arguments, "off") != 0);
+                }
+                zb_link_tuning_stats_t stats;
+                zb_link_tuning_get_stats(&stats);
+                ESP_LOGI(UART_RX_TASK_TAG, "LINK_STATUS enabled=%d link_status_s=%u keep_alive_ms=%" PRIu32 " routers=%u followers=%u applied=%u lqi_delta=%u.%u traffic_per_min=%" PRIu32 " background_per_min=%" PRIu32 " default_background_per_min=%" PRIu32 " decisions=%" PRIu32 " updates=%" PRIu32,
+                         stats.enabled, stats.link_status_s, stats.keep_alive_ms, stats.routers, stats.followers, stats.followers_applied,
+                         stats.lqi_delta_x10 / 10, stats.lqi_delta_x10 % 10, stats.traffic_per_min, stats.background_per_min,
+                         stats.default_background_per_min, stats.decisions, stats.updates_sent);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_bulk_bench")) != NULL)
+            {
+                /* "<id> <bytes>". */
+                char *size = NULL;
+                uint16_t id = (uint16_t)strtoul(arguments, &size, 10);
+                follower_bulk_benchmark(id, (uint16_t)strtoul(size, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "leader_latency")) != NULL)
+            {
+                /* "<id> <count>". */
+                char *count = NULL;
+                uint16_t id = (uint16_t)strtoul(arguments, &count, 10);
+                follower_latency_measure(id, (uint16_t)strtoul(count, NULL, 10), received_us);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_stress")) != NULL)
+            {
+                /* "<rate> <count> [<id> ...]", no IDs for every follower. */
+                static uint16_t ids[ZB_STRESS_MAX_TARGETS];
+                uint16_t id_count = 0;
+                char *next = NULL;
+                uint32_t rate = (uint32_t)strtoul(arguments, &next, 10);
+                uint32_t count = (uint32_t)strtoul(next, &next, 10);
+                for (char *end = next; id_count < ZB_STRESS_MAX_TARGETS; next = end)
+                {
+                    uint16_t id = (uint16_t)strtoul(next, &end, 10);
+                    if (end == next)
+                    {
+                        break;
+                    }
+                    ids[id_count++] = id;
+                }
+                follower_stress_benchmark(rate, count, ids, id_count);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_stress_group")) != NULL)
+            {
+                /* "<rate> <count> <group>". */
+                char *next = NULL;
+                uint32_t rate = (uint32_t)strtoul(arguments, &next, 10);
+                uint32_t count = (uint32_t)strtoul(next, &next, 10);
+                follower_stress_benchmark_group(rate, count, (uint8_t)strtoul(next, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "follower_sync")) != NULL)
+            {
+                /* "<on|off> <delay ms> [<id> ...]", no IDs for every follower. */
+                static uint16_t ids[ZB_TIME_SYNC_MAX_TARGETS];
+                uint16_t id_count = 0;
+                bool on = strncmp(arguments, "on", 2) == 0;
+                char *next = strchr(arguments, ' ');
+                uint32_t delay_ms = next ? (uint32_t)strtoul(next, &next, 10) : 0;
+                for (char *end = next; next && id_count < ZB_TIME_SYNC_MAX_TARGETS; next = end)
+                {
+                    uint16_t id = (uint16_t)strtoul(next, &end, 10);
+                    if (end == next)
+                    {
+                        break;
+                    }
+                    ids[id_count++] = id;
+                }
+                follower_sync_set(on, delay_ms, ids, id_count);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_time")) != NULL)
+            {
+                /* "<seconds since 1970>", sent by the GUI on connecting. */
+                zigbee_time_set((uint32_t)strtoul(arguments, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_topology") == 0)
             {
-                follower_toggle_led();
+                zb_topology_stats_t stats;
+                zb_topology_walk(&stats);
+                ESP_LOGI(UART_RX_TASK_TAG, "Topology: %" PRIu32 " records in %" PRIu32 " chunks, lock held %" PRIu32 " us at most.",
+                         stats.records, stats.chunks, stats.max_lock_hold_us);
+            }
+            else if ((arguments = command_arguments(data_string, "leader_scene_bench")) != NULL)
+            {
+                /* "<group> <scene>". */
+                char *scene = NULL;
+                uint8_t group = (uint8_t)strtoul(arguments, &scene, 10);
+                follower_scene_benchmark(group, (uint8_t)strtoul(scene, NULL, 10));
             }
             else if (strcmp(data_string, "leader_rust_task") == 0)
             {
                 vTaskResume(rust_task_handle);
             }
+            else if ((arguments = command_arguments(data_string, "leader_effect")) != NULL)
+            {
+                led_effect_params_t params;
+                if (led_effects_params_from_string(arguments, &params) == ESP_OK)
+                {
+                    led_effects_start(&params);
+                }
+            }
+            else if ((arguments = command_arguments(data_string, "leader_effect_fps")) != NULL)
+            {
+                led_effects_set_fps((uint32_t)strtoul(arguments, NULL, 10));
+            }
+            else if (strcmp(data_string, "leader_effect_stats") == 0)
+            {
+                led_effects_stats_t stats;
+                led_effects_get_stats(&stats);
+                ESP_LOGI(UART_RX_TASK_TAG, "Effects: %" PRIu32 ".%02" PRIu32 " of %" PRIu32 " FPS, %" PRIu32 " frames, %" PRIu32 " skipped, render %" PRIu32 " us (max %" PRIu32 " us).",
+                         stats.achieved_fps_x100 / 100, stats.achieved_fps_x100 % 100, stats.target_fps,
+                         stats.frames_rendered, stats.frames_skipped, stats.last_render_us, stats.max_render_us);
+            }
+            else if (strcmp(data_string, "leader_strip_stats") == 0)
+            {
+                led_strip_rmt_stats_t stats;
+                if (led_strip_rmt_get_stats(led_strip.handle, &stats) == ESP_OK)
+                {
+                    ESP_LOGI(UART_RX_TASK_TAG, "Strip: %" PRIu32 " frames, %" PRIu32 " refills, %" PRIu32 " underruns, last frame %" PRIu32 " us, encoder %" PRIu32 " calls and %" PRIu32 " us (max %" PRIu32 " us), %" PRIu32 " symbols, DMA %s.",
+                             stats.frames, stats.refills, stats.underruns, stats.last_frame_us, stats.last_encode_calls,
+                             stats.last_encode_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ, stats.max_encode_cycles / CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+                             stats.mem_block_symbols, stats.with_dma ? "on" : "off");
+                }
+            }
+            else if (strcmp(data_string, "leader_zb_stats") == 0)
+            {
+                zb_command_queue_stats_t stats;
+                zb_command_queue_get_stats(&stats);
+                ESP_LOGI(UART_RX_TASK_TAG, "Zigbee queue: depth %" PRIu32 " (max %" PRIu32 "), %" PRIu32 " sent in %" PRIu32 " batches, %" PRIu32 " dropped, %" PRIu32 " failed, lock wait %" PRIu32 " us (max %" PRIu32 " us), latency %" PRIu32 " us (max %" PRIu32 " us), %" PRIu32 " interactive (max wait %" PRIu32 " us).",
+                         stats.depth, stats.max_depth, stats.sent, stats.batches, stats.dropped, stats.send_failures,
+                         stats.last_lock_wait_us, stats.max_lock_wait_us, stats.last_latency_us, stats.max_latency_us,
+                         stats.interactive_sent, stats.max_interactive_wait_us);
+            }
+            else if (strcmp(data_string, "leader_zb_flows") == 0)
+            {
+                /* One line per destination, "ZB_FLOW dst=<short|group
+                 * 0x<id>|bound> ...". */
+                static zb_command_flow_stats_t flows[ZB_COMMAND_QUEUE_FLOWS];
+                uint32_t count = zb_command_queue_get_flow_stats(flows, ZB_COMMAND_QUEUE_FLOWS);
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    const zb_command_flow_stats_t *flow = &flows[i];
+                    char dst[sizeof("group_0x0000")];
+                    if (flow->dst.mode == ZB_COMMAND_DST_SHORT)
+                    {
+                        snprintf(dst, sizeof(dst), "0x%04hx", flow->dst.short_addr);
+                    }
+                    else if (flow->dst.mode == ZB_COMMAND_DST_GROUP)
+                    {
+                        snprintf(dst, sizeof(dst), "group_0x%04hx", flow->dst.group_id);
+                    }
+                    else
+                    {
+                        snprintf(dst, sizeof(dst), "bound");
+                    }
+                    uint32_t avg_wait_us = flow->sent ? (uint32_t)(flow->total_wait_us / flow->sent) : 0;
+                    ESP_LOGI(UART_RX_TASK_TAG, "ZB_FLOW dst=%s backlog=%" PRIu32 " max_backlog=%" PRIu32 " in_flight=%" PRIu32 " sent=%" PRIu32
+                                               " dropped=%" PRIu32 " stalls=%" PRIu32 " avg_wait_us=%" PRIu32 " max_wait_us=%" PRIu32,
+                             dst, flow->backlog, flow->max_backlog, flow->in_flight, flow->sent, flow->dropped, flow->stalls, avg_wait_us,
+                             flow->max_wait_us);
+                }
+            }
+            else if ((arguments = command_arguments(data_string, "leader_brightness")) != NULL)
+            {
+                /* Takes effect on the next refresh. */
+                led_strip_set_brightness(led_strip.handle, (uint8_t)strtoul(arguments, NULL, 10));
+            }
+            else if ((arguments = command_arguments(data_string, "follower_effect")) != NULL)
+            {
+                led_effect_params_t params;
+                if (led_effects_params_from_string(arguments, &params) == ESP_OK)
+                {
+                    follower_set_effect(&params);
+                }
+            }
+            else if ((arguments = command_arguments(data_string, "follower_effect_group")) != NULL)
+            {
+                /* "<group> <effect arguments>". */
+                char *effect_arguments = NULL;
+                uint8_t group = (uint8_t)strtoul(arguments, &effect_arguments, 10);
+                led_effect_params_t params;
+                if (led_effects_params_from_string(effect_arguments, &params) == ESP_OK)
+                {
+                    follower_set_effect_group(group, &params);
+                }
+            }
+            else if ((arguments = command_arguments(data_string, "follower_effect_id")) != NULL)
+            {
+                /* "<id> <effect arguments>". */
+                char *effect_arguments = NULL;
+                uint16_t id = (uint16_t)strtoul(arguments, &effect_arguments, 10);
+                led_effect_params_t params;
+                if (led_effects_params_from_string(effect_arguments, &params) == ESP_OK)
+                {
+                    follower_set_effect_by_id(id, &params);
+                }
+            }
             else
             {
                 ESP_LOGE(UART_RX_TASK_TAG, "Error: Did not understand command.");
@@ -492,7 +921,6 @@ static void uart_rx_task(void *arg)
     }
 
     /* It should never reach here. */
-    free(data);
     vTaskDelete(NULL);
 }
 
@@ -23,7 +23,26 @@
  *############################################################*/
 
 #include "esp_zigbee_core.h"
+#include "follower_groups.h"
+#include "follower_registry.h"
+#include "follower_scenes.h"
+#include "led_effects.h"
 #include "switch_driver.h"
+#include "zb_benchmark.h"
+#include "zb_bulk.h"
+#include "zb_channel.h"
+#include "zb_command_queue.h"
+#include "zb_commission.h"
+#include "zb_delivery.h"
+#include "zb_fanout.h"
+#include "zb_latency.h"
+#include "zb_link_tuning.h"
+#include "zb_ota_server.h"
+#include "zb_ota_upload.h"
+#include "zb_resources.h"
+#include "zb_stress.h"
+#include "zb_time_sync.h"
+#include "zb_topology.h"
 #include "zcl_utility.h"
 
 /*##############################################################
@@ -34,7 +53,12 @@
 #define MAX_CHILDREN 10                        /* the max amount of connected devices */
 #define INSTALLCODE_POLICY_ENABLE false        /* enable the install code policy for security */
 #define HA_ONOFF_SWITCH_ENDPOINT 1             /* esp light switch device endpoint */
-#define ESP_ZB_PRIMARY_CHANNEL_MASK (1l << 13) /* Zigbee primary channel mask use in the example */
+#define ESP_ZB_PRIMARY_CHANNEL_MASK (1l << 13) /* used if the channel scan at formation fails, see zb_channel.h */
+
+/* LED effects cluster (manufacturer-specific, must match the follower) */
+#define LED_EFFECTS_CLUSTER_ID 0xFC00   /* private cluster carrying LED effect commands */
+#define LED_EFFECTS_CMD_START_ID 0x00   /* payload: octet string of led_effects_params_to_bytes() */
+#define LED_EFFECTS_ATTR_TYPE_ID 0x0000 /* the effect that is currently selected */
 
 /* Basic manufacturer information */
 #define ESP_MANUFACTURER_NAME "\x09" \
@@ -75,3 +99,250 @@ void zigbee_configure(void);
  *------------------------------------------------------------*/
 
 void follower_toggle_led(void);
+
+/*--------------------------------------------------------------
+ * follower_set_effect()
+ *------------------------------------------------------------*/
+
+void follower_set_effect(const led_effect_params_t *params);
+
+/*--------------------------------------------------------------
+ * follower_toggle_led_by_id()
+ *------------------------------------------------------------*/
+
+/* Toggle one follower, by its registry ID. */
+esp_err_t follower_toggle_led_by_id(uint16_t id);
+
+/*--------------------------------------------------------------
+ * follower_set_led_by_id()
+ *------------------------------------------------------------*/
+
+/* Switch one follower on or off, by its registry ID. Unlike a
+ * toggle, sending it twice does the same as sending it once. */
+esp_err_t follower_set_led_by_id(uint16_t id, bool on);
+
+/*--------------------------------------------------------------
+ * follower_state()
+ *------------------------------------------------------------*/
+
+/* Log one follower's on/off and effect state as last reported or
+ * delivered, as "FOLLOWER_STATE id=<id> on_off=<on|off|unknown>
+ * pending=<on|off|none> effect=<name> age_s=<s> lookup_us=<us>" for
+ * the GUI. pending is an on/off command still on its way. */
+esp_err_t follower_state(uint16_t id);
+
+/*--------------------------------------------------------------
+ * follower_set_effect_by_id()
+ *------------------------------------------------------------*/
+
+/* Send an LED effect to one follower, by its registry ID. */
+esp_err_t follower_set_effect_by_id(uint16_t id, const led_effect_params_t *params);
+
+/*--------------------------------------------------------------
+ * follower_list()
+ *------------------------------------------------------------*/
+
+void follower_list(void);
+
+/*--------------------------------------------------------------
+ * follower_toggle_group()
+ *------------------------------------------------------------*/
+
+/* Toggle every member of a group with one frame: off if any member
+ * is on, else on. */
+esp_err_t follower_toggle_group(uint8_t group);
+
+/*--------------------------------------------------------------
+ * follower_set_effect_group()
+ *------------------------------------------------------------*/
+
+/* Send an LED effect to every member of a group with one frame. */
+esp_err_t follower_set_effect_group(uint8_t group, const led_effect_params_t *params);
+
+/*--------------------------------------------------------------
+ * follower_group_add()
+ *------------------------------------------------------------*/
+
+/* Ask a follower to join a group. The membership is saved once the
+ * follower confirms. */
+esp_err_t follower_group_add(uint16_t id, uint8_t group);
+
+/*--------------------------------------------------------------
+ * follower_group_remove()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_group_remove(uint16_t id, uint8_t group);
+
+/*--------------------------------------------------------------
+ * follower_group_benchmark()
+ *------------------------------------------------------------*/
+
+/* Compare unicast and group addressing for 1, 10 and 50 followers.
+ * Runs in a task of its own and returns at once, with
+ * ESP_ERR_INVALID_STATE if another benchmark is still running. */
+esp_err_t follower_group_benchmark(void);
+
+/*--------------------------------------------------------------
+ * follower_fanout_benchmark()
+ *------------------------------------------------------------*/
+
+/* Compare switching every follower with unicasts sent back to back
+ * against the same unicasts spread out by the fan-out scheduler (see
+ * zb_fanout.h), `rounds` times each. Runs in a task of its own, as
+ * follower_group_benchmark() does. */
+esp_err_t follower_fanout_benchmark(uint32_t rounds);
+
+/*--------------------------------------------------------------
+ * follower_scene_store()
+ *------------------------------------------------------------*/
+
+/* Make every member of a group save its current state as a scene,
+ * with one frame. The scene is listed as unconfirmed until a member
+ * says it has it (follower_scenes.h), which they are asked for right
+ * after. */
+esp_err_t follower_scene_store(uint8_t group, uint8_t scene_id);
+
+/*--------------------------------------------------------------
+ * follower_scene_recall()
+ *------------------------------------------------------------*/
+
+/* Put every member of a group back in a scene, with one frame. */
+esp_err_t follower_scene_recall(uint8_t group, uint8_t scene_id);
+
+/*--------------------------------------------------------------
+ * follower_scene_membership()
+ *------------------------------------------------------------*/
+
+/* Ask one follower which scenes of a group it has. The answer is
+ * logged, and confirms the scenes it lists. */
+esp_err_t follower_scene_membership(uint16_t id, uint8_t group);
+
+/*--------------------------------------------------------------
+ * follower_scene_benchmark()
+ *------------------------------------------------------------*/
+
+/* Compare setting each attribute of each member of a group against
+ * one scene recall. Runs in a task of its own, as
+ * follower_group_benchmark() does. */
+esp_err_t follower_scene_benchmark(uint8_t group, uint8_t scene_id);
+
+/*--------------------------------------------------------------
+ * follower_bulk_benchmark()
+ *------------------------------------------------------------*/
+
+/* Compare a bulk transfer of `size` bytes to one follower with
+ * carrying the same bytes in effect commands. Runs in a task of its
+ * own, as follower_group_benchmark() does. */
+esp_err_t follower_bulk_benchmark(uint16_t id, uint16_t size);
+
+/*--------------------------------------------------------------
+ * follower_latency_measure()
+ *------------------------------------------------------------*/
+
+/* Toggle one follower `count` times and log the latency of every
+ * stage from `uart_us`, when the command arrived, to its LED
+ * changing. Runs in a task of its own, as follower_group_benchmark()
+ * does. */
+esp_err_t follower_latency_measure(uint16_t id, uint16_t count, int64_t uart_us);
+
+/*--------------------------------------------------------------
+ * follower_stress_benchmark()
+ *------------------------------------------------------------*/
+
+/* The capacity test: `count` unicast toggles at `rate` per second
+ * (0 for as fast as possible), round robin over the followers in
+ * `ids`, or over every follower if there are none. Logs what was
+ * sent, confirmed and delivered (see zb_stress.h). Runs in a task of
+ * its own, as follower_group_benchmark() does. */
+esp_err_t follower_stress_benchmark(uint32_t rate, uint32_t count, const uint16_t *ids, uint16_t id_count);
+
+/*--------------------------------------------------------------
+ * follower_stress_benchmark_group()
+ *------------------------------------------------------------*/
+
+/* The same with group toggles, each checked with every member of
+ * the group. */
+esp_err_t follower_stress_benchmark_group(uint32_t rate, uint32_t count, uint8_t group);
+
+/*--------------------------------------------------------------
+ * follower_sync_set()
+ *------------------------------------------------------------*/
+
+/* Switch the followers in `ids`, or every follower if there are
+ * none, on or off together, `delay_ms` from now by the shared time
+ * base. The delay must cover delivering to all of them. Logs the
+ * skew they achieved (see zb_time_sync.h). Runs in a task of its
+ * own, as follower_group_benchmark() does, so the delay counts from
+ * when that task starts. */
+esp_err_t follower_sync_set(bool on, uint32_t delay_ms, const uint16_t *ids, uint16_t id_count);
+
+/*--------------------------------------------------------------
+ * zigbee_channel_scan()
+ *------------------------------------------------------------*/
+
+/* Scan all channels and log the result (the GUI draws it). Does not
+ * change channel. */
+esp_err_t zigbee_channel_scan(void);
+
+/*--------------------------------------------------------------
+ * zigbee_channel_change()
+ *------------------------------------------------------------*/
+
+/* Move the whole network to another channel. */
+esp_err_t zigbee_channel_change(uint8_t channel);
+
+/*--------------------------------------------------------------
+ * zigbee_permit_join()
+ *------------------------------------------------------------*/
+
+/* Let new followers join for `seconds`, 0 closes the network again.
+ * After a reboot the network stays closed until this is called. */
+esp_err_t zigbee_permit_join(uint8_t seconds);
+
+/*--------------------------------------------------------------
+ * zigbee_ota_notify()
+ *------------------------------------------------------------*/
+
+/* Offer the staged follower image (zb_ota_server.h) to every
+ * follower. */
+esp_err_t zigbee_ota_notify(void);
+
+/*--------------------------------------------------------------
+ * zigbee_resources_log()
+ *------------------------------------------------------------*/
+
+/* Log the stack resource profile against its use so far, see
+ * zb_resources.h, then how full our own command, delivery and
+ * commissioning tables have been. */
+void zigbee_resources_log(void);
+
+/*--------------------------------------------------------------
+ * zigbee_commission_concurrency()
+ *------------------------------------------------------------*/
+
+/* Set how many ZDO requests commissioning may have outstanding at
+ * once, see zb_commission.h. */
+esp_err_t zigbee_commission_concurrency(uint8_t concurrency);
+
+/*--------------------------------------------------------------
+ * zigbee_fanout_slot()
+ *------------------------------------------------------------*/
+
+/* Fix the fan-out slot, or let it adapt if 0, see zb_fanout.h. */
+esp_err_t zigbee_fanout_slot(uint16_t slot_ms);
+
+/*--------------------------------------------------------------
+ * zigbee_link_tuning()
+ *------------------------------------------------------------*/
+
+/* Tune the link status period and the followers' keep-alive to the
+ * network, or go back to the defaults, see zb_link_tuning.h. */
+void zigbee_link_tuning(bool enabled);
+
+/*--------------------------------------------------------------
+ * zigbee_time_set()
+ *------------------------------------------------------------*/
+
+/* Set the time of day the Time cluster serves, in seconds since
+ * 1970-01-01 UTC. */
+esp_err_t zigbee_time_set(uint32_t unix_s);
@@ -0,0 +1,59 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Zigbee groups of followers. A command sent to a group
+ * reaches every member with one over-the-air frame, instead of one
+ * unicast frame per follower. Which followers are in which group is
+ * kept in the follower registry (follower_t.groups) and saved with
+ * it, so a follower that is commissioned again (or the leader
+ * rebooting) keeps its groups. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+#include "follower_registry.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Group n has the Zigbee group ID FOLLOWER_GROUP_ID(n). */
+#define FOLLOWER_GROUP_ID_BASE 0x0001
+#define FOLLOWER_GROUP_ID(group) ((uint16_t)(FOLLOWER_GROUP_ID_BASE + (group)))
+
+/* Every follower joins this group when it is commissioned. */
+#define FOLLOWER_GROUP_ALL 0
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * follower_groups_migrate()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Move the memberships saved by older firmware, in a blob of
+ * their own, into the registry, and erase that blob once the registry
+ * is saved. Call after follower_registry_load().
+ */
+esp_err_t follower_groups_migrate(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
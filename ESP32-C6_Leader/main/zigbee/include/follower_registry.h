@@ -0,0 +1,297 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The leader's table of followers. Every follower that
+ * joins gets a small ID (its slot in the table) and can be found by
+ * short address or by IEEE address in O(1) through two hash indexes,
+ * so lookups stay fast with hundreds of followers. What was learned
+ * while commissioning is saved, so a rebooted leader can control its
+ * followers at once instead of finding and binding them again. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Most followers the leader keeps track of. */
+#define FOLLOWER_REGISTRY_CAPACITY 256
+
+/* Returned instead of an ID when there is no such follower. */
+#define FOLLOWER_ID_INVALID 0xFFFF
+
+/* Cached attribute values that have not been reported yet. */
+#define FOLLOWER_ATTR_UNKNOWN 0xFF
+
+/* Clusters a follower has been found (and bound) with. */
+#define FOLLOWER_CLUSTER_ON_OFF (1 << 0)
+#define FOLLOWER_CLUSTER_LED_EFFECTS (1 << 1)
+
+/* Groups a follower can be in, one bit each of follower_t.groups. */
+#define FOLLOWER_GROUPS_COUNT 8
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+/* Kept small on purpose, the whole table is scanned only when it is
+ * listed. */
+typedef struct
+{
+    esp_zb_ieee_addr_t ieee_addr;
+    uint16_t short_addr;
+    uint16_t id;
+    uint8_t endpoint;
+    /* FOLLOWER_CLUSTER_* found on the endpoint. */
+    uint8_t clusters;
+    /* FOLLOWER_CLUSTER_* bound to the leader. */
+    uint8_t bound;
+    /* FOLLOWER_CLUSTER_* bound back, the follower reports them. */
+    uint8_t reporting;
+    /* Bit n set if a member of group n, see follower_groups.h. */
+    uint8_t groups;
+    /* Link quality from the neighbour table, 0 if not a neighbour. */
+    uint8_t lqi;
+    /* Cached attribute state, FOLLOWER_ATTR_UNKNOWN until reported. */
+    uint8_t on_off;
+    uint8_t effect_type;
+    /* On/off of the last command sent to it whose outcome is not known
+     * yet, FOLLOWER_ATTR_UNKNOWN if none. on_off takes it once the
+     * command is delivered or the follower reports it. */
+    uint8_t on_off_pending;
+    /* Seconds since boot when the follower was last heard from. */
+    uint32_t last_seen_s;
+    /* Commands sent to it again, see zb_delivery.h. Many point to a
+     * bad link. */
+    uint16_t retries;
+} follower_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * follower_registry_add()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Add a follower, or update its short address if it is
+ * already known (e.g. after a rejoin).
+ *
+ * @param ret_id Returned ID of the follower, may be NULL.
+ *
+ * @return ESP_ERR_NO_MEM if the table is full.
+ */
+esp_err_t follower_registry_add(const esp_zb_ieee_addr_t ieee_addr, uint16_t short_addr, uint16_t *ret_id);
+
+/*--------------------------------------------------------------
+ * follower_registry_remove()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_remove(uint16_t id);
+
+/*--------------------------------------------------------------
+ * follower_registry_find_by_short()
+ *------------------------------------------------------------*/
+
+/**
+ * @return The ID of the follower, or FOLLOWER_ID_INVALID.
+ */
+uint16_t follower_registry_find_by_short(uint16_t short_addr);
+
+/*--------------------------------------------------------------
+ * follower_registry_find_by_ieee()
+ *------------------------------------------------------------*/
+
+/**
+ * @return The ID of the follower, or FOLLOWER_ID_INVALID.
+ */
+uint16_t follower_registry_find_by_ieee(const esp_zb_ieee_addr_t ieee_addr);
+
+/*--------------------------------------------------------------
+ * follower_registry_get()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Copy a follower out of the table.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_get(uint16_t id, follower_t *follower);
+
+/*--------------------------------------------------------------
+ * follower_registry_count()
+ *------------------------------------------------------------*/
+
+uint16_t follower_registry_count(void);
+
+/*--------------------------------------------------------------
+ * follower_registry_set_endpoint()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Record the endpoint a follower's clusters were found on.
+ *
+ * @param clusters FOLLOWER_CLUSTER_* found on the endpoint.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_set_endpoint(uint16_t id, uint8_t endpoint, uint8_t clusters);
+
+/*--------------------------------------------------------------
+ * follower_registry_set_bound()
+ *------------------------------------------------------------*/
+
+/**
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_set_bound(uint16_t id, uint8_t cluster);
+
+/*--------------------------------------------------------------
+ * follower_registry_set_reporting()
+ *------------------------------------------------------------*/
+
+/**
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_set_reporting(uint16_t id, uint8_t cluster);
+
+/*--------------------------------------------------------------
+ * follower_registry_set_group()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Record that a follower joined or left a group.
+ *
+ * @param group Group index, not the group ID.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_set_group(uint16_t id, uint8_t group, bool member);
+
+/*--------------------------------------------------------------
+ * follower_registry_set_on_off()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Cache a delivered or reported on/off. A pending command with
+ * the same value is no longer pending.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_set_on_off(uint16_t id, bool on_off);
+
+/*--------------------------------------------------------------
+ * follower_registry_set_on_off_pending()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Note an on/off command on its way to the follower.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_set_on_off_pending(uint16_t id, bool on_off);
+
+/*--------------------------------------------------------------
+ * follower_registry_drop_on_off_pending()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Forget a pending on/off command that was not delivered, if
+ * it is still the latest one. The cache keeps its old value.
+ *
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_drop_on_off_pending(uint16_t id, bool on_off);
+
+/*--------------------------------------------------------------
+ * follower_registry_set_effect_type()
+ *------------------------------------------------------------*/
+
+/**
+ * @return ESP_ERR_NOT_FOUND if there is no follower with this ID.
+ */
+esp_err_t follower_registry_set_effect_type(uint16_t id, uint8_t effect_type);
+
+/*--------------------------------------------------------------
+ * follower_registry_touch()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Mark a follower as heard from just now.
+ */
+void follower_registry_touch(uint16_t short_addr);
+
+/*--------------------------------------------------------------
+ * follower_registry_count_retry()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Count a command sent to a follower again.
+ */
+void follower_registry_count_retry(uint16_t short_addr);
+
+/*--------------------------------------------------------------
+ * follower_registry_update_lqi()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Copy the link quality of every follower that is a
+ * neighbour from the stack's neighbour table. Must be called from
+ * the Zigbee task or with the Zigbee lock held.
+ */
+void follower_registry_update_lqi(void);
+
+/*--------------------------------------------------------------
+ * follower_registry_load()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Restore the saved followers, with the IDs they had. Call
+ * after nvs_flash_init() and before the first follower is added.
+ * Cached attributes and link quality are not saved, they are stale
+ * after a reboot.
+ */
+esp_err_t follower_registry_load(void);
+
+/*--------------------------------------------------------------
+ * follower_registry_save()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Save the followers, if anything worth saving changed since
+ * the last time. Cheap to call often.
+ */
+esp_err_t follower_registry_save(void);
+
+/*--------------------------------------------------------------
+ * follower_registry_erase_saved()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Forget the saved followers, so the next boot finds and
+ * binds them all again. The table itself is left alone.
+ */
+esp_err_t follower_registry_erase_saved(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,96 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The scenes the leader has stored on its followers. A
+ * scene is the whole state of every light in a group, stored on the
+ * lights themselves, so one recall frame changes all of them.
+ * Followers do not answer a store sent to a group, so the leader
+ * keeps its own list. A scene in it is unconfirmed until a follower
+ * lists it in a Get Scene Membership response, and only confirmed
+ * scenes are saved to NVS. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Matches the followers' scene tables. */
+#define FOLLOWER_SCENES_CAPACITY 16
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * follower_scenes_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Load the saved list. Call after nvs_flash_init().
+ */
+esp_err_t follower_scenes_init(void);
+
+/*--------------------------------------------------------------
+ * follower_scenes_stored()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Record that a scene was sent to be stored. A new scene is
+ * unconfirmed until follower_scenes_confirmed().
+ *
+ * @param group Group index, see follower_groups.h.
+ */
+esp_err_t follower_scenes_stored(uint8_t group, uint8_t scene_id);
+
+/*--------------------------------------------------------------
+ * follower_scenes_confirmed()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Record that a follower has a scene, as its Get Scene
+ * Membership response said. A scene the list does not have yet is
+ * added, the followers may have it from before the list was
+ * cleared.
+ */
+esp_err_t follower_scenes_confirmed(uint8_t group, uint8_t scene_id);
+
+/*--------------------------------------------------------------
+ * follower_scenes_recalled()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Count a recall of a scene.
+ *
+ * @return ESP_ERR_NOT_FOUND if the scene was never stored.
+ */
+esp_err_t follower_scenes_recalled(uint8_t group, uint8_t scene_id);
+
+/*--------------------------------------------------------------
+ * follower_scenes_list()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Log every stored scene.
+ */
+void follower_scenes_list(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,138 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Send statuses of a benchmark's own commands. Commands
+ * marked as a benchmark's (zb_command_t.benchmark) are tracked by the
+ * TSN the stack gave them until their send status comes back, so a
+ * benchmark is timed by its own frames and not by whatever else is
+ * on the air. Those sent through delivery tracking (zb_delivery.h)
+ * are also counted when they finish. The benchmarks themselves are in
+ * esp_zb_switch.h, each run in a task of its own. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+#include "zb_command_queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    /* Commands handed to the stack, and those whose send status came
+     * back, failed or not. A command still waiting when its TSN comes
+     * round again counts as failed. */
+    uint32_t sent;
+    uint32_t statuses;
+    uint32_t failed;
+    /* When the last send status came back. */
+    int64_t last_status_us;
+    /* Of the last command confirmed, the time from enqueueing it to
+     * handing it to the stack, and from there to its send status. */
+    uint32_t last_queued_us;
+    uint32_t last_confirm_us;
+    /* Commands delivery tracking finished, and those it gave up on.
+     * Their tries, and the tries that did not get through. */
+    uint32_t finished;
+    uint32_t undelivered;
+    uint32_t attempts;
+    uint32_t lost;
+    /* When the last one finished. */
+    int64_t last_finish_us;
+} zb_benchmark_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_benchmark_begin()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Forget the last run's counts. The calling task is the one
+ * zb_benchmark_wait() wakes up.
+ */
+void zb_benchmark_begin(void);
+
+/*--------------------------------------------------------------
+ * zb_benchmark_sent()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Remember the TSN of a command handed to the stack. Called
+ * by the command queue's send callback, with the Zigbee lock held.
+ * Commands that are not a benchmark's are ignored.
+ */
+void zb_benchmark_sent(const zb_command_t *command, uint8_t tsn);
+
+/*--------------------------------------------------------------
+ * zb_benchmark_send_status()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Match a send status to its command. Call it for every send
+ * status.
+ */
+void zb_benchmark_send_status(const esp_zb_zcl_command_send_status_message_t *message);
+
+/*--------------------------------------------------------------
+ * zb_benchmark_finished()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Count a command that delivery tracking finished. Call it
+ * from the zb_delivery finished callback. Commands that are not a
+ * benchmark's are ignored.
+ */
+void zb_benchmark_finished(const zb_command_t *command, bool ok, uint8_t attempts);
+
+/*--------------------------------------------------------------
+ * zb_benchmark_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_benchmark_get_stats(zb_benchmark_stats_t *stats);
+
+/*--------------------------------------------------------------
+ * zb_benchmark_wait()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Wait until `statuses` send statuses in all have come back
+ * since zb_benchmark_begin(). Only the task that called it may wait.
+ *
+ * @param deadline_us esp_timer_get_time() to give up at.
+ * @param stats The stats when the wait ended either way.
+ *
+ * @return ESP_ERR_TIMEOUT if they had not all come back by then.
+ */
+esp_err_t zb_benchmark_wait(uint32_t statuses, int64_t deadline_us, zb_benchmark_stats_t *stats);
+
+/*--------------------------------------------------------------
+ * zb_benchmark_wait_finished()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief The same, until `finished` commands in all have finished.
+ */
+esp_err_t zb_benchmark_wait_finished(uint32_t finished, int64_t deadline_us, zb_benchmark_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,131 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Bulk transfers to one follower, for payloads too big
+ * for a ZCL command (LED animation frames, configuration blocks).
+ * The payload is cut into fragments and sent as raw APS frames on a
+ * private profile, a window of fragments at a time. The follower
+ * acknowledges what it has, and the leader sends the rest again
+ * until everything is there. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Where bulk frames go, on both sides. Must match bulk_receiver.h on
+ * the follower. */
+#define ZB_BULK_ENDPOINT 200
+#define ZB_BULK_PROFILE_ID 0xC0B5
+#define ZB_BULK_CLUSTER_ID 0x0001
+
+/* Frame header: type, transfer ID, then for data the fragment number
+ * and fragment count, for an acknowledgement the first missing
+ * fragment and a bitmap of the 16 after it. All little-endian. */
+#define ZB_BULK_FRAME_DATA 0
+#define ZB_BULK_FRAME_ACK 1
+#define ZB_BULK_HEADER_SIZE 6
+
+/* Payload bytes per fragment. With the header, this keeps a frame
+ * within one secured 802.15.4 frame, so APS never fragments it. */
+#define ZB_BULK_FRAGMENT_SIZE 64
+/* Fragments are tracked in a 64-bit map. */
+#define ZB_BULK_MAX_FRAGMENTS 64
+#define ZB_BULK_MAX_SIZE (ZB_BULK_FRAGMENT_SIZE * ZB_BULK_MAX_FRAGMENTS)
+
+/* Fragments in flight before waiting for an acknowledgement. */
+#define ZB_BULK_WINDOW 8
+/* Time without progress before the window is sent again. */
+#define ZB_BULK_RETRY_MS 500
+#define ZB_BULK_MAX_RETRIES 5
+
+/* Estimated bytes on air per frame besides the APS payload: PHY
+ * header (6), MAC header and FCS (11), NWK header (8), NWK security
+ * (18), APS header (8), and the MAC acknowledgement (11). */
+#define ZB_BULK_AIR_OVERHEAD 62
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    uint8_t transfer_id;
+    uint16_t short_addr;
+    /* ESP_ERR_NOT_FINISHED while running, then ESP_OK or
+     * ESP_ERR_TIMEOUT. */
+    esp_err_t status;
+    uint16_t bytes;
+    uint16_t fragments;
+    /* Data frames sent, retransmissions included. */
+    uint32_t data_frames;
+    uint32_t retransmissions;
+    uint32_t ack_frames;
+    /* Estimated bytes on air both ways, see ZB_BULK_AIR_OVERHEAD. */
+    uint32_t air_bytes;
+    int64_t start_us;
+    int64_t elapsed_us;
+} zb_bulk_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_bulk_send()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Start sending `data` to a follower. The data is copied.
+ * Must be called from the Zigbee task or with the Zigbee lock held.
+ *
+ * @return ESP_ERR_INVALID_STATE if a transfer is already running.
+ */
+esp_err_t zb_bulk_send(uint16_t short_addr, const uint8_t *data, uint16_t length);
+
+/*--------------------------------------------------------------
+ * zb_bulk_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take bulk acknowledgements out of the incoming APS frames.
+ * Call it from the handler registered with
+ * esp_zb_aps_data_indication_handler_register().
+ *
+ * @return true if the frame was for us.
+ */
+bool zb_bulk_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * zb_bulk_get_stats()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Copy the stats of the current or last transfer.
+ *
+ * @return true once the transfer is over.
+ */
+bool zb_bulk_get_stats(zb_bulk_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
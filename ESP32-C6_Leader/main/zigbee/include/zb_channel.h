@@ -0,0 +1,147 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Channel selection for the coordinator. An energy
+ * detect scan measures all 16 channels, the quietest one is chosen
+ * to form the network on, and the scan is repeated now and then to
+ * report new interference (e.g. Wi-Fi). The network only moves when
+ * asked to, with zb_channel_change().
+ *
+ * zb_channel_rank() and zb_channel_select() are pure, they only look
+ * at their arguments, so they can be built and checked on a host
+ * with recorded scan data (see zb_channel_select.c). */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* The 2.4 GHz channels. */
+#define ZB_CHANNEL_FIRST 11
+#define ZB_CHANNEL_LAST 26
+#define ZB_CHANNEL_COUNT (ZB_CHANNEL_LAST - ZB_CHANNEL_FIRST + 1)
+
+/* Time on each channel, ((1 << n) + 1) beacon intervals of 15.36 ms.
+ * 2 is about 77 ms, so a full scan takes the radio off the network
+ * for about 1.2 s. */
+#define ZB_CHANNEL_SCAN_DURATION 2
+
+/* How often the leader scans again once the network is up. */
+#define ZB_CHANNEL_RESCAN_PERIOD_MS (10 * 60 * 1000)
+
+/* A channel change costs every follower a rejoin, so only suggest
+ * one if the new channel is at least this much quieter. */
+#define ZB_CHANNEL_CHANGE_MARGIN_DB 10
+
+/* Energy on a neighbouring channel counts this much less than energy
+ * on the channel itself. */
+#define ZB_CHANNEL_ADJACENT_REJECTION_DB 15
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    /* Energy of channel ZB_CHANNEL_FIRST + i, in dBm, INT8_MIN if it
+     * was not measured. */
+    int8_t energy_dbm[ZB_CHANNEL_COUNT];
+    /* Channels that were actually measured. */
+    uint32_t channel_mask;
+    /* When the scan finished, 0 if there was none yet. */
+    int64_t time_us;
+} zb_channel_scan_t;
+
+/* Called in the Zigbee task when a scan is done. `best` is the
+ * channel to use, or 0 if the scan failed. */
+typedef void (*zb_channel_scan_cb_t)(uint8_t best);
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_channel_rank()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Sort the channels in `channel_mask` from quietest to
+ * noisiest. A channel scores its own energy, or its neighbours'
+ * energy less ZB_CHANNEL_ADJACENT_REJECTION_DB if that is higher.
+ * Equal scores keep channel order.
+ *
+ * @param ranked Returned channels, quietest first.
+ *
+ * @return How many channels were ranked.
+ */
+uint8_t zb_channel_rank(const int8_t energy_dbm[ZB_CHANNEL_COUNT], uint32_t channel_mask, uint8_t ranked[ZB_CHANNEL_COUNT]);
+
+/*--------------------------------------------------------------
+ * zb_channel_select()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Pick the channel to be on.
+ *
+ * @param current_channel The channel in use, or 0 if none yet.
+ * @param margin_db How much quieter another channel must be to
+ * leave `current_channel`.
+ *
+ * @return The channel, or 0 if `channel_mask` has no channels.
+ */
+uint8_t zb_channel_select(const int8_t energy_dbm[ZB_CHANNEL_COUNT], uint32_t channel_mask, uint8_t current_channel,
+                          int8_t margin_db);
+
+/*--------------------------------------------------------------
+ * zb_channel_scan()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Start an energy detect scan of every channel. Must be called
+ * from the Zigbee task or with the Zigbee lock held.
+ *
+ * @param done Called with the channel to use when the scan is done.
+ *
+ * @return ESP_ERR_INVALID_STATE if a scan is already running.
+ */
+esp_err_t zb_channel_scan(zb_channel_scan_cb_t done);
+
+/*--------------------------------------------------------------
+ * zb_channel_change()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Move the whole network to another channel, with a ZDO
+ * Mgmt_NWK_Update_req broadcast through ZBOSS, which also bumps the
+ * network update ID and moves the coordinator. Routers switch with
+ * it; end devices find the network again by rejoining. Must be
+ * called from the Zigbee task or with the Zigbee lock held.
+ */
+esp_err_t zb_channel_change(uint8_t channel);
+
+/*--------------------------------------------------------------
+ * zb_channel_get_last_scan()
+ *------------------------------------------------------------*/
+
+void zb_channel_get_last_scan(zb_channel_scan_t *scan);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,272 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: An outbound queue for Zigbee commands. Producers
+ * (UART, buttons) enqueue a small command descriptor and return at
+ * once. A dispatcher task takes the Zigbee lock and sends whatever
+ * is pending in one batch, so a busy stack never stalls producers.
+ *
+ * Commands wait per destination, and the destinations take turns by
+ * deficit round robin, so each gets its share of the air whatever
+ * the others queue up. A destination also has only so many commands
+ * with the stack at once, so one behind a bad link, whose sends take
+ * long to be confirmed, holds up nobody but itself. Interactive
+ * commands skip all of that in a lane of their own. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+#include "freertos/FreeRTOS.h"
+#include "led_effects.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Commands waiting, over all destinations, and for one. */
+#define ZB_COMMAND_QUEUE_LENGTH 32
+#define ZB_COMMAND_QUEUE_FLOW_BACKLOG 8
+/* Destinations tracked at once. One that has nothing waiting or in
+ * flight makes room for a new one, the least recently used first. */
+#define ZB_COMMAND_QUEUE_FLOWS 24
+/* Commands per destination handed to the stack and not yet
+ * confirmed. One whose confirmation has not come after the stall
+ * time no longer counts. */
+#define ZB_COMMAND_QUEUE_FLOW_IN_FLIGHT 2
+#define ZB_COMMAND_QUEUE_FLOW_STALL_MS 3000
+/* Bytes of ZCL frame a destination may send per turn. At least the
+ * largest command, so every turn sends something. */
+#define ZB_COMMAND_QUEUE_QUANTUM 16
+/* Most commands sent per lock acquisition. */
+#define ZB_COMMAND_QUEUE_BATCH_SIZE 4
+/* Sent commands whose latency is still being measured. */
+#define ZB_COMMAND_QUEUE_IN_FLIGHT 8
+#define ZB_COMMAND_QUEUE_TASK_PRIORITY configMAX_PRIORITIES - 3
+#define ZB_COMMAND_QUEUE_TASK_STACK_DEPTH 4096
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+/* Where a command goes. Zero-initialized means "every bound
+ * follower". */
+typedef enum
+{
+    ZB_COMMAND_DST_BOUND = 0,
+    ZB_COMMAND_DST_SHORT,
+    /* Every member of a group, in one frame. */
+    ZB_COMMAND_DST_GROUP,
+} zb_command_dst_mode_t;
+
+typedef struct
+{
+    zb_command_dst_mode_t mode;
+    /* ZB_COMMAND_DST_SHORT only. */
+    uint16_t short_addr;
+    uint8_t endpoint;
+    /* ZB_COMMAND_DST_GROUP only. */
+    uint16_t group_id;
+} zb_command_dst_t;
+
+typedef enum
+{
+    /* Takes its turn with the other commands to its destination. */
+    ZB_COMMAND_PRIORITY_NORMAL = 0,
+    /* Someone is waiting to see it, a GUI click or a button press.
+     * Sent before any normal command. */
+    ZB_COMMAND_PRIORITY_INTERACTIVE,
+} zb_command_priority_t;
+
+typedef enum
+{
+    ZB_COMMAND_ON_OFF_TOGGLE = 0,
+    ZB_COMMAND_LED_EFFECT,
+    /* Ask a follower to join or leave a group. */
+    ZB_COMMAND_GROUP_ADD,
+    ZB_COMMAND_GROUP_REMOVE,
+    /* Store or recall a scene, or ask which scenes a follower has. */
+    ZB_COMMAND_SCENE_STORE,
+    ZB_COMMAND_SCENE_RECALL,
+    ZB_COMMAND_SCENE_MEMBERSHIP,
+    /* Switch on or off, the same however often it arrives. */
+    ZB_COMMAND_ON_OFF_SET,
+    /* Ask a follower to report an attribute, or to read it now. */
+    ZB_COMMAND_CONFIG_REPORT,
+    ZB_COMMAND_READ_ATTR,
+    ZB_COMMAND_TYPE_COUNT
+} zb_command_type_t;
+
+typedef struct
+{
+    zb_command_type_t type;
+    zb_command_dst_t dst;
+    zb_command_priority_t priority;
+    /* Set by zb_command_queue_send(). */
+    int64_t enqueued_us;
+    /* Set by zb_delivery_send(), 0 for commands nobody waits on. */
+    uint16_t request_id;
+    /* Sent by a benchmark, which times it by its TSN, see
+     * zb_benchmark.h. */
+    bool benchmark;
+    union
+    {
+        led_effect_params_t effect;
+        uint16_t group_id;
+        struct
+        {
+            uint16_t group_id;
+            uint8_t scene_id;
+        } scene;
+        bool on_off;
+        struct
+        {
+            uint16_t cluster_id;
+            uint16_t attr_id;
+            /* ZB_COMMAND_CONFIG_REPORT only. */
+            uint8_t attr_type;
+        } attr;
+    } data;
+} zb_command_t;
+
+/* Send one command. Called by the dispatcher with the Zigbee lock
+ * held. Returns the ZCL transaction sequence number (TSN). */
+typedef uint8_t (*zb_command_send_cb_t)(const zb_command_t *command);
+
+typedef struct
+{
+    uint32_t depth;
+    uint32_t max_depth;
+    uint32_t enqueued;
+    uint32_t sent;
+    /* Commands rejected because the queue was full. */
+    uint32_t dropped;
+    uint32_t batches;
+    /* Time the dispatcher waited for the Zigbee lock. */
+    uint32_t last_lock_wait_us;
+    uint32_t max_lock_wait_us;
+    /* Time from enqueueing to the stack reporting the send status. */
+    uint32_t last_latency_us;
+    uint32_t max_latency_us;
+    /* The same, split at handing the command to the stack. */
+    uint32_t last_queued_us;
+    uint32_t last_confirm_us;
+    /* Send statuses reported by the stack, failed or not. */
+    uint32_t statuses;
+    uint32_t send_failures;
+    /* When the last send status was reported. */
+    int64_t last_status_us;
+    /* Commands handed to the stack still waiting for their first send
+     * status. Each holds at least one of the stack's I/O buffers, so
+     * the most there were is a floor for the buffers needed. */
+    uint32_t in_flight;
+    uint32_t max_in_flight;
+    /* Interactive commands, and the longest one waited. */
+    uint32_t interactive_sent;
+    uint32_t max_interactive_wait_us;
+} zb_command_queue_stats_t;
+
+/* One destination, since it was first tracked. */
+typedef struct
+{
+    zb_command_dst_t dst;
+    /* Commands waiting, and the most there were. */
+    uint32_t backlog;
+    uint32_t max_backlog;
+    uint32_t in_flight;
+    uint32_t sent;
+    /* Refused because its backlog was full. */
+    uint32_t dropped;
+    /* Times its sends went unconfirmed for the stall time. */
+    uint32_t stalls;
+    /* Time from enqueueing to being handed to the stack. */
+    uint64_t total_wait_us;
+    uint32_t max_wait_us;
+} zb_command_flow_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_command_queue_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Create the queue and the dispatcher task.
+ *
+ * @param send Sends one command, with the Zigbee lock held.
+ */
+esp_err_t zb_command_queue_init(zb_command_send_cb_t send);
+
+/*--------------------------------------------------------------
+ * zb_command_queue_send()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Enqueue a command without blocking.
+ *
+ * @return ESP_ERR_NO_MEM if the queue, or the destination's share
+ * of it, is full, the command is dropped.
+ */
+esp_err_t zb_command_queue_send(const zb_command_t *command);
+
+/*--------------------------------------------------------------
+ * zb_command_queue_send_wait()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Enqueue a command, waiting up to `ticks_to_wait` for room.
+ * For callers that would rather be paced than drop commands.
+ *
+ * @return ESP_ERR_TIMEOUT if there was still no room, the command is
+ * dropped.
+ */
+esp_err_t zb_command_queue_send_wait(const zb_command_t *command, TickType_t ticks_to_wait);
+
+/*--------------------------------------------------------------
+ * zb_command_queue_send_status()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Feed the stack's send status of a ZCL command back to the
+ * queue, to measure latency. Call it from the handler registered
+ * with esp_zb_zcl_command_send_status_handler_register().
+ */
+void zb_command_queue_send_status(const esp_zb_zcl_command_send_status_message_t *message);
+
+/*--------------------------------------------------------------
+ * zb_command_queue_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_command_queue_get_stats(zb_command_queue_stats_t *stats);
+
+/*--------------------------------------------------------------
+ * zb_command_queue_get_flow_stats()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Copy the stats of up to `max_count` tracked destinations.
+ *
+ * @return The number copied.
+ */
+uint32_t zb_command_queue_get_flow_stats(zb_command_flow_stats_t *stats, uint32_t max_count);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,127 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Commissioning of new followers, paced. A device that
+ * announces itself waits in a bounded queue. The leader then finds
+ * its light endpoint and binds it both ways, one ZDO request at a
+ * time per device and only so many at once overall, so a crowd of
+ * devices powering up together does not run the stack out of
+ * buffers. A request that fails is tried again after a backoff.
+ *
+ * Each device is logged as "COMMISSION id=<id> short=<addr>
+ * ms=<ms> retries=<n>" once it is fully commissioned, the time
+ * counted from its announcement. Once the queue runs empty, the whole
+ * batch is logged as "COMMISSION_BATCH devices=<n> commissioned=<n>
+ * failed=<n> retries=<n> concurrency=<n> ms=<ms>". */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Devices waiting or being commissioned. More are refused until they
+ * announce themselves again. */
+#define ZB_COMMISSION_QUEUE_SIZE 64
+
+/* ZDO requests outstanding at once, by default and at most. */
+#define ZB_COMMISSION_CONCURRENCY 4
+#define ZB_COMMISSION_MAX_CONCURRENCY 16
+
+/* Tries per request, and the backoff before the first retry, doubled
+ * for each one after it. */
+#define ZB_COMMISSION_MAX_ATTEMPTS 4
+#define ZB_COMMISSION_BACKOFF_BASE_MS 500
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+/* Called in the Zigbee task once a follower's light endpoint is found
+ * and in the registry. */
+typedef void (*zb_commission_found_cb_t)(uint16_t id);
+/* Called in the Zigbee task once a follower binds one of its
+ * FOLLOWER_CLUSTER_* back to us, so its reports can be set up. */
+typedef void (*zb_commission_reporting_cb_t)(uint16_t id, uint8_t cluster);
+
+typedef struct
+{
+    /* Devices in the queue, the most there were, and those turned
+     * away because it was full. */
+    uint16_t queued;
+    uint16_t max_queued;
+    uint16_t refused;
+    /* Requests outstanding. */
+    uint8_t in_flight;
+    uint8_t concurrency;
+    /* Since boot. */
+    uint16_t commissioned;
+    uint16_t failed;
+    uint16_t retries;
+} zb_commission_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_commission_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Set what commissioning binds to and who hears of it.
+ *
+ * @param endpoint Our endpoint the followers are bound to.
+ * @param effects_cluster_id The LED effects cluster, bound along with
+ * On/Off.
+ */
+esp_err_t zb_commission_init(uint8_t endpoint, uint16_t effects_cluster_id, zb_commission_found_cb_t found_cb,
+                             zb_commission_reporting_cb_t reporting_cb);
+
+/*--------------------------------------------------------------
+ * zb_commission_enqueue()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Commission a device that announced itself. One already in
+ * the queue only has its short address brought up to date. Must be
+ * called from the Zigbee task.
+ */
+esp_err_t zb_commission_enqueue(const esp_zb_ieee_addr_t ieee_addr, uint16_t short_addr);
+
+/*--------------------------------------------------------------
+ * zb_commission_set_concurrency()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Set how many ZDO requests may be outstanding at once. Must
+ * be called from the Zigbee task or with the Zigbee lock held.
+ */
+esp_err_t zb_commission_set_concurrency(uint8_t concurrency);
+
+/*--------------------------------------------------------------
+ * zb_commission_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_commission_get_stats(zb_commission_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,157 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Delivery tracking for commands a user asked for.
+ * Each one gets a request ID, and is followed by the TSN the stack
+ * gave it through its send status and, for a single follower, its
+ * default response. Lost ones are sent again after a backoff that
+ * doubles each time, with some jitter so followers that lost
+ * commands together do not all get them again at once. The outcome
+ * is logged under the request ID, for the UART caller to read. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+#include "zb_command_queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Commands whose outcome is not known yet. More are sent, but not
+ * tracked. */
+#define ZB_DELIVERY_MAX_PENDING 32
+/* Tries per command, the first one included. */
+#define ZB_DELIVERY_MAX_ATTEMPTS 5
+/* The first backoff, doubled on every retry up to the cap. Each is
+ * then moved by up to a quarter either way. */
+#define ZB_DELIVERY_BACKOFF_BASE_MS 250
+#define ZB_DELIVERY_BACKOFF_MAX_MS 4000
+/* Longest wait for a send status before sending again. */
+#define ZB_DELIVERY_STATUS_TIMEOUT_MS 3000
+/* Longest wait for a default response once the follower has
+ * acknowledged the frame. Followers may not send one, so none is
+ * taken as delivered. */
+#define ZB_DELIVERY_RESPONSE_TIMEOUT_MS 1000
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    /* Commands being tracked, and the most there were. */
+    uint16_t pending;
+    uint16_t max_pending;
+    /* Commands sent untracked because every slot was taken. */
+    uint32_t untracked;
+    /* Since boot: tries handed to the stack, those lost to a failed
+     * send or a missing send status, and commands sent again. */
+    uint32_t attempts;
+    uint32_t lost;
+    uint32_t retries;
+    /* Commands finished either way, those that failed, and when the
+     * last one finished. */
+    uint32_t finished;
+    uint32_t failed;
+    int64_t last_finish_us;
+} zb_delivery_stats_t;
+
+/* Told the outcome of each command with a request ID, and the tries
+ * it took, in the Zigbee task or with the Zigbee lock held. A command
+ * sent untracked counts as failed after one try, its outcome is never
+ * known. */
+typedef void (*zb_delivery_finished_cb_t)(const zb_command_t *command, bool ok, uint8_t attempts);
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_delivery_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Set who is told the outcome of each command. Call it before
+ * the first zb_delivery_send().
+ */
+esp_err_t zb_delivery_init(zb_delivery_finished_cb_t finished);
+
+/*--------------------------------------------------------------
+ * zb_delivery_send()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Give a command a request ID and enqueue it. Logs
+ * "DELIVERY req=<id> queued", and later either
+ * "DELIVERY req=<id> ok attempts=<n> ms=<ms>" or
+ * "DELIVERY req=<id> failed attempts=<n> reason=<why>".
+ *
+ * On/off toggles are never sent again, since a toggle that did
+ * arrive would be undone. Their outcome is still logged.
+ *
+ * @return ESP_ERR_NO_MEM if the command queue is full, the command
+ * is dropped.
+ */
+esp_err_t zb_delivery_send(zb_command_t *command);
+
+/*--------------------------------------------------------------
+ * zb_delivery_sent()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Remember the TSN of a command handed to the stack. Called
+ * by the command queue's send callback, with the Zigbee lock held.
+ * Commands without a request ID are ignored.
+ */
+void zb_delivery_sent(const zb_command_t *command, uint8_t tsn);
+
+/*--------------------------------------------------------------
+ * zb_delivery_send_status()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Match a send status to its command. Call it for every send
+ * status.
+ */
+void zb_delivery_send_status(const esp_zb_zcl_command_send_status_message_t *message);
+
+/*--------------------------------------------------------------
+ * zb_delivery_default_response()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Match a default response to its command. Call it from the
+ * action handler.
+ */
+void zb_delivery_default_response(const esp_zb_zcl_cmd_default_resp_message_t *message);
+
+/*--------------------------------------------------------------
+ * zb_delivery_get_stats()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Must be called from the Zigbee task or with the Zigbee lock
+ * held.
+ */
+void zb_delivery_get_stats(zb_delivery_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
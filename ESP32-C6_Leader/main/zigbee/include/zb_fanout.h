@@ -0,0 +1,112 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Fan-out of one command to many followers, spread out
+ * in time. Sent back to back, the unicasts all go on the air at once,
+ * where they and the followers' acknowledgements contend for the
+ * channel and are lost to collisions and retried. Here each
+ * destination gets a slot of its own in a window, and its command is
+ * sent at a random point of its slot, so sends are apart by at least
+ * half a slot and do not line up with anything else periodic.
+ *
+ * The slot widens while tries are being lost and narrows again while
+ * they are not, going by the loss rate delivery tracking measures
+ * (zb_delivery.h). Every command is sent with zb_delivery_send(), so
+ * each has its outcome logged and is retried like any other. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "zb_command_queue.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Commands scheduled and not sent yet, over all fan-outs. */
+#define ZB_FANOUT_MAX_COMMANDS 32
+
+/* Time per destination, at first and within which it adapts. The
+ * window of a fan-out is the slot times its destinations. */
+#define ZB_FANOUT_SLOT_MS 8
+#define ZB_FANOUT_MIN_SLOT_MS 2
+#define ZB_FANOUT_MAX_SLOT_MS 64
+/* Tries between adaptations, fewer say too little about the loss
+ * rate. */
+#define ZB_FANOUT_MIN_SAMPLES 16
+/* Loss rates above which the slot is doubled, and below which it is
+ * cut by a quarter. */
+#define ZB_FANOUT_LOSS_HIGH_PCT 10
+#define ZB_FANOUT_LOSS_LOW_PCT 2
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    uint16_t slot_ms;
+    bool adaptive;
+    /* Tries lost, of those between the last two adaptations. */
+    uint8_t loss_pct;
+    /* Commands scheduled, and the most there were. */
+    uint16_t scheduled;
+    uint16_t max_scheduled;
+    /* Since boot. Dropped commands found the command queue full when
+     * their time came. */
+    uint32_t fanouts;
+    uint32_t commands;
+    uint32_t dropped;
+} zb_fanout_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_fanout_send()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Send `count` commands, in order, across a window of
+ * `count` slots. Must be called from the Zigbee task or with the
+ * Zigbee lock held.
+ *
+ * @return ESP_ERR_NO_MEM if they do not all fit, none is sent.
+ */
+esp_err_t zb_fanout_send(const zb_command_t *commands, uint32_t count);
+
+/*--------------------------------------------------------------
+ * zb_fanout_set_slot()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Fix the slot, or let it adapt again, from where it is, if 0.
+ * Must be called from the Zigbee task or with the Zigbee lock held.
+ */
+esp_err_t zb_fanout_set_slot(uint16_t slot_ms);
+
+/*--------------------------------------------------------------
+ * zb_fanout_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_fanout_get_stats(zb_fanout_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,154 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: End-to-end latency, from a command arriving over UART
+ * to the follower's LED changing. The leader times its own stages,
+ * the follower times its own and reports them back, and the samples
+ * are summed up as percentiles and a histogram per stage, logged for
+ * the GUI to plot. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Latency frames go to the bulk endpoint and profile (zb_bulk.h) on
+ * a cluster of their own. Must match light_latency.h on the
+ * follower. */
+#define ZB_LATENCY_CLUSTER_ID 0x0002
+/* Leader to follower: report or stop reporting, 1 byte. */
+#define ZB_LATENCY_FRAME_MODE 0
+/* Follower to leader: the time from receiving the command to the
+ * LED refresh in us, 4 bytes, little-endian. */
+#define ZB_LATENCY_FRAME_REPORT 1
+#define ZB_LATENCY_REPORT_SIZE 5
+
+/* Samples kept per stage, older ones are dropped. */
+#define ZB_LATENCY_MAX_SAMPLES 256
+
+/* Histogram bucket n counts samples under (1 << n) ms, the last one
+ * everything else. */
+#define ZB_LATENCY_BUCKETS 13
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef enum
+{
+    /* Leader: UART receive to handing the frame to the stack. */
+    ZB_LATENCY_UART_TO_SUBMIT = 0,
+    /* Leader: handing the frame to the stack to its send status. */
+    ZB_LATENCY_SUBMIT_TO_CONFIRM,
+    /* Follower: receiving the command to the LED refresh. */
+    ZB_LATENCY_RECEIVE_TO_LED,
+    /* UART receive to the LED refresh, the sum of the above. A little
+     * high, the send status comes after the follower has the frame. */
+    ZB_LATENCY_END_TO_END,
+    /* UART receive to the follower's report arriving. */
+    ZB_LATENCY_ROUND_TRIP,
+    ZB_LATENCY_STAGE_COUNT
+} zb_latency_stage_t;
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+    uint32_t buckets[ZB_LATENCY_BUCKETS];
+} zb_latency_summary_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_latency_set_mode()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Ask a follower to report, or stop reporting, its latency
+ * for every on/off command. Must be called from the Zigbee task or
+ * with the Zigbee lock held.
+ */
+esp_err_t zb_latency_set_mode(uint16_t short_addr, bool enabled);
+
+/*--------------------------------------------------------------
+ * zb_latency_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take latency reports out of the incoming APS frames. Call
+ * it from the handler registered with
+ * esp_zb_aps_data_indication_handler_register().
+ *
+ * @return true if the frame was for us.
+ */
+bool zb_latency_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * zb_latency_get_report()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Copy the last report from a follower.
+ *
+ * @param receive_to_led_us The follower's latency.
+ * @param received_us When the report arrived, 0 if none did. A new
+ * report is told from the last one by this.
+ */
+void zb_latency_get_report(uint32_t *receive_to_led_us, int64_t *received_us);
+
+/*--------------------------------------------------------------
+ * zb_latency_reset()
+ *------------------------------------------------------------*/
+
+void zb_latency_reset(void);
+
+/*--------------------------------------------------------------
+ * zb_latency_add()
+ *------------------------------------------------------------*/
+
+void zb_latency_add(zb_latency_stage_t stage, uint32_t latency_us);
+
+/*--------------------------------------------------------------
+ * zb_latency_summarize()
+ *------------------------------------------------------------*/
+
+void zb_latency_summarize(zb_latency_stage_t stage, zb_latency_summary_t *summary);
+
+/*--------------------------------------------------------------
+ * zb_latency_log()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Log the summary of every stage, one line each as
+ * "LATENCY <stage> n=<n> p50=<us> p95=<us> p99=<us> max=<us>
+ * hist=<count>,...", which the GUI plots.
+ */
+void zb_latency_log(void);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
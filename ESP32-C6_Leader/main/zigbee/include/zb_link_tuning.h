@@ -0,0 +1,171 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Tuning of the network's background frames to the
+ * network. Two kinds of frame go out whether anyone is using the
+ * network or not: the leader's NWK link status, every link status
+ * period, and each follower's keep-alive to its parent, every
+ * keep-alive interval. Their defaults suit a small, shaky network,
+ * and in a dense one they take a good part of the air.
+ *
+ * The leader samples its neighbour table and counts its own
+ * commands, and once a minute decides from them:
+ *     - The link status period. Only routers listen to link status,
+ *       so with none around it is stretched as far as it goes. With
+ *       routers it stays at the default while their link quality
+ *       (LQI) moves, and is stretched while it holds still, more so
+ *       while the leader is busy sending.
+ *     - The followers' keep-alive interval. The more followers there
+ *       are, the longer it gets, so they send about a set number of
+ *       keep-alives a minute between them. It is halved while LQI
+ *       moves, so a follower that lost its parent notices soon, and
+ *       doubled while the leader is busy.
+ * Followers are told their keep-alive over a cluster of their own,
+ * a few at a time, and answer with the one they applied.
+ *
+ * Every change is logged as "LINK_TUNING link_status_s=<s>
+ * keep_alive_ms=<ms> routers=<n> followers=<n> lqi_delta=<x.y>
+ * traffic_per_min=<n> background_per_min=<before>-><after>". The
+ * background frames a minute are worked out from the link status
+ * period and the keep-alive each follower applied, since the stack
+ * does not count them. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Keep-alive frames go to the bulk endpoint and profile (zb_bulk.h)
+ * on a cluster of their own. Must match light_link.h on the
+ * follower. */
+#define ZB_LINK_TUNING_CLUSTER_ID 0x0005
+/* Leader to follower: the keep-alive interval to use in ms, 4 bytes,
+ * little-endian. */
+#define ZB_LINK_TUNING_FRAME_KEEP_ALIVE 0
+/* Follower to leader: the keep-alive interval it applied, the same
+ * way. */
+#define ZB_LINK_TUNING_FRAME_APPLIED 1
+#define ZB_LINK_TUNING_FRAME_SIZE 5
+
+/* The neighbour table is sampled this often, and a decision taken
+ * every so many samples. */
+#define ZB_LINK_TUNING_SAMPLE_PERIOD_MS (10 * 1000)
+#define ZB_LINK_TUNING_SAMPLES 6
+/* Neighbours whose LQI is followed. */
+#define ZB_LINK_TUNING_MAX_NEIGHBOURS 32
+/* Average LQI change between samples, in tenths, up to which the
+ * links count as holding still. */
+#define ZB_LINK_TUNING_STABLE_LQI_DELTA_X10 40
+/* Commands the leader sent in a minute from which it counts as
+ * busy. */
+#define ZB_LINK_TUNING_BUSY_PER_MIN 120
+
+/* Link status periods, in s. Routers drop a neighbour after three
+ * link status periods of their own without hearing from it, 15 s by
+ * default, so with routers it stays under 45 s. */
+#define ZB_LINK_TUNING_LINK_STATUS_STABLE_S 30
+#define ZB_LINK_TUNING_LINK_STATUS_BUSY_S 40
+#define ZB_LINK_TUNING_LINK_STATUS_NO_ROUTERS_S 120
+
+/* Keep-alive intervals. The default is the followers' ED_KEEP_ALIVE,
+ * which they use until told otherwise. The most stays well inside
+ * their end device timeout. */
+#define ZB_LINK_TUNING_KEEP_ALIVE_DEFAULT_MS 3000
+#define ZB_LINK_TUNING_KEEP_ALIVE_MAX_MS (60 * 1000)
+/* Keep-alives a minute the followers should send between them. */
+#define ZB_LINK_TUNING_KEEP_ALIVE_BUDGET_PER_MIN 120
+/* Followers told their keep-alive per sample, and samples before
+ * one that did not answer is told again. */
+#define ZB_LINK_TUNING_UPDATES_PER_SAMPLE 8
+#define ZB_LINK_TUNING_RETRY_SAMPLES 6
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool enabled;
+    uint8_t link_status_s;
+    /* What the followers are told. */
+    uint32_t keep_alive_ms;
+    /* At the last decision. */
+    uint16_t routers;
+    uint16_t followers;
+    /* Followers that applied the keep-alive they are told. */
+    uint16_t followers_applied;
+    uint16_t lqi_delta_x10;
+    uint32_t traffic_per_min;
+    /* Background frames a minute with the defaults, and now. */
+    uint32_t default_background_per_min;
+    uint32_t background_per_min;
+    /* Since boot. */
+    uint32_t decisions;
+    uint32_t updates_sent;
+} zb_link_tuning_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_start()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Start sampling, once the network is up. Must be called from
+ * the Zigbee task.
+ */
+void zb_link_tuning_start(void);
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_set_enabled()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Tune, or go back to the defaults and stay there. Must be
+ * called from the Zigbee task or with the Zigbee lock held.
+ */
+void zb_link_tuning_set_enabled(bool enabled);
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take the followers' answers out of the incoming APS frames.
+ * Call it from the handler registered with
+ * esp_zb_aps_data_indication_handler_register().
+ *
+ * @return true if the frame was for us.
+ */
+bool zb_link_tuning_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_link_tuning_get_stats(zb_link_tuning_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
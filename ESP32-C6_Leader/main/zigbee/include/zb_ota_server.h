@@ -0,0 +1,171 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The leader as OTA upgrade server for the followers.
+ * A follower image, already wrapped as a Zigbee OTA file, is staged
+ * in a flash partition of its own (see zb_ota_upload.h for how it
+ * gets there), announced with an image notify, and served to every
+ * follower that asks for it, many at a time. Each follower's
+ * transfer time and the number of followers served at once are
+ * logged for the GUI. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* The staging partition, see partitions.csv. */
+#define ZB_OTA_PARTITION_NAME "ota_stage"
+#define ZB_OTA_PARTITION_SUBTYPE 0x40
+
+/* The follower image. Must match light_ota.h on the follower. */
+#define ZB_OTA_MANUFACTURER_CODE 0x131B
+#define ZB_OTA_IMAGE_TYPE 0x1011
+
+/* Zigbee OTA file header, all little-endian. Only the fields the
+ * server needs are read. */
+#define ZB_OTA_FILE_IDENTIFIER 0x0BEEF11E
+#define ZB_OTA_HEADER_SIZE 56
+
+/* Only one image is served at a time. */
+#define ZB_OTA_FILE_INDEX 0
+#define ZB_OTA_FILE_COUNT 1
+
+/* Followers that answer an image notify, in percent. All of them, so
+ * one notify starts every follower at once. */
+#define ZB_OTA_QUERY_JITTER 100
+
+/* Followers tracked at once. More are refused a block until one
+ * finishes, and ask again. */
+#define ZB_OTA_MAX_CLIENTS 16
+/* A follower that has not asked for a block for this long no longer
+ * counts as being served. */
+#define ZB_OTA_ACTIVE_MS 5000
+/* One that asks again after this long starts over. */
+#define ZB_OTA_RESTART_MS 30000
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool ready;
+    uint32_t size;
+    uint32_t file_version;
+    /* Followers being served now, and the most there have been. */
+    uint16_t active;
+    uint16_t max_active;
+    /* Since the image was staged. */
+    uint16_t finished;
+    uint16_t aborted;
+    /* Blocks a follower asked for again, its first answer lost. */
+    uint32_t resent;
+} zb_ota_server_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_ota_stage_begin()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Drop the staged image and erase room for a new one of
+ * `size` bytes. Takes a while, up to a few seconds for a full image.
+ */
+esp_err_t zb_ota_stage_begin(uint32_t size);
+
+/*--------------------------------------------------------------
+ * zb_ota_stage_write()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_stage_write(uint32_t offset, const uint8_t *data, uint32_t length);
+
+/*--------------------------------------------------------------
+ * zb_ota_stage_end()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Check the header of the staged image and make it the one
+ * served.
+ */
+esp_err_t zb_ota_stage_end(void);
+
+/*--------------------------------------------------------------
+ * zb_ota_server_notify()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Hand the staged image to the stack and tell the followers
+ * about it. Must be called from the Zigbee task or with the Zigbee
+ * lock held.
+ *
+ * @param endpoint The endpoint with the OTA upgrade server cluster.
+ */
+esp_err_t zb_ota_server_notify(uint8_t endpoint);
+
+/*--------------------------------------------------------------
+ * zb_ota_server_peek_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Note the file offset of a follower's Image Block or Page
+ * Request, which the stack does not pass on to the block callback.
+ * Call it for every APS data indication. It never takes the frame,
+ * the stack still answers it.
+ */
+void zb_ota_server_peek_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * zb_ota_server_handle_query()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Answer a follower's query for the next image. Call it for
+ * ESP_ZB_CORE_OTA_UPGRADE_SRV_QUERY_IMAGE_CB_ID.
+ */
+esp_err_t zb_ota_server_handle_query(const esp_zb_zcl_ota_upgrade_server_query_image_message_t *message);
+
+/*--------------------------------------------------------------
+ * zb_ota_server_handle_status()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Log a follower's transfer starting, ending or being
+ * aborted. Call it for ESP_ZB_CORE_OTA_UPGRADE_SRV_STATUS_CB_ID.
+ * An end is logged as "OTA_DONE short=<addr> id=<id> ms=<ms>
+ * bytes=<n> concurrent=<n> max_concurrent=<n> resent=<n>", which the
+ * GUI shows.
+ */
+esp_err_t zb_ota_server_handle_status(const esp_zb_zcl_ota_upgrade_server_status_message_t *message);
+
+/*--------------------------------------------------------------
+ * zb_ota_server_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_ota_server_get_stats(zb_ota_server_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
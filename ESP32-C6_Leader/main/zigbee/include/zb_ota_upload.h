@@ -0,0 +1,97 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Receiving a follower image from the GUI over UART
+ * into the OTA staging area (zb_ota_server.h). After the
+ * "leader_ota_upload <size>" command, the UART carries binary frames
+ * instead of commands until the image is complete:
+ *
+ *     0xA5, sequence (2), length (2), payload (length), CRC-32 (4)
+ *
+ * All little-endian. The CRC is the usual one (as zlib's crc32())
+ * over the sequence, length and payload. Frame n holds the bytes
+ * from n * ZB_OTA_UPLOAD_CHUNK_SIZE, only the last one is shorter.
+ * Every frame is answered with a log line: "OTA_ACK seq=<n>" once
+ * everything up to frame n is written, or "OTA_NAK seq=<n>" for
+ * frame n to be sent again, with whatever followed it. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define ZB_OTA_UPLOAD_START_BYTE 0xA5
+#define ZB_OTA_UPLOAD_HEADER_SIZE 5
+#define ZB_OTA_UPLOAD_CRC_SIZE 4
+/* Must match the GUI. A few frames fit in the UART receive buffer,
+ * so the GUI can keep the line busy while waiting for the ACKs. */
+#define ZB_OTA_UPLOAD_CHUNK_SIZE 512
+/* The upload is given up after this long without a frame. */
+#define ZB_OTA_UPLOAD_TIMEOUT_MS 10000
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+/* Called once the whole image is staged. */
+typedef void (*zb_ota_upload_done_t)(void);
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_ota_upload_begin()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Get the staging area ready for an image of `size` bytes and
+ * start taking frames. Logs "OTA_UPLOAD ready" once the GUI may
+ * start sending.
+ */
+esp_err_t zb_ota_upload_begin(uint32_t size, zb_ota_upload_done_t done);
+
+/*--------------------------------------------------------------
+ * zb_ota_upload_active()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Whether frames are expected. Gives up an upload that has
+ * timed out, so call it every time the UART is read.
+ */
+bool zb_ota_upload_active(void);
+
+/*--------------------------------------------------------------
+ * zb_ota_upload_feed()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take bytes from the UART. Frames may be split across calls.
+ *
+ * @return false if the bytes are not for the upload and should be
+ * read as a command.
+ */
+bool zb_ota_upload_feed(const uint8_t *data, size_t length);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,140 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: How much of the stack's memory to set aside, as one
+ * of a few profiles sized for the network the leader runs. The sizes
+ * can only be set before esp_zb_init(), so the profile is saved in
+ * NVS and a new one takes effect at the next boot. The most of each
+ * table that was ever in use is kept, to check a profile against
+ * real load. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Used until another is saved. Its sizes are the library's
+ * defaults. */
+#define ZB_RESOURCES_DEFAULT_PROFILE ZB_RESOURCES_PROFILE_MEDIUM
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef enum
+{
+    /* A handful of followers, as little RAM as possible. */
+    ZB_RESOURCES_PROFILE_SMALL = 0,
+    /* A few dozen. */
+    ZB_RESOURCES_PROFILE_MEDIUM,
+    /* Up to the registry's capacity, with room for bursts. */
+    ZB_RESOURCES_PROFILE_LARGE,
+    ZB_RESOURCES_PROFILE_COUNT
+} zb_resources_profile_t;
+
+typedef struct
+{
+    const char *name;
+    /* Sizes the neighbour, routing and address tables. */
+    uint16_t network_size;
+    uint16_t io_buffers;
+    uint16_t scheduler_queue;
+    uint16_t src_bindings;
+    uint16_t dst_bindings;
+    uint8_t max_children;
+} zb_resources_sizes_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_resources_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Load the saved profile. Call after nvs_flash_init().
+ */
+esp_err_t zb_resources_init(void);
+
+/*--------------------------------------------------------------
+ * zb_resources_stack_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Size the stack for the profile and call esp_zb_init() with
+ * `config`, whose maximum number of children is set too. Logs the
+ * heap the stack took.
+ */
+void zb_resources_stack_init(esp_zb_cfg_t *config);
+
+/*--------------------------------------------------------------
+ * zb_resources_set_profile()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Save a profile for the next boot.
+ */
+esp_err_t zb_resources_set_profile(zb_resources_profile_t profile);
+
+/*--------------------------------------------------------------
+ * zb_resources_profile_from_string()
+ *------------------------------------------------------------*/
+
+/**
+ * @return The profile named `name`, or ZB_RESOURCES_PROFILE_COUNT if
+ * there is none.
+ */
+zb_resources_profile_t zb_resources_profile_from_string(const char *name);
+
+/*--------------------------------------------------------------
+ * zb_resources_sample()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Count the neighbour and routing table entries in use, and
+ * keep the most. Must be called from the Zigbee task or with the
+ * Zigbee lock held.
+ */
+void zb_resources_sample(void);
+
+/*--------------------------------------------------------------
+ * zb_resources_log()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Log the profile against the most of it ever used, as
+ * "ZB_RESOURCES profile=<name> network=<size>
+ * neighbors=<now>/<most> routes=<now>/<most>
+ * dst_bindings=<used>/<size> src_bindings=<size>
+ * io_buffers=<size> in_flight=<most> send_failures=<n>
+ * scheduler_queue=<size> queue_depth=<most> stack_heap=<bytes>
+ * min_free_heap=<bytes>". The stack does not say how many of its I/O
+ * buffers or scheduler slots are taken, the commands in flight and
+ * queued stand in for them.
+ *
+ * @param bindings Bindings made to followers.
+ */
+void zb_resources_log(uint32_t bindings);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
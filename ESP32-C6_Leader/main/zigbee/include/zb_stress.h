@@ -0,0 +1,208 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Bookkeeping for the capacity test, a flood of on/off
+ * toggles at a set rate. Every toggle is tracked by the TSN the stack
+ * gave it until its send status comes back, and each follower counts
+ * the toggles it really received, so what was sent, confirmed and
+ * delivered can be told apart. The run itself is
+ * follower_stress_benchmark() in esp_zb_switch.h. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Counter frames go to the bulk endpoint and profile (zb_bulk.h) on
+ * a cluster of their own. Must match light_stress.h on the
+ * follower. */
+#define ZB_STRESS_CLUSTER_ID 0x0003
+/* Leader to follower: report the counter, 1 byte. */
+#define ZB_STRESS_FRAME_QUERY 0
+/* Follower to leader: on/off commands received since boot, 4 bytes,
+ * little-endian. It is read before and after a run, so it is never
+ * reset. */
+#define ZB_STRESS_FRAME_COUNT 1
+#define ZB_STRESS_COUNT_SIZE 5
+
+/* Most followers whose counters one run checks. */
+#define ZB_STRESS_MAX_TARGETS 32
+/* Latency samples kept, later ones are not measured. */
+#define ZB_STRESS_MAX_SAMPLES 1024
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    /* Toggles handed to the command queue, and those it had no room
+     * for. */
+    uint32_t attempted;
+    uint32_t dropped;
+    /* Toggles handed to the stack, and their send statuses. */
+    uint32_t sent;
+    uint32_t confirmed;
+    uint32_t failed;
+    /* Toggles each reporting follower should have, and did, receive.
+     * A group toggle counts once per member. */
+    uint32_t expected;
+    uint32_t delivered;
+    /* Followers that did not report their counter before or after
+     * the run, and are left out of the two above. */
+    uint32_t unreported;
+    /* From the first toggle to the last send status. */
+    int64_t elapsed_us;
+    /* Time from enqueueing a toggle to its send status, of the
+     * confirmed ones. */
+    uint32_t samples;
+    uint32_t p50_us;
+    uint32_t p95_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} zb_stress_result_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_stress_begin()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Forget the last run. Add its targets, query their counters,
+ * then call zb_stress_start().
+ */
+void zb_stress_begin(void);
+
+/*--------------------------------------------------------------
+ * zb_stress_add_target()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Check a follower's counter in this run.
+ *
+ * @param expected Toggles it should receive, added to on every call.
+ */
+esp_err_t zb_stress_add_target(uint16_t short_addr, uint32_t expected);
+
+/*--------------------------------------------------------------
+ * zb_stress_start()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take the counters reported so far as the starting point
+ * and start tracking toggles.
+ */
+void zb_stress_start(void);
+
+/*--------------------------------------------------------------
+ * zb_stress_sent()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Remember a toggle handed to the stack. Called by the
+ * command queue's send callback, ignored outside a run.
+ */
+void zb_stress_sent(uint8_t tsn, int64_t enqueued_us);
+
+/*--------------------------------------------------------------
+ * zb_stress_send_status()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Match a send status to its toggle. Call it for every send
+ * status.
+ */
+void zb_stress_send_status(const esp_zb_zcl_command_send_status_message_t *message);
+
+/*--------------------------------------------------------------
+ * zb_stress_outstanding()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Toggles sent whose send status has not come back.
+ */
+uint32_t zb_stress_outstanding(void);
+
+/*--------------------------------------------------------------
+ * zb_stress_query()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Ask every target for its counter. Must be called from the
+ * Zigbee task or with the Zigbee lock held.
+ */
+esp_err_t zb_stress_query(void);
+
+/*--------------------------------------------------------------
+ * zb_stress_all_reported()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Whether every target has answered the last query.
+ */
+bool zb_stress_all_reported(void);
+
+/*--------------------------------------------------------------
+ * zb_stress_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Take counter reports out of the incoming APS frames. Call
+ * it from the handler registered with
+ * esp_zb_aps_data_indication_handler_register().
+ *
+ * @return true if the frame was for us.
+ */
+bool zb_stress_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * zb_stress_end()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Stop tracking toggles and sum the run up. Query the
+ * counters again first.
+ *
+ * @param attempted Toggles handed to the command queue.
+ * @param dropped Of those, the ones it had no room for.
+ */
+void zb_stress_end(uint32_t attempted, uint32_t dropped, zb_stress_result_t *result);
+
+/*--------------------------------------------------------------
+ * zb_stress_log()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Log a run as one line, "STRESS rate=<per s> attempted=<n>
+ * dropped=<n> sent=<n> confirmed=<n> failed=<n> expected=<n>
+ * delivered=<n> unreported=<n> ms=<ms> delivered_per_s=<n>
+ * loss_pct=<%> p50=<us> p95=<us> p99=<us> max=<us>", which the GUI
+ * reads. The loss counts toggles the queue dropped too.
+ */
+void zb_stress_log(uint32_t rate, const zb_stress_result_t *result);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
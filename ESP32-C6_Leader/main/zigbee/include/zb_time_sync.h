@@ -0,0 +1,203 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: A shared time base for the network, and actions that
+ * followers carry out at the same instant. The leader's esp_timer
+ * clock is the reference. Followers keep in step with it through
+ * request and response exchanges, four timestamps each, so the
+ * radio's delay cancels out. A scheduled action carries the
+ * reference time to carry it out at, so the order and delay of
+ * delivery do not matter. Each follower reports when it really did
+ * it, and the spread of those times is the skew.
+ *
+ * The leader also serves the ZCL Time cluster, for the time of day.
+ * Its attribute counts whole seconds, far too coarse to line actions
+ * up, so it plays no part in the above. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_zigbee_core.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Time frames go to the bulk endpoint and profile (zb_bulk.h) on a
+ * cluster of their own. Must match light_sync.h on the follower. */
+#define ZB_TIME_SYNC_CLUSTER_ID 0x0004
+/* Follower to leader: the follower's send time t1 in us, 8 bytes,
+ * little-endian like every field below. */
+#define ZB_TIME_SYNC_FRAME_REQUEST 0
+#define ZB_TIME_SYNC_REQUEST_SIZE 9
+/* Leader to follower: t1 back, then the leader's receive time t2 and
+ * send time t3, 8 bytes each. */
+#define ZB_TIME_SYNC_FRAME_RESPONSE 1
+#define ZB_TIME_SYNC_RESPONSE_SIZE 25
+/* Leader to follower: action ID, 2 bytes, reference time to carry it
+ * out at, 8 bytes, action, 1 byte, and its value, 1 byte. */
+#define ZB_TIME_SYNC_FRAME_SCHEDULE 2
+#define ZB_TIME_SYNC_SCHEDULE_SIZE 13
+/* Follower to leader: action ID, 2 bytes, reference time it was
+ * carried out at, 8 bytes, how late that was by its own clock,
+ * signed, 4 bytes, how far its clock may be off, 4 bytes, and a
+ * status, 1 byte. */
+#define ZB_TIME_SYNC_FRAME_EXECUTED 3
+#define ZB_TIME_SYNC_EXECUTED_SIZE 20
+
+/* Actions. */
+#define ZB_TIME_SYNC_ACTION_ON_OFF 0
+
+/* Statuses. */
+#define ZB_TIME_SYNC_STATUS_OK 0
+/* The follower had no time base yet and did it on arrival. */
+#define ZB_TIME_SYNC_STATUS_NOT_SYNCED 1
+
+/* Most followers one action is checked on. */
+#define ZB_TIME_SYNC_MAX_TARGETS 32
+
+/* Time Status bits of the ZCL Time cluster. */
+#define ZB_TIME_STATUS_MASTER (1 << 0)
+#define ZB_TIME_STATUS_SYNCHRONIZED (1 << 1)
+
+/* Seconds from the Unix epoch to the Zigbee one, 2000-01-01 UTC. */
+#define ZB_TIME_UNIX_TO_ZIGBEE_S 946684800UL
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    uint16_t action_id;
+    uint32_t targets;
+    /* Followers that reported, and those of them without a time
+     * base. The latter are left out of the figures below. */
+    uint32_t reported;
+    uint32_t not_synced;
+    /* The latest minus the earliest reported time it was carried
+     * out at. */
+    uint32_t skew_us;
+    /* The latest any follower was by its own clock. */
+    int32_t max_late_us;
+    /* The most any follower's clock may be off, so the skew could
+     * be this much larger or smaller. */
+    uint32_t max_error_us;
+} zb_time_sync_result_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_time_sync_add_time_cluster()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Add the Time cluster server, with the leader as the time
+ * master, to an endpoint. Call before registering the device.
+ */
+esp_err_t zb_time_sync_add_time_cluster(esp_zb_ep_list_t *ep_list, uint8_t endpoint);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_set_utc()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Set the time of day, which the Time cluster then keeps.
+ * Must be called from the Zigbee task or with the Zigbee lock held.
+ *
+ * @param unix_s Seconds since 1970-01-01 UTC.
+ */
+esp_err_t zb_time_sync_set_utc(uint32_t unix_s);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_begin()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Forget the last action and start a new one. Add its
+ * targets, then call zb_time_sync_schedule().
+ *
+ * @return The new action's ID.
+ */
+uint16_t zb_time_sync_begin(void);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_add_target()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_time_sync_add_target(uint16_t short_addr);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_schedule()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Tell every target to switch on or off at `at_us`, in
+ * esp_timer_get_time() microseconds of the leader. Must be called
+ * from the Zigbee task or with the Zigbee lock held.
+ */
+esp_err_t zb_time_sync_schedule(int64_t at_us, bool on);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_all_reported()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Whether every target has reported carrying out the action.
+ */
+bool zb_time_sync_all_reported(void);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_handle_indication()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Answer time requests and take action reports out of the
+ * incoming APS frames. Call it from the handler registered with
+ * esp_zb_aps_data_indication_handler_register(), as early as
+ * possible, since the receive time is taken here.
+ *
+ * @return true if the frame was for us.
+ */
+bool zb_time_sync_handle_indication(const esp_zb_apsde_data_ind_t *ind);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_end()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Sum up the reports of the action.
+ */
+void zb_time_sync_end(zb_time_sync_result_t *result);
+
+/*--------------------------------------------------------------
+ * zb_time_sync_log()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Log an action as one line, "SYNC_ACTION id=<id>
+ * targets=<n> reported=<n> not_synced=<n> skew_us=<us>
+ * max_late_us=<us> max_error_us=<us>".
+ */
+void zb_time_sync_log(const zb_time_sync_result_t *result);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
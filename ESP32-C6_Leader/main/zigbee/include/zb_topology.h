@@ -0,0 +1,114 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Dumps the leader's view of the network: its
+ * neighbour table, its routing table and its route records. The
+ * tables are walked a few entries at a time so the Zigbee lock is
+ * never held for long, and every chunk is logged as compact binary
+ * records the GUI turns into a topology graph. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* Table entries read per lock acquisition. */
+#define ZB_TOPOLOGY_CHUNK_SIZE 8
+
+/* Bytes of one encoded record, see zb_topology_encode(). */
+#define ZB_TOPOLOGY_RECORD_SIZE 9
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef enum
+{
+    /* A device the leader hears directly. */
+    ZB_TOPOLOGY_NEIGHBOR = 0,
+    /* A device the leader reaches through a next hop. */
+    ZB_TOPOLOGY_ROUTE,
+    /* A device that told the leader the path it takes to it. */
+    ZB_TOPOLOGY_ROUTE_RECORD,
+    ZB_TOPOLOGY_KIND_COUNT
+} zb_topology_kind_t;
+
+typedef struct
+{
+    zb_topology_kind_t kind;
+    /* The device the entry is about. */
+    uint16_t short_addr;
+    /* The device it is linked through: the leader for a neighbour,
+     * the next hop for a route, the first relay for a route record. */
+    uint16_t via;
+    /* Neighbour: relationship (0 parent, 1 child, 2 sibling, 3 none,
+     * 4 previous child, 5 unauthenticated child).
+     * Route: status (0 active, 1 discovering, 2 discovery failed,
+     * 3 inactive, 4 validating).
+     * Route record: relay count. */
+    uint8_t relationship;
+    /* Neighbour only, 0 otherwise. */
+    uint8_t lqi;
+    uint8_t cost;
+    /* Neighbour: link status periods since last heard.
+     * Route and route record: expiry. */
+    uint8_t age;
+} zb_topology_record_t;
+
+typedef struct
+{
+    uint32_t records;
+    uint32_t chunks;
+    /* Longest the Zigbee lock was held for one chunk. */
+    uint32_t max_lock_hold_us;
+} zb_topology_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_topology_encode()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Pack a record into ZB_TOPOLOGY_RECORD_SIZE bytes:
+ * kind, short address (LE), via (LE), relationship, LQI, cost, age.
+ */
+void zb_topology_encode(const zb_topology_record_t *record, uint8_t *buffer);
+
+/*--------------------------------------------------------------
+ * zb_topology_walk()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Walk all three tables and log them. Takes the Zigbee lock
+ * once per chunk, so it must not be called with the lock held or
+ * from the Zigbee task. Blocks until done.
+ *
+ * Logs "TOPOLOGY_BEGIN leader=<addr>", then one
+ * "TOPOLOGY <hex records>" line per chunk, then
+ * "TOPOLOGY_END records=<n>".
+ *
+ * @param stats Returned stats of the walk, may be NULL.
+ */
+void zb_topology_walk(zb_topology_stats_t *stats);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
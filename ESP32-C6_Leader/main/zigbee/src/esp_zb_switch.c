@@ -33,6 +33,7 @@
  * Standard.
  *============================================================*/
 
+#include "inttypes.h"
 #include "string.h"
 
 /*==============================================================
@@ -42,6 +43,7 @@
 #include "esp_err.h"
 #include "esp_check.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_zb_switch.h"
 #include "ha/esp_zigbee_ha_standard.h"
 #include "nvs_flash.h"
@@ -60,55 +62,1975 @@
 #if defined ZB_ED_ROLE
 #error Define ZB_COORDINATOR_ROLE in idf.py menuconfig to compile light switch source code.
 #endif
-typedef struct light_bulb_device_params_s
+
+/* What a benchmark was asked for, copied for its task. */
+typedef union
+{
+    struct
+    {
+        uint8_t group;
+        uint8_t scene_id;
+    } scene;
+    struct
+    {
+        uint16_t id;
+        uint16_t size;
+    } bulk;
+    struct
+    {
+        uint16_t id;
+        uint16_t count;
+        int64_t uart_us;
+    } latency;
+    struct
+    {
+        uint32_t rate;
+        uint32_t count;
+        /* follower_stress_benchmark_group() only. */
+        uint8_t group;
+        uint16_t id_count;
+        uint16_t ids[ZB_STRESS_MAX_TARGETS];
+    } stress;
+    struct
+    {
+        uint32_t rounds;
+    } fanout;
+    struct
+    {
+        bool on;
+        uint32_t delay_ms;
+        uint16_t id_count;
+        uint16_t ids[ZB_TIME_SYNC_MAX_TARGETS];
+    } sync;
+} benchmark_args_t;
+
+typedef void (*benchmark_fn_t)(const benchmark_args_t *args);
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ESP_ZB_SWITCH";
+
+/* How often follower link quality is copied from the neighbour
+ * table. */
+static const uint32_t FOLLOWER_LQI_PERIOD_MS = 10 * 1000;
+
+/* After a reboot, known followers are asked for their state this
+ * many at a time, so the command queue never overflows. */
+static const uint16_t FOLLOWER_PROBE_BATCH = ZB_COMMAND_QUEUE_LENGTH / 2;
+static const uint32_t FOLLOWER_PROBE_PERIOD_MS = 100;
+
+/* Numbers of followers follower_group_benchmark() times. */
+static const uint32_t BENCHMARK_FOLLOWERS[] = {1, 10, 50};
+/* Runs of follower_fanout_benchmark() each way, and at most. */
+static const uint32_t BENCHMARK_FANOUT_ROUNDS = 5;
+static const uint32_t BENCHMARK_FANOUT_MAX_ROUNDS = 50;
+/* The task a benchmark runs in. Below the Zigbee task and the
+ * dispatcher, whose work it waits on. */
+static const uint32_t BENCHMARK_TASK_STACK_DEPTH = 4096;
+static const UBaseType_t BENCHMARK_TASK_PRIORITY = configMAX_PRIORITIES - 4;
+/* Longest wait for the sends of one benchmark run. */
+static const int64_t BENCHMARK_TIMEOUT_US = 10 * 1000 * 1000;
+/* Most effect commands follower_bulk_benchmark() sends to compare
+ * with, the rate is the same for more. */
+static const uint32_t BENCHMARK_ZCL_COMMANDS = 32;
+/* Followers report their on/off and effect attributes at once on
+ * change, and at least this often otherwise, so a lost report is
+ * made good and the cache never goes stale for long. */
+static const uint16_t FOLLOWER_REPORT_MIN_INTERVAL_S = 0;
+static const uint16_t FOLLOWER_REPORT_MAX_INTERVAL_S = 5 * 60;
+/* Longest wait for the followers' capacity test counters. */
+static const int64_t STRESS_REPORT_TIMEOUT_US = 2 * 1000 * 1000;
+/* Longest wait for the followers' reports of a synchronized action,
+ * past the time it was due. */
+static const int64_t SYNC_REPORT_TIMEOUT_US = 2 * 1000 * 1000;
+/* Longest wait for a follower's latency report. */
+static const int64_t LATENCY_REPORT_TIMEOUT_US = 2 * 1000 * 1000;
+/* ZCL frame control, sequence number and command ID. */
+static const uint32_t ZCL_HEADER_SIZE = 3;
+/* A default response carries the command ID and a status. */
+static const uint32_t ZCL_DEFAULT_RESPONSE_SIZE = 2;
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static switch_func_pair_t button_func_pair[] = {
+    {GPIO_INPUT_IO_TOGGLE_SWITCH, SWITCH_ONOFF_TOGGLE_CONTROL}};
+
+/* Followers were restored from flash at boot. */
+static bool s_warm_start = false;
+/* When a follower first answered after boot, 0 until one has. */
+static int64_t s_first_controllable_us = 0;
+
+/* Guards the two below it. */
+static portMUX_TYPE s_benchmark_lock = portMUX_INITIALIZER_UNLOCKED;
+/* The benchmark running, NULL if none, and what it was asked for. */
+static benchmark_fn_t s_benchmark_fn = NULL;
+static benchmark_args_t s_benchmark_args;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_command_send()
+ *------------------------------------------------------------*/
+
+/* Send one queued command. The command queue calls this with the
+ * Zigbee lock held, so nothing here may take the lock. */
+
+static uint8_t zb_command_send(const zb_command_t *command)
+{
+    /* Either every bound follower, or one follower by address. */
+    esp_zb_zcl_basic_cmd_t basic_cmd = {
+        .src_endpoint = HA_ONOFF_SWITCH_ENDPOINT,
+    };
+    esp_zb_zcl_address_mode_t address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT;
+    if (command->dst.mode == ZB_COMMAND_DST_SHORT)
+    {
+        basic_cmd.dst_addr_u.addr_short = command->dst.short_addr;
+        basic_cmd.dst_endpoint = command->dst.endpoint;
+        address_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT;
+    }
+    else if (command->dst.mode == ZB_COMMAND_DST_GROUP)
+    {
+        basic_cmd.dst_addr_u.addr_short = command->dst.group_id;
+        address_mode = ESP_ZB_APS_ADDR_MODE_16_GROUP_ENDP_NOT_PRESENT;
+    }
+
+    uint8_t tsn = 0;
+    switch (command->type)
+    {
+    case ZB_COMMAND_ON_OFF_TOGGLE:
+    {
+        /* "Command request". */
+        esp_zb_zcl_on_off_cmd_t cmd_req;
+        /* The "endpoint" of the switch device, and where to send. */
+        cmd_req.zcl_basic_cmd = basic_cmd;
+        /* Something about an address. */
+        cmd_req.address_mode = address_mode;
+        /* Thing that says to toggle the light, in contrast to doing
+         * something else. */
+        cmd_req.on_off_cmd_id = ESP_ZB_ZCL_CMD_ON_OFF_TOGGLE_ID;
+        /* Send the on/off command. */
+        tsn = esp_zb_zcl_on_off_cmd_req(&cmd_req);
+        /* In case it is part of a capacity test. */
+        zb_stress_sent(tsn, command->enqueued_us);
+        /* Say we did it. Yay! */
+        ESP_EARLY_LOGI(TAG, "Send on/off toggle command.");
+        break;
+    }
+    case ZB_COMMAND_LED_EFFECT:
+    {
+        /* An octet string starts with its length. */
+        uint8_t payload[1 + LED_EFFECTS_PARAMS_WIRE_SIZE];
+        payload[0] = LED_EFFECTS_PARAMS_WIRE_SIZE;
+        led_effects_params_to_bytes(&command->data.effect, &payload[1]);
+
+        esp_zb_zcl_custom_cluster_cmd_req_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .profile_id = ESP_ZB_AF_HA_PROFILE_ID,
+            .cluster_id = LED_EFFECTS_CLUSTER_ID,
+            .direction = ESP_ZB_ZCL_CMD_DIRECTION_TO_SRV,
+            .custom_cmd_id = LED_EFFECTS_CMD_START_ID,
+            .data.type = ESP_ZB_ZCL_ATTR_TYPE_OCTET_STRING,
+            .data.size = sizeof(payload),
+            .data.value = payload,
+        };
+        tsn = esp_zb_zcl_custom_cluster_cmd_req(&cmd_req);
+        ESP_EARLY_LOGI(TAG, "Send '%s' effect command.", led_effects_type_to_string(command->data.effect.type));
+        break;
+    }
+    case ZB_COMMAND_GROUP_ADD:
+    case ZB_COMMAND_GROUP_REMOVE:
+    {
+        /* Adding and removing take the same request. */
+        esp_zb_zcl_groups_add_group_cmd_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .group_id = command->data.group_id,
+        };
+        if (command->type == ZB_COMMAND_GROUP_ADD)
+        {
+            tsn = esp_zb_zcl_groups_add_group_cmd_req(&cmd_req);
+        }
+        else
+        {
+            tsn = esp_zb_zcl_groups_remove_group_cmd_req(&cmd_req);
+        }
+        ESP_EARLY_LOGI(TAG, "Send %s group 0x%04x command.", command->type == ZB_COMMAND_GROUP_ADD ? "add" : "remove",
+                       command->data.group_id);
+        break;
+    }
+    case ZB_COMMAND_SCENE_STORE:
+    {
+        esp_zb_zcl_scenes_store_scene_cmd_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .group_id = command->data.scene.group_id,
+            .scene_id = command->data.scene.scene_id,
+        };
+        tsn = esp_zb_zcl_scenes_store_scene_cmd_req(&cmd_req);
+        ESP_EARLY_LOGI(TAG, "Send store scene %u command.", command->data.scene.scene_id);
+        break;
+    }
+    case ZB_COMMAND_SCENE_RECALL:
+    {
+        esp_zb_zcl_scenes_recall_scene_cmd_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .group_id = command->data.scene.group_id,
+            .scene_id = command->data.scene.scene_id,
+        };
+        tsn = esp_zb_zcl_scenes_recall_scene_cmd_req(&cmd_req);
+        ESP_EARLY_LOGI(TAG, "Send recall scene %u command.", command->data.scene.scene_id);
+        break;
+    }
+    case ZB_COMMAND_SCENE_MEMBERSHIP:
+    {
+        esp_zb_zcl_scenes_get_scene_membership_cmd_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .group_id = command->data.scene.group_id,
+        };
+        tsn = esp_zb_zcl_scenes_get_scene_membership_cmd_req(&cmd_req);
+        ESP_EARLY_LOGI(TAG, "Send get scene membership command.");
+        break;
+    }
+    case ZB_COMMAND_ON_OFF_SET:
+    {
+        esp_zb_zcl_on_off_cmd_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .on_off_cmd_id = command->data.on_off ? ESP_ZB_ZCL_CMD_ON_OFF_ON_ID : ESP_ZB_ZCL_CMD_ON_OFF_OFF_ID,
+        };
+        tsn = esp_zb_zcl_on_off_cmd_req(&cmd_req);
+        ESP_EARLY_LOGI(TAG, "Send on/off %s command.", command->data.on_off ? "on" : "off");
+        break;
+    }
+    case ZB_COMMAND_CONFIG_REPORT:
+    {
+        /* Only looked at for analog types, the attributes here are
+         * reported on every change. */
+        uint8_t reportable_change = 0;
+        esp_zb_zcl_config_report_record_t record = {
+            .direction = ESP_ZB_ZCL_REPORT_DIRECTION_SEND,
+            .attributeID = command->data.attr.attr_id,
+            .attrType = command->data.attr.attr_type,
+            .min_interval = FOLLOWER_REPORT_MIN_INTERVAL_S,
+            .max_interval = FOLLOWER_REPORT_MAX_INTERVAL_S,
+            .reportable_change = &reportable_change,
+        };
+        esp_zb_zcl_config_report_cmd_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .clusterID = command->data.attr.cluster_id,
+            .record_number = 1,
+            .record_field = &record,
+        };
+        tsn = esp_zb_zcl_config_report_cmd_req(&cmd_req);
+        ESP_EARLY_LOGI(TAG, "Send configure reporting command for attribute 0x%04x of cluster 0x%04x.", command->data.attr.attr_id,
+                       command->data.attr.cluster_id);
+        break;
+    }
+    case ZB_COMMAND_READ_ATTR:
+    {
+        uint16_t attr_id = command->data.attr.attr_id;
+        esp_zb_zcl_read_attr_cmd_t cmd_req = {
+            .zcl_basic_cmd = basic_cmd,
+            .address_mode = address_mode,
+            .clusterID = command->data.attr.cluster_id,
+            .attr_number = 1,
+            .attr_field = &attr_id,
+        };
+        tsn = esp_zb_zcl_read_attr_cmd_req(&cmd_req);
+        ESP_EARLY_LOGI(TAG, "Send read attribute 0x%04x of cluster 0x%04x command.", attr_id, command->data.attr.cluster_id);
+        break;
+    }
+    default:
+        ESP_LOGE(TAG, "Unknown command type %d.", command->type);
+        break;
+    }
+    /* In case someone waits on its outcome. */
+    zb_delivery_sent(command, tsn);
+    zb_benchmark_sent(command, tsn);
+    return tsn;
+}
+
+/*--------------------------------------------------------------
+ * follower_mark_controllable()
+ *------------------------------------------------------------*/
+
+/* Log, once per boot, how long it took until a bound follower
+ * answered, the figure a warm start is meant to cut down. */
+static void follower_mark_controllable(uint16_t short_addr)
+{
+    if (s_first_controllable_us != 0)
+    {
+        return;
+    }
+    follower_t follower;
+    uint16_t id = follower_registry_find_by_short(short_addr);
+    if (follower_registry_get(id, &follower) != ESP_OK || !(follower.bound & FOLLOWER_CLUSTER_ON_OFF))
+    {
+        return;
+    }
+    s_first_controllable_us = esp_timer_get_time();
+    ESP_LOGI(TAG, "REJOIN first_controllable_ms=%" PRIu32 " id=%u start=%s", (uint32_t)(s_first_controllable_us / 1000), id,
+             s_warm_start ? "warm" : "cold");
+}
+
+/*--------------------------------------------------------------
+ * zb_command_send_status_cb()
+ *------------------------------------------------------------*/
+
+static void zb_command_send_status_cb(esp_zb_zcl_command_send_status_message_t message)
+{
+    zb_command_queue_send_status(&message);
+    zb_stress_send_status(&message);
+    zb_delivery_send_status(&message);
+    zb_benchmark_send_status(&message);
+    if (message.status == ESP_OK && message.dst_addr.addr_type == ESP_ZB_ZCL_ADDR_TYPE_SHORT)
+    {
+        follower_registry_touch(message.dst_addr.u.short_addr);
+        follower_mark_controllable(message.dst_addr.u.short_addr);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_delivery_finished_cb()
+ *------------------------------------------------------------*/
+
+/* An on/off set that got to its follower is the follower's state now,
+ * one that did not is no longer on its way. See
+ * follower_set_led_by_id(). */
+static void zb_delivery_finished_cb(const zb_command_t *command, bool ok, uint8_t attempts)
+{
+    zb_benchmark_finished(command, ok, attempts);
+    if (command->type != ZB_COMMAND_ON_OFF_SET || command->dst.mode != ZB_COMMAND_DST_SHORT)
+    {
+        return;
+    }
+    uint16_t id = follower_registry_find_by_short(command->dst.short_addr);
+    if (id == FOLLOWER_ID_INVALID)
+    {
+        return;
+    }
+    if (ok)
+    {
+        follower_registry_set_on_off(id, command->data.on_off);
+    }
+    else
+    {
+        follower_registry_drop_on_off_pending(id, command->data.on_off);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_aps_data_indication_handler()
+ *------------------------------------------------------------*/
+
+/* Returns true for frames the stack should not look at. */
+static bool zb_aps_data_indication_handler(esp_zb_apsde_data_ind_t ind)
+{
+    /* Time requests first, their receive time is taken on entry. */
+    if (zb_time_sync_handle_indication(&ind) || zb_bulk_handle_indication(&ind) || zb_latency_handle_indication(&ind) ||
+        zb_stress_handle_indication(&ind) || zb_link_tuning_handle_indication(&ind))
+    {
+        follower_registry_touch(ind.src_short_addr);
+        return true;
+    }
+    /* Only looked at, the stack still answers it. */
+    zb_ota_server_peek_indication(&ind);
+    return false;
+}
+
+/*--------------------------------------------------------------
+ * follower_dst()
+ *------------------------------------------------------------*/
+
+/* Look up where to send a command for one follower. */
+static esp_err_t follower_dst(uint16_t id, zb_command_dst_t *dst)
+{
+    follower_t follower;
+    ESP_RETURN_ON_ERROR(follower_registry_get(id, &follower), TAG, "No follower with ID %u", id);
+    ESP_RETURN_ON_FALSE(follower.endpoint != 0, ESP_ERR_INVALID_STATE, TAG, "Follower %u has no light endpoint yet", id);
+    dst->mode = ZB_COMMAND_DST_SHORT;
+    dst->short_addr = follower.short_addr;
+    dst->endpoint = follower.endpoint;
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * followers_any_on()
+ *------------------------------------------------------------*/
+
+/* Whether any follower bound to a cluster in `bound`, or in a group
+ * in `groups`, is on or about to be, by the registry. A follower
+ * whose state is not known counts as off. */
+static bool followers_any_on(uint8_t bound, uint8_t groups)
+{
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) != ESP_OK || (!(follower.bound & bound) && !(follower.groups & groups)))
+        {
+            continue;
+        }
+        uint8_t on_off = follower.on_off_pending != FOLLOWER_ATTR_UNKNOWN ? follower.on_off_pending : follower.on_off;
+        if (on_off != FOLLOWER_ATTR_UNKNOWN && on_off)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/*--------------------------------------------------------------
+ * follower_toggle_led()
+ *------------------------------------------------------------*/
+
+/* Implement light switch toggle functionality. Returns at once; the
+ * command is sent by the command queue.
+ *
+ * Sent as an explicit on or off, off if any bound follower is on, as
+ * follower_toggle_led_by_id() does for one. A toggle that got lost
+ * could not be sent again, it might have arrived after all, while
+ * this one goes through delivery's retries. The followers report
+ * the new state, which updates the cache. */
+
+void follower_toggle_led(void)
+{
+    zb_command_t command = {
+        .type = ZB_COMMAND_ON_OFF_SET,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+        .data.on_off = !followers_any_on(FOLLOWER_CLUSTER_ON_OFF, 0),
+    };
+    zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_group_request()
+ *------------------------------------------------------------*/
+
+/* Ask a follower to join or leave a group. Its membership is recorded
+ * once the follower answers, in zb_group_response_handler(). */
+static esp_err_t follower_group_request(uint16_t id, uint8_t group, bool add)
+{
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid group %u", group);
+    zb_command_t command = {
+        .type = add ? ZB_COMMAND_GROUP_ADD : ZB_COMMAND_GROUP_REMOVE,
+        .data.group_id = FOLLOWER_GROUP_ID(group),
+    };
+    ESP_RETURN_ON_ERROR(follower_dst(id, &command.dst), TAG, "Cannot address follower");
+    return zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_report_request()
+ *------------------------------------------------------------*/
+
+/* Ask a follower to report an attribute from now on, and read it
+ * once so the cache does not wait for the first change. */
+static esp_err_t follower_report_request(uint16_t id, uint16_t cluster_id, uint16_t attr_id, uint8_t attr_type)
+{
+    zb_command_t command = {
+        .type = ZB_COMMAND_CONFIG_REPORT,
+        .data.attr.cluster_id = cluster_id,
+        .data.attr.attr_id = attr_id,
+        .data.attr.attr_type = attr_type,
+    };
+    ESP_RETURN_ON_ERROR(follower_dst(id, &command.dst), TAG, "Cannot address follower");
+    ESP_RETURN_ON_ERROR(zb_command_queue_send(&command), TAG, "Failed to queue configure reporting");
+    command.type = ZB_COMMAND_READ_ATTR;
+    return zb_command_queue_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_is_set_up()
+ *------------------------------------------------------------*/
+
+/* Found, bound both ways and reporting. Both ends keep all of that
+ * in flash, so such a follower needs nothing more after a reboot or
+ * a rejoin. */
+static bool follower_is_set_up(const follower_t *follower)
+{
+    return follower->endpoint != 0 && follower->clusters != 0 && (follower->bound & follower->clusters) == follower->clusters &&
+           (follower->reporting & follower->clusters) == follower->clusters;
+}
+
+/*--------------------------------------------------------------
+ * follower_probe()
+ *------------------------------------------------------------*/
+
+/* Read a follower's on/off state, to fill the cache and to see it is
+ * there. */
+static esp_err_t follower_probe(uint16_t id)
+{
+    zb_command_t command = {
+        .type = ZB_COMMAND_READ_ATTR,
+        .data.attr.cluster_id = ESP_ZB_ZCL_CLUSTER_ID_ON_OFF,
+        .data.attr.attr_id = ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID,
+    };
+    ESP_RETURN_ON_ERROR(follower_dst(id, &command.dst), TAG, "Cannot address follower");
+    return zb_command_queue_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_probe_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task. Probes batch `param` of the restored
+ * followers and schedules the next batch. */
+static void follower_probe_cb(uint8_t param)
+{
+    uint16_t first = param * FOLLOWER_PROBE_BATCH;
+    for (uint16_t id = first; id < first + FOLLOWER_PROBE_BATCH && id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) == ESP_OK && follower_is_set_up(&follower))
+        {
+            follower_probe(id);
+        }
+    }
+    if (first + FOLLOWER_PROBE_BATCH < FOLLOWER_REGISTRY_CAPACITY)
+    {
+        esp_zb_scheduler_alarm(follower_probe_cb, param + 1, FOLLOWER_PROBE_PERIOD_MS);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_group_response_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_group_response_handler(const esp_zb_zcl_groups_operate_group_resp_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    bool add = message->info.command.id == ESP_ZB_ZCL_CMD_GROUPS_ADD_GROUP;
+    uint8_t group = (uint8_t)(message->group_id - FOLLOWER_GROUP_ID_BASE);
+    uint16_t id = follower_registry_find_by_short(message->info.src_address.u.short_addr);
+    ESP_RETURN_ON_FALSE(message->group_id >= FOLLOWER_GROUP_ID_BASE && group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG,
+                        "Response for unknown group 0x%04x", message->group_id);
+    ESP_RETURN_ON_FALSE(id != FOLLOWER_ID_INVALID, ESP_ERR_NOT_FOUND, TAG, "Response from unknown device 0x%04hx",
+                        message->info.src_address.u.short_addr);
+
+    /* Already in the group, or already not in it, is as good as done. */
+    esp_zb_zcl_status_t status = message->info.status;
+    bool done = status == ESP_ZB_ZCL_STATUS_SUCCESS || (add && status == ESP_ZB_ZCL_STATUS_DUPE_EXISTS) ||
+                (!add && status == ESP_ZB_ZCL_STATUS_NOT_FOUND);
+    ESP_RETURN_ON_FALSE(done, ESP_FAIL, TAG, "Follower %u failed to %s group %u (status 0x%02x)", id, add ? "join" : "leave",
+                        group, status);
+
+    /* Saved with the registry, follower_found_cb() restores it from
+     * there. */
+    ESP_RETURN_ON_ERROR(follower_registry_set_group(id, group, add), TAG, "Follower %u is gone", id);
+    ESP_LOGI(TAG, "Follower %u %s group %u", id, add ? "joined" : "left", group);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_scene_membership_handler()
+ *------------------------------------------------------------*/
+
+/* Also confirms the scenes listed, see follower_scene_store(). */
+static esp_err_t zb_scene_membership_handler(const esp_zb_zcl_scenes_get_scene_membership_resp_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
+                        message->info.status);
+    ESP_LOGI(TAG, "Follower 0x%04hx has %u scene(s) in group 0x%04x, room for %u more:", message->info.src_address.u.short_addr,
+             message->scene_count, message->group_id, message->capacity);
+    uint8_t group = (uint8_t)(message->group_id - FOLLOWER_GROUP_ID_BASE);
+    bool ours = message->group_id >= FOLLOWER_GROUP_ID_BASE && group < FOLLOWER_GROUPS_COUNT;
+    for (uint8_t i = 0; message->scene_list && i < message->scene_count; i++)
+    {
+        ESP_LOGI(TAG, "  scene %u", message->scene_list[i]);
+        if (ours)
+        {
+            follower_scenes_confirmed(group, message->scene_list[i]);
+        }
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_cache_attribute()
+ *------------------------------------------------------------*/
+
+/* Keep a reported or read attribute in the registry, where state
+ * queries are answered from. */
+static void follower_cache_attribute(uint16_t short_addr, uint16_t cluster_id, const esp_zb_zcl_attribute_t *attribute)
+{
+    uint16_t id = follower_registry_find_by_short(short_addr);
+    if (id == FOLLOWER_ID_INVALID || !attribute->data.value)
+    {
+        return;
+    }
+    follower_mark_controllable(short_addr);
+    if (cluster_id == ESP_ZB_ZCL_CLUSTER_ID_ON_OFF && attribute->id == ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID &&
+        attribute->data.type == ESP_ZB_ZCL_ATTR_TYPE_BOOL)
+    {
+        follower_registry_set_on_off(id, *(const bool *)attribute->data.value);
+    }
+    else if (cluster_id == LED_EFFECTS_CLUSTER_ID && attribute->id == LED_EFFECTS_ATTR_TYPE_ID &&
+             attribute->data.type == ESP_ZB_ZCL_ATTR_TYPE_U8)
+    {
+        follower_registry_set_effect_type(id, *(const uint8_t *)attribute->data.value);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_report_attr_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_report_attr_handler(const esp_zb_zcl_report_attr_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    ESP_RETURN_ON_FALSE(message->status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
+                        message->status);
+    ESP_RETURN_ON_FALSE(message->src_address.addr_type == ESP_ZB_ZCL_ADDR_TYPE_SHORT, ESP_ERR_INVALID_ARG, TAG,
+                        "Report from a long address");
+    ESP_LOGI(TAG, "Follower 0x%04hx reported attribute 0x%04x of cluster 0x%04x", message->src_address.u.short_addr,
+             message->attribute.id, message->cluster);
+    follower_cache_attribute(message->src_address.u.short_addr, message->cluster, &message->attribute);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_read_attr_resp_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_read_attr_resp_handler(const esp_zb_zcl_cmd_read_attr_resp_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    ESP_RETURN_ON_FALSE(message->info.status == ESP_ZB_ZCL_STATUS_SUCCESS, ESP_ERR_INVALID_ARG, TAG, "Received message: error status(%d)",
+                        message->info.status);
+    for (esp_zb_zcl_read_attr_resp_variable_t *variable = message->variables; variable; variable = variable->next)
+    {
+        if (variable->status == ESP_ZB_ZCL_STATUS_SUCCESS)
+        {
+            follower_cache_attribute(message->info.src_address.u.short_addr, message->info.cluster, &variable->attribute);
+        }
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_config_report_resp_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_config_report_resp_handler(const esp_zb_zcl_cmd_config_report_resp_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    for (esp_zb_zcl_config_report_resp_variable_t *variable = message->variables; variable; variable = variable->next)
+    {
+        if (variable->status != ESP_ZB_ZCL_STATUS_SUCCESS)
+        {
+            ESP_LOGW(TAG, "Follower 0x%04hx will not report attribute 0x%04x of cluster 0x%04x (status 0x%02x)",
+                     message->info.src_address.u.short_addr, variable->attribute_id, message->info.cluster, variable->status);
+        }
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_action_handler()
+ *------------------------------------------------------------*/
+
+static esp_err_t zb_action_handler(esp_zb_core_action_callback_id_t callback_id, const void *message)
+{
+    esp_err_t ret = ESP_OK;
+    switch (callback_id)
+    {
+    case ESP_ZB_CORE_CMD_OPERATE_GROUP_RESP_CB_ID:
+        ret = zb_group_response_handler((esp_zb_zcl_groups_operate_group_resp_message_t *)message);
+        break;
+    case ESP_ZB_CORE_CMD_GET_SCENE_MEMBERSHIP_RESP_CB_ID:
+        ret = zb_scene_membership_handler((esp_zb_zcl_scenes_get_scene_membership_resp_message_t *)message);
+        break;
+    case ESP_ZB_CORE_REPORT_ATTR_CB_ID:
+        ret = zb_report_attr_handler((esp_zb_zcl_report_attr_message_t *)message);
+        break;
+    case ESP_ZB_CORE_CMD_READ_ATTR_RESP_CB_ID:
+        ret = zb_read_attr_resp_handler((esp_zb_zcl_cmd_read_attr_resp_message_t *)message);
+        break;
+    case ESP_ZB_CORE_CMD_REPORT_CONFIG_RESP_CB_ID:
+        ret = zb_config_report_resp_handler((esp_zb_zcl_cmd_config_report_resp_message_t *)message);
+        break;
+    case ESP_ZB_CORE_CMD_DEFAULT_RESP_CB_ID:
+        zb_delivery_default_response((esp_zb_zcl_cmd_default_resp_message_t *)message);
+        break;
+    case ESP_ZB_CORE_OTA_UPGRADE_SRV_QUERY_IMAGE_CB_ID:
+        ret = zb_ota_server_handle_query((esp_zb_zcl_ota_upgrade_server_query_image_message_t *)message);
+        break;
+    case ESP_ZB_CORE_OTA_UPGRADE_SRV_STATUS_CB_ID:
+        ret = zb_ota_server_handle_status((esp_zb_zcl_ota_upgrade_server_status_message_t *)message);
+        break;
+    default:
+        ESP_LOGW(TAG, "Receive Zigbee action(0x%x) callback", callback_id);
+        break;
+    }
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_toggle_led_by_id()
+ *------------------------------------------------------------*/
+
+/* Sent as the opposite of the state the follower is headed for, the
+ * last on/off still on its way or else the cached one, so a command
+ * that arrives twice does no harm. */
+
+esp_err_t follower_toggle_led_by_id(uint16_t id)
+{
+    follower_t follower;
+    ESP_RETURN_ON_ERROR(follower_registry_get(id, &follower), TAG, "No follower with ID %u", id);
+    uint8_t on_off = follower.on_off_pending != FOLLOWER_ATTR_UNKNOWN ? follower.on_off_pending : follower.on_off;
+    if (on_off != FOLLOWER_ATTR_UNKNOWN)
+    {
+        return follower_set_led_by_id(id, !on_off);
+    }
+    zb_command_t command = {
+        .type = ZB_COMMAND_ON_OFF_TOGGLE,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+    };
+    ESP_RETURN_ON_ERROR(follower_dst(id, &command.dst), TAG, "Cannot address follower");
+    return zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_set_led_by_id()
+ *------------------------------------------------------------*/
+
+/* The command is marked pending before it is queued, so a toggle
+ * right after this one goes the right way. The cache only takes the
+ * new state once the command is delivered, see
+ * zb_delivery_finished_cb(), or the follower reports it. */
+
+esp_err_t follower_set_led_by_id(uint16_t id, bool on)
+{
+    zb_command_t command = {
+        .type = ZB_COMMAND_ON_OFF_SET,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+        .data.on_off = on,
+    };
+    ESP_RETURN_ON_ERROR(follower_dst(id, &command.dst), TAG, "Cannot address follower");
+    ESP_RETURN_ON_ERROR(follower_registry_set_on_off_pending(id, on), TAG, "No follower with ID %u", id);
+    esp_err_t err = zb_delivery_send(&command);
+    if (err != ESP_OK)
+    {
+        follower_registry_drop_on_off_pending(id, on);
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to queue on/off command");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_state()
+ *------------------------------------------------------------*/
+
+/* Answered from the registry, the follower is not asked. */
+
+esp_err_t follower_state(uint16_t id)
+{
+    int64_t start_us = esp_timer_get_time();
+    follower_t follower;
+    ESP_RETURN_ON_ERROR(follower_registry_get(id, &follower), TAG, "No follower with ID %u", id);
+    uint32_t lookup_us = (uint32_t)(esp_timer_get_time() - start_us);
+
+    uint32_t now_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    const char *on_off = follower.on_off == FOLLOWER_ATTR_UNKNOWN ? "unknown" : follower.on_off ? "on" : "off";
+    const char *pending = follower.on_off_pending == FOLLOWER_ATTR_UNKNOWN ? "none" : follower.on_off_pending ? "on" : "off";
+    const char *effect = follower.effect_type == FOLLOWER_ATTR_UNKNOWN ? "unknown" : led_effects_type_to_string(follower.effect_type);
+    ESP_LOGI(TAG, "FOLLOWER_STATE id=%u on_off=%s pending=%s effect=%s age_s=%" PRIu32 " lookup_us=%" PRIu32, id, on_off, pending,
+             effect, now_s - follower.last_seen_s, lookup_us);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_set_effect()
+ *------------------------------------------------------------*/
+
+/* Send an LED effect to the followers bound to the LED effects
+ * cluster. Returns at once; the command is sent by the command
+ * queue. */
+
+void follower_set_effect(const led_effect_params_t *params)
+{
+    zb_command_t command = {
+        .type = ZB_COMMAND_LED_EFFECT,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+        .data.effect = *params,
+    };
+    zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_set_effect_by_id()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_set_effect_by_id(uint16_t id, const led_effect_params_t *params)
+{
+    zb_command_t command = {
+        .type = ZB_COMMAND_LED_EFFECT,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+        .data.effect = *params,
+    };
+    ESP_RETURN_ON_ERROR(follower_dst(id, &command.dst), TAG, "Cannot address follower");
+    return zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_toggle_group()
+ *------------------------------------------------------------*/
+
+/* An explicit on or off, as in follower_toggle_led(). */
+
+esp_err_t follower_toggle_group(uint8_t group)
+{
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid group %u", group);
+    zb_command_t command = {
+        .type = ZB_COMMAND_ON_OFF_SET,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+        .dst.mode = ZB_COMMAND_DST_GROUP,
+        .dst.group_id = FOLLOWER_GROUP_ID(group),
+        .data.on_off = !followers_any_on(0, (uint8_t)(1 << group)),
+    };
+    return zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_set_effect_group()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_set_effect_group(uint8_t group, const led_effect_params_t *params)
+{
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid group %u", group);
+    zb_command_t command = {
+        .type = ZB_COMMAND_LED_EFFECT,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+        .dst.mode = ZB_COMMAND_DST_GROUP,
+        .dst.group_id = FOLLOWER_GROUP_ID(group),
+        .data.effect = *params,
+    };
+    return zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_group_add()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_group_add(uint16_t id, uint8_t group)
+{
+    return follower_group_request(id, group, true);
+}
+
+/*--------------------------------------------------------------
+ * follower_group_remove()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_group_remove(uint16_t id, uint8_t group)
+{
+    return follower_group_request(id, group, false);
+}
+
+/*--------------------------------------------------------------
+ * benchmark_task()
+ *------------------------------------------------------------*/
+
+/* Runs one benchmark, then deletes itself. */
+static void benchmark_task(void *arg)
+{
+    s_benchmark_fn(&s_benchmark_args);
+    taskENTER_CRITICAL(&s_benchmark_lock);
+    s_benchmark_fn = NULL;
+    taskEXIT_CRITICAL(&s_benchmark_lock);
+    vTaskDelete(NULL);
+}
+
+/*--------------------------------------------------------------
+ * benchmark_start()
+ *------------------------------------------------------------*/
+
+/* Run a benchmark in a task of its own, so the caller, usually the
+ * UART task, goes on at once. Benchmarks run one at a time, their
+ * frames would hold each other up otherwise. */
+static esp_err_t benchmark_start(benchmark_fn_t fn, const benchmark_args_t *args)
+{
+    taskENTER_CRITICAL(&s_benchmark_lock);
+    bool busy = s_benchmark_fn != NULL;
+    if (!busy)
+    {
+        s_benchmark_fn = fn;
+        s_benchmark_args = *args;
+    }
+    taskEXIT_CRITICAL(&s_benchmark_lock);
+    ESP_RETURN_ON_FALSE(!busy, ESP_ERR_INVALID_STATE, TAG, "Another benchmark is still running");
+
+    if (xTaskCreate(benchmark_task, "benchmark", BENCHMARK_TASK_STACK_DEPTH, NULL, BENCHMARK_TASK_PRIORITY, NULL) != pdPASS)
+    {
+        taskENTER_CRITICAL(&s_benchmark_lock);
+        s_benchmark_fn = NULL;
+        taskEXIT_CRITICAL(&s_benchmark_lock);
+        ESP_LOGE(TAG, "Failed to create benchmark task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * benchmark_wait()
+ *------------------------------------------------------------*/
+
+/* Wait until the benchmark's own commands have had `statuses` send
+ * statuses in total (zb_benchmark.h). Returns the time from
+ * `start_us` to the last of them, or -1 on timeout. */
+static int64_t benchmark_wait(uint32_t statuses, int64_t start_us)
+{
+    zb_benchmark_stats_t stats;
+    if (zb_benchmark_wait(statuses, start_us + BENCHMARK_TIMEOUT_US, &stats) != ESP_OK)
+    {
+        return -1;
+    }
+    return stats.last_status_us - start_us;
+}
+
+/*--------------------------------------------------------------
+ * group_benchmark_run()
+ *------------------------------------------------------------*/
+
+/* For each count of followers, time changing all of their states
+ * with one unicast toggle each, then with one group toggle. There are
+ * usually fewer real followers than that, so the unicast toggles go
+ * round robin to the real ones; each still costs its own frame. Only
+ * the benchmark's own send statuses count, other traffic slows it
+ * down but does not end a wait early. */
+static void group_benchmark_run(const benchmark_args_t *args)
+{
+    /* Too big for the benchmark task's stack. */
+    static uint16_t ids[FOLLOWER_REGISTRY_CAPACITY];
+    uint16_t real = 0;
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) == ESP_OK && follower.endpoint != 0)
+        {
+            ids[real++] = id;
+        }
+    }
+    if (real == 0)
+    {
+        ESP_LOGE(TAG, "No followers to benchmark with.");
+        return;
+    }
+
+    zb_benchmark_begin();
+    for (size_t i = 0; i < sizeof(BENCHMARK_FOLLOWERS) / sizeof(BENCHMARK_FOLLOWERS[0]); i++)
+    {
+        uint32_t count = BENCHMARK_FOLLOWERS[i];
+        zb_benchmark_stats_t stats;
+        zb_command_t command = {
+            .type = ZB_COMMAND_ON_OFF_TOGGLE,
+            .benchmark = true,
+        };
+
+        /* Unicast, paced by the queue instead of dropping. */
+        zb_benchmark_get_stats(&stats);
+        int64_t start_us = esp_timer_get_time();
+        for (uint32_t n = 0; n < count; n++)
+        {
+            follower_dst(ids[n % real], &command.dst);
+            zb_command_queue_send_wait(&command, portMAX_DELAY);
+        }
+        int64_t unicast_us = benchmark_wait(stats.statuses + count, start_us);
+
+        /* Group. */
+        command.dst.mode = ZB_COMMAND_DST_GROUP;
+        command.dst.group_id = FOLLOWER_GROUP_ID(FOLLOWER_GROUP_ALL);
+        zb_benchmark_get_stats(&stats);
+        start_us = esp_timer_get_time();
+        zb_command_queue_send_wait(&command, portMAX_DELAY);
+        int64_t group_us = benchmark_wait(stats.statuses + 1, start_us);
+
+        ESP_LOGI(TAG, "%" PRIu32 " follower(s): unicast %" PRId64 " us, group %" PRId64 " us.", count, unicast_us, group_us);
+    }
+}
+
+/*--------------------------------------------------------------
+ * follower_group_benchmark()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_group_benchmark(void)
+{
+    benchmark_args_t args = {0};
+    return benchmark_start(group_benchmark_run, &args);
+}
+
+/*--------------------------------------------------------------
+ * fanout_benchmark_run()
+ *------------------------------------------------------------*/
+
+/* Each round switches every follower with a light on, then off, once
+ * back to back and once fanned out, taking turns so neither always
+ * goes first. The commands are sets, not toggles, so lost ones are
+ * retried, and a run is done when every one of them is delivered or
+ * given up on. Only the benchmark's own commands count, by
+ * zb_benchmark_finished(), other traffic slows it down but is not
+ * counted. */
+static void fanout_benchmark_run(const benchmark_args_t *args)
+{
+    /* Too big for the benchmark task's stack. */
+    static zb_command_t commands[ZB_FANOUT_MAX_COMMANDS];
+    static uint16_t ids[ZB_FANOUT_MAX_COMMANDS];
+    uint32_t count = 0;
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY && count < ZB_FANOUT_MAX_COMMANDS; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) == ESP_OK && follower.endpoint != 0)
+        {
+            commands[count] = (zb_command_t){
+                .type = ZB_COMMAND_ON_OFF_SET,
+                .benchmark = true,
+            };
+            follower_dst(id, &commands[count].dst);
+            ids[count++] = id;
+        }
+    }
+    if (count == 0)
+    {
+        ESP_LOGE(TAG, "No followers to benchmark with.");
+        return;
+    }
+    uint32_t rounds = args->fanout.rounds;
+
+    /* Totals, back to back first, then fanned out. */
+    int64_t total_us[2] = {0};
+    uint32_t completed[2] = {0};
+    uint32_t lost[2] = {0};
+    uint32_t retries[2] = {0};
+    uint32_t failed[2] = {0};
+    zb_benchmark_begin();
+    for (uint32_t run = 0; run < rounds * 2; run++)
+    {
+        uint32_t fanned = (run + run / 2) % 2;
+        bool on = run % 2 == 0;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            commands[i].data.on_off = on;
+            /* As in follower_set_led_by_id(). */
+            follower_registry_set_on_off_pending(ids[i], on);
+        }
+
+        zb_benchmark_stats_t before;
+        zb_benchmark_stats_t after;
+        zb_fanout_stats_t fanout;
+        uint32_t sent = 0;
+        zb_benchmark_get_stats(&before);
+        int64_t start_us = esp_timer_get_time();
+        if (fanned)
+        {
+            esp_zb_lock_acquire(portMAX_DELAY);
+            zb_fanout_get_stats(&fanout);
+            uint32_t dropped = fanout.dropped;
+            sent = zb_fanout_send(commands, count) == ESP_OK ? count : 0;
+            esp_zb_lock_release();
+            /* Commands the queue had no room for when their time came
+             * never finish. */
+            do
+            {
+                vTaskDelay(1);
+                zb_fanout_get_stats(&fanout);
+            } while (sent > 0 && fanout.scheduled > 0 && esp_timer_get_time() - start_us < BENCHMARK_TIMEOUT_US);
+            sent -= fanout.dropped - dropped;
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                sent += zb_delivery_send(&commands[i]) == ESP_OK;
+            }
+        }
+        int64_t elapsed_us = -1;
+        if (zb_benchmark_wait_finished(before.finished + sent, start_us + BENCHMARK_TIMEOUT_US, &after) == ESP_OK)
+        {
+            elapsed_us = after.last_finish_us - start_us;
+        }
+        zb_fanout_get_stats(&fanout);
+
+        /* Every command finished has one try that is not a retry. */
+        uint32_t run_lost = after.lost - before.lost;
+        uint32_t run_retries = (after.attempts - before.attempts) - (after.finished - before.finished);
+        uint32_t run_failed = after.undelivered - before.undelivered;
+        ESP_LOGI(TAG, "FANOUT mode=%s targets=%" PRIu32 " sent=%" PRIu32 " slot_ms=%u ms=%" PRId64 " lost=%" PRIu32 " retries=%" PRIu32
+                      " failed=%" PRIu32,
+                 fanned ? "staggered" : "naive", count, sent, fanned ? fanout.slot_ms : 0, elapsed_us < 0 ? -1 : elapsed_us / 1000,
+                 run_lost, run_retries, run_failed);
+        if (elapsed_us >= 0)
+        {
+            total_us[fanned] += elapsed_us;
+            completed[fanned]++;
+        }
+        lost[fanned] += run_lost;
+        retries[fanned] += run_retries;
+        failed[fanned] += run_failed;
+    }
+
+    /* Average completion time of the runs that completed, totals of
+     * the rest. */
+    ESP_LOGI(TAG, "FANOUT_BENCH targets=%" PRIu32 " rounds=%" PRIu32 " naive_ms=%" PRId64 " naive_lost=%" PRIu32 " naive_retries=%" PRIu32
+                  " naive_failed=%" PRIu32 " staggered_ms=%" PRId64 " staggered_lost=%" PRIu32 " staggered_retries=%" PRIu32
+                  " staggered_failed=%" PRIu32,
+             count, rounds * 2, completed[0] ? total_us[0] / completed[0] / 1000 : -1, lost[0], retries[0], failed[0],
+             completed[1] ? total_us[1] / completed[1] / 1000 : -1, lost[1], retries[1], failed[1]);
+}
+
+/*--------------------------------------------------------------
+ * follower_fanout_benchmark()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_fanout_benchmark(uint32_t rounds)
+{
+    rounds = rounds == 0 ? BENCHMARK_FANOUT_ROUNDS : rounds;
+    benchmark_args_t args = {
+        .fanout.rounds = rounds > BENCHMARK_FANOUT_MAX_ROUNDS ? BENCHMARK_FANOUT_MAX_ROUNDS : rounds,
+    };
+    return benchmark_start(fanout_benchmark_run, &args);
+}
+
+/*--------------------------------------------------------------
+ * follower_scene_send()
+ *------------------------------------------------------------*/
+
+/* Store or recall a scene on every member of a group, or ask them
+ * which scenes they have, in one frame. */
+static esp_err_t follower_scene_send(zb_command_type_t type, uint8_t group, uint8_t scene_id)
+{
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid group %u", group);
+    zb_command_t command = {
+        .type = type,
+        .priority = ZB_COMMAND_PRIORITY_INTERACTIVE,
+        .dst.mode = ZB_COMMAND_DST_GROUP,
+        .dst.group_id = FOLLOWER_GROUP_ID(group),
+        .data.scene.group_id = FOLLOWER_GROUP_ID(group),
+        .data.scene.scene_id = scene_id,
+    };
+    return zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * follower_scene_store()
+ *------------------------------------------------------------*/
+
+/* Followers do not answer a store sent to a group, so the scene is
+ * unconfirmed until one of them lists it. The members are asked
+ * right after, in the same lane, so the store is there first. Only
+ * members with scenes in the group answer a group-addressed Get
+ * Scene Membership. */
+
+esp_err_t follower_scene_store(uint8_t group, uint8_t scene_id)
+{
+    ESP_RETURN_ON_ERROR(follower_scene_send(ZB_COMMAND_SCENE_STORE, group, scene_id), TAG, "Failed to store scene");
+    ESP_RETURN_ON_ERROR(follower_scenes_stored(group, scene_id), TAG, "Failed to record scene");
+    return follower_scene_send(ZB_COMMAND_SCENE_MEMBERSHIP, group, scene_id);
+}
+
+/*--------------------------------------------------------------
+ * follower_scene_recall()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_scene_recall(uint8_t group, uint8_t scene_id)
+{
+    /* Unknown scenes are still sent, the followers may have them from
+     * before the leader's list was cleared. */
+    follower_scenes_recalled(group, scene_id);
+    return follower_scene_send(ZB_COMMAND_SCENE_RECALL, group, scene_id);
+}
+
+/*--------------------------------------------------------------
+ * follower_scene_membership()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_scene_membership(uint16_t id, uint8_t group)
+{
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid group %u", group);
+    zb_command_t command = {
+        .type = ZB_COMMAND_SCENE_MEMBERSHIP,
+        .data.scene.group_id = FOLLOWER_GROUP_ID(group),
+    };
+    ESP_RETURN_ON_ERROR(follower_dst(id, &command.dst), TAG, "Cannot address follower");
+    return zb_delivery_send(&command);
+}
+
+/*--------------------------------------------------------------
+ * scene_benchmark_run()
+ *------------------------------------------------------------*/
+
+/* Change the state of every member of a group the long way, with an
+ * on/off command and an effect command to each, then put them all
+ * back with one scene recall. Only the benchmark's own send statuses
+ * count. */
+static void scene_benchmark_run(const benchmark_args_t *args)
+{
+    uint8_t group = args->scene.group;
+    uint8_t scene_id = args->scene.scene_id;
+    zb_command_t effect_command = {
+        .type = ZB_COMMAND_LED_EFFECT,
+        .benchmark = true,
+        .data.effect.type = LED_EFFECT_NONE,
+    };
+    zb_command_t on_off_command = {
+        .type = ZB_COMMAND_ON_OFF_TOGGLE,
+        .benchmark = true,
+    };
+    zb_benchmark_stats_t stats;
+
+    /* Each attribute of each light on its own. */
+    uint32_t commands = 0;
+    zb_benchmark_begin();
+    zb_benchmark_get_stats(&stats);
+    int64_t start_us = esp_timer_get_time();
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) != ESP_OK || !(follower.groups & (1 << group)) ||
+            follower_dst(id, &effect_command.dst) != ESP_OK)
+        {
+            continue;
+        }
+        on_off_command.dst = effect_command.dst;
+        zb_command_queue_send_wait(&effect_command, portMAX_DELAY);
+        zb_command_queue_send_wait(&on_off_command, portMAX_DELAY);
+        commands += 2;
+    }
+    if (commands == 0)
+    {
+        ESP_LOGE(TAG, "No followers in group %u to benchmark with.", group);
+        return;
+    }
+    int64_t individual_us = benchmark_wait(stats.statuses + commands, start_us);
+
+    /* One recall, as follower_scene_recall() sends it. */
+    zb_command_t recall_command = {
+        .type = ZB_COMMAND_SCENE_RECALL,
+        .benchmark = true,
+        .dst.mode = ZB_COMMAND_DST_GROUP,
+        .dst.group_id = FOLLOWER_GROUP_ID(group),
+        .data.scene.group_id = FOLLOWER_GROUP_ID(group),
+        .data.scene.scene_id = scene_id,
+    };
+    zb_benchmark_get_stats(&stats);
+    start_us = esp_timer_get_time();
+    follower_scenes_recalled(group, scene_id);
+    zb_command_queue_send_wait(&recall_command, portMAX_DELAY);
+    int64_t recall_us = benchmark_wait(stats.statuses + 1, start_us);
+
+    ESP_LOGI(TAG, "%" PRIu32 " follower(s): individually %" PRIu32 " commands in %" PRId64 " us, scene recall 1 command in %" PRId64 " us.",
+             commands / 2, commands, individual_us, recall_us);
+}
+
+/*--------------------------------------------------------------
+ * follower_scene_benchmark()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_scene_benchmark(uint8_t group, uint8_t scene_id)
+{
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid group %u", group);
+    benchmark_args_t args = {
+        .scene.group = group,
+        .scene.scene_id = scene_id,
+    };
+    return benchmark_start(scene_benchmark_run, &args);
+}
+
+/*--------------------------------------------------------------
+ * bulk_benchmark_run()
+ *------------------------------------------------------------*/
+
+/* Send `size` bytes to one follower as a bulk transfer, then as many
+ * effect commands as it would take to carry them in ZCL, and compare
+ * goodput and how much of the airtime is payload. The follower logs
+ * the checksum of what it received. */
+static void bulk_benchmark_run(const benchmark_args_t *args)
+{
+    /* Too big for the benchmark task's stack. */
+    static uint8_t payload[ZB_BULK_MAX_SIZE];
+    uint16_t size = args->bulk.size;
+    zb_command_t command = {
+        .type = ZB_COMMAND_LED_EFFECT,
+        .benchmark = true,
+        .data.effect.type = LED_EFFECT_NONE,
+    };
+    if (follower_dst(args->bulk.id, &command.dst) != ESP_OK)
+    {
+        return;
+    }
+    uint32_t checksum = 0;
+    for (uint16_t i = 0; i < size; i++)
+    {
+        payload[i] = (uint8_t)(i * 7 + 1);
+        checksum += payload[i];
+    }
+
+    /* Bulk. */
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_bulk_send(command.dst.short_addr, payload, size);
+    esp_zb_lock_release();
+    if (err != ESP_OK)
+    {
+        return;
+    }
+    zb_bulk_stats_t bulk;
+    int64_t start_us = esp_timer_get_time();
+    while (!zb_bulk_get_stats(&bulk) && esp_timer_get_time() - start_us < BENCHMARK_TIMEOUT_US)
+    {
+        vTaskDelay(1);
+    }
+    if (bulk.status != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Bulk transfer did not finish (%s).", esp_err_to_name(bulk.status));
+        return;
+    }
+
+    /* ZCL, LED_EFFECTS_PARAMS_WIRE_SIZE bytes per command. */
+    uint32_t needed = (size + LED_EFFECTS_PARAMS_WIRE_SIZE - 1) / LED_EFFECTS_PARAMS_WIRE_SIZE;
+    uint32_t commands = needed < BENCHMARK_ZCL_COMMANDS ? needed : BENCHMARK_ZCL_COMMANDS;
+    zb_benchmark_stats_t stats;
+    zb_benchmark_begin();
+    zb_benchmark_get_stats(&stats);
+    start_us = esp_timer_get_time();
+    for (uint32_t n = 0; n < commands; n++)
+    {
+        zb_command_queue_send_wait(&command, portMAX_DELAY);
+    }
+    int64_t zcl_us = benchmark_wait(stats.statuses + commands, start_us);
+
+    /* Each command is a request and a default response. */
+    uint32_t zcl_air_bytes = 2 * (ZB_BULK_AIR_OVERHEAD + ZCL_HEADER_SIZE) + 1 + LED_EFFECTS_PARAMS_WIRE_SIZE + ZCL_DEFAULT_RESPONSE_SIZE;
+    ESP_LOGI(TAG, "Bulk: %u bytes in %" PRId64 " us, %" PRId64 " B/s, %" PRIu32 "%% of airtime is payload, %" PRIu32 " data frames (%" PRIu32 " again), %" PRIu32 " acknowledgements, checksum 0x%08" PRIx32 ".",
+             bulk.bytes, bulk.elapsed_us, (int64_t)bulk.bytes * 1000000 / bulk.elapsed_us, (uint32_t)bulk.bytes * 100 / bulk.air_bytes,
+             bulk.data_frames, bulk.retransmissions, bulk.ack_frames, checksum);
+    if (zcl_us > 0)
+    {
+        ESP_LOGI(TAG, "ZCL: %" PRIu32 " effect commands of %u bytes in %" PRId64 " us, %" PRId64 " B/s, %" PRIu32 "%% of airtime is payload, %" PRIu32 " commands needed in all.",
+                 commands, LED_EFFECTS_PARAMS_WIRE_SIZE, zcl_us, (int64_t)commands * LED_EFFECTS_PARAMS_WIRE_SIZE * 1000000 / zcl_us,
+                 (uint32_t)LED_EFFECTS_PARAMS_WIRE_SIZE * 100 / zcl_air_bytes, needed);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "ZCL: effect commands did not finish.");
+    }
+}
+
+/*--------------------------------------------------------------
+ * follower_bulk_benchmark()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_bulk_benchmark(uint16_t id, uint16_t size)
+{
+    ESP_RETURN_ON_FALSE(size > 0 && size <= ZB_BULK_MAX_SIZE, ESP_ERR_INVALID_ARG, TAG, "Invalid size %u, at most %u bytes.", size,
+                        ZB_BULK_MAX_SIZE);
+    benchmark_args_t args = {
+        .bulk.id = id,
+        .bulk.size = size,
+    };
+    return benchmark_start(bulk_benchmark_run, &args);
+}
+
+/*--------------------------------------------------------------
+ * latency_measure_run()
+ *------------------------------------------------------------*/
+
+/* Toggle one follower `count` times, one toggle at a time, and time
+ * every stage from the UART to its LED. Only the first toggle really
+ * came over the UART; each later one counts as arriving when the one
+ * before it is done. With one toggle out at a time, the benchmark's
+ * one send status is that toggle's own. */
+static void latency_measure_run(const benchmark_args_t *args)
+{
+    uint16_t count = args->latency.count;
+    int64_t uart_us = args->latency.uart_us;
+    zb_command_t command = {
+        .type = ZB_COMMAND_ON_OFF_TOGGLE,
+        .benchmark = true,
+    };
+    if (follower_dst(args->latency.id, &command.dst) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "Nothing to measure.");
+        return;
+    }
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_latency_set_mode(command.dst.short_addr, true);
+    esp_zb_lock_release();
+    if (err != ESP_OK)
+    {
+        return;
+    }
+
+    zb_latency_reset();
+    zb_benchmark_begin();
+    uint32_t lost = 0;
+    for (uint16_t n = 0; n < count; n++)
+    {
+        if (n > 0)
+        {
+            uart_us = esp_timer_get_time();
+        }
+        uint32_t receive_to_led_us;
+        int64_t report_us;
+        zb_latency_get_report(&receive_to_led_us, &report_us);
+        int64_t last_report_us = report_us;
+
+        /* Leader. */
+        zb_benchmark_stats_t before;
+        zb_benchmark_stats_t stats;
+        zb_benchmark_get_stats(&before);
+        int64_t enqueued_us = esp_timer_get_time();
+        zb_command_queue_send_wait(&command, portMAX_DELAY);
+        err = zb_benchmark_wait(before.statuses + 1, enqueued_us + BENCHMARK_TIMEOUT_US, &stats);
+        if (err != ESP_OK)
+        {
+            /* Forget it, so a late send status is not taken for the
+             * next toggle's. */
+            zb_benchmark_begin();
+        }
+        if (err != ESP_OK || stats.failed != before.failed)
+        {
+            lost++;
+            continue;
+        }
+        uint32_t uart_to_submit_us = (uint32_t)(enqueued_us - uart_us) + stats.last_queued_us;
+        zb_latency_add(ZB_LATENCY_UART_TO_SUBMIT, uart_to_submit_us);
+        zb_latency_add(ZB_LATENCY_SUBMIT_TO_CONFIRM, stats.last_confirm_us);
+
+        /* Follower. */
+        while (report_us == last_report_us && esp_timer_get_time() - enqueued_us < LATENCY_REPORT_TIMEOUT_US)
+        {
+            vTaskDelay(1);
+            zb_latency_get_report(&receive_to_led_us, &report_us);
+        }
+        if (report_us == last_report_us)
+        {
+            lost++;
+            continue;
+        }
+        zb_latency_add(ZB_LATENCY_RECEIVE_TO_LED, receive_to_led_us);
+        zb_latency_add(ZB_LATENCY_END_TO_END, uart_to_submit_us + stats.last_confirm_us + receive_to_led_us);
+        zb_latency_add(ZB_LATENCY_ROUND_TRIP, (uint32_t)(report_us - uart_us));
+    }
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    zb_latency_set_mode(command.dst.short_addr, false);
+    esp_zb_lock_release();
+    zb_latency_log();
+    ESP_LOGI(TAG, "LATENCY_END n=%u lost=%" PRIu32, count, lost);
+}
+
+/*--------------------------------------------------------------
+ * follower_latency_measure()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_latency_measure(uint16_t id, uint16_t count, int64_t uart_us)
 {
-    esp_zb_ieee_addr_t ieee_addr;
-    uint8_t endpoint;
-    uint16_t short_addr;
-} light_bulb_device_params_t;
+    ESP_RETURN_ON_FALSE(count > 0, ESP_ERR_INVALID_ARG, TAG, "Nothing to measure.");
+    benchmark_args_t args = {
+        .latency.id = id,
+        .latency.count = count,
+        .latency.uart_us = uart_us,
+    };
+    return benchmark_start(latency_measure_run, &args);
+}
 
-/*##############################################################
- * CONSTANTS
- *############################################################*/
+/*--------------------------------------------------------------
+ * stress_query()
+ *------------------------------------------------------------*/
 
-static const char *TAG = "ESP_ZB_SWITCH";
+/* Ask the followers of a capacity test for their counters and wait
+ * for them. Those that do not answer are left out of the result. */
+static void stress_query(void)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_stress_query();
+    esp_zb_lock_release();
+    int64_t start_us = esp_timer_get_time();
+    while (err == ESP_OK && !zb_stress_all_reported() && esp_timer_get_time() - start_us < STRESS_REPORT_TIMEOUT_US)
+    {
+        vTaskDelay(1);
+    }
+}
 
-/*##############################################################
- * GLOBAL VARIABLES
- *############################################################*/
+/*--------------------------------------------------------------
+ * stress_run()
+ *------------------------------------------------------------*/
 
-static switch_func_pair_t button_func_pair[] = {
-    {GPIO_INPUT_IO_TOGGLE_SWITCH, SWITCH_ONOFF_TOGGLE_CONTROL}};
+/* Send `count` toggles, taking turns over `commands`, at `rate` per
+ * second, or as fast as the queue takes them if 0. A paced toggle
+ * the queue has no room for is dropped, as a real one would be, and
+ * counted as lost. The targets must already be added. */
+static void stress_run(uint32_t rate, uint32_t count, const zb_command_t *commands, uint32_t command_count)
+{
+    stress_query();
+    zb_stress_start();
 
-/*##############################################################
- * FUNCTIONS
- *############################################################*/
+    uint32_t dropped = 0;
+    int64_t start_us = esp_timer_get_time();
+    for (uint32_t n = 0; n < count; n++)
+    {
+        const zb_command_t *command = &commands[n % command_count];
+        if (rate == 0)
+        {
+            zb_command_queue_send_wait(command, portMAX_DELAY);
+            continue;
+        }
+        /* Sleep whole ticks only. Within a tick the toggles go out
+         * together, the average rate is still right. */
+        int64_t wait_us = start_us + (int64_t)n * 1000000 / rate - esp_timer_get_time();
+        if (wait_us >= portTICK_PERIOD_MS * 1000)
+        {
+            vTaskDelay((TickType_t)(wait_us / (portTICK_PERIOD_MS * 1000)));
+        }
+        if (zb_command_queue_send(command) != ESP_OK)
+        {
+            dropped++;
+        }
+    }
+
+    /* Every send status, then every counter. */
+    int64_t last_us = esp_timer_get_time();
+    while (zb_stress_outstanding() > 0 && esp_timer_get_time() - last_us < BENCHMARK_TIMEOUT_US)
+    {
+        vTaskDelay(1);
+    }
+    stress_query();
+
+    zb_stress_result_t result;
+    zb_stress_end(count, dropped, &result);
+    zb_stress_log(rate, &result);
+}
 
 /*--------------------------------------------------------------
- * follower_toggle_led()
+ * stress_benchmark_run()
  *------------------------------------------------------------*/
 
-/* Implement light switch toggle functionality. */
+/* Unicast toggles, round robin over the followers. Each follower's
+ * share is known up front, so its counter can be checked against
+ * it. */
+static void stress_benchmark_run(const benchmark_args_t *args)
+{
+    /* Too big for the benchmark task's stack. */
+    static zb_command_t commands[ZB_STRESS_MAX_TARGETS];
+    uint32_t rate = args->stress.rate;
+    uint32_t count = args->stress.count;
+    const uint16_t *ids = args->stress.ids;
+    uint16_t id_count = args->stress.id_count;
+    uint32_t command_count = 0;
 
-void follower_toggle_led(void)
+    if (id_count == 0)
+    {
+        /* Every follower with a light. */
+        for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY && command_count < ZB_STRESS_MAX_TARGETS; id++)
+        {
+            follower_t follower;
+            if (follower_registry_get(id, &follower) == ESP_OK && follower.endpoint != 0)
+            {
+                commands[command_count].type = ZB_COMMAND_ON_OFF_TOGGLE;
+                follower_dst(id, &commands[command_count].dst);
+                command_count++;
+            }
+        }
+    }
+    for (uint16_t i = 0; i < id_count && command_count < ZB_STRESS_MAX_TARGETS; i++)
+    {
+        commands[command_count].type = ZB_COMMAND_ON_OFF_TOGGLE;
+        if (follower_dst(ids[i], &commands[command_count].dst) == ESP_OK)
+        {
+            command_count++;
+        }
+    }
+    if (command_count == 0)
+    {
+        ESP_LOGE(TAG, "Nothing to stress.");
+        return;
+    }
+
+    zb_stress_begin();
+    for (uint32_t i = 0; i < command_count; i++)
+    {
+        uint32_t share = count / command_count + (i < count % command_count ? 1 : 0);
+        zb_stress_add_target(commands[i].dst.short_addr, share);
+    }
+    stress_run(rate, count, commands, command_count);
+}
+
+/*--------------------------------------------------------------
+ * follower_stress_benchmark()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_stress_benchmark(uint32_t rate, uint32_t count, const uint16_t *ids, uint16_t id_count)
+{
+    ESP_RETURN_ON_FALSE(count > 0, ESP_ERR_INVALID_ARG, TAG, "Nothing to stress.");
+    benchmark_args_t args = {
+        .stress.rate = rate,
+        .stress.count = count,
+        .stress.id_count = id_count < ZB_STRESS_MAX_TARGETS ? id_count : ZB_STRESS_MAX_TARGETS,
+    };
+    memcpy(args.stress.ids, ids, args.stress.id_count * sizeof(uint16_t));
+    return benchmark_start(stress_benchmark_run, &args);
+}
+
+/*--------------------------------------------------------------
+ * stress_group_benchmark_run()
+ *------------------------------------------------------------*/
+
+/* Group toggles. Every member should receive all of them. */
+static void stress_group_benchmark_run(const benchmark_args_t *args)
+{
+    uint32_t rate = args->stress.rate;
+    uint32_t count = args->stress.count;
+    uint8_t group = args->stress.group;
+    zb_command_t command = {
+        .type = ZB_COMMAND_ON_OFF_TOGGLE,
+        .dst.mode = ZB_COMMAND_DST_GROUP,
+        .dst.group_id = FOLLOWER_GROUP_ID(group),
+    };
+
+    zb_stress_begin();
+    uint32_t members = 0;
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) == ESP_OK && follower.endpoint != 0 && (follower.groups & (1 << group)) &&
+            zb_stress_add_target(follower.short_addr, count) == ESP_OK)
+        {
+            members++;
+        }
+    }
+    if (members == 0)
+    {
+        ESP_LOGE(TAG, "No followers in group %u to stress.", group);
+        return;
+    }
+    stress_run(rate, count, &command, 1);
+}
+
+/*--------------------------------------------------------------
+ * follower_stress_benchmark_group()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_stress_benchmark_group(uint32_t rate, uint32_t count, uint8_t group)
+{
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT && count > 0, ESP_ERR_INVALID_ARG, TAG, "Nothing to stress.");
+    benchmark_args_t args = {
+        .stress.rate = rate,
+        .stress.count = count,
+        .stress.group = group,
+    };
+    return benchmark_start(stress_group_benchmark_run, &args);
+}
+
+/*--------------------------------------------------------------
+ * sync_set_run()
+ *------------------------------------------------------------*/
+
+/* The frames go out one by one, and in any order, the time they
+ * carry is what lines the followers up.
+ *
+ * Once the action is scheduled the targets are marked pending, as in
+ * follower_set_led_by_id(). Their attribute reports, sent as their
+ * LEDs change, update the cache. A target that has not reported by
+ * the end of the wait is no longer pending and keeps its old
+ * state. */
+static void sync_set_run(const benchmark_args_t *args)
+{
+    bool on = args->sync.on;
+    const uint16_t *ids = args->sync.ids;
+    uint16_t id_count = args->sync.id_count;
+    uint16_t target_ids[ZB_TIME_SYNC_MAX_TARGETS];
+    zb_time_sync_begin();
+    uint32_t targets = 0;
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) != ESP_OK || follower.endpoint == 0)
+        {
+            continue;
+        }
+        bool wanted = id_count == 0;
+        for (uint16_t i = 0; i < id_count && !wanted; i++)
+        {
+            wanted = ids[i] == id;
+        }
+        if (wanted && zb_time_sync_add_target(follower.short_addr) == ESP_OK)
+        {
+            target_ids[targets++] = id;
+        }
+    }
+    if (targets == 0)
+    {
+        ESP_LOGE(TAG, "No followers to switch.");
+        return;
+    }
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    int64_t at_us = esp_timer_get_time() + (int64_t)args->sync.delay_ms * 1000;
+    esp_err_t err = zb_time_sync_schedule(at_us, on);
+    esp_zb_lock_release();
+    if (err != ESP_OK)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < targets; i++)
+    {
+        follower_registry_set_on_off_pending(target_ids[i], on);
+    }
+    while (!zb_time_sync_all_reported() && esp_timer_get_time() - at_us < SYNC_REPORT_TIMEOUT_US)
+    {
+        vTaskDelay(1);
+    }
+    for (uint32_t i = 0; i < targets; i++)
+    {
+        follower_registry_drop_on_off_pending(target_ids[i], on);
+    }
+
+    zb_time_sync_result_t result;
+    zb_time_sync_end(&result);
+    zb_time_sync_log(&result);
+}
+
+/*--------------------------------------------------------------
+ * follower_sync_set()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_sync_set(bool on, uint32_t delay_ms, const uint16_t *ids, uint16_t id_count)
+{
+    benchmark_args_t args = {
+        .sync.on = on,
+        .sync.delay_ms = delay_ms,
+        .sync.id_count = id_count < ZB_TIME_SYNC_MAX_TARGETS ? id_count : ZB_TIME_SYNC_MAX_TARGETS,
+    };
+    memcpy(args.sync.ids, ids, args.sync.id_count * sizeof(uint16_t));
+    return benchmark_start(sync_set_run, &args);
+}
+
+/*--------------------------------------------------------------
+ * follower_list()
+ *------------------------------------------------------------*/
+
+/* Log every follower in the registry. */
+
+void follower_list(void)
+{
+    uint32_t now_s = (uint32_t)(esp_timer_get_time() / 1000000);
+    ESP_LOGI(TAG, "%u follower(s):", follower_registry_count());
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) != ESP_OK)
+        {
+            continue;
+        }
+        ESP_LOGI(TAG, "  [%u] short 0x%04hx, ieee %02x:%02x:%02x:%02x:%02x:%02x:%02x:%02x, endpoint %u, bound 0x%02x, reporting 0x%02x, groups 0x%02x, lqi %u, on/off %u, effect %u, retries %u, seen %" PRIu32 " s ago",
+                 follower.id, follower.short_addr,
+                 follower.ieee_addr[7], follower.ieee_addr[6], follower.ieee_addr[5], follower.ieee_addr[4],
+                 follower.ieee_addr[3], follower.ieee_addr[2], follower.ieee_addr[1], follower.ieee_addr[0],
+                 follower.endpoint, follower.bound, follower.reporting, follower.groups, follower.lqi, follower.on_off, follower.effect_type,
+                 follower.retries, now_s - follower.last_seen_s);
+    }
+}
+
+/*--------------------------------------------------------------
+ * follower_lqi_update_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, and schedules itself again. */
+static void follower_lqi_update_cb(uint8_t param)
+{
+    follower_registry_update_lqi();
+    zb_resources_sample();
+    /* Commissioning changes come in bursts, saving here writes each
+     * burst once. */
+    follower_registry_save();
+    esp_zb_scheduler_alarm(follower_lqi_update_cb, 0, FOLLOWER_LQI_PERIOD_MS);
+}
+
+/*--------------------------------------------------------------
+ * formation_scan_done()
+ *------------------------------------------------------------*/
+
+/* Form the network on the quietest channel, or on the default one if
+ * the scan failed. */
+static void formation_scan_done(uint8_t best)
+{
+    if (best != 0)
+    {
+        esp_zb_set_primary_network_channel_set(1UL << best);
+    }
+    ESP_LOGI(TAG, "Start network formation");
+    esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_FORMATION);
+}
+
+/*--------------------------------------------------------------
+ * rescan_done()
+ *------------------------------------------------------------*/
+
+/* The scan is already logged and kept (zb_channel_get_last_scan()).
+ * A move costs every follower a rejoin, so it is left to whoever reads
+ * the log, see zigbee_channel_change(). */
+static void rescan_done(uint8_t best)
+{
+    /* zb_channel_select() already kept the current channel unless
+     * another one is clearly quieter. */
+    uint8_t current = esp_zb_get_current_channel();
+    if (best != 0 && best != current)
+    {
+        ESP_LOGW(TAG, "Channel %u is quieter than channel %u, leader_channel_change %u to move", best, current, best);
+    }
+}
+
+/*--------------------------------------------------------------
+ * channel_rescan_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, and schedules itself again. */
+static void channel_rescan_cb(uint8_t param)
+{
+    zb_channel_scan(rescan_done);
+    esp_zb_scheduler_alarm(channel_rescan_cb, 0, ZB_CHANNEL_RESCAN_PERIOD_MS);
+}
+
+/*--------------------------------------------------------------
+ * zigbee_channel_scan()
+ *------------------------------------------------------------*/
+
+esp_err_t zigbee_channel_scan(void)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_channel_scan(NULL);
+    esp_zb_lock_release();
+    return err;
+}
+
+/*--------------------------------------------------------------
+ * zigbee_channel_change()
+ *------------------------------------------------------------*/
+
+esp_err_t zigbee_channel_change(uint8_t channel)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_channel_change(channel);
+    esp_zb_lock_release();
+    return err;
+}
+
+/*--------------------------------------------------------------
+ * zigbee_permit_join()
+ *------------------------------------------------------------*/
+
+esp_err_t zigbee_permit_join(uint8_t seconds)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = esp_zb_bdb_open_network(seconds);
+    esp_zb_lock_release();
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to open the network");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zigbee_ota_notify()
+ *------------------------------------------------------------*/
+
+esp_err_t zigbee_ota_notify(void)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_ota_server_notify(HA_ONOFF_SWITCH_ENDPOINT);
+    esp_zb_lock_release();
+    return err;
+}
+
+/*--------------------------------------------------------------
+ * zigbee_resources_log()
+ *------------------------------------------------------------*/
+
+void zigbee_resources_log(void)
+{
+    uint32_t bindings = 0;
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) == ESP_OK)
+        {
+            bindings += !!(follower.bound & FOLLOWER_CLUSTER_ON_OFF) + !!(follower.bound & FOLLOWER_CLUSTER_LED_EFFECTS);
+        }
+    }
+    zb_command_queue_stats_t queue_stats;
+    zb_commission_stats_t commission_stats;
+    zb_delivery_stats_t delivery_stats;
+    zb_fanout_stats_t fanout_stats;
+    zb_command_queue_get_stats(&queue_stats);
+    zb_commission_get_stats(&commission_stats);
+    zb_fanout_get_stats(&fanout_stats);
+    esp_zb_lock_acquire(portMAX_DELAY);
+    zb_resources_sample();
+    zb_resources_log(bindings);
+    zb_delivery_get_stats(&delivery_stats);
+    esp_zb_lock_release();
+    /* Our own fixed tables, each as "<in use>/<size> max=<most>" and
+     * how often it was full. */
+    ESP_LOGI(TAG, "ZB_TABLES commands=%" PRIu32 "/%d max=%" PRIu32 " dropped=%" PRIu32 " delivery=%u/%d max=%u untracked=%" PRIu32
+                  " commission=%u/%d max=%u refused=%u fanout=%u/%d max=%u dropped=%" PRIu32,
+             queue_stats.depth, ZB_COMMAND_QUEUE_LENGTH, queue_stats.max_depth, queue_stats.dropped, delivery_stats.pending,
+             ZB_DELIVERY_MAX_PENDING, delivery_stats.max_pending, delivery_stats.untracked, commission_stats.queued,
+             ZB_COMMISSION_QUEUE_SIZE, commission_stats.max_queued, commission_stats.refused, fanout_stats.scheduled,
+             ZB_FANOUT_MAX_COMMANDS, fanout_stats.max_scheduled, fanout_stats.dropped);
+}
+
+/*--------------------------------------------------------------
+ * zigbee_commission_concurrency()
+ *------------------------------------------------------------*/
+
+esp_err_t zigbee_commission_concurrency(uint8_t concurrency)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_commission_set_concurrency(concurrency);
+    esp_zb_lock_release();
+    return err;
+}
+
+/*--------------------------------------------------------------
+ * zigbee_fanout_slot()
+ *------------------------------------------------------------*/
+
+esp_err_t zigbee_fanout_slot(uint16_t slot_ms)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    esp_err_t err = zb_fanout_set_slot(slot_ms);
+    esp_zb_lock_release();
+    return err;
+}
+
+/*--------------------------------------------------------------
+ * zigbee_link_tuning()
+ *------------------------------------------------------------*/
+
+void zigbee_link_tuning(bool enabled)
+{
+    esp_zb_lock_acquire(portMAX_DELAY);
+    zb_link_tuning_set_enabled(enabled);
+    esp_zb_lock_release();
+}
+
+/*--------------------------------------------------------------
+ * zigbee_time_set()
+ *------------------------------------------------------------*/
+
+esp_err_t zigbee_time_set(uint32_t unix_s)
 {
-    /* "Command request". */
-    esp_zb_zcl_on_off_cmd_t cmd_req;
-    /* The "endpoint" of the switch device. */
-    cmd_req.zcl_basic_cmd.src_endpoint = HA_ONOFF_SWITCH_ENDPOINT;
-    /* Something about an address. */
-    cmd_req.address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT;
-    /* Thing that says to toggle the light, in contrast to doing
-     * something else. */
-    cmd_req.on_off_cmd_id = ESP_ZB_ZCL_CMD_ON_OFF_TOGGLE_ID;
-    /* Try to "acquire a lock" for a long time. */
     esp_zb_lock_acquire(portMAX_DELAY);
-    /* Send the on/off command. */
-    esp_zb_zcl_on_off_cmd_req(&cmd_req);
-    /* Release the "lock". */
+    esp_err_t err = zb_time_sync_set_utc(unix_s);
     esp_zb_lock_release();
-    /* Say we did it. Yay! */
-    ESP_EARLY_LOGI(TAG, "Send on/off toggle command.");
+    return err;
 }
 
 /*--------------------------------------------------------------
@@ -120,14 +2042,7 @@ static void zb_buttons_handler(switch_func_pair_t *button_func_pair)
     if (button_func_pair->func == SWITCH_ONOFF_TOGGLE_CONTROL)
     {
         /* Implemented light switch toggle functionality. */
-        esp_zb_zcl_on_off_cmd_t cmd_req;
-        cmd_req.zcl_basic_cmd.src_endpoint = HA_ONOFF_SWITCH_ENDPOINT;
-        cmd_req.address_mode = ESP_ZB_APS_ADDR_MODE_DST_ADDR_ENDP_NOT_PRESENT;
-        cmd_req.on_off_cmd_id = ESP_ZB_ZCL_CMD_ON_OFF_TOGGLE_ID;
-        esp_zb_lock_acquire(portMAX_DELAY);
-        esp_zb_zcl_on_off_cmd_req(&cmd_req);
-        esp_zb_lock_release();
-        ESP_EARLY_LOGI(TAG, "Send 'on_off toggle' command");
+        follower_toggle_led();
     }
 }
 
@@ -153,46 +2068,41 @@ static void bdb_start_top_level_commissioning_cb(uint8_t mode_mask)
 }
 
 /*--------------------------------------------------------------
- * bind_cb()
+ * follower_found_cb()
  *------------------------------------------------------------*/
 
-static void bind_cb(esp_zb_zdp_status_t zdo_status, void *user_ctx)
+/* A light was found, see zb_commission.h. */
+static void follower_found_cb(uint16_t id)
 {
-    if (zdo_status == ESP_ZB_ZDP_STATUS_SUCCESS)
+    /* Put the light back in the groups it was in, and in the group
+     * of all followers. */
+    follower_t light;
+    ESP_RETURN_ON_FALSE(follower_registry_get(id, &light) == ESP_OK, , TAG, "Follower %u is gone", id);
+    uint8_t groups = light.groups | (1 << FOLLOWER_GROUP_ALL);
+    for (uint8_t group = 0; group < FOLLOWER_GROUPS_COUNT; group++)
     {
-        ESP_LOGI(TAG, "Bound successfully!");
-        if (user_ctx)
+        if (groups & (1 << group))
         {
-            light_bulb_device_params_t *light = (light_bulb_device_params_t *)user_ctx;
-            ESP_LOGI(TAG, "The light originating from address(0x%x) on endpoint(%d)", light->short_addr, light->endpoint);
-            free(light);
+            follower_group_request(id, group, true);
         }
     }
 }
 
 /*--------------------------------------------------------------
- * user_find_cb()
+ * follower_reporting_cb()
  *------------------------------------------------------------*/
 
-static void user_find_cb(esp_zb_zdp_status_t zdo_status, uint16_t addr, uint8_t endpoint, void *user_ctx)
+/* The light bound a cluster back to us, which its attribute reports
+ * follow, see zb_commission.h. */
+static void follower_reporting_cb(uint16_t id, uint8_t cluster)
 {
-    if (zdo_status == ESP_ZB_ZDP_STATUS_SUCCESS)
+    if (cluster == FOLLOWER_CLUSTER_ON_OFF)
+    {
+        follower_report_request(id, ESP_ZB_ZCL_CLUSTER_ID_ON_OFF, ESP_ZB_ZCL_ATTR_ON_OFF_ON_OFF_ID, ESP_ZB_ZCL_ATTR_TYPE_BOOL);
+    }
+    else
     {
-        ESP_LOGI(TAG, "Found light");
-        esp_zb_zdo_bind_req_param_t bind_req;
-        light_bulb_device_params_t *light = (light_bulb_device_params_t *)malloc(sizeof(light_bulb_device_params_t));
-        light->endpoint = endpoint;
-        light->short_addr = addr;
-        esp_zb_ieee_address_by_short(light->short_addr, light->ieee_addr);
-        esp_zb_get_long_address(bind_req.src_address);
-        bind_req.src_endp = HA_ONOFF_SWITCH_ENDPOINT;
-        bind_req.cluster_id = ESP_ZB_ZCL_CLUSTER_ID_ON_OFF;
-        bind_req.dst_addr_mode = ESP_ZB_ZDO_BIND_DST_ADDR_MODE_64_BIT_EXTENDED;
-        memcpy(bind_req.dst_address_u.addr_long, light->ieee_addr, sizeof(esp_zb_ieee_addr_t));
-        bind_req.dst_endp = endpoint;
-        bind_req.req_dst_addr = esp_zb_get_short_address();
-        ESP_LOGI(TAG, "Try to bind On/Off");
-        esp_zb_zdo_device_bind_req(&bind_req, bind_cb, (void *)light);
+        follower_report_request(id, LED_EFFECTS_CLUSTER_ID, LED_EFFECTS_ATTR_TYPE_ID, ESP_ZB_ZCL_ATTR_TYPE_U8);
     }
 }
 
@@ -206,6 +2116,7 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     esp_err_t err_status = signal_struct->esp_err_status;
     esp_zb_app_signal_type_t sig_type = *p_sg_p;
     esp_zb_zdo_signal_device_annce_params_t *dev_annce_params = NULL;
+    esp_zb_zdo_signal_leave_indication_params_t *leave_params = NULL;
     switch (sig_type)
     {
     case ESP_ZB_ZDO_SIGNAL_SKIP_STARTUP:
@@ -217,16 +2128,26 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
         if (err_status == ESP_OK)
         {
             ESP_LOGI(TAG, "Deferred driver initialization %s", deferred_driver_init() ? "failed" : "successful");
+            esp_zb_scheduler_alarm(follower_lqi_update_cb, 0, FOLLOWER_LQI_PERIOD_MS);
+            esp_zb_scheduler_alarm(channel_rescan_cb, 0, ZB_CHANNEL_RESCAN_PERIOD_MS);
+            zb_link_tuning_start();
             ESP_LOGI(TAG, "Device started up in %s factory-reset mode", esp_zb_bdb_is_factory_new() ? "" : "non");
             if (esp_zb_bdb_is_factory_new())
             {
-                ESP_LOGI(TAG, "Start network formation");
-                esp_zb_bdb_start_top_level_commissioning(ESP_ZB_BDB_MODE_NETWORK_FORMATION);
+                /* Pick the channel first, see formation_scan_done(). */
+                ESP_LOGI(TAG, "Scan channels");
+                if (zb_channel_scan(formation_scan_done) != ESP_OK)
+                {
+                    formation_scan_done(0);
+                }
             }
             else
             {
-                esp_zb_bdb_open_network(180);
-                ESP_LOGI(TAG, "Device rebooted");
+                /* The followers are still in the network, nobody new
+                 * can join unless asked for, see zigbee_permit_join(). */
+                ESP_LOGI(TAG, "Device rebooted, %s start with %u follower(s)", s_warm_start ? "warm" : "cold",
+                         follower_registry_count());
+                esp_zb_scheduler_alarm(follower_probe_cb, 0, 0);
             }
         }
         else
@@ -260,10 +2181,33 @@ void esp_zb_app_signal_handler(esp_zb_app_signal_t *signal_struct)
     case ESP_ZB_ZDO_SIGNAL_DEVICE_ANNCE:
         dev_annce_params = (esp_zb_zdo_signal_device_annce_params_t *)esp_zb_app_signal_get_params(p_sg_p);
         ESP_LOGI(TAG, "New device commissioned or rejoined (short: 0x%04hx)", dev_annce_params->device_short_addr);
-        esp_zb_zdo_match_desc_req_param_t cmd_req;
-        cmd_req.dst_nwk_addr = dev_annce_params->device_short_addr;
-        cmd_req.addr_of_interest = dev_annce_params->device_short_addr;
-        esp_zb_zdo_find_on_off_light(&cmd_req, user_find_cb, NULL);
+        uint16_t id = FOLLOWER_ID_INVALID;
+        follower_t follower;
+        follower_registry_add(dev_annce_params->ieee_addr, dev_annce_params->device_short_addr, &id);
+        if (follower_registry_get(id, &follower) == ESP_OK && follower_is_set_up(&follower))
+        {
+            /* Only the short address may have changed, which the
+             * registry has already taken. */
+            ESP_LOGI(TAG, "Follower %u is already set up, skip finding and binding it", id);
+            follower_probe(id);
+            break;
+        }
+        /* Found and bound in turn with the others that just joined,
+         * see zb_commission.h. */
+        zb_commission_enqueue(dev_annce_params->ieee_addr, dev_annce_params->device_short_addr);
+        break;
+    case ESP_ZB_ZDO_SIGNAL_LEAVE_INDICATION:
+        leave_params = (esp_zb_zdo_signal_leave_indication_params_t *)esp_zb_app_signal_get_params(p_sg_p);
+        ESP_LOGI(TAG, "Device left (short: 0x%04hx, rejoin: %d)", leave_params->short_addr, leave_params->rejoin);
+        /* A device that rejoins keeps its ID. */
+        if (!leave_params->rejoin)
+        {
+            uint16_t id = follower_registry_find_by_ieee(leave_params->device_addr);
+            if (id != FOLLOWER_ID_INVALID)
+            {
+                follower_registry_remove(id);
+            }
+        }
         break;
     case ESP_ZB_NWK_SIGNAL_PERMIT_JOIN_STATUS:
         if (err_status == ESP_OK)
@@ -293,7 +2237,7 @@ static void esp_zb_task(void *pvParameters)
 {
     /* Initialize Zigbee stack. */
     esp_zb_cfg_t zb_nwk_cfg = ESP_ZB_ZC_CONFIG();
-    esp_zb_init(&zb_nwk_cfg);
+    zb_resources_stack_init(&zb_nwk_cfg);
     esp_zb_on_off_switch_cfg_t switch_cfg = ESP_ZB_DEFAULT_ON_OFF_SWITCH_CONFIG();
     esp_zb_ep_list_t *esp_zb_on_off_switch_ep = esp_zb_on_off_switch_ep_create(HA_ONOFF_SWITCH_ENDPOINT, &switch_cfg);
     zcl_basic_manufacturer_info_t info = {
@@ -302,7 +2246,35 @@ static void esp_zb_task(void *pvParameters)
     };
 
     esp_zcl_utility_add_ep_basic_manufacturer_info(esp_zb_on_off_switch_ep, HA_ONOFF_SWITCH_ENDPOINT, &info);
+    /* The leader is the client of the followers' LED effects cluster. */
+    esp_zb_attribute_list_t *effects_cluster = esp_zb_zcl_attr_list_create(LED_EFFECTS_CLUSTER_ID);
+    esp_zb_cluster_list_add_custom_cluster(esp_zb_ep_list_get_ep(esp_zb_on_off_switch_ep, HA_ONOFF_SWITCH_ENDPOINT), effects_cluster,
+                                           ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
+    /* And of their groups cluster, to manage group membership. */
+    esp_zb_attribute_list_t *groups_cluster = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_GROUPS);
+    esp_zb_cluster_list_add_groups_cluster(esp_zb_ep_list_get_ep(esp_zb_on_off_switch_ep, HA_ONOFF_SWITCH_ENDPOINT), groups_cluster,
+                                           ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
+    /* And of their scenes cluster, to store and recall scenes. */
+    esp_zb_attribute_list_t *scenes_cluster = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_SCENES);
+    esp_zb_cluster_list_add_scenes_cluster(esp_zb_ep_list_get_ep(esp_zb_on_off_switch_ep, HA_ONOFF_SWITCH_ENDPOINT), scenes_cluster,
+                                           ESP_ZB_ZCL_CLUSTER_CLIENT_ROLE);
+    /* And the server of their OTA upgrade cluster, see zb_ota_server.h. */
+    esp_zb_zcl_ota_upgrade_server_variable_t ota_server_variable = {
+        .query_jitter = ZB_OTA_QUERY_JITTER,
+        .current_time = 0,
+        .file_count = ZB_OTA_FILE_COUNT,
+    };
+    esp_zb_attribute_list_t *ota_cluster = esp_zb_zcl_attr_list_create(ESP_ZB_ZCL_CLUSTER_ID_OTA_UPGRADE);
+    esp_zb_ota_cluster_add_attr(ota_cluster, ESP_ZB_ZCL_ATTR_OTA_UPGRADE_SERVER_DATA_ID, &ota_server_variable);
+    esp_zb_cluster_list_add_ota_cluster(esp_zb_ep_list_get_ep(esp_zb_on_off_switch_ep, HA_ONOFF_SWITCH_ENDPOINT), ota_cluster,
+                                        ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+    /* And the network's time master, see zb_time_sync.h. */
+    ESP_ERROR_CHECK(zb_time_sync_add_time_cluster(esp_zb_on_off_switch_ep, HA_ONOFF_SWITCH_ENDPOINT));
+    ESP_ERROR_CHECK(zb_commission_init(HA_ONOFF_SWITCH_ENDPOINT, LED_EFFECTS_CLUSTER_ID, follower_found_cb, follower_reporting_cb));
     esp_zb_device_register(esp_zb_on_off_switch_ep);
+    esp_zb_core_action_handler_register(zb_action_handler);
+    esp_zb_zcl_command_send_status_handler_register(zb_command_send_status_cb);
+    esp_zb_aps_data_indication_handler_register(zb_aps_data_indication_handler);
     esp_zb_set_primary_network_channel_set(ESP_ZB_PRIMARY_CHANNEL_MASK);
     ESP_ERROR_CHECK(esp_zb_start(false));
     esp_zb_stack_main_loop();
@@ -319,7 +2291,15 @@ void zigbee_configure(void)
         .host_config = ESP_ZB_DEFAULT_HOST_CONFIG(),
     };
     ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(zb_resources_init());
+    ESP_ERROR_CHECK(follower_registry_load());
+    /* Not fatal, tried again on the next boot. */
+    follower_groups_migrate();
+    s_warm_start = follower_registry_count() > 0;
+    ESP_ERROR_CHECK(follower_scenes_init());
     ESP_ERROR_CHECK(esp_zb_platform_config(&config));
+    ESP_ERROR_CHECK(zb_delivery_init(zb_delivery_finished_cb));
+    ESP_ERROR_CHECK(zb_command_queue_init(zb_command_send));
 
     xTaskCreate(esp_zb_task, "esp_zb_task", 4096, NULL, configMAX_PRIORITIES - 3, NULL);
 }
@@ -0,0 +1,132 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Zigbee groups of followers. See follower_groups.h.
+ *
+ * Notes:
+ *     - Older firmware saved the memberships in an NVS blob of their
+ *       own, (IEEE address, groups) records, next to the registry's.
+ *       With two copies a restore could read one and miss the other,
+ *       so the registry is now the only one and the old blob is read
+ *       once, at boot, and erased. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "follower_groups.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+/* A record of the old blob. */
+typedef struct
+{
+    esp_zb_ieee_addr_t ieee_addr;
+    uint8_t groups;
+} saved_groups_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "FOLLOWER_GROUPS";
+static const char *NVS_NAMESPACE = "followers";
+static const char *NVS_KEY = "groups";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* Too big for the stack of the task that boots. */
+static saved_groups_t s_saved[FOLLOWER_REGISTRY_CAPACITY];
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * erase_saved()
+ *------------------------------------------------------------*/
+
+static esp_err_t erase_saved(void)
+{
+    nvs_handle_t handle;
+    ESP_RETURN_ON_ERROR(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle), TAG, "Failed to open NVS");
+    esp_err_t err = nvs_erase_key(handle, NVS_KEY);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to erase the old groups");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_groups_migrate()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_groups_migrate(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        /* Nothing saved yet. */
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to open NVS");
+
+    size_t size = sizeof(s_saved);
+    err = nvs_get_blob(handle, NVS_KEY, s_saved, &size);
+    nvs_close(handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        /* Migrated already, or never saved. */
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to load the old groups");
+
+    /* Followers the registry no longer has are dropped, as removing a
+     * follower drops its groups now. */
+    uint16_t count = (uint16_t)(size / sizeof(saved_groups_t));
+    uint16_t moved = 0;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint16_t id = follower_registry_find_by_ieee(s_saved[i].ieee_addr);
+        if (id == FOLLOWER_ID_INVALID)
+        {
+            continue;
+        }
+        for (uint8_t group = 0; group < FOLLOWER_GROUPS_COUNT; group++)
+        {
+            if (s_saved[i].groups & (1 << group))
+            {
+                follower_registry_set_group(id, group, true);
+            }
+        }
+        moved++;
+    }
+    /* The old blob goes only once the registry holds its groups. */
+    ESP_RETURN_ON_ERROR(follower_registry_save(), TAG, "Failed to save the migrated groups");
+    ESP_RETURN_ON_ERROR(erase_saved(), TAG, "Failed to finish migrating groups");
+    ESP_LOGI(TAG, "Moved the groups of %u of %u follower(s) into the registry", moved, count);
+    return ESP_OK;
+}
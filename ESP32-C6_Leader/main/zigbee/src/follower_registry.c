@@ -0,0 +1,903 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The leader's table of followers. See
+ * follower_registry.h.
+ *
+ * Notes:
+ *     - Followers live in a fixed array. A follower's ID is its index,
+ *       and free IDs are kept on a stack, so adding and removing never
+ *       scan the array.
+ *     - Two open-addressing hash indexes (linear probing, twice as
+ *       many slots as followers) map short and IEEE addresses to IDs.
+ *       A slot holds ID + 1, so a zeroed slot is empty.
+ *     - Removed keys leave a tombstone so later keys in the same probe
+ *       run are still found. When tombstones pile up (short addresses
+ *       change on every rejoin), the index is rebuilt.
+ *     - The saved table is one NVS blob, group memberships included.
+ *       Changes only mark it dirty and follower_registry_save() writes
+ *       it later, so commissioning a batch of followers costs one
+ *       flash write instead of several per follower.
+ *     - The blob starts with a version. A blob of another version is
+ *       dropped rather than misread, and its followers are found and
+ *       bound again. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <stddef.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "follower_registry.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define INDEX_BITS 9
+#define INDEX_SIZE (1 << INDEX_BITS)
+#define INDEX_EMPTY 0
+#define INDEX_DELETED 0xFFFF
+
+/* Rebuild an index once this many of its slots are tombstones. */
+#define INDEX_MAX_DELETED (INDEX_SIZE / 4)
+
+_Static_assert(INDEX_SIZE >= 2 * FOLLOWER_REGISTRY_CAPACITY, "Index must stay at most half full");
+
+/* Bump whenever saved_follower_t changes. */
+#define SAVED_VERSION 1
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    uint16_t slots[INDEX_SIZE];
+    uint16_t deleted;
+} index_t;
+
+/* What survives a reboot of one follower. */
+typedef struct
+{
+    esp_zb_ieee_addr_t ieee_addr;
+    uint16_t short_addr;
+    uint16_t id;
+    uint8_t endpoint;
+    uint8_t clusters;
+    uint8_t bound;
+    uint8_t reporting;
+    uint8_t groups;
+} saved_follower_t;
+
+/* The saved blob, only the first `count` followers are written. */
+typedef struct
+{
+    uint8_t version;
+    /* sizeof(saved_follower_t), so a layout change is caught even if
+     * the version was not bumped. */
+    uint8_t follower_size;
+    uint16_t count;
+    saved_follower_t followers[FOLLOWER_REGISTRY_CAPACITY];
+} saved_registry_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "FOLLOWER_REGISTRY";
+/* Shares the namespace with the saved scenes. */
+static const char *NVS_NAMESPACE = "followers";
+static const char *NVS_KEY = "registry";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* Guards everything below it. Written by the Zigbee task, read by
+ * the UART task. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static follower_t s_followers[FOLLOWER_REGISTRY_CAPACITY];
+static bool s_in_use[FOLLOWER_REGISTRY_CAPACITY];
+static uint16_t s_free_ids[FOLLOWER_REGISTRY_CAPACITY];
+static uint16_t s_free_count;
+static bool s_initialized = false;
+static uint16_t s_count;
+static index_t s_short_index;
+static index_t s_ieee_index;
+/* Something saved changed since the last save. */
+static bool s_dirty = false;
+/* Saving stops until the next boot, see follower_registry_erase_saved(). */
+static bool s_save_disabled = false;
+
+/* Only touched by the Zigbee task, when loading and saving. */
+static saved_registry_t s_saved;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*==============================================================
+ * Hashing.
+ *============================================================*/
+
+/*--------------------------------------------------------------
+ * hash_short()
+ *------------------------------------------------------------*/
+
+/* Fibonacci hashing. Short addresses are random, but this also
+ * spreads out any that are close together. */
+static inline uint32_t hash_short(uint16_t short_addr)
+{
+    return ((uint32_t)short_addr * 2654435769u) >> (32 - INDEX_BITS);
+}
+
+/*--------------------------------------------------------------
+ * hash_ieee()
+ *------------------------------------------------------------*/
+
+/* FNV-1a over the 8 bytes, then Fibonacci hashing. IEEE addresses
+ * from one vendor share their top bytes, so every byte must count. */
+static inline uint32_t hash_ieee(const esp_zb_ieee_addr_t ieee_addr)
+{
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(esp_zb_ieee_addr_t); i++)
+    {
+        hash = (hash ^ ieee_addr[i]) * 16777619u;
+    }
+    return (hash * 2654435769u) >> (32 - INDEX_BITS);
+}
+
+/*==============================================================
+ * Indexes. All of these expect `s_lock` to be held.
+ *============================================================*/
+
+/*--------------------------------------------------------------
+ * key_matches()
+ *------------------------------------------------------------*/
+
+static inline bool key_matches(const index_t *index, uint16_t id, uint16_t short_addr, const uint8_t *ieee_addr)
+{
+    if (index == &s_short_index)
+    {
+        return s_followers[id].short_addr == short_addr;
+    }
+    return memcmp(s_followers[id].ieee_addr, ieee_addr, sizeof(esp_zb_ieee_addr_t)) == 0;
+}
+
+/*--------------------------------------------------------------
+ * index_find()
+ *------------------------------------------------------------*/
+
+/* Return the slot holding the key, or -1. */
+static int index_find(const index_t *index, uint32_t hash, uint16_t short_addr, const uint8_t *ieee_addr)
+{
+    for (uint32_t probe = 0; probe < INDEX_SIZE; probe++)
+    {
+        uint32_t slot = (hash + probe) & (INDEX_SIZE - 1);
+        uint16_t value = index->slots[slot];
+        if (value == INDEX_EMPTY)
+        {
+            return -1;
+        }
+        if (value != INDEX_DELETED && key_matches(index, value - 1, short_addr, ieee_addr))
+        {
+            return (int)slot;
+        }
+    }
+    return -1;
+}
+
+/*--------------------------------------------------------------
+ * index_insert()
+ *------------------------------------------------------------*/
+
+/* Put an ID into the first empty or deleted slot of its probe run.
+ * The index is never more than half full, so there always is one. */
+static void index_insert(index_t *index, uint32_t hash, uint16_t id)
+{
+    for (uint32_t probe = 0; probe < INDEX_SIZE; probe++)
+    {
+        uint32_t slot = (hash + probe) & (INDEX_SIZE - 1);
+        uint16_t value = index->slots[slot];
+        if (value == INDEX_EMPTY || value == INDEX_DELETED)
+        {
+            if (value == INDEX_DELETED)
+            {
+                index->deleted--;
+            }
+            index->slots[slot] = id + 1;
+            return;
+        }
+    }
+}
+
+/*--------------------------------------------------------------
+ * index_rebuild()
+ *------------------------------------------------------------*/
+
+static void index_rebuild(index_t *index)
+{
+    memset(index, 0, sizeof(*index));
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        if (s_in_use[id])
+        {
+            uint32_t hash = index == &s_short_index ? hash_short(s_followers[id].short_addr) : hash_ieee(s_followers[id].ieee_addr);
+            index_insert(index, hash, id);
+        }
+    }
+}
+
+/*--------------------------------------------------------------
+ * index_remove()
+ *------------------------------------------------------------*/
+
+static void index_remove(index_t *index, int slot)
+{
+    if (slot < 0)
+    {
+        return;
+    }
+    index->slots[slot] = INDEX_DELETED;
+    index->deleted++;
+}
+
+/*--------------------------------------------------------------
+ * index_compact()
+ *------------------------------------------------------------*/
+
+/* Call once the table and the index agree again. */
+static void index_compact(index_t *index)
+{
+    if (index->deleted > INDEX_MAX_DELETED)
+    {
+        index_rebuild(index);
+    }
+}
+
+/*--------------------------------------------------------------
+ * find_by_short_locked()
+ *------------------------------------------------------------*/
+
+static uint16_t find_by_short_locked(uint16_t short_addr)
+{
+    int slot = index_find(&s_short_index, hash_short(short_addr), short_addr, NULL);
+    return slot < 0 ? FOLLOWER_ID_INVALID : s_short_index.slots[slot] - 1;
+}
+
+/*--------------------------------------------------------------
+ * find_by_ieee_locked()
+ *------------------------------------------------------------*/
+
+static uint16_t find_by_ieee_locked(const esp_zb_ieee_addr_t ieee_addr)
+{
+    int slot = index_find(&s_ieee_index, hash_ieee(ieee_addr), 0, ieee_addr);
+    return slot < 0 ? FOLLOWER_ID_INVALID : s_ieee_index.slots[slot] - 1;
+}
+
+/*--------------------------------------------------------------
+ * init_locked()
+ *------------------------------------------------------------*/
+
+static void init_locked(void)
+{
+    if (s_initialized)
+    {
+        return;
+    }
+    /* Pushed in reverse, so IDs are handed out from 0 up. */
+    for (uint16_t i = 0; i < FOLLOWER_REGISTRY_CAPACITY; i++)
+    {
+        s_free_ids[i] = FOLLOWER_REGISTRY_CAPACITY - 1 - i;
+    }
+    s_free_count = FOLLOWER_REGISTRY_CAPACITY;
+    s_initialized = true;
+}
+
+/*--------------------------------------------------------------
+ * now_s()
+ *------------------------------------------------------------*/
+
+static inline uint32_t now_s(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+/*==============================================================
+ * Public.
+ *============================================================*/
+
+/*--------------------------------------------------------------
+ * follower_registry_add()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_add(const esp_zb_ieee_addr_t ieee_addr, uint16_t short_addr, uint16_t *ret_id)
+{
+    esp_err_t ret = ESP_OK;
+    uint16_t id = FOLLOWER_ID_INVALID;
+    taskENTER_CRITICAL(&s_lock);
+    init_locked();
+    id = find_by_ieee_locked(ieee_addr);
+    if (id != FOLLOWER_ID_INVALID)
+    {
+        /* Known follower. Rejoining may have given it a new short
+         * address. */
+        follower_t *follower = &s_followers[id];
+        if (follower->short_addr != short_addr)
+        {
+            index_remove(&s_short_index, index_find(&s_short_index, hash_short(follower->short_addr), follower->short_addr, NULL));
+            follower->short_addr = short_addr;
+            index_insert(&s_short_index, hash_short(short_addr), id);
+            index_compact(&s_short_index);
+            s_dirty = true;
+        }
+        follower->last_seen_s = now_s();
+    }
+    else if (s_free_count == 0)
+    {
+        ret = ESP_ERR_NO_MEM;
+    }
+    else
+    {
+        id = s_free_ids[--s_free_count];
+        follower_t *follower = &s_followers[id];
+        memset(follower, 0, sizeof(*follower));
+        memcpy(follower->ieee_addr, ieee_addr, sizeof(esp_zb_ieee_addr_t));
+        follower->short_addr = short_addr;
+        follower->id = id;
+        follower->on_off = FOLLOWER_ATTR_UNKNOWN;
+        follower->effect_type = FOLLOWER_ATTR_UNKNOWN;
+        follower->on_off_pending = FOLLOWER_ATTR_UNKNOWN;
+        follower->last_seen_s = now_s();
+        s_in_use[id] = true;
+        s_count++;
+        index_insert(&s_short_index, hash_short(short_addr), id);
+        index_insert(&s_ieee_index, hash_ieee(ieee_addr), id);
+        s_dirty = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    ESP_RETURN_ON_FALSE(ret == ESP_OK, ret, TAG, "Registry full, follower 0x%04hx not added", short_addr);
+    if (ret_id)
+    {
+        *ret_id = id;
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_remove()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_remove(uint16_t id)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_OK;
+    taskENTER_CRITICAL(&s_lock);
+    if (!s_in_use[id])
+    {
+        ret = ESP_ERR_NOT_FOUND;
+    }
+    else
+    {
+        follower_t *follower = &s_followers[id];
+        index_remove(&s_short_index, index_find(&s_short_index, hash_short(follower->short_addr), follower->short_addr, NULL));
+        index_remove(&s_ieee_index, index_find(&s_ieee_index, hash_ieee(follower->ieee_addr), 0, follower->ieee_addr));
+        s_in_use[id] = false;
+        s_free_ids[s_free_count++] = id;
+        s_count--;
+        index_compact(&s_short_index);
+        index_compact(&s_ieee_index);
+        s_dirty = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_find_by_short()
+ *------------------------------------------------------------*/
+
+uint16_t follower_registry_find_by_short(uint16_t short_addr)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint16_t id = find_by_short_locked(short_addr);
+    taskEXIT_CRITICAL(&s_lock);
+    return id;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_find_by_ieee()
+ *------------------------------------------------------------*/
+
+uint16_t follower_registry_find_by_ieee(const esp_zb_ieee_addr_t ieee_addr)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint16_t id = find_by_ieee_locked(ieee_addr);
+    taskEXIT_CRITICAL(&s_lock);
+    return id;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_get()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_get(uint16_t id, follower_t *follower)
+{
+    ESP_RETURN_ON_FALSE(follower, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    if (id >= FOLLOWER_REGISTRY_CAPACITY)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        *follower = s_followers[id];
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_count()
+ *------------------------------------------------------------*/
+
+uint16_t follower_registry_count(void)
+{
+    return s_count;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_set_endpoint()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_set_endpoint(uint16_t id, uint8_t endpoint, uint8_t clusters)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        s_followers[id].endpoint = endpoint;
+        s_followers[id].clusters |= clusters;
+        s_dirty = true;
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_set_bound()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_set_bound(uint16_t id, uint8_t cluster)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        s_followers[id].bound |= cluster;
+        s_dirty = true;
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_set_reporting()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_set_reporting(uint16_t id, uint8_t cluster)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        s_followers[id].reporting |= cluster;
+        s_dirty = true;
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_set_group()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_set_group(uint16_t id, uint8_t group, bool member)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    ESP_RETURN_ON_FALSE(group < FOLLOWER_GROUPS_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid group");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        if (member)
+        {
+            s_followers[id].groups |= (uint8_t)(1 << group);
+        }
+        else
+        {
+            s_followers[id].groups &= (uint8_t)~(1 << group);
+        }
+        s_dirty = true;
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_set_on_off()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_set_on_off(uint16_t id, bool on_off)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        s_followers[id].on_off = on_off;
+        if (s_followers[id].on_off_pending == on_off)
+        {
+            s_followers[id].on_off_pending = FOLLOWER_ATTR_UNKNOWN;
+        }
+        s_followers[id].last_seen_s = now_s();
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_set_on_off_pending()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_set_on_off_pending(uint16_t id, bool on_off)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        s_followers[id].on_off_pending = on_off;
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_drop_on_off_pending()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_drop_on_off_pending(uint16_t id, bool on_off)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        if (s_followers[id].on_off_pending == on_off)
+        {
+            s_followers[id].on_off_pending = FOLLOWER_ATTR_UNKNOWN;
+        }
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_set_effect_type()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_set_effect_type(uint16_t id, uint8_t effect_type)
+{
+    ESP_RETURN_ON_FALSE(id < FOLLOWER_REGISTRY_CAPACITY, ESP_ERR_INVALID_ARG, TAG, "Invalid follower ID");
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_in_use[id])
+    {
+        s_followers[id].effect_type = effect_type;
+        s_followers[id].last_seen_s = now_s();
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_touch()
+ *------------------------------------------------------------*/
+
+void follower_registry_touch(uint16_t short_addr)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint16_t id = find_by_short_locked(short_addr);
+    if (id != FOLLOWER_ID_INVALID)
+    {
+        s_followers[id].last_seen_s = now_s();
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_count_retry()
+ *------------------------------------------------------------*/
+
+void follower_registry_count_retry(uint16_t short_addr)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint16_t id = find_by_short_locked(short_addr);
+    if (id != FOLLOWER_ID_INVALID && s_followers[id].retries < UINT16_MAX)
+    {
+        s_followers[id].retries++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_update_lqi()
+ *------------------------------------------------------------*/
+
+void follower_registry_update_lqi(void)
+{
+    /* Followers that dropped out of the neighbour table read 0. */
+    taskENTER_CRITICAL(&s_lock);
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        s_followers[id].lqi = 0;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    esp_zb_nwk_info_iterator_t iterator = ESP_ZB_NWK_INFO_ITERATOR_INIT;
+    esp_zb_nwk_neighbor_info_t neighbor;
+    while (esp_zb_nwk_get_next_neighbor(&iterator, &neighbor) == ESP_OK)
+    {
+        taskENTER_CRITICAL(&s_lock);
+        uint16_t id = find_by_short_locked(neighbor.short_addr);
+        if (id != FOLLOWER_ID_INVALID)
+        {
+            s_followers[id].lqi = neighbor.lqi;
+        }
+        taskEXIT_CRITICAL(&s_lock);
+    }
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_load()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_load(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        /* Nothing saved yet. */
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to open NVS");
+
+    size_t size = sizeof(s_saved);
+    err = nvs_get_blob(handle, NVS_KEY, &s_saved, &size);
+    nvs_close(handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ESP_OK;
+    }
+    if (err == ESP_ERR_NVS_INVALID_LENGTH)
+    {
+        /* Bigger than any blob this version writes. */
+        size = 0;
+    }
+    else
+    {
+        ESP_RETURN_ON_ERROR(err, TAG, "Failed to load followers");
+    }
+    uint16_t count = s_saved.count;
+    if (size < offsetof(saved_registry_t, followers) ||
+        s_saved.version != SAVED_VERSION ||
+        s_saved.follower_size != sizeof(saved_follower_t) ||
+        count > FOLLOWER_REGISTRY_CAPACITY ||
+        size != offsetof(saved_registry_t, followers) + count * sizeof(saved_follower_t))
+    {
+        ESP_LOGW(TAG, "Saved followers are from another version, they are found again instead");
+        return ESP_OK;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    for (uint16_t i = 0; i < count; i++)
+    {
+        const saved_follower_t *saved = &s_saved.followers[i];
+        if (saved->id >= FOLLOWER_REGISTRY_CAPACITY || s_in_use[saved->id])
+        {
+            continue;
+        }
+        follower_t *follower = &s_followers[saved->id];
+        memset(follower, 0, sizeof(*follower));
+        memcpy(follower->ieee_addr, saved->ieee_addr, sizeof(esp_zb_ieee_addr_t));
+        follower->short_addr = saved->short_addr;
+        follower->id = saved->id;
+        follower->endpoint = saved->endpoint;
+        follower->clusters = saved->clusters;
+        follower->bound = saved->bound;
+        follower->reporting = saved->reporting;
+        follower->groups = saved->groups;
+        follower->on_off = FOLLOWER_ATTR_UNKNOWN;
+        follower->effect_type = FOLLOWER_ATTR_UNKNOWN;
+        follower->on_off_pending = FOLLOWER_ATTR_UNKNOWN;
+        s_in_use[saved->id] = true;
+        s_count++;
+    }
+    /* Free IDs from 0 up, as in init_locked(), minus the restored
+     * ones. */
+    s_free_count = 0;
+    for (uint16_t i = 0; i < FOLLOWER_REGISTRY_CAPACITY; i++)
+    {
+        uint16_t id = FOLLOWER_REGISTRY_CAPACITY - 1 - i;
+        if (!s_in_use[id])
+        {
+            s_free_ids[s_free_count++] = id;
+        }
+    }
+    s_initialized = true;
+    index_rebuild(&s_short_index);
+    index_rebuild(&s_ieee_index);
+    uint16_t loaded = s_count;
+    taskEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Loaded %u follower(s)", loaded);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_save()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_save(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    bool dirty = s_dirty && !s_save_disabled;
+    if (dirty)
+    {
+        /* A change made while saving marks it dirty again, for the
+         * next save. */
+        s_dirty = false;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (!dirty)
+    {
+        return ESP_OK;
+    }
+
+    /* One follower at a time under the lock, so the UART task is
+     * never held up for the whole table. */
+    uint16_t count = 0;
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        taskENTER_CRITICAL(&s_lock);
+        bool in_use = s_in_use[id];
+        if (in_use)
+        {
+            follower = s_followers[id];
+        }
+        taskEXIT_CRITICAL(&s_lock);
+        if (!in_use)
+        {
+            continue;
+        }
+        saved_follower_t *saved = &s_saved.followers[count++];
+        memcpy(saved->ieee_addr, follower.ieee_addr, sizeof(esp_zb_ieee_addr_t));
+        saved->short_addr = follower.short_addr;
+        saved->id = id;
+        saved->endpoint = follower.endpoint;
+        saved->clusters = follower.clusters;
+        saved->bound = follower.bound;
+        saved->reporting = follower.reporting;
+        saved->groups = follower.groups;
+    }
+    s_saved.version = SAVED_VERSION;
+    s_saved.follower_size = sizeof(saved_follower_t);
+    s_saved.count = count;
+
+    /* Flash is written outside the critical section too. */
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err == ESP_OK)
+    {
+        if (count == 0)
+        {
+            err = nvs_erase_key(handle, NVS_KEY);
+            if (err == ESP_ERR_NVS_NOT_FOUND)
+            {
+                err = ESP_OK;
+            }
+        }
+        else
+        {
+            err = nvs_set_blob(handle, NVS_KEY, &s_saved, offsetof(saved_registry_t, followers) + count * sizeof(saved_follower_t));
+        }
+        if (err == ESP_OK)
+        {
+            err = nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+    if (err != ESP_OK)
+    {
+        /* Try again next time. */
+        taskENTER_CRITICAL(&s_lock);
+        s_dirty = true;
+        taskEXIT_CRITICAL(&s_lock);
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to save followers");
+    ESP_LOGI(TAG, "Saved %u follower(s)", count);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_registry_erase_saved()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_registry_erase_saved(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_save_disabled = true;
+    taskEXIT_CRITICAL(&s_lock);
+
+    nvs_handle_t handle;
+    ESP_RETURN_ON_ERROR(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle), TAG, "Failed to open NVS");
+    esp_err_t err = nvs_erase_key(handle, NVS_KEY);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        err = ESP_OK;
+    }
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to erase saved followers");
+    ESP_LOGI(TAG, "Erased the saved followers, they are found again after the next boot");
+    return ESP_OK;
+}
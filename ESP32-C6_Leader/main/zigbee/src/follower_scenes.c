@@ -0,0 +1,284 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The scenes the leader has stored on its followers.
+ * See follower_scenes.h.
+ *
+ * Notes:
+ *     - The UART task stores and recalls, the Zigbee task confirms,
+ *       so the list has a lock. NVS is written outside it, from a
+ *       copy.
+ *     - Recall counts are not saved, only which scenes exist. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "follower_scenes.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    uint8_t group;
+    uint8_t scene_id;
+} saved_scene_t;
+
+typedef struct
+{
+    bool in_use;
+    /* A follower has said it has the scene. */
+    bool confirmed;
+    saved_scene_t saved;
+    uint32_t recalls;
+    /* Seconds since boot of the last store or recall, 0 if neither
+     * since boot. */
+    uint32_t last_used_s;
+} follower_scene_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "FOLLOWER_SCENES";
+static const char *NVS_NAMESPACE = "followers";
+static const char *NVS_KEY = "scenes";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* Guards the scenes. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static follower_scene_t s_scenes[FOLLOWER_SCENES_CAPACITY];
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * find_scene()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. */
+static follower_scene_t *find_scene(uint8_t group, uint8_t scene_id)
+{
+    for (int i = 0; i < FOLLOWER_SCENES_CAPACITY; i++)
+    {
+        follower_scene_t *scene = &s_scenes[i];
+        if (scene->in_use && scene->saved.group == group && scene->saved.scene_id == scene_id)
+        {
+            return scene;
+        }
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------
+ * now_s()
+ *------------------------------------------------------------*/
+
+static uint32_t now_s(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000000);
+}
+
+/*--------------------------------------------------------------
+ * follower_scenes_init()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_scenes_init(void)
+{
+    memset(s_scenes, 0, sizeof(s_scenes));
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        /* Nothing saved yet. */
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to open NVS");
+
+    saved_scene_t saved[FOLLOWER_SCENES_CAPACITY];
+    size_t size = sizeof(saved);
+    err = nvs_get_blob(handle, NVS_KEY, saved, &size);
+    nvs_close(handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to load scenes");
+    for (size_t i = 0; i < size / sizeof(saved_scene_t); i++)
+    {
+        s_scenes[i].in_use = true;
+        s_scenes[i].confirmed = true;
+        s_scenes[i].saved = saved[i];
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * scenes_save()
+ *------------------------------------------------------------*/
+
+/* Save the confirmed scenes. */
+static esp_err_t scenes_save(void)
+{
+    saved_scene_t saved[FOLLOWER_SCENES_CAPACITY];
+    size_t count = 0;
+    taskENTER_CRITICAL(&s_lock);
+    for (int i = 0; i < FOLLOWER_SCENES_CAPACITY; i++)
+    {
+        if (s_scenes[i].in_use && s_scenes[i].confirmed)
+        {
+            saved[count++] = s_scenes[i].saved;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    nvs_handle_t handle;
+    ESP_RETURN_ON_ERROR(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle), TAG, "Failed to open NVS");
+    esp_err_t err = nvs_set_blob(handle, NVS_KEY, saved, count * sizeof(saved_scene_t));
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to save scenes");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * scene_add()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. The scene, added unconfirmed if
+ * need be, NULL if the list is full. */
+static follower_scene_t *scene_add(uint8_t group, uint8_t scene_id)
+{
+    follower_scene_t *scene = find_scene(group, scene_id);
+    for (int i = 0; scene == NULL && i < FOLLOWER_SCENES_CAPACITY; i++)
+    {
+        if (!s_scenes[i].in_use)
+        {
+            scene = &s_scenes[i];
+            *scene = (follower_scene_t){
+                .in_use = true,
+                .saved.group = group,
+                .saved.scene_id = scene_id,
+            };
+        }
+    }
+    return scene;
+}
+
+/*--------------------------------------------------------------
+ * follower_scenes_stored()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_scenes_stored(uint8_t group, uint8_t scene_id)
+{
+    /* Storing again only changes what the lights hold, a scene that
+     * was confirmed stays so. */
+    taskENTER_CRITICAL(&s_lock);
+    follower_scene_t *scene = scene_add(group, scene_id);
+    if (scene)
+    {
+        scene->last_used_s = now_s();
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_RETURN_ON_FALSE(scene, ESP_ERR_NO_MEM, TAG, "Scene list full");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_scenes_confirmed()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_scenes_confirmed(uint8_t group, uint8_t scene_id)
+{
+    taskENTER_CRITICAL(&s_lock);
+    follower_scene_t *scene = scene_add(group, scene_id);
+    bool newly = scene && !scene->confirmed;
+    if (newly)
+    {
+        scene->confirmed = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_RETURN_ON_FALSE(scene, ESP_ERR_NO_MEM, TAG, "Scene list full");
+    if (!newly)
+    {
+        return ESP_OK;
+    }
+    ESP_LOGI(TAG, "Scene %u of group %u confirmed", scene_id, group);
+    return scenes_save();
+}
+
+/*--------------------------------------------------------------
+ * follower_scenes_recalled()
+ *------------------------------------------------------------*/
+
+esp_err_t follower_scenes_recalled(uint8_t group, uint8_t scene_id)
+{
+    taskENTER_CRITICAL(&s_lock);
+    follower_scene_t *scene = find_scene(group, scene_id);
+    if (scene)
+    {
+        scene->recalls++;
+        scene->last_used_s = now_s();
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_RETURN_ON_FALSE(scene, ESP_ERR_NOT_FOUND, TAG, "Scene %u of group %u was never stored", scene_id, group);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * follower_scenes_list()
+ *------------------------------------------------------------*/
+
+void follower_scenes_list(void)
+{
+    for (int i = 0; i < FOLLOWER_SCENES_CAPACITY; i++)
+    {
+        taskENTER_CRITICAL(&s_lock);
+        follower_scene_t scene = s_scenes[i];
+        taskEXIT_CRITICAL(&s_lock);
+        if (scene.in_use)
+        {
+            ESP_LOGI(TAG, "  group %u, scene %u%s: %" PRIu32 " recall(s), last used at %" PRIu32 " s", scene.saved.group,
+                     scene.saved.scene_id, scene.confirmed ? "" : " (unconfirmed)", scene.recalls, scene.last_used_s);
+        }
+    }
+}
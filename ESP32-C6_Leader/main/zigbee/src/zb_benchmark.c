@@ -0,0 +1,216 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Send statuses of a benchmark's own commands. See
+ * zb_benchmark.h.
+ *
+ * Notes:
+ *     - Commands are tracked in a table indexed by TSN, as in
+ *       zb_stress.c. The dispatcher writes it and the Zigbee task
+ *       reads it, so it has a lock.
+ *     - The waiting task sleeps on its notification, which every
+ *       send status and finish of ours gives, instead of polling. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <stdbool.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_benchmark.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define TSN_COUNT 256
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* Guards everything below it. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_task = NULL;
+static bool s_pending[TSN_COUNT];
+static int64_t s_enqueued_us[TSN_COUNT];
+static int64_t s_submitted_us[TSN_COUNT];
+static zb_benchmark_stats_t s_stats;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_benchmark_begin()
+ *------------------------------------------------------------*/
+
+void zb_benchmark_begin(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    memset(s_pending, 0, sizeof(s_pending));
+    s_stats = (zb_benchmark_stats_t){0};
+    s_task = xTaskGetCurrentTaskHandle();
+    taskEXIT_CRITICAL(&s_lock);
+    /* Nothing given before now is ours. */
+    ulTaskNotifyTake(pdTRUE, 0);
+}
+
+/*--------------------------------------------------------------
+ * zb_benchmark_sent()
+ *------------------------------------------------------------*/
+
+void zb_benchmark_sent(const zb_command_t *command, uint8_t tsn)
+{
+    if (!command->benchmark)
+    {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    if (s_pending[tsn])
+    {
+        s_stats.statuses++;
+        s_stats.failed++;
+    }
+    s_pending[tsn] = true;
+    s_enqueued_us[tsn] = command->enqueued_us;
+    s_submitted_us[tsn] = now_us;
+    s_stats.sent++;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_benchmark_send_status()
+ *------------------------------------------------------------*/
+
+void zb_benchmark_send_status(const esp_zb_zcl_command_send_status_message_t *message)
+{
+    int64_t now_us = esp_timer_get_time();
+    TaskHandle_t task = NULL;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_pending[message->tsn])
+    {
+        s_pending[message->tsn] = false;
+        s_stats.statuses++;
+        s_stats.last_status_us = now_us;
+        if (message->status != ESP_OK)
+        {
+            s_stats.failed++;
+        }
+        else
+        {
+            s_stats.last_queued_us = (uint32_t)(s_submitted_us[message->tsn] - s_enqueued_us[message->tsn]);
+            s_stats.last_confirm_us = (uint32_t)(now_us - s_submitted_us[message->tsn]);
+        }
+        task = s_task;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (task)
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_benchmark_finished()
+ *------------------------------------------------------------*/
+
+void zb_benchmark_finished(const zb_command_t *command, bool ok, uint8_t attempts)
+{
+    if (!command->benchmark)
+    {
+        return;
+    }
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.finished++;
+    s_stats.undelivered += !ok;
+    s_stats.attempts += attempts;
+    s_stats.lost += attempts - (ok ? 1 : 0);
+    s_stats.last_finish_us = now_us;
+    TaskHandle_t task = s_task;
+    taskEXIT_CRITICAL(&s_lock);
+    if (task)
+    {
+        xTaskNotifyGive(task);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_benchmark_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_benchmark_get_stats(zb_benchmark_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * benchmark_wait()
+ *------------------------------------------------------------*/
+
+/* Wait until the count picked by `finishes` reaches `count`. */
+static esp_err_t benchmark_wait(bool finishes, uint32_t count, int64_t deadline_us, zb_benchmark_stats_t *stats)
+{
+    for (;;)
+    {
+        zb_benchmark_get_stats(stats);
+        if ((finishes ? stats->finished : stats->statuses) >= count)
+        {
+            return ESP_OK;
+        }
+        int64_t left_us = deadline_us - esp_timer_get_time();
+        if (left_us <= 0)
+        {
+            return ESP_ERR_TIMEOUT;
+        }
+        /* Rounded up, so the last wait does not end a tick early. */
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS((left_us + 999) / 1000) + 1);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_benchmark_wait()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_benchmark_wait(uint32_t statuses, int64_t deadline_us, zb_benchmark_stats_t *stats)
+{
+    return benchmark_wait(false, statuses, deadline_us, stats);
+}
+
+/*--------------------------------------------------------------
+ * zb_benchmark_wait_finished()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_benchmark_wait_finished(uint32_t finished, int64_t deadline_us, zb_benchmark_stats_t *stats)
+{
+    return benchmark_wait(true, finished, deadline_us, stats);
+}
@@ -0,0 +1,326 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Bulk transfers to one follower. See zb_bulk.h.
+ *
+ * Notes:
+ *     - Everything but zb_bulk_get_stats() runs in the Zigbee task,
+ *       or with the Zigbee lock held, so only the stats need a lock.
+ *     - Frames go without APS acknowledgements. The bulk
+ *       acknowledgement already says what arrived, for a whole
+ *       window at once, and an APS acknowledgement per fragment would
+ *       double the frames on air.
+ *     - A fragment the follower reports missing while a later one
+ *       arrived is sent again at once. Only a silent follower waits
+ *       for ZB_BULK_RETRY_MS. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_bulk.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_BULK";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static uint8_t s_buffer[ZB_BULK_MAX_SIZE];
+static bool s_running = false;
+static uint8_t s_next_transfer_id = 0;
+/* Bit n set for fragment n. */
+static uint64_t s_acked;
+/* Sent since the last retry, so not to be sent again yet. */
+static uint64_t s_sent;
+/* Sent at least once, to count retransmissions. */
+static uint64_t s_ever_sent;
+/* First fragment not acknowledged yet. */
+static uint16_t s_base;
+static uint8_t s_retries;
+
+/* Guards s_stats, which the UART task reads. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static zb_bulk_stats_t s_stats;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+static void retry_cb(uint8_t transfer_id);
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * all_fragments()
+ *------------------------------------------------------------*/
+
+static uint64_t all_fragments(uint16_t fragments)
+{
+    return fragments >= 64 ? UINT64_MAX : (1ULL << fragments) - 1;
+}
+
+/*--------------------------------------------------------------
+ * send_fragment()
+ *------------------------------------------------------------*/
+
+static void send_fragment(uint16_t fragment)
+{
+    uint16_t offset = fragment * ZB_BULK_FRAGMENT_SIZE;
+    uint16_t size = s_stats.bytes - offset < ZB_BULK_FRAGMENT_SIZE ? s_stats.bytes - offset : ZB_BULK_FRAGMENT_SIZE;
+    uint8_t frame[ZB_BULK_HEADER_SIZE + ZB_BULK_FRAGMENT_SIZE] = {
+        ZB_BULK_FRAME_DATA,
+        s_stats.transfer_id,
+        (uint8_t)(fragment), (uint8_t)(fragment >> 8),
+        (uint8_t)(s_stats.fragments), (uint8_t)(s_stats.fragments >> 8),
+    };
+    memcpy(&frame[ZB_BULK_HEADER_SIZE], &s_buffer[offset], size);
+
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = s_stats.short_addr,
+        .dst_endpoint = ZB_BULK_ENDPOINT,
+        .profile_id = ZB_BULK_PROFILE_ID,
+        .cluster_id = ZB_BULK_CLUSTER_ID,
+        .src_endpoint = ZB_BULK_ENDPOINT,
+        .asdu_length = ZB_BULK_HEADER_SIZE + size,
+        .asdu = frame,
+    };
+    if (esp_zb_aps_data_request(&req) != ESP_OK)
+    {
+        /* Left unsent, the next retry picks it up. */
+        ESP_LOGW(TAG, "Failed to send fragment %u", fragment);
+        return;
+    }
+
+    uint64_t bit = 1ULL << fragment;
+    s_sent |= bit;
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.data_frames++;
+    s_stats.air_bytes += ZB_BULK_AIR_OVERHEAD + ZB_BULK_HEADER_SIZE + size;
+    if (s_ever_sent & bit)
+    {
+        s_stats.retransmissions++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    s_ever_sent |= bit;
+}
+
+/*--------------------------------------------------------------
+ * send_window()
+ *------------------------------------------------------------*/
+
+/* Send every fragment of the window that is neither acknowledged nor
+ * already on its way. */
+static void send_window(void)
+{
+    for (uint16_t fragment = s_base; fragment < s_stats.fragments && fragment < s_base + ZB_BULK_WINDOW; fragment++)
+    {
+        if (!((s_acked | s_sent) & (1ULL << fragment)))
+        {
+            send_fragment(fragment);
+        }
+    }
+}
+
+/*--------------------------------------------------------------
+ * arm_retry()
+ *------------------------------------------------------------*/
+
+static void arm_retry(void)
+{
+    esp_zb_scheduler_alarm_cancel(retry_cb, s_stats.transfer_id);
+    esp_zb_scheduler_alarm(retry_cb, s_stats.transfer_id, ZB_BULK_RETRY_MS);
+}
+
+/*--------------------------------------------------------------
+ * finish()
+ *------------------------------------------------------------*/
+
+static void finish(esp_err_t status)
+{
+    esp_zb_scheduler_alarm_cancel(retry_cb, s_stats.transfer_id);
+    s_running = false;
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.status = status;
+    s_stats.elapsed_us = esp_timer_get_time() - s_stats.start_us;
+    zb_bulk_stats_t stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "Transfer %u to 0x%04hx %s: %u bytes in %" PRId64 " us, %" PRIu32 " data frames (%" PRIu32 " again), %" PRIu32 " acknowledgements",
+             stats.transfer_id, stats.short_addr, status == ESP_OK ? "done" : "failed", stats.bytes, stats.elapsed_us,
+             stats.data_frames, stats.retransmissions, stats.ack_frames);
+}
+
+/*--------------------------------------------------------------
+ * retry_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task when a window went unacknowledged. */
+static void retry_cb(uint8_t transfer_id)
+{
+    if (!s_running || transfer_id != s_stats.transfer_id)
+    {
+        return;
+    }
+    if (++s_retries > ZB_BULK_MAX_RETRIES)
+    {
+        finish(ESP_ERR_TIMEOUT);
+        return;
+    }
+    /* Everything not acknowledged is fair game again. */
+    s_sent &= s_acked;
+    send_window();
+    arm_retry();
+}
+
+/*--------------------------------------------------------------
+ * handle_ack()
+ *------------------------------------------------------------*/
+
+static void handle_ack(uint16_t first_missing, uint16_t bitmap)
+{
+    uint64_t all = all_fragments(s_stats.fragments);
+    uint64_t acked = s_acked | (all_fragments(first_missing) & all);
+    for (int i = 0; i < 16; i++)
+    {
+        uint32_t fragment = first_missing + 1 + i;
+        if ((bitmap & (1U << i)) && fragment < s_stats.fragments)
+        {
+            acked |= 1ULL << fragment;
+        }
+    }
+    bool progress = acked != s_acked;
+    s_acked = acked;
+
+    if (s_acked == all)
+    {
+        finish(ESP_OK);
+        return;
+    }
+
+    /* A hole below a fragment that arrived was lost, send it again
+     * now rather than after a timeout. */
+    uint16_t highest = 63 - __builtin_clzll(s_acked | 1);
+    for (uint16_t fragment = first_missing; fragment < highest; fragment++)
+    {
+        s_sent &= ~(1ULL << fragment) | s_acked;
+    }
+
+    while (s_acked & (1ULL << s_base))
+    {
+        s_base++;
+    }
+    if (progress)
+    {
+        s_retries = 0;
+        arm_retry();
+    }
+    send_window();
+}
+
+/*--------------------------------------------------------------
+ * zb_bulk_send()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_bulk_send(uint16_t short_addr, const uint8_t *data, uint16_t length)
+{
+    ESP_RETURN_ON_FALSE(!s_running, ESP_ERR_INVALID_STATE, TAG, "Transfer already running");
+    ESP_RETURN_ON_FALSE(data && length > 0 && length <= ZB_BULK_MAX_SIZE, ESP_ERR_INVALID_ARG, TAG, "Invalid length %u", length);
+
+    memcpy(s_buffer, data, length);
+    s_acked = 0;
+    s_sent = 0;
+    s_ever_sent = 0;
+    s_base = 0;
+    s_retries = 0;
+    s_running = true;
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats = (zb_bulk_stats_t){
+        .transfer_id = s_next_transfer_id++,
+        .short_addr = short_addr,
+        .status = ESP_ERR_NOT_FINISHED,
+        .bytes = length,
+        .fragments = (length + ZB_BULK_FRAGMENT_SIZE - 1) / ZB_BULK_FRAGMENT_SIZE,
+        .start_us = esp_timer_get_time(),
+    };
+    taskEXIT_CRITICAL(&s_lock);
+
+    send_window();
+    arm_retry();
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_bulk_handle_indication()
+ *------------------------------------------------------------*/
+
+bool zb_bulk_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != ZB_BULK_PROFILE_ID || ind->cluster_id != ZB_BULK_CLUSTER_ID || ind->dst_endpoint != ZB_BULK_ENDPOINT)
+    {
+        return false;
+    }
+    /* Ours, even if it is useless. */
+    const uint8_t *frame = ind->asdu;
+    if (ind->asdu_length < ZB_BULK_HEADER_SIZE || frame[0] != ZB_BULK_FRAME_ACK || !s_running ||
+        frame[1] != s_stats.transfer_id || ind->src_short_addr != s_stats.short_addr)
+    {
+        return true;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.ack_frames++;
+    s_stats.air_bytes += ZB_BULK_AIR_OVERHEAD + ind->asdu_length;
+    taskEXIT_CRITICAL(&s_lock);
+    handle_ack(frame[2] | (frame[3] << 8), frame[4] | (frame[5] << 8));
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * zb_bulk_get_stats()
+ *------------------------------------------------------------*/
+
+bool zb_bulk_get_stats(zb_bulk_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+    return stats->status != ESP_ERR_NOT_FINISHED;
+}
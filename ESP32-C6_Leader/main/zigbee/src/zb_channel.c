@@ -0,0 +1,203 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Energy detect scans and channel changes. See
+ * zb_channel.h.
+ *
+ * Notes:
+ *     - Every scan is logged as one line starting with
+ *       "CHANNEL_SCAN", which the GUI parses to draw the channels.
+ *     - esp-zigbee-lib has no call for Mgmt_NWK_Update_req, so it
+ *       goes through ZBOSS's zb_zdo_mgmt_nwk_update_req(). ZBOSS then
+ *       bumps the network update ID and moves the coordinator itself
+ *       along with the rest of the network. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_zigbee_core.h"
+#include "zboss_api.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_channel.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_CHANNEL";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* A scan may run without a callback, so it is tracked apart. */
+static bool s_running = false;
+static zb_channel_scan_cb_t s_done = NULL;
+
+/* Guards s_last_scan, which the UART task reads. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static zb_channel_scan_t s_last_scan;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * log_scan()
+ *------------------------------------------------------------*/
+
+static void log_scan(const zb_channel_scan_t *scan, uint8_t best)
+{
+    /* "CHANNEL_SCAN current=<n> best=<n> energy=<dBm of 11>,...,<dBm of 26>"
+     * with "-128" for a channel that was not measured. */
+    char energy[ZB_CHANNEL_COUNT * 5 + 1];
+    int length = 0;
+    for (int i = 0; i < ZB_CHANNEL_COUNT; i++)
+    {
+        bool measured = scan->channel_mask & (1UL << (ZB_CHANNEL_FIRST + i));
+        length += snprintf(&energy[length], sizeof(energy) - length, "%s%d", i ? "," : "", measured ? scan->energy_dbm[i] : INT8_MIN);
+    }
+    ESP_LOGI(TAG, "CHANNEL_SCAN current=%u best=%u energy=%s", esp_zb_get_current_channel(), best, energy);
+}
+
+/*--------------------------------------------------------------
+ * energy_detect_cb()
+ *------------------------------------------------------------*/
+
+static void energy_detect_cb(esp_zb_zdp_status_t status, uint16_t count, esp_zb_energy_detect_channel_info_t *channel_info)
+{
+    zb_channel_scan_cb_t done = s_done;
+    s_done = NULL;
+    s_running = false;
+    uint8_t best = 0;
+
+    if (status != ESP_ZB_ZDP_STATUS_SUCCESS)
+    {
+        ESP_LOGW(TAG, "Energy detect scan failed (status: 0x%x)", status);
+    }
+    else
+    {
+        zb_channel_scan_t scan = {0};
+        /* As logged, so a channel that was not measured does not count
+         * against its neighbours. */
+        memset(scan.energy_dbm, INT8_MIN, sizeof(scan.energy_dbm));
+        for (uint16_t i = 0; i < count; i++)
+        {
+            uint8_t channel = channel_info[i].channel_number;
+            if (channel >= ZB_CHANNEL_FIRST && channel <= ZB_CHANNEL_LAST)
+            {
+                scan.energy_dbm[channel - ZB_CHANNEL_FIRST] = channel_info[i].energy_detected;
+                scan.channel_mask |= 1UL << channel;
+            }
+        }
+        scan.time_us = esp_timer_get_time();
+        /* Before a network is formed there is no current channel. */
+        uint8_t current = esp_zb_bdb_is_factory_new() ? 0 : esp_zb_get_current_channel();
+        best = zb_channel_select(scan.energy_dbm, scan.channel_mask, current, ZB_CHANNEL_CHANGE_MARGIN_DB);
+
+        taskENTER_CRITICAL(&s_lock);
+        s_last_scan = scan;
+        taskEXIT_CRITICAL(&s_lock);
+        log_scan(&scan, best);
+    }
+
+    if (done)
+    {
+        done(best);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_channel_scan()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_channel_scan(zb_channel_scan_cb_t done)
+{
+    ESP_RETURN_ON_FALSE(!s_running, ESP_ERR_INVALID_STATE, TAG, "Scan already running");
+    s_running = true;
+    s_done = done;
+    esp_zb_zdo_energy_detect_request(ESP_ZB_TRANSCEIVER_ALL_CHANNELS_MASK, ZB_CHANNEL_SCAN_DURATION, energy_detect_cb);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * channel_change_cb()
+ *------------------------------------------------------------*/
+
+/* ZBOSS hands the request's buffer back here once it is done with
+ * it. */
+static void channel_change_cb(zb_uint8_t param)
+{
+    zb_buf_free(param);
+}
+
+/*--------------------------------------------------------------
+ * zb_channel_change()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_channel_change(uint8_t channel)
+{
+    ESP_RETURN_ON_FALSE(channel >= ZB_CHANNEL_FIRST && channel <= ZB_CHANNEL_LAST, ESP_ERR_INVALID_ARG, TAG, "Invalid channel %u", channel);
+    uint8_t current = esp_zb_get_current_channel();
+    if (channel == current)
+    {
+        return ESP_OK;
+    }
+
+    zb_bufid_t buf = zb_buf_get_out();
+    ESP_RETURN_ON_FALSE(buf != 0, ESP_ERR_NO_MEM, TAG, "No buffer for channel change");
+    zb_zdo_mgmt_nwk_update_req_t *req = ZB_BUF_GET_PARAM(buf, zb_zdo_mgmt_nwk_update_req_t);
+    req->hdr.scan_channels = 1UL << channel;
+    req->hdr.scan_duration = ZB_ZDO_NEW_ACTIVE_CHANNEL;
+    req->scan_count = 0;
+    req->manager_addr = 0;
+    req->dst_addr = ZB_NWK_BROADCAST_RX_ON_WHEN_IDLE;
+    if (zb_zdo_mgmt_nwk_update_req(buf, channel_change_cb) == ZB_ZDO_INVALID_TSN)
+    {
+        zb_buf_free(buf);
+        ESP_LOGE(TAG, "Failed to send channel change");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "Moving network from channel %u to %u", current, channel);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_channel_get_last_scan()
+ *------------------------------------------------------------*/
+
+void zb_channel_get_last_scan(zb_channel_scan_t *scan)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *scan = s_last_scan;
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,109 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The pure part of channel selection. See
+ * zb_channel.h.
+ *
+ * Notes:
+ *     - Nothing here may call ESP-IDF or the Zigbee stack, so this
+ *       file builds on a host as is. ../test_host tests it there. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+
+#include "zb_channel.h"
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * channel_in_mask()
+ *------------------------------------------------------------*/
+
+static bool channel_in_mask(uint8_t channel, uint32_t channel_mask)
+{
+    return channel >= ZB_CHANNEL_FIRST && channel <= ZB_CHANNEL_LAST && (channel_mask & (1UL << channel));
+}
+
+/*--------------------------------------------------------------
+ * channel_score()
+ *------------------------------------------------------------*/
+
+/* Higher is noisier. In dBm, widened to avoid overflow. */
+static int16_t channel_score(const int8_t energy_dbm[ZB_CHANNEL_COUNT], uint8_t channel)
+{
+    int i = channel - ZB_CHANNEL_FIRST;
+    int16_t score = energy_dbm[i];
+    if (i > 0 && energy_dbm[i - 1] - ZB_CHANNEL_ADJACENT_REJECTION_DB > score)
+    {
+        score = energy_dbm[i - 1] - ZB_CHANNEL_ADJACENT_REJECTION_DB;
+    }
+    if (i < ZB_CHANNEL_COUNT - 1 && energy_dbm[i + 1] - ZB_CHANNEL_ADJACENT_REJECTION_DB > score)
+    {
+        score = energy_dbm[i + 1] - ZB_CHANNEL_ADJACENT_REJECTION_DB;
+    }
+    return score;
+}
+
+/*--------------------------------------------------------------
+ * zb_channel_rank()
+ *------------------------------------------------------------*/
+
+uint8_t zb_channel_rank(const int8_t energy_dbm[ZB_CHANNEL_COUNT], uint32_t channel_mask, uint8_t ranked[ZB_CHANNEL_COUNT])
+{
+    int16_t scores[ZB_CHANNEL_COUNT];
+    uint8_t count = 0;
+
+    /* Insertion sort, 16 channels at most. Strictly greater keeps
+     * equal scores in channel order. */
+    for (uint8_t channel = ZB_CHANNEL_FIRST; channel <= ZB_CHANNEL_LAST; channel++)
+    {
+        if (!channel_in_mask(channel, channel_mask))
+        {
+            continue;
+        }
+        int16_t score = channel_score(energy_dbm, channel);
+        uint8_t i = count++;
+        while (i > 0 && scores[i - 1] > score)
+        {
+            scores[i] = scores[i - 1];
+            ranked[i] = ranked[i - 1];
+            i--;
+        }
+        scores[i] = score;
+        ranked[i] = channel;
+    }
+    return count;
+}
+
+/*--------------------------------------------------------------
+ * zb_channel_select()
+ *------------------------------------------------------------*/
+
+uint8_t zb_channel_select(const int8_t energy_dbm[ZB_CHANNEL_COUNT], uint32_t channel_mask, uint8_t current_channel,
+                          int8_t margin_db)
+{
+    uint8_t ranked[ZB_CHANNEL_COUNT];
+    if (zb_channel_rank(energy_dbm, channel_mask, ranked) == 0)
+    {
+        return 0;
+    }
+    uint8_t best = ranked[0];
+    if (!channel_in_mask(current_channel, channel_mask) || best == current_channel)
+    {
+        return best;
+    }
+    /* Only move for a real improvement. */
+    if (channel_score(energy_dbm, current_channel) - channel_score(energy_dbm, best) < margin_db)
+    {
+        return current_channel;
+    }
+    return best;
+}
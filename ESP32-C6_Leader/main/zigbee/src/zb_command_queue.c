@@ -0,0 +1,723 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: An outbound queue for Zigbee commands. See
+ * zb_command_queue.h.
+ *
+ * Notes:
+ *     - Only the dispatcher task ever waits for the Zigbee lock.
+ *       Once it has the lock it sends up to
+ *       ZB_COMMAND_QUEUE_BATCH_SIZE commands before releasing it, so
+ *       a burst of commands costs one lock acquisition, not one each.
+ *     - Latency is measured by TSN: the enqueue time of each sent
+ *       command is kept until the stack reports its send status.
+ *     - Waiting commands are kept in a fixed table, each on one list:
+ *       the free list, the interactive lane, or its destination's
+ *       list. The destinations with commands waiting take turns in
+ *       a ring, by deficit round robin. A destination earns its
+ *       quantum on each turn it is free to send, and spends it at
+ *       the ZCL frame size of each command sent.
+ *     - A destination's sends in flight are found again by TSN, so
+ *       its confirmations free it up. A bound command may go to
+ *       several devices, and frees it on the first. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <stdbool.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_command_queue.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define TSN_COUNT 256
+
+/* The end of a list. */
+#define ENTRY_NONE -1
+#define FLOW_NONE -1
+
+/* Frame control, TSN and command ID. */
+#define ZCL_HEADER_SIZE 3
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool in_use;
+    uint8_t tsn;
+    int64_t enqueued_us;
+    int64_t submitted_us;
+} in_flight_t;
+
+typedef struct
+{
+    zb_command_t command;
+    int16_t next;
+    int8_t flow;
+} entry_t;
+
+typedef struct
+{
+    int16_t head;
+    int16_t tail;
+} list_t;
+
+typedef struct
+{
+    bool used;
+    /* In the ring, and whether it got its quantum this turn. */
+    bool active;
+    bool topped_up;
+    int32_t deficit;
+    list_t waiting;
+    int64_t last_submitted_us;
+    int64_t last_used_us;
+    zb_command_flow_stats_t stats;
+} flow_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_COMMAND_QUEUE";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static zb_command_send_cb_t s_send = NULL;
+static TaskHandle_t s_task = NULL;
+/* Counts free entries, so producers can wait for one. */
+static SemaphoreHandle_t s_room = NULL;
+
+/* Guards everything below it. Written by the dispatcher and by the
+ * Zigbee task (send status), read by anyone. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static zb_command_queue_stats_t s_stats;
+static in_flight_t s_in_flight[ZB_COMMAND_QUEUE_IN_FLIGHT];
+static uint32_t s_in_flight_next;
+/* One bit per TSN waiting for its send status. Unlike the slots
+ * above, this covers every command sent. */
+static uint32_t s_pending_tsns[TSN_COUNT / 32];
+/* The flow each pending TSN counts against, plus one, 0 for none. */
+static uint8_t s_tsn_flows[TSN_COUNT];
+
+static entry_t s_entries[ZB_COMMAND_QUEUE_LENGTH];
+static list_t s_free;
+static list_t s_interactive;
+static flow_t s_flows[ZB_COMMAND_QUEUE_FLOWS];
+/* The destinations with normal commands waiting, in turn order. */
+static int8_t s_ring[ZB_COMMAND_QUEUE_FLOWS];
+static uint32_t s_ring_head;
+static uint32_t s_ring_count;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * list_push()
+ *------------------------------------------------------------*/
+
+static void list_push(list_t *list, int16_t index)
+{
+    s_entries[index].next = ENTRY_NONE;
+    if (list->tail == ENTRY_NONE)
+    {
+        list->head = index;
+    }
+    else
+    {
+        s_entries[list->tail].next = index;
+    }
+    list->tail = index;
+}
+
+/*--------------------------------------------------------------
+ * list_pop()
+ *------------------------------------------------------------*/
+
+static int16_t list_pop(list_t *list)
+{
+    int16_t index = list->head;
+    if (index != ENTRY_NONE)
+    {
+        list->head = s_entries[index].next;
+        if (list->head == ENTRY_NONE)
+        {
+            list->tail = ENTRY_NONE;
+        }
+    }
+    return index;
+}
+
+/*--------------------------------------------------------------
+ * command_cost()
+ *------------------------------------------------------------*/
+
+/* The size of a command's ZCL frame, near enough. */
+static int32_t command_cost(const zb_command_t *command)
+{
+    switch (command->type)
+    {
+    case ZB_COMMAND_LED_EFFECT:
+        /* An octet string, its length first. */
+        return ZCL_HEADER_SIZE + 1 + LED_EFFECTS_PARAMS_WIRE_SIZE;
+    case ZB_COMMAND_GROUP_ADD:
+        /* The group ID and an empty name. */
+        return ZCL_HEADER_SIZE + 3;
+    case ZB_COMMAND_GROUP_REMOVE:
+    case ZB_COMMAND_SCENE_MEMBERSHIP:
+    case ZB_COMMAND_READ_ATTR:
+        return ZCL_HEADER_SIZE + 2;
+    case ZB_COMMAND_SCENE_STORE:
+    case ZB_COMMAND_SCENE_RECALL:
+        return ZCL_HEADER_SIZE + 3;
+    case ZB_COMMAND_CONFIG_REPORT:
+        /* Direction, attribute, type and both intervals. */
+        return ZCL_HEADER_SIZE + 8;
+    default:
+        return ZCL_HEADER_SIZE;
+    }
+}
+
+/*--------------------------------------------------------------
+ * dst_equal()
+ *------------------------------------------------------------*/
+
+static bool dst_equal(const zb_command_dst_t *a, const zb_command_dst_t *b)
+{
+    if (a->mode != b->mode)
+    {
+        return false;
+    }
+    switch (a->mode)
+    {
+    case ZB_COMMAND_DST_SHORT:
+        return a->short_addr == b->short_addr;
+    case ZB_COMMAND_DST_GROUP:
+        return a->group_id == b->group_id;
+    default:
+        return true;
+    }
+}
+
+/*--------------------------------------------------------------
+ * flow_idle()
+ *------------------------------------------------------------*/
+
+static bool flow_idle(const flow_t *flow, int64_t now_us)
+{
+    return flow->stats.backlog == 0 &&
+           (flow->stats.in_flight == 0 || now_us - flow->last_submitted_us >= ZB_COMMAND_QUEUE_FLOW_STALL_MS * 1000LL);
+}
+
+/*--------------------------------------------------------------
+ * flow_find()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. The flow of a destination, made
+ * if need be in place of the least recently used idle one. */
+static int8_t flow_find(const zb_command_dst_t *dst, int64_t now_us)
+{
+    int8_t reuse = FLOW_NONE;
+    for (int8_t i = 0; i < ZB_COMMAND_QUEUE_FLOWS; i++)
+    {
+        flow_t *flow = &s_flows[i];
+        if (flow->used && dst_equal(&flow->stats.dst, dst))
+        {
+            return i;
+        }
+        if (!flow->used || flow_idle(flow, now_us))
+        {
+            if (reuse == FLOW_NONE || !flow->used ||
+                (s_flows[reuse].used && flow->last_used_us < s_flows[reuse].last_used_us))
+            {
+                reuse = i;
+            }
+        }
+    }
+    if (reuse == FLOW_NONE)
+    {
+        return FLOW_NONE;
+    }
+
+    /* Its sends still in flight no longer count against anyone. */
+    for (uint32_t tsn = 0; tsn < TSN_COUNT; tsn++)
+    {
+        if (s_tsn_flows[tsn] == reuse + 1)
+        {
+            s_tsn_flows[tsn] = 0;
+        }
+    }
+    s_flows[reuse] = (flow_t){
+        .used = true,
+        .waiting = {ENTRY_NONE, ENTRY_NONE},
+        .stats.dst = *dst,
+    };
+    return reuse;
+}
+
+/*--------------------------------------------------------------
+ * flow_can_send()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. */
+static bool flow_can_send(flow_t *flow, int64_t now_us)
+{
+    if (flow->stats.in_flight < ZB_COMMAND_QUEUE_FLOW_IN_FLIGHT)
+    {
+        return true;
+    }
+    if (now_us - flow->last_submitted_us < ZB_COMMAND_QUEUE_FLOW_STALL_MS * 1000LL)
+    {
+        return false;
+    }
+    /* The confirmations are not coming, most likely the stack dropped
+     * the frames. Start counting afresh. */
+    flow->stats.in_flight = 0;
+    flow->stats.stalls++;
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * ring_rotate()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. The flow at the head goes to the
+ * back, its turn over. */
+static void ring_rotate(void)
+{
+    int8_t index = s_ring[s_ring_head];
+    s_flows[index].topped_up = false;
+    s_ring_head = (s_ring_head + 1) % ZB_COMMAND_QUEUE_FLOWS;
+    s_ring[(s_ring_head + s_ring_count - 1) % ZB_COMMAND_QUEUE_FLOWS] = index;
+}
+
+/*--------------------------------------------------------------
+ * dequeue_next()
+ *------------------------------------------------------------*/
+
+/* Must be called with s_lock held. Take the next command to send:
+ * an interactive one if there is any, else the next by deficit round
+ * robin among the destinations free to send. Returns false if there
+ * is none for now. */
+static bool dequeue_next(zb_command_t *command, int8_t *flow_index, int64_t now_us)
+{
+    int16_t index = list_pop(&s_interactive);
+    if (index == ENTRY_NONE)
+    {
+        /* Each flow is seen at most twice, once to be topped up and
+         * once more if that was not enough. */
+        for (uint32_t visits = 0; index == ENTRY_NONE && visits < 2 * s_ring_count; visits++)
+        {
+            flow_t *flow = &s_flows[s_ring[s_ring_head]];
+            if (!flow_can_send(flow, now_us))
+            {
+                /* It earns nothing, and keeps no more than a turn's
+                 * worth, or credit would pile up while it waits. */
+                if (flow->deficit > ZB_COMMAND_QUEUE_QUANTUM)
+                {
+                    flow->deficit = ZB_COMMAND_QUEUE_QUANTUM;
+                }
+                ring_rotate();
+                continue;
+            }
+            if (!flow->topped_up)
+            {
+                flow->deficit += ZB_COMMAND_QUEUE_QUANTUM;
+                flow->topped_up = true;
+            }
+            int32_t cost = command_cost(&s_entries[flow->waiting.head].command);
+            if (cost > flow->deficit)
+            {
+                ring_rotate();
+                continue;
+            }
+            flow->deficit -= cost;
+            index = list_pop(&flow->waiting);
+            if (flow->waiting.head == ENTRY_NONE)
+            {
+                /* Out of the ring, and no credit saved up for later. */
+                flow->active = false;
+                flow->topped_up = false;
+                flow->deficit = 0;
+                s_ring_head = (s_ring_head + 1) % ZB_COMMAND_QUEUE_FLOWS;
+                s_ring_count--;
+            }
+        }
+        if (index == ENTRY_NONE)
+        {
+            return false;
+        }
+    }
+
+    entry_t *entry = &s_entries[index];
+    *command = entry->command;
+    *flow_index = entry->flow;
+    list_push(&s_free, index);
+
+    flow_t *flow = &s_flows[entry->flow];
+    uint32_t wait_us = (uint32_t)(now_us - command->enqueued_us);
+    flow->stats.backlog--;
+    flow->stats.in_flight++;
+    flow->stats.sent++;
+    flow->stats.total_wait_us += wait_us;
+    if (wait_us > flow->stats.max_wait_us)
+    {
+        flow->stats.max_wait_us = wait_us;
+    }
+    flow->last_submitted_us = now_us;
+    flow->last_used_us = now_us;
+    if (command->priority == ZB_COMMAND_PRIORITY_INTERACTIVE)
+    {
+        s_stats.interactive_sent++;
+        if (wait_us > s_stats.max_interactive_wait_us)
+        {
+            s_stats.max_interactive_wait_us = wait_us;
+        }
+    }
+    s_stats.depth--;
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * track_in_flight()
+ *------------------------------------------------------------*/
+
+/* Remember when a sent command was enqueued and sent, and for which
+ * flow. If every slot is busy the oldest one is reused, and that
+ * command goes unmeasured. It is counted as in flight either way. */
+static void track_in_flight(uint8_t tsn, int8_t flow, int64_t enqueued_us, int64_t submitted_us)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_tsn_flows[tsn] = (uint8_t)(flow + 1);
+    in_flight_t *slot = &s_in_flight[s_in_flight_next];
+    s_in_flight_next = (s_in_flight_next + 1) % ZB_COMMAND_QUEUE_IN_FLIGHT;
+    slot->in_use = true;
+    slot->tsn = tsn;
+    slot->enqueued_us = enqueued_us;
+    slot->submitted_us = submitted_us;
+    uint32_t bit = 1U << (tsn % 32);
+    if (!(s_pending_tsns[tsn / 32] & bit))
+    {
+        s_pending_tsns[tsn / 32] |= bit;
+        s_stats.in_flight++;
+        if (s_stats.in_flight > s_stats.max_in_flight)
+        {
+            s_stats.max_in_flight = s_stats.in_flight;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_command_queue_task()
+ *------------------------------------------------------------*/
+
+static void zb_command_queue_task(void *arg)
+{
+    zb_command_t commands[ZB_COMMAND_QUEUE_BATCH_SIZE];
+    int8_t flows[ZB_COMMAND_QUEUE_BATCH_SIZE];
+
+    /* Loop forever. */
+    for (;;)
+    {
+        /* Take what may be sent now, up to a batch. */
+        uint32_t count = 0;
+        bool waiting = false;
+        taskENTER_CRITICAL(&s_lock);
+        int64_t now_us = esp_timer_get_time();
+        while (count < ZB_COMMAND_QUEUE_BATCH_SIZE && dequeue_next(&commands[count], &flows[count], now_us))
+        {
+            count++;
+        }
+        waiting = s_stats.depth > 0;
+        taskEXIT_CRITICAL(&s_lock);
+
+        if (count == 0)
+        {
+            /* Sleep until something is enqueued or confirmed. Commands
+             * held back by a stalled destination are looked at again
+             * after the stall time. */
+            ulTaskNotifyTake(pdTRUE, waiting ? pdMS_TO_TICKS(ZB_COMMAND_QUEUE_FLOW_STALL_MS) : portMAX_DELAY);
+            continue;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            xSemaphoreGive(s_room);
+        }
+
+        int64_t wait_start_us = esp_timer_get_time();
+        esp_zb_lock_acquire(portMAX_DELAY);
+        uint32_t lock_wait_us = (uint32_t)(esp_timer_get_time() - wait_start_us);
+        for (uint32_t i = 0; i < count; i++)
+        {
+            int64_t submitted_us = esp_timer_get_time();
+            uint8_t tsn = s_send(&commands[i]);
+            track_in_flight(tsn, flows[i], commands[i].enqueued_us, submitted_us);
+        }
+        esp_zb_lock_release();
+
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.sent += count;
+        s_stats.batches++;
+        s_stats.last_lock_wait_us = lock_wait_us;
+        if (lock_wait_us > s_stats.max_lock_wait_us)
+        {
+            s_stats.max_lock_wait_us = lock_wait_us;
+        }
+        taskEXIT_CRITICAL(&s_lock);
+    }
+
+    /* It should never reach here. */
+    vTaskDelete(NULL);
+}
+
+/*--------------------------------------------------------------
+ * zb_command_queue_init()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_command_queue_init(zb_command_send_cb_t send)
+{
+    ESP_RETURN_ON_FALSE(send, ESP_ERR_INVALID_ARG, TAG, "No send callback");
+    ESP_RETURN_ON_FALSE(s_room == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+    s_send = send;
+    s_free = (list_t){ENTRY_NONE, ENTRY_NONE};
+    s_interactive = (list_t){ENTRY_NONE, ENTRY_NONE};
+    for (int16_t i = 0; i < ZB_COMMAND_QUEUE_LENGTH; i++)
+    {
+        list_push(&s_free, i);
+    }
+    s_room = xSemaphoreCreateCounting(ZB_COMMAND_QUEUE_LENGTH, ZB_COMMAND_QUEUE_LENGTH);
+    ESP_RETURN_ON_FALSE(s_room, ESP_ERR_NO_MEM, TAG, "Failed to create queue");
+    BaseType_t created = xTaskCreate(zb_command_queue_task, "zb_command_queue", ZB_COMMAND_QUEUE_TASK_STACK_DEPTH, NULL,
+                                     ZB_COMMAND_QUEUE_TASK_PRIORITY, &s_task);
+    ESP_RETURN_ON_FALSE(created == pdPASS, ESP_ERR_NO_MEM, TAG, "Failed to create task");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_command_queue_send()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_command_queue_send(const zb_command_t *command)
+{
+    /* Never wait. A full queue means the stack is far behind, and a
+     * stale command is worth less than a responsive caller. */
+    esp_err_t err = zb_command_queue_send_wait(command, 0);
+    return err == ESP_ERR_TIMEOUT ? ESP_ERR_NO_MEM : err;
+}
+
+/*--------------------------------------------------------------
+ * zb_command_queue_send_wait()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_command_queue_send_wait(const zb_command_t *command, TickType_t ticks_to_wait)
+{
+    ESP_RETURN_ON_FALSE(command && command->type < ZB_COMMAND_TYPE_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid command");
+    ESP_RETURN_ON_FALSE(s_room, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+
+    TickType_t start = xTaskGetTickCount();
+    bool accepted = false;
+    for (;;)
+    {
+        TickType_t waited = xTaskGetTickCount() - start;
+        TickType_t remaining = ticks_to_wait == portMAX_DELAY ? portMAX_DELAY : waited < ticks_to_wait ? ticks_to_wait - waited : 0;
+        if (xSemaphoreTake(s_room, remaining) != pdTRUE)
+        {
+            break;
+        }
+
+        taskENTER_CRITICAL(&s_lock);
+        int64_t now_us = esp_timer_get_time();
+        int8_t flow_index = flow_find(&command->dst, now_us);
+        flow_t *flow = flow_index == FLOW_NONE ? NULL : &s_flows[flow_index];
+        /* Interactive commands are few, and not held to the share. */
+        if (flow && (flow->stats.backlog < ZB_COMMAND_QUEUE_FLOW_BACKLOG || command->priority == ZB_COMMAND_PRIORITY_INTERACTIVE))
+        {
+            int16_t index = list_pop(&s_free);
+            entry_t *entry = &s_entries[index];
+            entry->command = *command;
+            entry->command.enqueued_us = now_us;
+            entry->flow = flow_index;
+            if (command->priority == ZB_COMMAND_PRIORITY_INTERACTIVE)
+            {
+                list_push(&s_interactive, index);
+            }
+            else
+            {
+                list_push(&flow->waiting, index);
+                if (!flow->active)
+                {
+                    flow->active = true;
+                    s_ring[(s_ring_head + s_ring_count) % ZB_COMMAND_QUEUE_FLOWS] = flow_index;
+                    s_ring_count++;
+                }
+            }
+            flow->last_used_us = now_us;
+            if (++flow->stats.backlog > flow->stats.max_backlog)
+            {
+                flow->stats.max_backlog = flow->stats.backlog;
+            }
+            if (++s_stats.depth > s_stats.max_depth)
+            {
+                s_stats.max_depth = s_stats.depth;
+            }
+            s_stats.enqueued++;
+            accepted = true;
+        }
+        taskEXIT_CRITICAL(&s_lock);
+        if (accepted)
+        {
+            xTaskNotifyGive(s_task);
+            break;
+        }
+
+        /* The destination has its share waiting, or every flow is
+         * busy. Give the entry back and look again in a tick. */
+        xSemaphoreGive(s_room);
+        if (remaining == 0)
+        {
+            break;
+        }
+        vTaskDelay(1);
+    }
+
+    if (!accepted)
+    {
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.dropped++;
+        for (int8_t i = 0; i < ZB_COMMAND_QUEUE_FLOWS; i++)
+        {
+            if (s_flows[i].used && dst_equal(&s_flows[i].stats.dst, &command->dst))
+            {
+                s_flows[i].stats.dropped++;
+                break;
+            }
+        }
+        taskEXIT_CRITICAL(&s_lock);
+    }
+    ESP_RETURN_ON_FALSE(accepted, ESP_ERR_TIMEOUT, TAG, "Queue full, command dropped");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_command_queue_send_status()
+ *------------------------------------------------------------*/
+
+void zb_command_queue_send_status(const esp_zb_zcl_command_send_status_message_t *message)
+{
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.statuses++;
+    s_stats.last_status_us = now_us;
+    if (message->status != ESP_OK)
+    {
+        s_stats.send_failures++;
+    }
+    uint32_t bit = 1U << (message->tsn % 32);
+    if (s_pending_tsns[message->tsn / 32] & bit)
+    {
+        s_pending_tsns[message->tsn / 32] &= ~bit;
+        s_stats.in_flight--;
+    }
+    bool flow_freed = false;
+    if (s_tsn_flows[message->tsn] != 0)
+    {
+        flow_t *flow = &s_flows[s_tsn_flows[message->tsn] - 1];
+        s_tsn_flows[message->tsn] = 0;
+        if (flow->stats.in_flight > 0)
+        {
+            flow->stats.in_flight--;
+            flow_freed = flow->stats.backlog > 0;
+        }
+    }
+    for (int i = 0; i < ZB_COMMAND_QUEUE_IN_FLIGHT; i++)
+    {
+        in_flight_t *slot = &s_in_flight[i];
+        if (slot->in_use && slot->tsn == message->tsn)
+        {
+            /* A bound command may go to several devices. Only the
+             * first status is counted. */
+            slot->in_use = false;
+            s_stats.last_latency_us = (uint32_t)(now_us - slot->enqueued_us);
+            s_stats.last_queued_us = (uint32_t)(slot->submitted_us - slot->enqueued_us);
+            s_stats.last_confirm_us = (uint32_t)(now_us - slot->submitted_us);
+            if (s_stats.last_latency_us > s_stats.max_latency_us)
+            {
+                s_stats.max_latency_us = s_stats.last_latency_us;
+            }
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    if (flow_freed)
+    {
+        /* It may have been held back. */
+        xTaskNotifyGive(s_task);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_command_queue_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_command_queue_get_stats(zb_command_queue_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_command_queue_get_flow_stats()
+ *------------------------------------------------------------*/
+
+uint32_t zb_command_queue_get_flow_stats(zb_command_flow_stats_t *stats, uint32_t max_count)
+{
+    uint32_t count = 0;
+    taskENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < ZB_COMMAND_QUEUE_FLOWS && count < max_count; i++)
+    {
+        if (s_flows[i].used)
+        {
+            stats[count++] = s_flows[i].stats;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return count;
+}
@@ -0,0 +1,534 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Paced commissioning of new followers. See
+ * zb_commission.h.
+ *
+ * Notes:
+ *     - Everything here runs in the Zigbee task, except for
+ *       zb_commission_get_stats(), so only the stats have a lock.
+ *     - A device goes through its steps one request at a time, and
+ *       the oldest device that is ready goes first, so the first to
+ *       announce are the first to be done.
+ *     - The stack answers every ZDO request, with
+ *       ESP_ZB_ZDP_STATUS_TIMEOUT if the device did not, so a request
+ *       stays outstanding only until then. Its `user_ctx` is the
+ *       device's slot, which is not reused before the answer. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "follower_registry.h"
+#include "zb_commission.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef enum
+{
+    /* Find the light endpoint. */
+    STEP_FIND = 0,
+    /* Bind us to the light. */
+    STEP_BIND_ON_OFF,
+    STEP_BIND_LED_EFFECTS,
+    /* Bind the light to us, for its reports. */
+    STEP_REPORT_ON_OFF,
+    STEP_REPORT_LED_EFFECTS,
+    STEP_DONE,
+} step_t;
+
+typedef struct
+{
+    bool used;
+    bool in_flight;
+    step_t step;
+    /* Tries of the current step, and retries of all steps. */
+    uint8_t attempts;
+    uint8_t retries;
+    uint16_t id;
+    uint16_t short_addr;
+    esp_zb_ieee_addr_t ieee_addr;
+    uint8_t endpoint;
+    /* When it announced itself, and when it may try again. */
+    int64_t enqueued_us;
+    int64_t ready_us;
+} device_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_COMMISSION";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static uint8_t s_endpoint;
+static uint16_t s_effects_cluster_id;
+static zb_commission_found_cb_t s_found_cb;
+static zb_commission_reporting_cb_t s_reporting_cb;
+
+static device_t s_devices[ZB_COMMISSION_QUEUE_SIZE];
+static uint8_t s_concurrency = ZB_COMMISSION_CONCURRENCY;
+static uint8_t s_in_flight;
+
+/* The batch in progress, from the first device to join an empty
+ * queue until the queue is empty again. */
+static int64_t s_batch_start_us;
+static uint16_t s_batch_devices;
+static uint16_t s_batch_commissioned;
+static uint16_t s_batch_failed;
+static uint16_t s_batch_retries;
+
+/* Guards the stats, which any task may read. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static zb_commission_stats_t s_stats;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+static void commission_pump(void);
+static void commission_pump_cb(uint8_t param);
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * device_ctx()
+ *------------------------------------------------------------*/
+
+static void *device_ctx(const device_t *device)
+{
+    return (void *)(uintptr_t)(device - s_devices);
+}
+
+/*--------------------------------------------------------------
+ * device_from_ctx()
+ *------------------------------------------------------------*/
+
+static device_t *device_from_ctx(void *user_ctx)
+{
+    return &s_devices[(uintptr_t)user_ctx];
+}
+
+/*--------------------------------------------------------------
+ * queued_count()
+ *------------------------------------------------------------*/
+
+static uint16_t queued_count(void)
+{
+    uint16_t count = 0;
+    for (uint32_t i = 0; i < ZB_COMMISSION_QUEUE_SIZE; i++)
+    {
+        count += s_devices[i].used;
+    }
+    return count;
+}
+
+/*--------------------------------------------------------------
+ * stats_publish()
+ *------------------------------------------------------------*/
+
+static void stats_publish(void)
+{
+    uint16_t queued = queued_count();
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.queued = queued;
+    if (queued > s_stats.max_queued)
+    {
+        s_stats.max_queued = queued;
+    }
+    s_stats.in_flight = s_in_flight;
+    s_stats.concurrency = s_concurrency;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * device_finish()
+ *------------------------------------------------------------*/
+
+/* Log the outcome and free the slot, and the batch once it was the
+ * last. */
+static void device_finish(device_t *device, bool ok, const char *reason)
+{
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - device->enqueued_us) / 1000);
+    if (ok)
+    {
+        ESP_LOGI(TAG, "COMMISSION id=%u short=0x%04hx ms=%" PRIu32 " retries=%u", device->id, device->short_addr, ms,
+                 device->retries);
+        s_batch_commissioned++;
+    }
+    else
+    {
+        ESP_LOGW(TAG, "COMMISSION short=0x%04hx failed ms=%" PRIu32 " step=%d reason=%s", device->short_addr, ms, device->step,
+                 reason);
+        s_batch_failed++;
+    }
+    device->used = false;
+
+    taskENTER_CRITICAL(&s_lock);
+    if (ok)
+    {
+        s_stats.commissioned++;
+    }
+    else
+    {
+        s_stats.failed++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (queued_count() == 0)
+    {
+        ESP_LOGI(TAG, "COMMISSION_BATCH devices=%u commissioned=%u failed=%u retries=%u concurrency=%u ms=%" PRIu32, s_batch_devices,
+                 s_batch_commissioned, s_batch_failed, s_batch_retries, s_concurrency,
+                 (uint32_t)((esp_timer_get_time() - s_batch_start_us) / 1000));
+    }
+}
+
+/*--------------------------------------------------------------
+ * device_step_done()
+ *------------------------------------------------------------*/
+
+/* A request was answered. Move on to the next step, or try this one
+ * again after a backoff, or give up. */
+static void device_step_done(device_t *device, bool ok, const char *reason)
+{
+    device->in_flight = false;
+    s_in_flight--;
+    if (ok)
+    {
+        device->step++;
+        device->attempts = 0;
+        if (device->step == STEP_DONE)
+        {
+            device_finish(device, true, NULL);
+        }
+    }
+    else if (device->attempts >= ZB_COMMISSION_MAX_ATTEMPTS)
+    {
+        device_finish(device, false, reason);
+    }
+    else
+    {
+        uint32_t backoff_ms = ZB_COMMISSION_BACKOFF_BASE_MS << (device->attempts - 1);
+        /* Spread out devices that failed together. */
+        backoff_ms = backoff_ms - backoff_ms / 4 + esp_random() % (backoff_ms / 2 + 1);
+        device->ready_us = esp_timer_get_time() + (int64_t)backoff_ms * 1000;
+        esp_zb_scheduler_alarm(commission_pump_cb, 0, backoff_ms);
+        device->retries++;
+        s_batch_retries++;
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.retries++;
+        taskEXIT_CRITICAL(&s_lock);
+        ESP_LOGI(TAG, "COMMISSION short=0x%04hx retry step=%d attempt=%u backoff_ms=%" PRIu32 " reason=%s", device->short_addr,
+                 device->step, device->attempts + 1, backoff_ms, reason);
+    }
+    commission_pump();
+}
+
+/*--------------------------------------------------------------
+ * device_abort()
+ *------------------------------------------------------------*/
+
+/* A request was answered, but there is no point in going on. */
+static void device_abort(device_t *device, const char *reason)
+{
+    device->in_flight = false;
+    s_in_flight--;
+    device_finish(device, false, reason);
+    commission_pump();
+}
+
+/*--------------------------------------------------------------
+ * find_cb()
+ *------------------------------------------------------------*/
+
+static void find_cb(esp_zb_zdp_status_t zdo_status, uint16_t addr, uint8_t endpoint, void *user_ctx)
+{
+    device_t *device = device_from_ctx(user_ctx);
+    if (zdo_status != ESP_ZB_ZDP_STATUS_SUCCESS)
+    {
+        device_step_done(device, false, zdo_status == ESP_ZB_ZDP_STATUS_TIMEOUT ? "timeout" : "find");
+        return;
+    }
+
+    ESP_LOGI(TAG, "Found light");
+    /* Normally added on its device announcement already. */
+    uint16_t id = follower_registry_find_by_ieee(device->ieee_addr);
+    if (id == FOLLOWER_ID_INVALID && follower_registry_add(device->ieee_addr, addr, &id) != ESP_OK)
+    {
+        device_abort(device, "registry_full");
+        return;
+    }
+    device->id = id;
+    device->endpoint = endpoint;
+    /* It may have left, and been removed, since it was announced. */
+    if (follower_registry_set_endpoint(id, endpoint, FOLLOWER_CLUSTER_ON_OFF | FOLLOWER_CLUSTER_LED_EFFECTS) != ESP_OK)
+    {
+        device_abort(device, "gone");
+        return;
+    }
+    s_found_cb(id);
+    device_step_done(device, true, NULL);
+}
+
+/*--------------------------------------------------------------
+ * bind_cb()
+ *------------------------------------------------------------*/
+
+static void bind_cb(esp_zb_zdp_status_t zdo_status, void *user_ctx)
+{
+    device_t *device = device_from_ctx(user_ctx);
+    if (zdo_status != ESP_ZB_ZDP_STATUS_SUCCESS)
+    {
+        device_step_done(device, false, zdo_status == ESP_ZB_ZDP_STATUS_TIMEOUT ? "timeout" : "bind");
+        return;
+    }
+
+    /* As in find_cb(), the follower may be gone by now. */
+    esp_err_t err = ESP_OK;
+    switch (device->step)
+    {
+    case STEP_BIND_ON_OFF:
+        ESP_LOGI(TAG, "Bound On/Off of follower %u", device->id);
+        err = follower_registry_set_bound(device->id, FOLLOWER_CLUSTER_ON_OFF);
+        break;
+    case STEP_BIND_LED_EFFECTS:
+        ESP_LOGI(TAG, "Bound LED effects of follower %u", device->id);
+        err = follower_registry_set_bound(device->id, FOLLOWER_CLUSTER_LED_EFFECTS);
+        break;
+    case STEP_REPORT_ON_OFF:
+        err = follower_registry_set_reporting(device->id, FOLLOWER_CLUSTER_ON_OFF);
+        if (err == ESP_OK)
+        {
+            s_reporting_cb(device->id, FOLLOWER_CLUSTER_ON_OFF);
+        }
+        break;
+    case STEP_REPORT_LED_EFFECTS:
+        err = follower_registry_set_reporting(device->id, FOLLOWER_CLUSTER_LED_EFFECTS);
+        if (err == ESP_OK)
+        {
+            s_reporting_cb(device->id, FOLLOWER_CLUSTER_LED_EFFECTS);
+        }
+        break;
+    default:
+        break;
+    }
+    if (err != ESP_OK)
+    {
+        device_abort(device, "gone");
+        return;
+    }
+    device_step_done(device, true, NULL);
+}
+
+/*--------------------------------------------------------------
+ * device_request()
+ *------------------------------------------------------------*/
+
+/* Send the request of the device's current step. */
+static void device_request(device_t *device)
+{
+    device->in_flight = true;
+    device->attempts++;
+    s_in_flight++;
+
+    if (device->step == STEP_FIND)
+    {
+        esp_zb_zdo_match_desc_req_param_t find_req;
+        find_req.dst_nwk_addr = device->short_addr;
+        find_req.addr_of_interest = device->short_addr;
+        esp_zb_zdo_find_on_off_light(&find_req, find_cb, device_ctx(device));
+        return;
+    }
+
+    esp_zb_zdo_bind_req_param_t bind_req;
+    bool on_off = device->step == STEP_BIND_ON_OFF || device->step == STEP_REPORT_ON_OFF;
+    bind_req.cluster_id = on_off ? ESP_ZB_ZCL_CLUSTER_ID_ON_OFF : s_effects_cluster_id;
+    bind_req.dst_addr_mode = ESP_ZB_ZDO_BIND_DST_ADDR_MODE_64_BIT_EXTENDED;
+    if (device->step == STEP_BIND_ON_OFF || device->step == STEP_BIND_LED_EFFECTS)
+    {
+        /* The LED effects cluster lives on the same endpoint. */
+        esp_zb_get_long_address(bind_req.src_address);
+        bind_req.src_endp = s_endpoint;
+        memcpy(bind_req.dst_address_u.addr_long, device->ieee_addr, sizeof(esp_zb_ieee_addr_t));
+        bind_req.dst_endp = device->endpoint;
+        bind_req.req_dst_addr = esp_zb_get_short_address();
+    }
+    else
+    {
+        /* This request goes to the light. */
+        memcpy(bind_req.src_address, device->ieee_addr, sizeof(esp_zb_ieee_addr_t));
+        bind_req.src_endp = device->endpoint;
+        esp_zb_get_long_address(bind_req.dst_address_u.addr_long);
+        bind_req.dst_endp = s_endpoint;
+        bind_req.req_dst_addr = device->short_addr;
+    }
+    esp_zb_zdo_device_bind_req(&bind_req, bind_cb, device_ctx(device));
+}
+
+/*--------------------------------------------------------------
+ * commission_pump()
+ *------------------------------------------------------------*/
+
+/* Send requests, oldest device first, until the limit is reached or
+ * no device is ready. */
+static void commission_pump(void)
+{
+    int64_t now_us = esp_timer_get_time();
+    while (s_in_flight < s_concurrency)
+    {
+        device_t *next = NULL;
+        for (uint32_t i = 0; i < ZB_COMMISSION_QUEUE_SIZE; i++)
+        {
+            device_t *device = &s_devices[i];
+            if (device->used && !device->in_flight && device->ready_us <= now_us &&
+                (!next || device->enqueued_us < next->enqueued_us))
+            {
+                next = device;
+            }
+        }
+        if (!next)
+        {
+            break;
+        }
+        device_request(next);
+    }
+    stats_publish();
+}
+
+/*--------------------------------------------------------------
+ * commission_pump_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, once a backoff is over. */
+static void commission_pump_cb(uint8_t param)
+{
+    commission_pump();
+}
+
+/*--------------------------------------------------------------
+ * zb_commission_init()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_commission_init(uint8_t endpoint, uint16_t effects_cluster_id, zb_commission_found_cb_t found_cb,
+                             zb_commission_reporting_cb_t reporting_cb)
+{
+    ESP_RETURN_ON_FALSE(found_cb && reporting_cb, ESP_ERR_INVALID_ARG, TAG, "Missing callback");
+    s_endpoint = endpoint;
+    s_effects_cluster_id = effects_cluster_id;
+    s_found_cb = found_cb;
+    s_reporting_cb = reporting_cb;
+    stats_publish();
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_commission_enqueue()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_commission_enqueue(const esp_zb_ieee_addr_t ieee_addr, uint16_t short_addr)
+{
+    device_t *free_slot = NULL;
+    for (uint32_t i = 0; i < ZB_COMMISSION_QUEUE_SIZE; i++)
+    {
+        device_t *device = &s_devices[i];
+        if (device->used && memcmp(device->ieee_addr, ieee_addr, sizeof(esp_zb_ieee_addr_t)) == 0)
+        {
+            device->short_addr = short_addr;
+            return ESP_OK;
+        }
+        if (!free_slot && !device->used)
+        {
+            free_slot = device;
+        }
+    }
+    if (!free_slot)
+    {
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.refused++;
+        taskEXIT_CRITICAL(&s_lock);
+    }
+    ESP_RETURN_ON_FALSE(free_slot, ESP_ERR_NO_MEM, TAG, "COMMISSION short=0x%04hx queue_full", short_addr);
+
+    int64_t now_us = esp_timer_get_time();
+    if (queued_count() == 0)
+    {
+        s_batch_start_us = now_us;
+        s_batch_devices = 0;
+        s_batch_commissioned = 0;
+        s_batch_failed = 0;
+        s_batch_retries = 0;
+    }
+    s_batch_devices++;
+    *free_slot = (device_t){
+        .used = true,
+        .step = STEP_FIND,
+        .id = FOLLOWER_ID_INVALID,
+        .short_addr = short_addr,
+        .enqueued_us = now_us,
+        .ready_us = now_us,
+    };
+    memcpy(free_slot->ieee_addr, ieee_addr, sizeof(esp_zb_ieee_addr_t));
+    commission_pump();
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_commission_set_concurrency()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_commission_set_concurrency(uint8_t concurrency)
+{
+    ESP_RETURN_ON_FALSE(concurrency >= 1 && concurrency <= ZB_COMMISSION_MAX_CONCURRENCY, ESP_ERR_INVALID_ARG, TAG,
+                        "Concurrency must be 1 to %d", ZB_COMMISSION_MAX_CONCURRENCY);
+    s_concurrency = concurrency;
+    ESP_LOGI(TAG, "Up to %u ZDO requests at once", concurrency);
+    commission_pump();
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_commission_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_commission_get_stats(zb_commission_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,415 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Delivery tracking with retries. See zb_delivery.h.
+ *
+ * Notes:
+ *     - Apart from the request ID counter, everything here is used
+ *       by the Zigbee task, or by the dispatcher with the Zigbee lock
+ *       held, so it has no lock of its own.
+ *     - A command is matched by TSN, and by address when it went to
+ *       one follower. A retry gets a new TSN, so a late answer to an
+ *       earlier try is ignored.
+ *     - The alarms of a slot take its index as their parameter, which
+ *       is what lets them be cancelled one slot at a time. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "follower_registry.h"
+#include "zb_delivery.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef enum
+{
+    PENDING_FREE = 0,
+    /* In the command queue, first try or retry. */
+    PENDING_QUEUED,
+    /* Waiting for the send status. */
+    PENDING_SENT,
+    /* Acknowledged, waiting for the default response. */
+    PENDING_ACKED,
+    /* Waiting to be sent again. */
+    PENDING_BACKOFF,
+} pending_state_t;
+
+typedef struct
+{
+    pending_state_t state;
+    uint8_t tsn;
+    uint8_t attempts;
+    /* When the first try was enqueued. */
+    int64_t first_us;
+    zb_command_t command;
+} pending_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_DELIVERY";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+/* Guarded by s_lock, request IDs are taken by any task. */
+static uint16_t s_next_request_id;
+
+static zb_delivery_finished_cb_t s_finished = NULL;
+static pending_t s_pending[ZB_DELIVERY_MAX_PENDING];
+static zb_delivery_stats_t s_stats;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+static void delivery_timeout_cb(uint8_t param);
+static void delivery_retry_cb(uint8_t param);
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * expects_response()
+ *------------------------------------------------------------*/
+
+/* Commands to one follower that have no response of their own are
+ * answered with a default response. */
+static bool expects_response(const zb_command_t *command)
+{
+    if (command->dst.mode != ZB_COMMAND_DST_SHORT)
+    {
+        return false;
+    }
+    switch (command->type)
+    {
+    case ZB_COMMAND_ON_OFF_TOGGLE:
+    case ZB_COMMAND_ON_OFF_SET:
+    case ZB_COMMAND_LED_EFFECT:
+    case ZB_COMMAND_SCENE_RECALL:
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*--------------------------------------------------------------
+ * elapsed_ms()
+ *------------------------------------------------------------*/
+
+static uint32_t elapsed_ms(const pending_t *pending)
+{
+    return (uint32_t)((esp_timer_get_time() - pending->first_us) / 1000);
+}
+
+/*--------------------------------------------------------------
+ * find_by_tsn()
+ *------------------------------------------------------------*/
+
+/* A sent command with this TSN, to this follower if it went to one. */
+static pending_t *find_by_tsn(uint8_t tsn, bool short_addr_known, uint16_t short_addr)
+{
+    for (uint32_t i = 0; i < ZB_DELIVERY_MAX_PENDING; i++)
+    {
+        pending_t *pending = &s_pending[i];
+        if ((pending->state != PENDING_SENT && pending->state != PENDING_ACKED) || pending->tsn != tsn)
+        {
+            continue;
+        }
+        if (short_addr_known && pending->command.dst.mode == ZB_COMMAND_DST_SHORT && pending->command.dst.short_addr != short_addr)
+        {
+            continue;
+        }
+        return pending;
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------
+ * delivery_finish()
+ *------------------------------------------------------------*/
+
+/* Log the outcome, pass it on and free the slot. */
+static void delivery_finish(pending_t *pending, bool ok, const char *reason)
+{
+    uint8_t index = (uint8_t)(pending - s_pending);
+    esp_zb_scheduler_alarm_cancel(delivery_timeout_cb, index);
+    esp_zb_scheduler_alarm_cancel(delivery_retry_cb, index);
+    if (ok)
+    {
+        ESP_LOGI(TAG, "DELIVERY req=%u ok attempts=%u ms=%" PRIu32, pending->command.request_id, pending->attempts, elapsed_ms(pending));
+    }
+    else
+    {
+        ESP_LOGW(TAG, "DELIVERY req=%u failed attempts=%u ms=%" PRIu32 " reason=%s", pending->command.request_id, pending->attempts,
+                 elapsed_ms(pending), reason);
+    }
+    pending->state = PENDING_FREE;
+    s_stats.pending--;
+    s_stats.finished++;
+    s_stats.failed += !ok;
+    s_stats.last_finish_us = esp_timer_get_time();
+    s_finished(&pending->command, ok, pending->attempts);
+}
+
+/*--------------------------------------------------------------
+ * delivery_retry()
+ *------------------------------------------------------------*/
+
+/* Send again after a backoff, or give up. */
+static void delivery_retry(pending_t *pending, const char *reason)
+{
+    s_stats.lost++;
+    if (pending->command.type == ZB_COMMAND_ON_OFF_TOGGLE || pending->attempts >= ZB_DELIVERY_MAX_ATTEMPTS)
+    {
+        delivery_finish(pending, false, reason);
+        return;
+    }
+
+    uint32_t backoff_ms = ZB_DELIVERY_BACKOFF_BASE_MS << (pending->attempts - 1);
+    if (backoff_ms > ZB_DELIVERY_BACKOFF_MAX_MS)
+    {
+        backoff_ms = ZB_DELIVERY_BACKOFF_MAX_MS;
+    }
+    backoff_ms = backoff_ms - backoff_ms / 4 + esp_random() % (backoff_ms / 2 + 1);
+
+    uint8_t index = (uint8_t)(pending - s_pending);
+    esp_zb_scheduler_alarm_cancel(delivery_timeout_cb, index);
+    pending->state = PENDING_BACKOFF;
+    esp_zb_scheduler_alarm(delivery_retry_cb, index, backoff_ms);
+    ESP_LOGI(TAG, "DELIVERY req=%u retry attempt=%u backoff_ms=%" PRIu32 " reason=%s", pending->command.request_id,
+             pending->attempts + 1, backoff_ms, reason);
+}
+
+/*--------------------------------------------------------------
+ * delivery_timeout_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task. */
+static void delivery_timeout_cb(uint8_t param)
+{
+    pending_t *pending = &s_pending[param];
+    if (pending->state == PENDING_SENT)
+    {
+        delivery_retry(pending, "timeout");
+    }
+    else if (pending->state == PENDING_ACKED)
+    {
+        /* Acknowledged, only the default response is missing. */
+        delivery_finish(pending, true, NULL);
+    }
+}
+
+/*--------------------------------------------------------------
+ * delivery_retry_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task. */
+static void delivery_retry_cb(uint8_t param)
+{
+    pending_t *pending = &s_pending[param];
+    if (pending->state != PENDING_BACKOFF)
+    {
+        return;
+    }
+    if (zb_command_queue_send(&pending->command) != ESP_OK)
+    {
+        delivery_finish(pending, false, "queue_full");
+        return;
+    }
+    pending->state = PENDING_QUEUED;
+    s_stats.retries++;
+    if (pending->command.dst.mode == ZB_COMMAND_DST_SHORT)
+    {
+        follower_registry_count_retry(pending->command.dst.short_addr);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_delivery_init()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_delivery_init(zb_delivery_finished_cb_t finished)
+{
+    ESP_RETURN_ON_FALSE(finished, ESP_ERR_INVALID_ARG, TAG, "No finished callback");
+    s_finished = finished;
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_delivery_send()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_delivery_send(zb_command_t *command)
+{
+    taskENTER_CRITICAL(&s_lock);
+    /* 0 means untracked. */
+    if (++s_next_request_id == 0)
+    {
+        s_next_request_id = 1;
+    }
+    command->request_id = s_next_request_id;
+    taskEXIT_CRITICAL(&s_lock);
+
+    esp_err_t err = zb_command_queue_send(command);
+    if (err != ESP_OK)
+    {
+        ESP_LOGW(TAG, "DELIVERY req=%u failed attempts=0 ms=0 reason=queue_full", command->request_id);
+        return err;
+    }
+    ESP_LOGI(TAG, "DELIVERY req=%u queued", command->request_id);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_delivery_sent()
+ *------------------------------------------------------------*/
+
+void zb_delivery_sent(const zb_command_t *command, uint8_t tsn)
+{
+    if (command->request_id == 0)
+    {
+        return;
+    }
+
+    /* A retry, or the first try. */
+    pending_t *pending = NULL;
+    pending_t *free_slot = NULL;
+    for (uint32_t i = 0; i < ZB_DELIVERY_MAX_PENDING; i++)
+    {
+        if (s_pending[i].state == PENDING_QUEUED && s_pending[i].command.request_id == command->request_id)
+        {
+            pending = &s_pending[i];
+            break;
+        }
+        if (!free_slot && s_pending[i].state == PENDING_FREE)
+        {
+            free_slot = &s_pending[i];
+        }
+    }
+    if (!pending)
+    {
+        if (!free_slot)
+        {
+            ESP_LOGW(TAG, "DELIVERY req=%u untracked", command->request_id);
+            s_stats.untracked++;
+            s_finished(command, false, 1);
+            return;
+        }
+        pending = free_slot;
+        if (++s_stats.pending > s_stats.max_pending)
+        {
+            s_stats.max_pending = s_stats.pending;
+        }
+        pending->command = *command;
+        pending->attempts = 0;
+        pending->first_us = command->enqueued_us;
+    }
+
+    pending->state = PENDING_SENT;
+    pending->tsn = tsn;
+    pending->attempts++;
+    s_stats.attempts++;
+    esp_zb_scheduler_alarm(delivery_timeout_cb, (uint8_t)(pending - s_pending), ZB_DELIVERY_STATUS_TIMEOUT_MS);
+}
+
+/*--------------------------------------------------------------
+ * zb_delivery_send_status()
+ *------------------------------------------------------------*/
+
+void zb_delivery_send_status(const esp_zb_zcl_command_send_status_message_t *message)
+{
+    bool short_addr_known = message->dst_addr.addr_type == ESP_ZB_ZCL_ADDR_TYPE_SHORT;
+    pending_t *pending = find_by_tsn(message->tsn, short_addr_known, message->dst_addr.u.short_addr);
+    if (!pending || pending->state != PENDING_SENT)
+    {
+        return;
+    }
+    if (message->status != ESP_OK)
+    {
+        delivery_retry(pending, "send");
+        return;
+    }
+    if (!expects_response(&pending->command))
+    {
+        delivery_finish(pending, true, NULL);
+        return;
+    }
+    uint8_t index = (uint8_t)(pending - s_pending);
+    esp_zb_scheduler_alarm_cancel(delivery_timeout_cb, index);
+    pending->state = PENDING_ACKED;
+    esp_zb_scheduler_alarm(delivery_timeout_cb, index, ZB_DELIVERY_RESPONSE_TIMEOUT_MS);
+}
+
+/*--------------------------------------------------------------
+ * zb_delivery_default_response()
+ *------------------------------------------------------------*/
+
+void zb_delivery_default_response(const esp_zb_zcl_cmd_default_resp_message_t *message)
+{
+    if (!message || message->info.src_address.addr_type != ESP_ZB_ZCL_ADDR_TYPE_SHORT)
+    {
+        return;
+    }
+    pending_t *pending = find_by_tsn(message->info.header.tsn, true, message->info.src_address.u.short_addr);
+    if (!pending || !expects_response(&pending->command))
+    {
+        return;
+    }
+    if (message->status_code == ESP_ZB_ZCL_STATUS_SUCCESS)
+    {
+        delivery_finish(pending, true, NULL);
+        return;
+    }
+    /* The follower got it and said no, sending it again would not
+     * change that. */
+    char reason[sizeof("status_0x00")];
+    snprintf(reason, sizeof(reason), "status_0x%02x", message->status_code);
+    delivery_finish(pending, false, reason);
+}
+
+/*--------------------------------------------------------------
+ * zb_delivery_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_delivery_get_stats(zb_delivery_stats_t *stats)
+{
+    *stats = s_stats;
+}
@@ -0,0 +1,214 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Fan-out spread over a window. See zb_fanout.h.
+ *
+ * Notes:
+ *     - Everything here is used by the Zigbee task, or with the
+ *       Zigbee lock held, except zb_fanout_get_stats(), so only the
+ *       stats have a lock.
+ *     - The alarm of a scheduled command takes its slot in the table
+ *       as its parameter.
+ *     - The slot adapts when a fan-out is sent, to the loss rate
+ *       since the last time, which includes commands that were not
+ *       fanned out. It is the same channel they are lost on. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdbool.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_random.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_delivery.h"
+#include "zb_fanout.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool in_use;
+    zb_command_t command;
+} scheduled_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_FANOUT";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static scheduled_t s_scheduled[ZB_FANOUT_MAX_COMMANDS];
+/* Written with s_lock held, read without it where only the Zigbee
+ * task writes. */
+static zb_fanout_stats_t s_stats = {
+    .slot_ms = ZB_FANOUT_SLOT_MS,
+    .adaptive = true,
+};
+/* Delivery counters at the last adaptation. */
+static uint32_t s_last_attempts;
+static uint32_t s_last_lost;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * fanout_adapt()
+ *------------------------------------------------------------*/
+
+/* Widen the slot while tries are lost, narrow it while they are
+ * not. */
+static void fanout_adapt(void)
+{
+    zb_delivery_stats_t delivery;
+    zb_delivery_get_stats(&delivery);
+    uint32_t attempts = delivery.attempts - s_last_attempts;
+    if (attempts < ZB_FANOUT_MIN_SAMPLES)
+    {
+        return;
+    }
+    uint32_t lost = delivery.lost - s_last_lost;
+    s_last_attempts = delivery.attempts;
+    s_last_lost = delivery.lost;
+    uint8_t loss_pct = (uint8_t)(lost >= attempts ? 100 : lost * 100 / attempts);
+
+    uint16_t slot_ms = s_stats.slot_ms;
+    if (s_stats.adaptive && loss_pct > ZB_FANOUT_LOSS_HIGH_PCT)
+    {
+        slot_ms = slot_ms * 2 > ZB_FANOUT_MAX_SLOT_MS ? ZB_FANOUT_MAX_SLOT_MS : slot_ms * 2;
+    }
+    else if (s_stats.adaptive && loss_pct < ZB_FANOUT_LOSS_LOW_PCT)
+    {
+        slot_ms -= slot_ms / 4 > 0 ? slot_ms / 4 : 1;
+        slot_ms = slot_ms < ZB_FANOUT_MIN_SLOT_MS ? ZB_FANOUT_MIN_SLOT_MS : slot_ms;
+    }
+    if (slot_ms != s_stats.slot_ms)
+    {
+        ESP_LOGI(TAG, "FANOUT_SLOT slot_ms=%u loss_pct=%u", slot_ms, loss_pct);
+    }
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.loss_pct = loss_pct;
+    s_stats.slot_ms = slot_ms;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * fanout_send_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, when a command's time comes. */
+static void fanout_send_cb(uint8_t param)
+{
+    scheduled_t *scheduled = &s_scheduled[param];
+    if (!scheduled->in_use)
+    {
+        return;
+    }
+    bool dropped = zb_delivery_send(&scheduled->command) != ESP_OK;
+    scheduled->in_use = false;
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.dropped += dropped;
+    s_stats.scheduled--;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_fanout_send()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_fanout_send(const zb_command_t *commands, uint32_t count)
+{
+    ESP_RETURN_ON_FALSE(commands && count > 0, ESP_ERR_INVALID_ARG, TAG, "Nothing to send");
+    ESP_RETURN_ON_FALSE(count <= (uint32_t)(ZB_FANOUT_MAX_COMMANDS - s_stats.scheduled), ESP_ERR_NO_MEM, TAG,
+                        "No room for %" PRIu32 " commands, %u scheduled", count, s_stats.scheduled);
+
+    fanout_adapt();
+    uint32_t slot_ms = s_stats.slot_ms;
+    uint32_t index = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        while (s_scheduled[index].in_use)
+        {
+            index++;
+        }
+        s_scheduled[index].in_use = true;
+        s_scheduled[index].command = commands[i];
+        /* Somewhere in the middle half of its slot. */
+        uint32_t delay_ms = i * slot_ms + slot_ms / 4 + esp_random() % (slot_ms / 2 + 1);
+        esp_zb_scheduler_alarm(fanout_send_cb, (uint8_t)index, delay_ms);
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.scheduled += count;
+    if (s_stats.scheduled > s_stats.max_scheduled)
+    {
+        s_stats.max_scheduled = s_stats.scheduled;
+    }
+    s_stats.fanouts++;
+    s_stats.commands += count;
+    taskEXIT_CRITICAL(&s_lock);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_fanout_set_slot()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_fanout_set_slot(uint16_t slot_ms)
+{
+    ESP_RETURN_ON_FALSE(slot_ms <= ZB_FANOUT_MAX_SLOT_MS, ESP_ERR_INVALID_ARG, TAG, "Slot of %u ms, at most %d", slot_ms,
+                        ZB_FANOUT_MAX_SLOT_MS);
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.adaptive = slot_ms == 0;
+    if (slot_ms != 0)
+    {
+        s_stats.slot_ms = slot_ms;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Fan-out slot %u ms%s.", s_stats.slot_ms, s_stats.adaptive ? ", adaptive" : "");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_fanout_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_fanout_get_stats(zb_fanout_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
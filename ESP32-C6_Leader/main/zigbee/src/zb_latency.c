@@ -0,0 +1,223 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: End-to-end latency. See zb_latency.h.
+ *
+ * Notes:
+ *     - The samples are only touched by whoever runs the
+ *       measurement, so they have no lock. The last report is
+ *       written by the Zigbee task and has one.
+ *     - The two clocks are never compared. Each side only reports
+ *       differences of its own timestamps. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_bulk.h"
+#include "zb_latency.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_LATENCY";
+
+/* As logged, for the GUI. */
+static const char *STAGE_NAMES[ZB_LATENCY_STAGE_COUNT] = {
+    [ZB_LATENCY_UART_TO_SUBMIT] = "uart_to_submit",
+    [ZB_LATENCY_SUBMIT_TO_CONFIRM] = "submit_to_confirm",
+    [ZB_LATENCY_RECEIVE_TO_LED] = "receive_to_led",
+    [ZB_LATENCY_END_TO_END] = "end_to_end",
+    [ZB_LATENCY_ROUND_TRIP] = "round_trip",
+};
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* A ring of the latest samples per stage. */
+static uint32_t s_samples[ZB_LATENCY_STAGE_COUNT][ZB_LATENCY_MAX_SAMPLES];
+static uint32_t s_counts[ZB_LATENCY_STAGE_COUNT];
+
+/* Guards the last report. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t s_report_receive_to_led_us;
+static int64_t s_report_received_us;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * compare_u32()
+ *------------------------------------------------------------*/
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------
+ * zb_latency_set_mode()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_latency_set_mode(uint16_t short_addr, bool enabled)
+{
+    uint8_t frame[] = {ZB_LATENCY_FRAME_MODE, enabled};
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = short_addr,
+        .dst_endpoint = ZB_BULK_ENDPOINT,
+        .profile_id = ZB_BULK_PROFILE_ID,
+        .cluster_id = ZB_LATENCY_CLUSTER_ID,
+        .src_endpoint = ZB_BULK_ENDPOINT,
+        .asdu_length = sizeof(frame),
+        .asdu = frame,
+        /* Unlike a report, losing this one spoils the whole run. */
+        .tx_options = ESP_ZB_APSDE_TX_OPT_ACK_TX,
+    };
+    ESP_RETURN_ON_ERROR(esp_zb_aps_data_request(&req), TAG, "Failed to send latency mode");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_latency_handle_indication()
+ *------------------------------------------------------------*/
+
+bool zb_latency_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != ZB_BULK_PROFILE_ID || ind->cluster_id != ZB_LATENCY_CLUSTER_ID || ind->dst_endpoint != ZB_BULK_ENDPOINT)
+    {
+        return false;
+    }
+    const uint8_t *frame = ind->asdu;
+    if (ind->asdu_length < ZB_LATENCY_REPORT_SIZE || frame[0] != ZB_LATENCY_FRAME_REPORT)
+    {
+        return true;
+    }
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    s_report_receive_to_led_us = frame[1] | (frame[2] << 8) | (frame[3] << 16) | ((uint32_t)frame[4] << 24);
+    s_report_received_us = now_us;
+    taskEXIT_CRITICAL(&s_lock);
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * zb_latency_get_report()
+ *------------------------------------------------------------*/
+
+void zb_latency_get_report(uint32_t *receive_to_led_us, int64_t *received_us)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *receive_to_led_us = s_report_receive_to_led_us;
+    *received_us = s_report_received_us;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_latency_reset()
+ *------------------------------------------------------------*/
+
+void zb_latency_reset(void)
+{
+    memset(s_counts, 0, sizeof(s_counts));
+}
+
+/*--------------------------------------------------------------
+ * zb_latency_add()
+ *------------------------------------------------------------*/
+
+void zb_latency_add(zb_latency_stage_t stage, uint32_t latency_us)
+{
+    s_samples[stage][s_counts[stage] % ZB_LATENCY_MAX_SAMPLES] = latency_us;
+    s_counts[stage]++;
+}
+
+/*--------------------------------------------------------------
+ * zb_latency_summarize()
+ *------------------------------------------------------------*/
+
+void zb_latency_summarize(zb_latency_stage_t stage, zb_latency_summary_t *summary)
+{
+    static uint32_t sorted[ZB_LATENCY_MAX_SAMPLES];
+    uint32_t count = s_counts[stage] < ZB_LATENCY_MAX_SAMPLES ? s_counts[stage] : ZB_LATENCY_MAX_SAMPLES;
+
+    memset(summary, 0, sizeof(*summary));
+    summary->count = count;
+    if (count == 0)
+    {
+        return;
+    }
+    memcpy(sorted, s_samples[stage], count * sizeof(sorted[0]));
+    qsort(sorted, count, sizeof(sorted[0]), compare_u32);
+    summary->p50_us = sorted[(count - 1) * 50 / 100];
+    summary->p95_us = sorted[(count - 1) * 95 / 100];
+    summary->p99_us = sorted[(count - 1) * 99 / 100];
+    summary->max_us = sorted[count - 1];
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int bucket = 0;
+        while (bucket < ZB_LATENCY_BUCKETS - 1 && sorted[i] >= (1000U << bucket))
+        {
+            bucket++;
+        }
+        summary->buckets[bucket]++;
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_latency_log()
+ *------------------------------------------------------------*/
+
+void zb_latency_log(void)
+{
+    for (int stage = 0; stage < ZB_LATENCY_STAGE_COUNT; stage++)
+    {
+        zb_latency_summary_t summary;
+        zb_latency_summarize(stage, &summary);
+
+        char histogram[ZB_LATENCY_BUCKETS * 4 + 1];
+        int length = 0;
+        for (int i = 0; i < ZB_LATENCY_BUCKETS; i++)
+        {
+            length += snprintf(&histogram[length], sizeof(histogram) - length, "%s%" PRIu32, i ? "," : "", summary.buckets[i]);
+        }
+        ESP_LOGI(TAG, "LATENCY %s n=%" PRIu32 " p50=%" PRIu32 " p95=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32 " hist=%s",
+                 STAGE_NAMES[stage], summary.count, summary.p50_us, summary.p95_us, summary.p99_us, summary.max_us, histogram);
+    }
+}
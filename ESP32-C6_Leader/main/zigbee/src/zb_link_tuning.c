@@ -0,0 +1,435 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Background frame tuning. See zb_link_tuning.h.
+ *
+ * Notes:
+ *     - Everything here is used by the Zigbee task, or with the
+ *       Zigbee lock held, except zb_link_tuning_get_stats(), so only
+ *       the stats have a lock.
+ *     - The LQI change is taken per neighbour between two samples in
+ *       a row, so one that comes and goes does not count as a
+ *       change.
+ *     - What each follower applied is kept by follower ID. Until it
+ *       answers, it is counted at the default, which it boots with
+ *       the first time, but told the keep-alive all the same, since
+ *       it may have kept another from before a leader reboot. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdlib.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_log.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "follower_registry.h"
+#include "zb_bulk.h"
+#include "zb_command_queue.h"
+#include "zb_link_tuning.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool in_use;
+    uint16_t short_addr;
+    uint8_t lqi;
+    /* In the last sample. */
+    bool seen;
+} neighbour_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_LINK_TUNING";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+/* Written with s_lock held, read without it in the Zigbee task,
+ * which is the only writer. */
+static zb_link_tuning_stats_t s_stats = {
+    .enabled = true,
+    .keep_alive_ms = ZB_LINK_TUNING_KEEP_ALIVE_DEFAULT_MS,
+};
+
+/* The stack's own link status period, read at start. */
+static uint8_t s_default_link_status_s;
+static uint32_t s_sample;
+
+/* This decision's samples. */
+static neighbour_t s_neighbours[ZB_LINK_TUNING_MAX_NEIGHBOURS];
+static uint32_t s_lqi_delta_sum;
+static uint32_t s_lqi_delta_count;
+static uint16_t s_routers;
+static uint32_t s_sent_before;
+
+/* By follower ID. The keep-alive it applied, 0 for unknown, and the
+ * sample it was last told one at, plus one, 0 for never. */
+static uint32_t s_applied_ms[FOLLOWER_REGISTRY_CAPACITY];
+static uint32_t s_told_sample[FOLLOWER_REGISTRY_CAPACITY];
+static uint16_t s_update_cursor;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+static void link_tuning_sample_cb(uint8_t param);
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * applied_ms()
+ *------------------------------------------------------------*/
+
+static uint32_t applied_ms(uint16_t id)
+{
+    return s_applied_ms[id] != 0 ? s_applied_ms[id] : ZB_LINK_TUNING_KEEP_ALIVE_DEFAULT_MS;
+}
+
+/*--------------------------------------------------------------
+ * per_min_x10()
+ *------------------------------------------------------------*/
+
+/* Frames a minute, in tenths, of one sent every `period_ms`, none
+ * before the period is known. */
+static uint32_t per_min_x10(uint32_t period_ms)
+{
+    return period_ms != 0 ? (600000 + period_ms / 2) / period_ms : 0;
+}
+
+/*--------------------------------------------------------------
+ * link_tuning_refresh()
+ *------------------------------------------------------------*/
+
+/* Count the followers and work out the background frames a minute,
+ * with the defaults, now, and once every follower applies
+ * `keep_alive_ms`. Returns the last. */
+static uint32_t link_tuning_refresh(uint32_t keep_alive_ms)
+{
+    uint16_t followers = 0;
+    uint16_t applied = 0;
+    uint32_t now_x10 = 0;
+    for (uint16_t id = 0; id < FOLLOWER_REGISTRY_CAPACITY; id++)
+    {
+        follower_t follower;
+        if (follower_registry_get(id, &follower) != ESP_OK || follower.endpoint == 0)
+        {
+            continue;
+        }
+        followers++;
+        applied += s_applied_ms[id] == s_stats.keep_alive_ms;
+        now_x10 += per_min_x10(applied_ms(id));
+    }
+    uint32_t link_status_x10 = per_min_x10(s_stats.link_status_s * 1000);
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.followers = followers;
+    s_stats.followers_applied = applied;
+    s_stats.default_background_per_min =
+        (per_min_x10(s_default_link_status_s * 1000) + followers * per_min_x10(ZB_LINK_TUNING_KEEP_ALIVE_DEFAULT_MS) + 5) / 10;
+    s_stats.background_per_min = (link_status_x10 + now_x10 + 5) / 10;
+    taskEXIT_CRITICAL(&s_lock);
+    return (link_status_x10 + followers * per_min_x10(keep_alive_ms) + 5) / 10;
+}
+
+/*--------------------------------------------------------------
+ * link_tuning_apply()
+ *------------------------------------------------------------*/
+
+/* Set the link status period and the keep-alive the followers are
+ * told, and log it if either changed. */
+static void link_tuning_apply(uint8_t link_status_s, uint32_t keep_alive_ms)
+{
+    if (link_status_s == s_stats.link_status_s && keep_alive_ms == s_stats.keep_alive_ms)
+    {
+        return;
+    }
+    if (link_status_s != s_stats.link_status_s && esp_zb_nwk_set_link_status_period(link_status_s) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to set the link status period to %u s", link_status_s);
+        link_status_s = esp_zb_nwk_get_link_status_period();
+    }
+    uint32_t before = s_stats.background_per_min;
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.link_status_s = link_status_s;
+    s_stats.keep_alive_ms = keep_alive_ms;
+    taskEXIT_CRITICAL(&s_lock);
+    uint32_t after = link_tuning_refresh(keep_alive_ms);
+    ESP_LOGI(TAG, "LINK_TUNING link_status_s=%u keep_alive_ms=%" PRIu32 " routers=%u followers=%u lqi_delta=%u.%u traffic_per_min=%" PRIu32
+                  " background_per_min=%" PRIu32 "->%" PRIu32,
+             link_status_s, keep_alive_ms, s_stats.routers, s_stats.followers, s_stats.lqi_delta_x10 / 10, s_stats.lqi_delta_x10 % 10,
+             s_stats.traffic_per_min, before, after);
+}
+
+/*--------------------------------------------------------------
+ * link_tuning_sample()
+ *------------------------------------------------------------*/
+
+/* Count the routers around and how far each neighbour's LQI moved
+ * since the last sample. */
+static void link_tuning_sample(void)
+{
+    for (uint32_t i = 0; i < ZB_LINK_TUNING_MAX_NEIGHBOURS; i++)
+    {
+        s_neighbours[i].in_use = s_neighbours[i].in_use && s_neighbours[i].seen;
+        s_neighbours[i].seen = false;
+    }
+
+    uint16_t routers = 0;
+    esp_zb_nwk_info_iterator_t iterator = ESP_ZB_NWK_INFO_ITERATOR_INIT;
+    esp_zb_nwk_neighbor_info_t info;
+    while (esp_zb_nwk_get_next_neighbor(&iterator, &info) == ESP_OK)
+    {
+        routers += info.device_type == ESP_ZB_DEVICE_TYPE_ROUTER;
+        neighbour_t *neighbour = NULL;
+        neighbour_t *free_slot = NULL;
+        for (uint32_t i = 0; i < ZB_LINK_TUNING_MAX_NEIGHBOURS && !neighbour; i++)
+        {
+            if (s_neighbours[i].in_use && s_neighbours[i].short_addr == info.short_addr)
+            {
+                neighbour = &s_neighbours[i];
+            }
+            else if (!s_neighbours[i].in_use && !free_slot)
+            {
+                free_slot = &s_neighbours[i];
+            }
+        }
+        if (neighbour)
+        {
+            s_lqi_delta_sum += (uint32_t)abs((int)info.lqi - (int)neighbour->lqi);
+            s_lqi_delta_count++;
+        }
+        else if (free_slot)
+        {
+            /* Its first sample. Past the table's size, neighbours go
+             * unfollowed. */
+            neighbour = free_slot;
+            neighbour->in_use = true;
+            neighbour->short_addr = info.short_addr;
+        }
+        if (neighbour)
+        {
+            neighbour->lqi = info.lqi;
+            neighbour->seen = true;
+        }
+    }
+    s_routers = routers > s_routers ? routers : s_routers;
+}
+
+/*--------------------------------------------------------------
+ * link_tuning_decide()
+ *------------------------------------------------------------*/
+
+/* Pick the link status period and the keep-alive from the last
+ * minute's samples. */
+static void link_tuning_decide(void)
+{
+    zb_command_queue_stats_t queue;
+    zb_command_queue_get_stats(&queue);
+    uint16_t lqi_delta_x10 = (uint16_t)(s_lqi_delta_count ? s_lqi_delta_sum * 10 / s_lqi_delta_count : 0);
+    /* The samples span a minute. */
+    uint32_t traffic_per_min = queue.sent - s_sent_before;
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.routers = s_routers;
+    s_stats.lqi_delta_x10 = lqi_delta_x10;
+    s_stats.traffic_per_min = traffic_per_min;
+    s_stats.decisions++;
+    taskEXIT_CRITICAL(&s_lock);
+    s_sent_before = queue.sent;
+    s_lqi_delta_sum = 0;
+    s_lqi_delta_count = 0;
+    s_routers = 0;
+    link_tuning_refresh(s_stats.keep_alive_ms);
+    if (!s_stats.enabled)
+    {
+        return;
+    }
+
+    bool stable = lqi_delta_x10 <= ZB_LINK_TUNING_STABLE_LQI_DELTA_X10;
+    bool busy = traffic_per_min >= ZB_LINK_TUNING_BUSY_PER_MIN;
+    uint8_t link_status_s = s_default_link_status_s;
+    if (s_stats.routers == 0)
+    {
+        link_status_s = ZB_LINK_TUNING_LINK_STATUS_NO_ROUTERS_S;
+    }
+    else if (stable)
+    {
+        link_status_s = busy ? ZB_LINK_TUNING_LINK_STATUS_BUSY_S : ZB_LINK_TUNING_LINK_STATUS_STABLE_S;
+    }
+    link_status_s = link_status_s < s_default_link_status_s ? s_default_link_status_s : link_status_s;
+
+    uint32_t keep_alive_ms = (uint32_t)s_stats.followers * 60 * 1000 / ZB_LINK_TUNING_KEEP_ALIVE_BUDGET_PER_MIN;
+    keep_alive_ms = stable ? keep_alive_ms : keep_alive_ms / 2;
+    keep_alive_ms = busy ? keep_alive_ms * 2 : keep_alive_ms;
+    keep_alive_ms = keep_alive_ms < ZB_LINK_TUNING_KEEP_ALIVE_DEFAULT_MS ? ZB_LINK_TUNING_KEEP_ALIVE_DEFAULT_MS : keep_alive_ms;
+    keep_alive_ms = keep_alive_ms > ZB_LINK_TUNING_KEEP_ALIVE_MAX_MS ? ZB_LINK_TUNING_KEEP_ALIVE_MAX_MS : keep_alive_ms;
+    link_tuning_apply(link_status_s, keep_alive_ms);
+}
+
+/*--------------------------------------------------------------
+ * link_tuning_update_followers()
+ *------------------------------------------------------------*/
+
+/* Tell a few of the followers not known to use the keep-alive,
+ * taking turns over the registry. */
+static void link_tuning_update_followers(void)
+{
+    uint8_t frame[ZB_LINK_TUNING_FRAME_SIZE] = {
+        ZB_LINK_TUNING_FRAME_KEEP_ALIVE,
+        (uint8_t)(s_stats.keep_alive_ms), (uint8_t)(s_stats.keep_alive_ms >> 8),
+        (uint8_t)(s_stats.keep_alive_ms >> 16), (uint8_t)(s_stats.keep_alive_ms >> 24),
+    };
+    uint32_t sent = 0;
+    for (uint16_t n = 0; n < FOLLOWER_REGISTRY_CAPACITY && sent < ZB_LINK_TUNING_UPDATES_PER_SAMPLE; n++)
+    {
+        uint16_t id = (s_update_cursor + n) % FOLLOWER_REGISTRY_CAPACITY;
+        follower_t follower;
+        if (follower_registry_get(id, &follower) != ESP_OK || follower.endpoint == 0 || s_applied_ms[id] == s_stats.keep_alive_ms ||
+            (s_told_sample[id] != 0 && s_sample + 1 - s_told_sample[id] < ZB_LINK_TUNING_RETRY_SAMPLES))
+        {
+            continue;
+        }
+        esp_zb_apsde_data_req_t req = {
+            .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+            .dst_addr.addr_short = follower.short_addr,
+            .dst_endpoint = ZB_BULK_ENDPOINT,
+            .profile_id = ZB_BULK_PROFILE_ID,
+            .cluster_id = ZB_LINK_TUNING_CLUSTER_ID,
+            .src_endpoint = ZB_BULK_ENDPOINT,
+            .asdu_length = sizeof(frame),
+            .asdu = frame,
+            .tx_options = ESP_ZB_APSDE_TX_OPT_ACK_TX,
+        };
+        if (esp_zb_aps_data_request(&req) != ESP_OK)
+        {
+            /* Out of buffers, the rest wait for the next sample. */
+            break;
+        }
+        s_told_sample[id] = s_sample + 1;
+        s_update_cursor = (id + 1) % FOLLOWER_REGISTRY_CAPACITY;
+        sent++;
+    }
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.updates_sent += sent;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * link_tuning_sample_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, and schedules itself again. */
+static void link_tuning_sample_cb(uint8_t param)
+{
+    link_tuning_sample();
+    if (++s_sample % ZB_LINK_TUNING_SAMPLES == 0)
+    {
+        link_tuning_decide();
+    }
+    link_tuning_update_followers();
+    esp_zb_scheduler_alarm(link_tuning_sample_cb, 0, ZB_LINK_TUNING_SAMPLE_PERIOD_MS);
+}
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_start()
+ *------------------------------------------------------------*/
+
+void zb_link_tuning_start(void)
+{
+    /* Once, a rejoin or second start must not take our own period
+     * for the default. */
+    if (s_default_link_status_s == 0)
+    {
+        s_default_link_status_s = esp_zb_nwk_get_link_status_period();
+        taskENTER_CRITICAL(&s_lock);
+        s_stats.link_status_s = s_default_link_status_s;
+        taskEXIT_CRITICAL(&s_lock);
+        ESP_LOGI(TAG, "Link status every %u s, keep-alive %" PRIu32 " ms to start with", s_default_link_status_s,
+                 s_stats.keep_alive_ms);
+    }
+    zb_command_queue_stats_t queue;
+    zb_command_queue_get_stats(&queue);
+    s_sent_before = queue.sent;
+    esp_zb_scheduler_alarm_cancel(link_tuning_sample_cb, 0);
+    esp_zb_scheduler_alarm(link_tuning_sample_cb, 0, ZB_LINK_TUNING_SAMPLE_PERIOD_MS);
+}
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_set_enabled()
+ *------------------------------------------------------------*/
+
+void zb_link_tuning_set_enabled(bool enabled)
+{
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.enabled = enabled;
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Link tuning %s", enabled ? "on, from the next decision" : "off");
+    if (!enabled && s_default_link_status_s != 0)
+    {
+        link_tuning_apply(s_default_link_status_s, ZB_LINK_TUNING_KEEP_ALIVE_DEFAULT_MS);
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_handle_indication()
+ *------------------------------------------------------------*/
+
+bool zb_link_tuning_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != ZB_BULK_PROFILE_ID || ind->cluster_id != ZB_LINK_TUNING_CLUSTER_ID || ind->dst_endpoint != ZB_BULK_ENDPOINT)
+    {
+        return false;
+    }
+    uint16_t id = follower_registry_find_by_short(ind->src_short_addr);
+    if (ind->asdu_length < ZB_LINK_TUNING_FRAME_SIZE || ind->asdu[0] != ZB_LINK_TUNING_FRAME_APPLIED || id == FOLLOWER_ID_INVALID)
+    {
+        return true;
+    }
+    const uint8_t *bytes = &ind->asdu[1];
+    s_applied_ms[id] = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    s_told_sample[id] = 0;
+    link_tuning_refresh(s_stats.keep_alive_ms);
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * zb_link_tuning_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_link_tuning_get_stats(zb_link_tuning_stats_t *stats)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *stats = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
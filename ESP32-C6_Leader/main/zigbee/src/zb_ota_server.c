@@ -0,0 +1,478 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The OTA upgrade server. See zb_ota_server.h.
+ *
+ * Notes:
+ *     - The stack asks for the next bytes of the image without
+ *       saying where they are in it. The offset the follower asked
+ *       for is taken from its Image Block (or Page) Request as it
+ *       comes in, before the stack answers it, and moved on by each
+ *       block served after it, for the rest of a page. A request
+ *       sent again, its answer lost, so gets the same bytes again.
+ *     - The staging area is written by the UART task and read by the
+ *       Zigbee task. The lock guards the state, not the flash: an
+ *       image replaced while it is being served ends those
+ *       transfers, the followers fail the image check and ask
+ *       again. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "follower_registry.h"
+#include "zb_ota_server.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+/* ZCL frame control: manufacturer specific, and server to client. */
+#define ZCL_FC_MANUFACTURER_SPECIFIC 0x04
+#define ZCL_FC_TO_CLIENT 0x08
+/* Frame control, TSN and command ID, and a manufacturer code if
+ * there is one. */
+#define ZCL_HEADER_SIZE 3
+#define ZCL_MANUFACTURER_CODE_SIZE 2
+
+/* OTA upgrade commands from a follower asking for data. */
+#define OTA_CMD_IMAGE_BLOCK_REQUEST 0x03
+#define OTA_CMD_IMAGE_PAGE_REQUEST 0x04
+/* Both start with field control, manufacturer code, image type and
+ * file version, then the file offset. */
+#define OTA_REQUEST_OFFSET_POS 9
+#define OTA_REQUEST_MIN_SIZE (OTA_REQUEST_OFFSET_POS + 4)
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    bool used;
+    uint16_t short_addr;
+    /* The next byte of the image this follower gets. */
+    uint32_t offset;
+    /* The furthest it has been given, and the blocks it asked for
+     * again. */
+    uint32_t served;
+    uint32_t resent;
+    int64_t start_us;
+    int64_t last_us;
+} zb_ota_client_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_OTA_SERVER";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static const esp_partition_t *s_partition = NULL;
+
+/* Guards everything below. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_ready = false;
+static uint32_t s_staged_size;
+static esp_zb_ota_file_header_t s_header;
+static zb_ota_client_t s_clients[ZB_OTA_MAX_CLIENTS];
+static uint16_t s_max_active;
+static uint16_t s_finished;
+static uint16_t s_aborted;
+static uint32_t s_resent;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * read_u16()
+ *------------------------------------------------------------*/
+
+static uint16_t read_u16(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+/*--------------------------------------------------------------
+ * read_u32()
+ *------------------------------------------------------------*/
+
+static uint32_t read_u32(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/*--------------------------------------------------------------
+ * count_active()
+ *------------------------------------------------------------*/
+
+/* Call with the lock held. */
+static uint16_t count_active(int64_t now_us)
+{
+    uint16_t active = 0;
+    for (int i = 0; i < ZB_OTA_MAX_CLIENTS; i++)
+    {
+        if (s_clients[i].used && now_us - s_clients[i].last_us < ZB_OTA_ACTIVE_MS * 1000LL)
+        {
+            active++;
+        }
+    }
+    return active;
+}
+
+/*--------------------------------------------------------------
+ * client_find()
+ *------------------------------------------------------------*/
+
+/* Call with the lock held. */
+static zb_ota_client_t *client_find(uint16_t short_addr)
+{
+    for (int i = 0; i < ZB_OTA_MAX_CLIENTS; i++)
+    {
+        if (s_clients[i].used && s_clients[i].short_addr == short_addr)
+        {
+            return &s_clients[i];
+        }
+    }
+    return NULL;
+}
+
+/*--------------------------------------------------------------
+ * client_get()
+ *------------------------------------------------------------*/
+
+/* The follower's transfer, started if it has none. A slot left by a
+ * follower that went quiet is reused before giving up. Call with the
+ * lock held. */
+static zb_ota_client_t *client_get(uint16_t short_addr, int64_t now_us)
+{
+    zb_ota_client_t *client = client_find(short_addr);
+    if (client && now_us - client->last_us < ZB_OTA_RESTART_MS * 1000LL)
+    {
+        return client;
+    }
+    if (!client)
+    {
+        for (int i = 0; i < ZB_OTA_MAX_CLIENTS && !client; i++)
+        {
+            if (!s_clients[i].used || now_us - s_clients[i].last_us >= ZB_OTA_RESTART_MS * 1000LL)
+            {
+                client = &s_clients[i];
+            }
+        }
+    }
+    if (client)
+    {
+        client->used = true;
+        client->short_addr = short_addr;
+        client->offset = 0;
+        client->served = 0;
+        client->resent = 0;
+        client->start_us = now_us;
+        client->last_us = now_us;
+    }
+    return client;
+}
+
+/*--------------------------------------------------------------
+ * next_data_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, for every image block a follower asks for.
+ * The stack copies the block before asking for another. */
+static esp_err_t next_data_cb(esp_zb_ota_zcl_information_t message, uint16_t index, uint8_t size, uint8_t **data)
+{
+    static uint8_t block[UINT8_MAX];
+    uint16_t short_addr = message.src_addr.u.short_addr;
+    int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    bool ready = s_ready && index == ZB_OTA_FILE_INDEX;
+    uint32_t image_size = s_header.image_size;
+    zb_ota_client_t *client = ready ? client_get(short_addr, now_us) : NULL;
+    uint32_t offset = client ? client->offset : 0;
+    taskEXIT_CRITICAL(&s_lock);
+
+    ESP_RETURN_ON_FALSE(ready, ESP_ERR_INVALID_STATE, TAG, "No image staged");
+    ESP_RETURN_ON_FALSE(client, ESP_ERR_NO_MEM, TAG, "Serving too many followers for 0x%04hx", short_addr);
+    ESP_RETURN_ON_FALSE(offset + size <= image_size, ESP_ERR_INVALID_SIZE, TAG, "0x%04hx asked past the end of the image", short_addr);
+    ESP_RETURN_ON_ERROR(esp_partition_read(s_partition, offset, block, size), TAG, "Failed to read the staged image");
+
+    taskENTER_CRITICAL(&s_lock);
+    client->offset = offset + size;
+    if (client->offset > client->served)
+    {
+        client->served = client->offset;
+    }
+    client->last_us = now_us;
+    uint16_t active = count_active(now_us);
+    if (active > s_max_active)
+    {
+        s_max_active = active;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    *data = block;
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_server_peek_indication()
+ *------------------------------------------------------------*/
+
+void zb_ota_server_peek_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->cluster_id != ESP_ZB_ZCL_CLUSTER_ID_OTA_UPGRADE || ind->asdu_length < ZCL_HEADER_SIZE)
+    {
+        return;
+    }
+    const uint8_t *frame = ind->asdu;
+    uint32_t header_size = ZCL_HEADER_SIZE + ((frame[0] & ZCL_FC_MANUFACTURER_SPECIFIC) ? ZCL_MANUFACTURER_CODE_SIZE : 0);
+    if ((frame[0] & ZCL_FC_TO_CLIENT) || ind->asdu_length < header_size + OTA_REQUEST_MIN_SIZE)
+    {
+        return;
+    }
+    uint8_t command_id = frame[header_size - 1];
+    if (command_id != OTA_CMD_IMAGE_BLOCK_REQUEST && command_id != OTA_CMD_IMAGE_PAGE_REQUEST)
+    {
+        return;
+    }
+    uint32_t offset = read_u32(&frame[header_size + OTA_REQUEST_OFFSET_POS]);
+    int64_t now_us = esp_timer_get_time();
+
+    taskENTER_CRITICAL(&s_lock);
+    zb_ota_client_t *client = s_ready ? client_get(ind->src_short_addr, now_us) : NULL;
+    if (client)
+    {
+        if (offset < client->served)
+        {
+            client->resent++;
+            s_resent++;
+        }
+        client->offset = offset;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_stage_begin()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_stage_begin(uint32_t size)
+{
+    if (!s_partition)
+    {
+        s_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ZB_OTA_PARTITION_SUBTYPE, ZB_OTA_PARTITION_NAME);
+    }
+    ESP_RETURN_ON_FALSE(s_partition, ESP_ERR_NOT_FOUND, TAG, "No %s partition", ZB_OTA_PARTITION_NAME);
+    ESP_RETURN_ON_FALSE(size > ZB_OTA_HEADER_SIZE && size <= s_partition->size, ESP_ERR_INVALID_SIZE, TAG,
+                        "An image of %" PRIu32 " bytes does not fit", size);
+
+    taskENTER_CRITICAL(&s_lock);
+    s_ready = false;
+    s_staged_size = size;
+    memset(s_clients, 0, sizeof(s_clients));
+    s_max_active = 0;
+    s_finished = 0;
+    s_aborted = 0;
+    s_resent = 0;
+    taskEXIT_CRITICAL(&s_lock);
+
+    uint32_t erase_size = (size + s_partition->erase_size - 1) / s_partition->erase_size * s_partition->erase_size;
+    ESP_RETURN_ON_ERROR(esp_partition_erase_range(s_partition, 0, erase_size), TAG, "Failed to erase the staging area");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_stage_write()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_stage_write(uint32_t offset, const uint8_t *data, uint32_t length)
+{
+    ESP_RETURN_ON_FALSE(s_partition, ESP_ERR_INVALID_STATE, TAG, "Staging not begun");
+    ESP_RETURN_ON_FALSE(offset + length <= s_staged_size, ESP_ERR_INVALID_SIZE, TAG, "Write past the end of the image");
+    ESP_RETURN_ON_ERROR(esp_partition_write(s_partition, offset, data, length), TAG, "Failed to write the staging area");
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_stage_end()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_stage_end(void)
+{
+    ESP_RETURN_ON_FALSE(s_partition, ESP_ERR_INVALID_STATE, TAG, "Staging not begun");
+    uint8_t header[ZB_OTA_HEADER_SIZE];
+    ESP_RETURN_ON_ERROR(esp_partition_read(s_partition, 0, header, sizeof(header)), TAG, "Failed to read the staged header");
+
+    /* File identifier, header version, header length, field control,
+     * manufacturer code, image type, file version, stack version,
+     * header string, total image size. */
+    ESP_RETURN_ON_FALSE(read_u32(&header[0]) == ZB_OTA_FILE_IDENTIFIER, ESP_ERR_INVALID_RESPONSE, TAG, "Not a Zigbee OTA file");
+    ESP_RETURN_ON_FALSE(read_u16(&header[6]) >= ZB_OTA_HEADER_SIZE, ESP_ERR_INVALID_RESPONSE, TAG, "Header too short");
+    ESP_RETURN_ON_FALSE(read_u32(&header[52]) == s_staged_size, ESP_ERR_INVALID_SIZE, TAG, "Header says %" PRIu32 " bytes, %" PRIu32 " staged",
+                        read_u32(&header[52]), s_staged_size);
+    esp_zb_ota_file_header_t file_header = {
+        .manufacturer_code = read_u16(&header[10]),
+        .image_type = read_u16(&header[12]),
+        .file_version = read_u32(&header[14]),
+        .image_size = s_staged_size,
+        .field_control = read_u16(&header[8]),
+    };
+    ESP_RETURN_ON_FALSE(file_header.manufacturer_code == ZB_OTA_MANUFACTURER_CODE && file_header.image_type == ZB_OTA_IMAGE_TYPE,
+                        ESP_ERR_INVALID_VERSION, TAG, "Not a follower image (0x%04x, 0x%04x)", file_header.manufacturer_code, file_header.image_type);
+
+    taskENTER_CRITICAL(&s_lock);
+    s_header = file_header;
+    s_ready = true;
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Staged version 0x%08" PRIx32 ", %" PRIu32 " bytes", file_header.file_version, file_header.image_size);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_server_notify()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_server_notify(uint8_t endpoint)
+{
+    taskENTER_CRITICAL(&s_lock);
+    bool ready = s_ready;
+    esp_zb_ota_file_header_t header = s_header;
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_RETURN_ON_FALSE(ready, ESP_ERR_INVALID_STATE, TAG, "No image staged");
+
+    esp_zb_ota_upgrade_server_notify_req_t req = {
+        .endpoint = endpoint,
+        .index = ZB_OTA_FILE_INDEX,
+        .notify_on = true,
+        /* Apply as soon as downloaded. */
+        .ota_upgrade_time = 0,
+        .ota_file_header = header,
+        .next_data_cb = next_data_cb,
+    };
+    ESP_RETURN_ON_ERROR(esp_zb_ota_upgrade_server_notify_req(&req), TAG, "Failed to notify the followers");
+    ESP_LOGI(TAG, "Notified the followers of version 0x%08" PRIx32, header.file_version);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_server_handle_query()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_server_handle_query(const esp_zb_zcl_ota_upgrade_server_query_image_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    taskENTER_CRITICAL(&s_lock);
+    bool match = s_ready && message->manufacturer_code == s_header.manufacturer_code && message->image_type == s_header.image_type &&
+                 message->version != s_header.file_version;
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Query from 0x%04hx at version 0x%08" PRIx32 ": %s", message->zcl_addr.u.short_addr, message->version,
+             match ? "image available" : "no image");
+    if (!match)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *message->table_idx = ZB_OTA_FILE_INDEX;
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_server_handle_status()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_server_handle_status(const esp_zb_zcl_ota_upgrade_server_status_message_t *message)
+{
+    ESP_RETURN_ON_FALSE(message, ESP_FAIL, TAG, "Empty message");
+    uint16_t short_addr = message->zcl_addr.u.short_addr;
+    uint16_t id = follower_registry_find_by_short(short_addr);
+    int64_t now_us = esp_timer_get_time();
+
+    if (message->server_status == ESP_ZB_ZCL_OTA_UPGRADE_SERVER_STARTED)
+    {
+        ESP_LOGI(TAG, "OTA_START short=0x%04hx id=%u", short_addr, id);
+        return ESP_OK;
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    zb_ota_client_t *client = client_find(short_addr);
+    zb_ota_client_t copy = client ? *client : (zb_ota_client_t){0};
+    uint16_t active = count_active(now_us);
+    uint16_t max_active = s_max_active;
+    if (client)
+    {
+        client->used = false;
+    }
+    if (message->server_status == ESP_ZB_ZCL_OTA_UPGRADE_SERVER_END)
+    {
+        s_finished++;
+    }
+    else
+    {
+        s_aborted++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (message->server_status == ESP_ZB_ZCL_OTA_UPGRADE_SERVER_END)
+    {
+        ESP_LOGI(TAG, "OTA_DONE short=0x%04hx id=%u ms=%" PRId64 " bytes=%" PRIu32 " concurrent=%u max_concurrent=%u resent=%" PRIu32,
+                 short_addr, id, client ? (now_us - copy.start_us) / 1000 : 0, copy.served, active, max_active, copy.resent);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "OTA_ABORTED short=0x%04hx id=%u bytes=%" PRIu32 " resent=%" PRIu32, short_addr, id, copy.served, copy.resent);
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_server_get_stats()
+ *------------------------------------------------------------*/
+
+void zb_ota_server_get_stats(zb_ota_server_stats_t *stats)
+{
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    stats->ready = s_ready;
+    stats->size = s_ready ? s_header.image_size : 0;
+    stats->file_version = s_ready ? s_header.file_version : 0;
+    stats->active = count_active(now_us);
+    stats->max_active = s_max_active;
+    stats->finished = s_finished;
+    stats->aborted = s_aborted;
+    stats->resent = s_resent;
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,211 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Receiving a follower image over UART. See
+ * zb_ota_upload.h.
+ *
+ * Notes:
+ *     - Only the UART task calls these functions, so there is no
+ *       lock.
+ *     - Frames are written in order only. Anything after a lost or
+ *       broken frame is answered with a NAK for the missing one, and
+ *       anything already written with an ACK, without writing it
+ *       again. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_ota_server.h"
+#include "zb_ota_upload.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define FRAME_MAX_SIZE (ZB_OTA_UPLOAD_HEADER_SIZE + ZB_OTA_UPLOAD_CHUNK_SIZE + ZB_OTA_UPLOAD_CRC_SIZE)
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_OTA_UPLOAD";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static bool s_active = false;
+static zb_ota_upload_done_t s_done = NULL;
+static uint32_t s_size;
+static uint16_t s_frames;
+static uint16_t s_next_seq;
+static int64_t s_start_us;
+static int64_t s_last_us;
+
+/* The frame being put together. */
+static uint8_t s_frame[FRAME_MAX_SIZE];
+static size_t s_frame_length;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * frame_size()
+ *------------------------------------------------------------*/
+
+/* The size of the frame being put together, 0 until its length is
+ * in. */
+static size_t frame_size(void)
+{
+    if (s_frame_length < ZB_OTA_UPLOAD_HEADER_SIZE)
+    {
+        return 0;
+    }
+    return ZB_OTA_UPLOAD_HEADER_SIZE + (s_frame[3] | (s_frame[4] << 8)) + ZB_OTA_UPLOAD_CRC_SIZE;
+}
+
+/*--------------------------------------------------------------
+ * frame_handle()
+ *------------------------------------------------------------*/
+
+static void frame_handle(void)
+{
+    uint16_t seq = s_frame[1] | (s_frame[2] << 8);
+    uint16_t length = s_frame[3] | (s_frame[4] << 8);
+    const uint8_t *payload = &s_frame[ZB_OTA_UPLOAD_HEADER_SIZE];
+    const uint8_t *crc = &payload[length];
+    uint32_t expected_crc = crc[0] | (crc[1] << 8) | (crc[2] << 16) | ((uint32_t)crc[3] << 24);
+
+    if (esp_rom_crc32_le(0, &s_frame[1], ZB_OTA_UPLOAD_HEADER_SIZE - 1 + length) != expected_crc)
+    {
+        ESP_LOGI(TAG, "OTA_NAK seq=%u", s_next_seq);
+        return;
+    }
+    if (seq < s_next_seq)
+    {
+        /* Our ACK got lost. */
+        ESP_LOGI(TAG, "OTA_ACK seq=%u", seq);
+        return;
+    }
+    uint32_t offset = (uint32_t)seq * ZB_OTA_UPLOAD_CHUNK_SIZE;
+    uint32_t expected_length = s_size - offset < ZB_OTA_UPLOAD_CHUNK_SIZE ? s_size - offset : ZB_OTA_UPLOAD_CHUNK_SIZE;
+    if (seq > s_next_seq || seq >= s_frames || length != expected_length)
+    {
+        ESP_LOGI(TAG, "OTA_NAK seq=%u", s_next_seq);
+        return;
+    }
+    if (zb_ota_stage_write(offset, payload, length) != ESP_OK)
+    {
+        ESP_LOGI(TAG, "OTA_NAK seq=%u", s_next_seq);
+        return;
+    }
+    s_next_seq++;
+    ESP_LOGI(TAG, "OTA_ACK seq=%u", seq);
+
+    if (s_next_seq == s_frames)
+    {
+        s_active = false;
+        esp_err_t err = zb_ota_stage_end();
+        ESP_LOGI(TAG, "OTA_UPLOAD %s bytes=%" PRIu32 " ms=%" PRId64, err == ESP_OK ? "done" : "failed", s_size,
+                 (esp_timer_get_time() - s_start_us) / 1000);
+        if (err == ESP_OK && s_done)
+        {
+            s_done();
+        }
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_upload_begin()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_ota_upload_begin(uint32_t size, zb_ota_upload_done_t done)
+{
+    s_active = false;
+    ESP_RETURN_ON_ERROR(zb_ota_stage_begin(size), TAG, "Failed to get the staging area ready");
+    s_done = done;
+    s_size = size;
+    s_frames = (size + ZB_OTA_UPLOAD_CHUNK_SIZE - 1) / ZB_OTA_UPLOAD_CHUNK_SIZE;
+    s_next_seq = 0;
+    s_frame_length = 0;
+    s_start_us = esp_timer_get_time();
+    s_last_us = s_start_us;
+    s_active = true;
+    ESP_LOGI(TAG, "OTA_UPLOAD ready bytes=%" PRIu32 " frames=%u", size, s_frames);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_upload_active()
+ *------------------------------------------------------------*/
+
+bool zb_ota_upload_active(void)
+{
+    if (s_active && esp_timer_get_time() - s_last_us > ZB_OTA_UPLOAD_TIMEOUT_MS * 1000LL)
+    {
+        s_active = false;
+        ESP_LOGW(TAG, "OTA_UPLOAD aborted after %u of %u frames", s_next_seq, s_frames);
+    }
+    return s_active;
+}
+
+/*--------------------------------------------------------------
+ * zb_ota_upload_feed()
+ *------------------------------------------------------------*/
+
+bool zb_ota_upload_feed(const uint8_t *data, size_t length)
+{
+    if (!zb_ota_upload_active() || (s_frame_length == 0 && data[0] != ZB_OTA_UPLOAD_START_BYTE))
+    {
+        return false;
+    }
+    s_last_us = esp_timer_get_time();
+
+    for (size_t i = 0; i < length && s_active; i++)
+    {
+        /* Skip to the start of the next frame after a broken one. */
+        if (s_frame_length == 0 && data[i] != ZB_OTA_UPLOAD_START_BYTE)
+        {
+            continue;
+        }
+        s_frame[s_frame_length++] = data[i];
+
+        size_t size = frame_size();
+        if (size > FRAME_MAX_SIZE)
+        {
+            ESP_LOGI(TAG, "OTA_NAK seq=%u", s_next_seq);
+            s_frame_length = 0;
+        }
+        else if (size != 0 && s_frame_length == size)
+        {
+            frame_handle();
+            s_frame_length = 0;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,234 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Stack resource profiles. See zb_resources.h.
+ *
+ * Notes:
+ *     - The samples are written by the Zigbee task only, and read
+ *       under the Zigbee lock, so they have no lock of their own.
+ *     - The coordinator binds each follower cluster on itself, so
+ *       every binding takes a destination entry, while the source
+ *       entries are shared per cluster. The large profile has room
+ *       for two clusters of every follower in the registry. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "nvs.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_command_queue.h"
+#include "zb_resources.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_RESOURCES";
+static const char *NVS_NAMESPACE = "zb_resources";
+static const char *NVS_KEY = "profile";
+
+static const zb_resources_sizes_t PROFILES[ZB_RESOURCES_PROFILE_COUNT] = {
+    [ZB_RESOURCES_PROFILE_SMALL] = {
+        .name = "small",
+        .network_size = 16,
+        .io_buffers = 40,
+        .scheduler_queue = 40,
+        .src_bindings = 8,
+        .dst_bindings = 16,
+        .max_children = 10,
+    },
+    [ZB_RESOURCES_PROFILE_MEDIUM] = {
+        .name = "medium",
+        .network_size = 64,
+        .io_buffers = 80,
+        .scheduler_queue = 80,
+        .src_bindings = 16,
+        .dst_bindings = 16,
+        .max_children = 10,
+    },
+    [ZB_RESOURCES_PROFILE_LARGE] = {
+        .name = "large",
+        .network_size = 256,
+        .io_buffers = 160,
+        .scheduler_queue = 160,
+        .src_bindings = 16,
+        .dst_bindings = 512,
+        .max_children = 32,
+    },
+};
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static zb_resources_profile_t s_profile = ZB_RESOURCES_DEFAULT_PROFILE;
+/* Heap taken by esp_zb_init(). */
+static uint32_t s_stack_heap;
+static uint32_t s_neighbors;
+static uint32_t s_max_neighbors;
+static uint32_t s_routes;
+static uint32_t s_max_routes;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * zb_resources_init()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_resources_init(void)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        /* Nothing saved yet. */
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to open NVS");
+
+    uint8_t profile;
+    err = nvs_get_u8(handle, NVS_KEY, &profile);
+    nvs_close(handle);
+    if (err == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ESP_OK;
+    }
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to load the profile");
+    if (profile < ZB_RESOURCES_PROFILE_COUNT)
+    {
+        s_profile = profile;
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_resources_stack_init()
+ *------------------------------------------------------------*/
+
+void zb_resources_stack_init(esp_zb_cfg_t *config)
+{
+    const zb_resources_sizes_t *sizes = &PROFILES[s_profile];
+    ESP_ERROR_CHECK(esp_zb_overall_network_size_set(sizes->network_size));
+    ESP_ERROR_CHECK(esp_zb_io_buffer_size_set(sizes->io_buffers));
+    ESP_ERROR_CHECK(esp_zb_scheduler_queue_size_set(sizes->scheduler_queue));
+    ESP_ERROR_CHECK(esp_zb_aps_src_binding_table_size_set(sizes->src_bindings));
+    ESP_ERROR_CHECK(esp_zb_aps_dst_binding_table_size_set(sizes->dst_bindings));
+    config->nwk_cfg.zczr_cfg.max_children = sizes->max_children;
+
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    esp_zb_init(config);
+    size_t free_after = heap_caps_get_free_size(MALLOC_CAP_DEFAULT);
+    s_stack_heap = free_before > free_after ? (uint32_t)(free_before - free_after) : 0;
+    ESP_LOGI(TAG, "Profile '%s', the stack took %" PRIu32 " bytes of heap", sizes->name, s_stack_heap);
+}
+
+/*--------------------------------------------------------------
+ * zb_resources_set_profile()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_resources_set_profile(zb_resources_profile_t profile)
+{
+    ESP_RETURN_ON_FALSE(profile < ZB_RESOURCES_PROFILE_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid profile %d", profile);
+    nvs_handle_t handle;
+    ESP_RETURN_ON_ERROR(nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle), TAG, "Failed to open NVS");
+    esp_err_t err = nvs_set_u8(handle, NVS_KEY, (uint8_t)profile);
+    if (err == ESP_OK)
+    {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    ESP_RETURN_ON_ERROR(err, TAG, "Failed to save the profile");
+    ESP_LOGI(TAG, "Profile '%s' saved, it takes effect after a restart", PROFILES[profile].name);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_resources_profile_from_string()
+ *------------------------------------------------------------*/
+
+zb_resources_profile_t zb_resources_profile_from_string(const char *name)
+{
+    for (int profile = 0; profile < ZB_RESOURCES_PROFILE_COUNT; profile++)
+    {
+        if (strcmp(name, PROFILES[profile].name) == 0)
+        {
+            return profile;
+        }
+    }
+    return ZB_RESOURCES_PROFILE_COUNT;
+}
+
+/*--------------------------------------------------------------
+ * zb_resources_sample()
+ *------------------------------------------------------------*/
+
+void zb_resources_sample(void)
+{
+    esp_zb_nwk_info_iterator_t iterator = ESP_ZB_NWK_INFO_ITERATOR_INIT;
+    esp_zb_nwk_neighbor_info_t neighbor;
+    uint32_t neighbors = 0;
+    while (esp_zb_nwk_get_next_neighbor(&iterator, &neighbor) == ESP_OK)
+    {
+        neighbors++;
+    }
+
+    iterator = ESP_ZB_NWK_INFO_ITERATOR_INIT;
+    esp_zb_nwk_route_info_t route;
+    uint32_t routes = 0;
+    while (esp_zb_nwk_get_next_route(&iterator, &route) == ESP_OK)
+    {
+        routes++;
+    }
+
+    s_neighbors = neighbors;
+    s_routes = routes;
+    if (neighbors > s_max_neighbors)
+    {
+        s_max_neighbors = neighbors;
+    }
+    if (routes > s_max_routes)
+    {
+        s_max_routes = routes;
+    }
+}
+
+/*--------------------------------------------------------------
+ * zb_resources_log()
+ *------------------------------------------------------------*/
+
+void zb_resources_log(uint32_t bindings)
+{
+    const zb_resources_sizes_t *sizes = &PROFILES[s_profile];
+    zb_command_queue_stats_t stats;
+    zb_command_queue_get_stats(&stats);
+    ESP_LOGI(TAG, "ZB_RESOURCES profile=%s network=%u neighbors=%" PRIu32 "/%" PRIu32 " routes=%" PRIu32 "/%" PRIu32 " dst_bindings=%" PRIu32
+                  "/%u src_bindings=%u io_buffers=%u in_flight=%" PRIu32 " send_failures=%" PRIu32 " scheduler_queue=%u queue_depth=%" PRIu32
+                  " stack_heap=%" PRIu32 " min_free_heap=%u",
+             sizes->name, sizes->network_size, s_neighbors, s_max_neighbors, s_routes, s_max_routes, bindings, sizes->dst_bindings,
+             sizes->src_bindings, sizes->io_buffers, stats.max_in_flight, stats.send_failures, sizes->scheduler_queue, stats.max_depth,
+             s_stack_heap, (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT));
+}
@@ -0,0 +1,384 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Capacity test bookkeeping. See zb_stress.h.
+ *
+ * Notes:
+ *     - Toggles are tracked in a table indexed by TSN. A TSN is one
+ *       byte, so a toggle still waiting when its TSN comes round
+ *       again is counted as failed. At any rate the queue can keep
+ *       up with, that never happens.
+ *     - Everything is written by the dispatcher and the Zigbee task
+ *       and read by whoever runs the test, so it all has one lock.
+ *     - Only toggles are tracked, so the odd read or report request
+ *       during a run does not spoil it. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_bulk.h"
+#include "zb_stress.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define TSN_COUNT 256
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    uint16_t short_addr;
+    uint32_t expected;
+    /* The counter when the run started, and as last reported. */
+    uint32_t start_count;
+    uint32_t count;
+    bool started;
+    bool reported;
+} target_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_STRESS";
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* Guards everything below it. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_active = false;
+static bool s_pending[TSN_COUNT];
+static int64_t s_enqueued_us[TSN_COUNT];
+static uint32_t s_sent;
+static uint32_t s_confirmed;
+static uint32_t s_failed;
+static int64_t s_first_us;
+static int64_t s_last_status_us;
+static uint32_t s_samples[ZB_STRESS_MAX_SAMPLES];
+static uint32_t s_sample_count;
+static target_t s_targets[ZB_STRESS_MAX_TARGETS];
+static uint32_t s_target_count;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * compare_u32()
+ *------------------------------------------------------------*/
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_begin()
+ *------------------------------------------------------------*/
+
+void zb_stress_begin(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    memset(s_pending, 0, sizeof(s_pending));
+    s_sent = 0;
+    s_confirmed = 0;
+    s_failed = 0;
+    s_first_us = 0;
+    s_last_status_us = 0;
+    s_sample_count = 0;
+    s_target_count = 0;
+    s_active = false;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_add_target()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_stress_add_target(uint16_t short_addr, uint32_t expected)
+{
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    taskENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < s_target_count; i++)
+    {
+        if (s_targets[i].short_addr == short_addr)
+        {
+            s_targets[i].expected += expected;
+            ret = ESP_OK;
+            break;
+        }
+    }
+    if (ret != ESP_OK && s_target_count < ZB_STRESS_MAX_TARGETS)
+    {
+        s_targets[s_target_count++] = (target_t){
+            .short_addr = short_addr,
+            .expected = expected,
+        };
+        ret = ESP_OK;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    ESP_RETURN_ON_ERROR(ret, TAG, "More than %d followers", ZB_STRESS_MAX_TARGETS);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_start()
+ *------------------------------------------------------------*/
+
+void zb_stress_start(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < s_target_count; i++)
+    {
+        s_targets[i].started = s_targets[i].reported;
+        s_targets[i].start_count = s_targets[i].count;
+    }
+    s_active = true;
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_sent()
+ *------------------------------------------------------------*/
+
+void zb_stress_sent(uint8_t tsn, int64_t enqueued_us)
+{
+    taskENTER_CRITICAL(&s_lock);
+    if (s_active)
+    {
+        if (s_pending[tsn])
+        {
+            s_failed++;
+        }
+        if (s_sent == 0)
+        {
+            s_first_us = enqueued_us;
+        }
+        s_pending[tsn] = true;
+        s_enqueued_us[tsn] = enqueued_us;
+        s_sent++;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_send_status()
+ *------------------------------------------------------------*/
+
+void zb_stress_send_status(const esp_zb_zcl_command_send_status_message_t *message)
+{
+    int64_t now_us = esp_timer_get_time();
+    taskENTER_CRITICAL(&s_lock);
+    if (s_active && s_pending[message->tsn])
+    {
+        s_pending[message->tsn] = false;
+        s_last_status_us = now_us;
+        if (message->status != ESP_OK)
+        {
+            s_failed++;
+        }
+        else
+        {
+            s_confirmed++;
+            if (s_sample_count < ZB_STRESS_MAX_SAMPLES)
+            {
+                s_samples[s_sample_count++] = (uint32_t)(now_us - s_enqueued_us[message->tsn]);
+            }
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_outstanding()
+ *------------------------------------------------------------*/
+
+uint32_t zb_stress_outstanding(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t outstanding = s_sent - s_confirmed - s_failed;
+    taskEXIT_CRITICAL(&s_lock);
+    return outstanding;
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_query()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_stress_query(void)
+{
+    uint8_t frame = ZB_STRESS_FRAME_QUERY;
+    uint16_t short_addrs[ZB_STRESS_MAX_TARGETS];
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t count = s_target_count;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        short_addrs[i] = s_targets[i].short_addr;
+        s_targets[i].reported = false;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        esp_zb_apsde_data_req_t req = {
+            .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+            .dst_addr.addr_short = short_addrs[i],
+            .dst_endpoint = ZB_BULK_ENDPOINT,
+            .profile_id = ZB_BULK_PROFILE_ID,
+            .cluster_id = ZB_STRESS_CLUSTER_ID,
+            .src_endpoint = ZB_BULK_ENDPOINT,
+            .asdu_length = sizeof(frame),
+            .asdu = &frame,
+            /* A lost query leaves the follower out of the whole run. */
+            .tx_options = ESP_ZB_APSDE_TX_OPT_ACK_TX,
+        };
+        ESP_RETURN_ON_ERROR(esp_zb_aps_data_request(&req), TAG, "Failed to query 0x%04hx", short_addrs[i]);
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_all_reported()
+ *------------------------------------------------------------*/
+
+bool zb_stress_all_reported(void)
+{
+    bool all = true;
+    taskENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < s_target_count; i++)
+    {
+        all = all && s_targets[i].reported;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return all;
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_handle_indication()
+ *------------------------------------------------------------*/
+
+bool zb_stress_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    if (ind->profile_id != ZB_BULK_PROFILE_ID || ind->cluster_id != ZB_STRESS_CLUSTER_ID || ind->dst_endpoint != ZB_BULK_ENDPOINT)
+    {
+        return false;
+    }
+    const uint8_t *frame = ind->asdu;
+    if (ind->asdu_length < ZB_STRESS_COUNT_SIZE || frame[0] != ZB_STRESS_FRAME_COUNT)
+    {
+        return true;
+    }
+    uint32_t count = frame[1] | (frame[2] << 8) | (frame[3] << 16) | ((uint32_t)frame[4] << 24);
+    taskENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < s_target_count; i++)
+    {
+        if (s_targets[i].short_addr == ind->src_short_addr)
+        {
+            s_targets[i].count = count;
+            s_targets[i].reported = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_end()
+ *------------------------------------------------------------*/
+
+void zb_stress_end(uint32_t attempted, uint32_t dropped, zb_stress_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    taskENTER_CRITICAL(&s_lock);
+    s_active = false;
+    result->attempted = attempted;
+    result->dropped = dropped;
+    result->sent = s_sent;
+    result->confirmed = s_confirmed;
+    result->failed = s_failed;
+    result->elapsed_us = s_last_status_us > s_first_us ? s_last_status_us - s_first_us : 0;
+    for (uint32_t i = 0; i < s_target_count; i++)
+    {
+        const target_t *target = &s_targets[i];
+        if (!target->started || !target->reported)
+        {
+            result->unreported++;
+            continue;
+        }
+        /* The counter may have wrapped. More than expected means it
+         * got a toggle from elsewhere. */
+        uint32_t received = target->count - target->start_count;
+        result->expected += target->expected;
+        result->delivered += received < target->expected ? received : target->expected;
+    }
+    uint32_t count = s_sample_count;
+    taskEXIT_CRITICAL(&s_lock);
+
+    /* Nothing writes the samples once the run is over. */
+    result->samples = count;
+    if (count == 0)
+    {
+        return;
+    }
+    qsort(s_samples, count, sizeof(s_samples[0]), compare_u32);
+    result->p50_us = s_samples[(count - 1) * 50 / 100];
+    result->p95_us = s_samples[(count - 1) * 95 / 100];
+    result->p99_us = s_samples[(count - 1) * 99 / 100];
+    result->max_us = s_samples[count - 1];
+}
+
+/*--------------------------------------------------------------
+ * zb_stress_log()
+ *------------------------------------------------------------*/
+
+void zb_stress_log(uint32_t rate, const zb_stress_result_t *result)
+{
+    /* In tenths of a percent. */
+    uint32_t loss = result->expected ? (uint32_t)((uint64_t)(result->expected - result->delivered) * 1000 / result->expected) : 0;
+    uint32_t delivered_per_s = result->elapsed_us > 0 ? (uint32_t)((int64_t)result->delivered * 1000000 / result->elapsed_us) : 0;
+    ESP_LOGI(TAG, "STRESS rate=%" PRIu32 " attempted=%" PRIu32 " dropped=%" PRIu32 " sent=%" PRIu32 " confirmed=%" PRIu32 " failed=%" PRIu32
+                  " expected=%" PRIu32 " delivered=%" PRIu32 " unreported=%" PRIu32 " ms=%" PRId64 " delivered_per_s=%" PRIu32
+                  " loss_pct=%" PRIu32 ".%" PRIu32 " p50=%" PRIu32 " p95=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32,
+             rate, result->attempted, result->dropped, result->sent, result->confirmed, result->failed, result->expected, result->delivered,
+             result->unreported, result->elapsed_us / 1000, delivered_per_s, loss / 10, loss % 10, result->p50_us, result->p95_us,
+             result->p99_us, result->max_us);
+}
@@ -0,0 +1,403 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: The network's time base and synchronized actions.
+ * See zb_time_sync.h.
+ *
+ * Notes:
+ *     - Time requests are answered straight from the indication
+ *       handler, so t2 and t3 are a few microseconds apart and the
+ *       command queue's delay never gets into the round trip.
+ *     - The targets are written by the Zigbee task and read by
+ *       whoever schedules the action, so they have a lock. The time
+ *       of day is only touched by the Zigbee task. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <string.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_bulk.h"
+#include "zb_time_sync.h"
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    uint16_t short_addr;
+    bool reported;
+    uint8_t status;
+    int64_t executed_us;
+    int32_t late_us;
+    uint32_t error_us;
+} target_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_TIME_SYNC";
+
+/* How often the Time attribute is brought up to date. */
+static const uint32_t TIME_TICK_MS = 1000;
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+/* Guards everything below it. */
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint16_t s_action_id;
+static target_t s_targets[ZB_TIME_SYNC_MAX_TARGETS];
+static uint32_t s_target_count;
+
+/* The endpoint with the Time cluster. */
+static uint8_t s_endpoint;
+/* Zigbee time minus seconds since boot, valid once the time of day
+ * is set. */
+static uint32_t s_utc_offset_s;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * read_u16()
+ *------------------------------------------------------------*/
+
+static uint16_t read_u16(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8);
+}
+
+/*--------------------------------------------------------------
+ * read_u32()
+ *------------------------------------------------------------*/
+
+static uint32_t read_u32(const uint8_t *bytes)
+{
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+/*--------------------------------------------------------------
+ * read_u64()
+ *------------------------------------------------------------*/
+
+static uint64_t read_u64(const uint8_t *bytes)
+{
+    return read_u32(bytes) | ((uint64_t)read_u32(bytes + 4) << 32);
+}
+
+/*--------------------------------------------------------------
+ * write_u64()
+ *------------------------------------------------------------*/
+
+static void write_u64(uint8_t *bytes, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+    {
+        bytes[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+/*--------------------------------------------------------------
+ * time_tick_cb()
+ *------------------------------------------------------------*/
+
+/* Runs in the Zigbee task, and schedules itself again. */
+static void time_tick_cb(uint8_t param)
+{
+    uint32_t time = (uint32_t)(esp_timer_get_time() / 1000000) + s_utc_offset_s;
+    esp_zb_zcl_set_attribute_val(s_endpoint, ESP_ZB_ZCL_CLUSTER_ID_TIME, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_TIME_TIME_ID, &time, false);
+    esp_zb_scheduler_alarm(time_tick_cb, 0, TIME_TICK_MS);
+}
+
+/*--------------------------------------------------------------
+ * send_frame()
+ *------------------------------------------------------------*/
+
+static esp_err_t send_frame(uint16_t short_addr, uint8_t *frame, uint32_t size, uint8_t tx_options)
+{
+    esp_zb_apsde_data_req_t req = {
+        .dst_addr_mode = ESP_ZB_APS_ADDR_MODE_16_ENDP_PRESENT,
+        .dst_addr.addr_short = short_addr,
+        .dst_endpoint = ZB_BULK_ENDPOINT,
+        .profile_id = ZB_BULK_PROFILE_ID,
+        .cluster_id = ZB_TIME_SYNC_CLUSTER_ID,
+        .src_endpoint = ZB_BULK_ENDPOINT,
+        .asdu_length = size,
+        .asdu = frame,
+        .tx_options = tx_options,
+    };
+    return esp_zb_aps_data_request(&req);
+}
+
+/*--------------------------------------------------------------
+ * handle_request()
+ *------------------------------------------------------------*/
+
+static void handle_request(uint16_t short_addr, const uint8_t *frame, int64_t received_us)
+{
+    uint8_t response[ZB_TIME_SYNC_RESPONSE_SIZE];
+    response[0] = ZB_TIME_SYNC_FRAME_RESPONSE;
+    memcpy(&response[1], &frame[1], 8);
+    write_u64(&response[9], (uint64_t)received_us);
+    write_u64(&response[17], (uint64_t)esp_timer_get_time());
+    /* No APS retries, a resent response would carry a stale t3. A
+     * lost one costs the follower one sample. */
+    if (send_frame(short_addr, response, sizeof(response), 0) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Failed to answer 0x%04hx", short_addr);
+    }
+}
+
+/*--------------------------------------------------------------
+ * handle_executed()
+ *------------------------------------------------------------*/
+
+static void handle_executed(uint16_t short_addr, const uint8_t *frame)
+{
+    uint16_t action_id = read_u16(&frame[1]);
+    taskENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; action_id == s_action_id && i < s_target_count; i++)
+    {
+        target_t *target = &s_targets[i];
+        if (target->short_addr == short_addr)
+        {
+            target->executed_us = (int64_t)read_u64(&frame[3]);
+            target->late_us = (int32_t)read_u32(&frame[11]);
+            target->error_us = read_u32(&frame[15]);
+            target->status = frame[19];
+            target->reported = true;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_add_time_cluster()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_time_sync_add_time_cluster(esp_zb_ep_list_t *ep_list, uint8_t endpoint)
+{
+    /* "Not set" until zb_time_sync_set_utc(). */
+    esp_zb_time_cluster_cfg_t time_cfg = {
+        .time = ESP_ZB_ZCL_TIME_TIME_DEFAULT_VALUE,
+        .time_status = ZB_TIME_STATUS_MASTER,
+    };
+    esp_zb_attribute_list_t *time_cluster = esp_zb_time_cluster_create(&time_cfg);
+    ESP_RETURN_ON_FALSE(time_cluster, ESP_ERR_NO_MEM, TAG, "Failed to create the Time cluster");
+    s_endpoint = endpoint;
+    return esp_zb_cluster_list_add_time_cluster(esp_zb_ep_list_get_ep(ep_list, endpoint), time_cluster, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE);
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_set_utc()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_time_sync_set_utc(uint32_t unix_s)
+{
+    ESP_RETURN_ON_FALSE(unix_s >= ZB_TIME_UNIX_TO_ZIGBEE_S, ESP_ERR_INVALID_ARG, TAG, "Time before 2000");
+    s_utc_offset_s = unix_s - ZB_TIME_UNIX_TO_ZIGBEE_S - (uint32_t)(esp_timer_get_time() / 1000000);
+    uint8_t time_status = ZB_TIME_STATUS_MASTER | ZB_TIME_STATUS_SYNCHRONIZED;
+    esp_zb_zcl_set_attribute_val(s_endpoint, ESP_ZB_ZCL_CLUSTER_ID_TIME, ESP_ZB_ZCL_CLUSTER_SERVER_ROLE,
+                                 ESP_ZB_ZCL_ATTR_TIME_TIME_STATUS_ID, &time_status, false);
+    esp_zb_scheduler_alarm_cancel(time_tick_cb, 0);
+    time_tick_cb(0);
+    ESP_LOGI(TAG, "Time of day set, %" PRIu32 " s since 1970", unix_s);
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_begin()
+ *------------------------------------------------------------*/
+
+uint16_t zb_time_sync_begin(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    /* 0 is never used, so a stray report for it matches nothing. */
+    if (++s_action_id == 0)
+    {
+        s_action_id = 1;
+    }
+    uint16_t action_id = s_action_id;
+    s_target_count = 0;
+    taskEXIT_CRITICAL(&s_lock);
+    return action_id;
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_add_target()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_time_sync_add_target(uint16_t short_addr)
+{
+    esp_err_t ret = ESP_OK;
+    taskENTER_CRITICAL(&s_lock);
+    if (s_target_count < ZB_TIME_SYNC_MAX_TARGETS)
+    {
+        target_t *target = &s_targets[s_target_count++];
+        memset(target, 0, sizeof(*target));
+        target->short_addr = short_addr;
+    }
+    else
+    {
+        ret = ESP_ERR_NO_MEM;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_schedule()
+ *------------------------------------------------------------*/
+
+esp_err_t zb_time_sync_schedule(int64_t at_us, bool on)
+{
+    uint16_t short_addrs[ZB_TIME_SYNC_MAX_TARGETS];
+    taskENTER_CRITICAL(&s_lock);
+    uint16_t action_id = s_action_id;
+    uint32_t count = s_target_count;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        short_addrs[i] = s_targets[i].short_addr;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    uint8_t frame[ZB_TIME_SYNC_SCHEDULE_SIZE];
+    frame[0] = ZB_TIME_SYNC_FRAME_SCHEDULE;
+    frame[1] = (uint8_t)(action_id);
+    frame[2] = (uint8_t)(action_id >> 8);
+    write_u64(&frame[3], (uint64_t)at_us);
+    frame[11] = ZB_TIME_SYNC_ACTION_ON_OFF;
+    frame[12] = on;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        ESP_RETURN_ON_ERROR(send_frame(short_addrs[i], frame, sizeof(frame), ESP_ZB_APSDE_TX_OPT_ACK_TX), TAG, "Failed to schedule on 0x%04hx", short_addrs[i]);
+    }
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_all_reported()
+ *------------------------------------------------------------*/
+
+bool zb_time_sync_all_reported(void)
+{
+    bool all = true;
+    taskENTER_CRITICAL(&s_lock);
+    for (uint32_t i = 0; i < s_target_count; i++)
+    {
+        all = all && s_targets[i].reported;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    return all;
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_handle_indication()
+ *------------------------------------------------------------*/
+
+bool zb_time_sync_handle_indication(const esp_zb_apsde_data_ind_t *ind)
+{
+    int64_t received_us = esp_timer_get_time();
+    if (ind->profile_id != ZB_BULK_PROFILE_ID || ind->cluster_id != ZB_TIME_SYNC_CLUSTER_ID || ind->dst_endpoint != ZB_BULK_ENDPOINT)
+    {
+        return false;
+    }
+    const uint8_t *frame = ind->asdu;
+    if (ind->asdu_length >= ZB_TIME_SYNC_REQUEST_SIZE && frame[0] == ZB_TIME_SYNC_FRAME_REQUEST)
+    {
+        handle_request(ind->src_short_addr, frame, received_us);
+    }
+    else if (ind->asdu_length >= ZB_TIME_SYNC_EXECUTED_SIZE && frame[0] == ZB_TIME_SYNC_FRAME_EXECUTED)
+    {
+        handle_executed(ind->src_short_addr, frame);
+    }
+    return true;
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_end()
+ *------------------------------------------------------------*/
+
+void zb_time_sync_end(zb_time_sync_result_t *result)
+{
+    memset(result, 0, sizeof(*result));
+    int64_t earliest_us = INT64_MAX;
+    int64_t latest_us = INT64_MIN;
+    bool first = true;
+    taskENTER_CRITICAL(&s_lock);
+    result->action_id = s_action_id;
+    result->targets = s_target_count;
+    for (uint32_t i = 0; i < s_target_count; i++)
+    {
+        const target_t *target = &s_targets[i];
+        if (!target->reported)
+        {
+            continue;
+        }
+        result->reported++;
+        if (target->status != ZB_TIME_SYNC_STATUS_OK)
+        {
+            result->not_synced++;
+            continue;
+        }
+        earliest_us = target->executed_us < earliest_us ? target->executed_us : earliest_us;
+        latest_us = target->executed_us > latest_us ? target->executed_us : latest_us;
+        if (first || target->late_us > result->max_late_us)
+        {
+            result->max_late_us = target->late_us;
+        }
+        if (target->error_us > result->max_error_us)
+        {
+            result->max_error_us = target->error_us;
+        }
+        first = false;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+    result->skew_us = latest_us > earliest_us ? (uint32_t)(latest_us - earliest_us) : 0;
+}
+
+/*--------------------------------------------------------------
+ * zb_time_sync_log()
+ *------------------------------------------------------------*/
+
+void zb_time_sync_log(const zb_time_sync_result_t *result)
+{
+    ESP_LOGI(TAG, "SYNC_ACTION id=%u targets=%" PRIu32 " reported=%" PRIu32 " not_synced=%" PRIu32 " skew_us=%" PRIu32 " max_late_us=%" PRId32
+                  " max_error_us=%" PRIu32,
+             result->action_id, result->targets, result->reported, result->not_synced, result->skew_us, result->max_late_us,
+             result->max_error_us);
+}
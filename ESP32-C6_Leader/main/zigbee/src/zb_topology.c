@@ -0,0 +1,211 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Network topology dump. See zb_topology.h.
+ *
+ * Notes:
+ *     - The lock is released between chunks, so a table can change
+ *       in the middle of a walk. An entry may then be missed or
+ *       logged twice. The GUI keeps the last record per device and
+ *       kind, and the next walk sorts it out.
+ *     - Records are logged as hex so they survive the text log,
+ *       ZB_TOPOLOGY_CHUNK_SIZE records (144 characters) per line. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_zigbee_core.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_topology.h"
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "ZB_TOPOLOGY";
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * next_record()
+ *------------------------------------------------------------*/
+
+/* Read the next entry of one table. Needs the Zigbee lock.
+ * Returns false at the end of the table. */
+static bool next_record(zb_topology_kind_t kind, esp_zb_nwk_info_iterator_t *iterator, zb_topology_record_t *record)
+{
+    *record = (zb_topology_record_t){.kind = kind};
+
+    switch (kind)
+    {
+    case ZB_TOPOLOGY_NEIGHBOR:
+    {
+        esp_zb_nwk_neighbor_info_t neighbor;
+        if (esp_zb_nwk_get_next_neighbor(iterator, &neighbor) != ESP_OK)
+        {
+            return false;
+        }
+        record->short_addr = neighbor.short_addr;
+        record->via = esp_zb_get_short_address();
+        record->relationship = neighbor.relationship;
+        record->lqi = neighbor.lqi;
+        record->cost = neighbor.outgoing_cost;
+        record->age = neighbor.age;
+        return true;
+    }
+    case ZB_TOPOLOGY_ROUTE:
+    {
+        esp_zb_nwk_route_info_t route;
+        if (esp_zb_nwk_get_next_route(iterator, &route) != ESP_OK)
+        {
+            return false;
+        }
+        record->short_addr = route.dest_addr;
+        record->via = route.next_hop_addr;
+        record->relationship = route.flags.status;
+        record->age = route.expiry;
+        return true;
+    }
+    case ZB_TOPOLOGY_ROUTE_RECORD:
+    {
+        esp_zb_nwk_route_record_info_t route_record;
+        if (esp_zb_nwk_get_next_route_record(iterator, &route_record) != ESP_OK)
+        {
+            return false;
+        }
+        record->short_addr = route_record.dest_address;
+        /* No relays means the device is a neighbour. */
+        record->via = route_record.relay_count > 0 ? route_record.path[0] : esp_zb_get_short_address();
+        record->relationship = route_record.relay_count;
+        record->cost = route_record.relay_count + 1;
+        record->age = route_record.expiry;
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/*--------------------------------------------------------------
+ * log_chunk()
+ *------------------------------------------------------------*/
+
+static void log_chunk(const zb_topology_record_t *records, size_t count)
+{
+    char hex[ZB_TOPOLOGY_CHUNK_SIZE * ZB_TOPOLOGY_RECORD_SIZE * 2 + 1];
+    int length = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        uint8_t buffer[ZB_TOPOLOGY_RECORD_SIZE];
+        zb_topology_encode(&records[i], buffer);
+        for (int j = 0; j < ZB_TOPOLOGY_RECORD_SIZE; j++)
+        {
+            length += snprintf(&hex[length], sizeof(hex) - length, "%02x", buffer[j]);
+        }
+    }
+    ESP_LOGI(TAG, "TOPOLOGY %s", hex);
+}
+
+/*--------------------------------------------------------------
+ * zb_topology_encode()
+ *------------------------------------------------------------*/
+
+void zb_topology_encode(const zb_topology_record_t *record, uint8_t *buffer)
+{
+    buffer[0] = (uint8_t)record->kind;
+    buffer[1] = (uint8_t)(record->short_addr);
+    buffer[2] = (uint8_t)(record->short_addr >> 8);
+    buffer[3] = (uint8_t)(record->via);
+    buffer[4] = (uint8_t)(record->via >> 8);
+    buffer[5] = record->relationship;
+    buffer[6] = record->lqi;
+    buffer[7] = record->cost;
+    buffer[8] = record->age;
+}
+
+/*--------------------------------------------------------------
+ * zb_topology_walk()
+ *------------------------------------------------------------*/
+
+void zb_topology_walk(zb_topology_stats_t *stats)
+{
+    zb_topology_stats_t walk = {0};
+
+    esp_zb_lock_acquire(portMAX_DELAY);
+    uint16_t leader = esp_zb_get_short_address();
+    esp_zb_lock_release();
+    ESP_LOGI(TAG, "TOPOLOGY_BEGIN leader=0x%04hx", leader);
+
+    for (int kind = 0; kind < ZB_TOPOLOGY_KIND_COUNT; kind++)
+    {
+        esp_zb_nwk_info_iterator_t iterator = ESP_ZB_NWK_INFO_ITERATOR_INIT;
+        bool more = true;
+        while (more)
+        {
+            /* Copy a chunk out with the lock held, log it without. */
+            zb_topology_record_t records[ZB_TOPOLOGY_CHUNK_SIZE];
+            size_t count = 0;
+            esp_zb_lock_acquire(portMAX_DELAY);
+            int64_t start_us = esp_timer_get_time();
+            while (count < ZB_TOPOLOGY_CHUNK_SIZE && (more = next_record(kind, &iterator, &records[count])))
+            {
+                count++;
+            }
+            uint32_t hold_us = (uint32_t)(esp_timer_get_time() - start_us);
+            esp_zb_lock_release();
+
+            if (hold_us > walk.max_lock_hold_us)
+            {
+                walk.max_lock_hold_us = hold_us;
+            }
+            if (count > 0)
+            {
+                log_chunk(records, count);
+                walk.records += count;
+                walk.chunks++;
+            }
+            /* Let the Zigbee task have the lock before the next chunk. */
+            if (more)
+            {
+                vTaskDelay(1);
+            }
+        }
+    }
+
+    ESP_LOGI(TAG, "TOPOLOGY_END records=%" PRIu32, walk.records);
+    if (stats)
+    {
+        *stats = walk;
+    }
+}
@@ -0,0 +1,267 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: Host test of channel selection (zb_channel_select.c).
+ * Scans are given as the energy list of a "CHANNEL_SCAN" log line,
+ * so a scan seen on a real leader can be pasted in as it is, with
+ * the channel it should pick.
+ *
+ * Notes:
+ *     - Build and run from this directory:
+ *           cmake -S . -B build && cmake --build build && ctest --test-dir build */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "zb_channel.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define CHECK(cond)                                                                  \
+    do                                                                               \
+    {                                                                                \
+        if (!(cond))                                                                 \
+        {                                                                            \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            s_failures++;                                                            \
+        }                                                                            \
+    } while (0)
+
+/* Every channel. */
+#define ALL_CHANNELS (((1UL << ZB_CHANNEL_COUNT) - 1) << ZB_CHANNEL_FIRST)
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef struct
+{
+    const char *name;
+    uint8_t current;
+    /* As logged: dBm of 11 to 26, -128 for a channel not measured. */
+    const char *energy;
+    uint8_t expected;
+} recorded_scan_t;
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const recorded_scan_t RECORDED_SCANS[] = {
+    /* Wi-Fi on 1, 6 and 11 covers 11-14, 16-19 and 21-24. 15 and 20
+     * sit between two of them and 25 next to one, so 26 wins. */
+    {"wifi_1_6_11", 11, "-52,-50,-54,-61,-82,-49,-47,-51,-58,-84,-57,-55,-59,-66,-90,-93", 26},
+    /* Quiet, and the current channel is only 7 dB worse than the
+     * best, so the network stays. */
+    {"quiet_keep", 15, "-92,-92,-92,-92,-89,-92,-92,-92,-92,-96,-92,-92,-92,-92,-92,-92", 15},
+    /* Wi-Fi came up on top of the current channel. */
+    {"wifi_on_current", 15, "-90,-90,-90,-60,-58,-62,-90,-90,-90,-90,-90,-90,-90,-90,-90,-94", 26},
+    /* Only some channels measured. */
+    {"partial", 20, "-128,-128,-128,-128,-75,-128,-128,-128,-128,-70,-128,-128,-128,-128,-128,-90", 26},
+};
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static int s_failures;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * parse_energy()
+ *------------------------------------------------------------*/
+
+/* Returns the mask of channels measured, 0 if the list is bad. */
+static uint32_t parse_energy(const char *list, int8_t energy_dbm[ZB_CHANNEL_COUNT])
+{
+    uint32_t channel_mask = 0;
+    const char *p = list;
+    for (int i = 0; i < ZB_CHANNEL_COUNT; i++)
+    {
+        char *end;
+        long dbm = strtol(p, &end, 10);
+        if (end == p || dbm < INT8_MIN || dbm > INT8_MAX || (*end != ',' && i < ZB_CHANNEL_COUNT - 1))
+        {
+            return 0;
+        }
+        energy_dbm[i] = (int8_t)dbm;
+        if (dbm != INT8_MIN)
+        {
+            channel_mask |= 1UL << (ZB_CHANNEL_FIRST + i);
+        }
+        p = end + 1;
+    }
+    return channel_mask;
+}
+
+/*--------------------------------------------------------------
+ * fill()
+ *------------------------------------------------------------*/
+
+static void fill(int8_t energy_dbm[ZB_CHANNEL_COUNT], int8_t dbm)
+{
+    memset(energy_dbm, dbm, ZB_CHANNEL_COUNT);
+}
+
+/*--------------------------------------------------------------
+ * energy_of()
+ *------------------------------------------------------------*/
+
+static int8_t *energy_of(int8_t energy_dbm[ZB_CHANNEL_COUNT], uint8_t channel)
+{
+    return &energy_dbm[channel - ZB_CHANNEL_FIRST];
+}
+
+/*--------------------------------------------------------------
+ * test_recorded_scans()
+ *------------------------------------------------------------*/
+
+static void test_recorded_scans(void)
+{
+    for (size_t i = 0; i < sizeof(RECORDED_SCANS) / sizeof(RECORDED_SCANS[0]); i++)
+    {
+        const recorded_scan_t *scan = &RECORDED_SCANS[i];
+        int8_t energy_dbm[ZB_CHANNEL_COUNT];
+        uint32_t channel_mask = parse_energy(scan->energy, energy_dbm);
+        CHECK(channel_mask != 0);
+        uint8_t best = zb_channel_select(energy_dbm, channel_mask, scan->current, ZB_CHANNEL_CHANGE_MARGIN_DB);
+        printf("%s: current=%u best=%u expected=%u\n", scan->name, scan->current, best, scan->expected);
+        CHECK(best == scan->expected);
+    }
+}
+
+/*--------------------------------------------------------------
+ * test_adjacent_penalty()
+ *------------------------------------------------------------*/
+
+static void test_adjacent_penalty(void)
+{
+    int8_t energy_dbm[ZB_CHANNEL_COUNT];
+    uint8_t ranked[ZB_CHANNEL_COUNT];
+
+    /* 15 is the quietest on its own, but 16 next to it is loud. 20 is
+     * a little noisier and has quiet neighbours, so it wins. */
+    fill(energy_dbm, -70);
+    *energy_of(energy_dbm, 15) = -95;
+    *energy_of(energy_dbm, 16) = -40;
+    *energy_of(energy_dbm, 20) = -90;
+    CHECK(zb_channel_select(energy_dbm, ALL_CHANNELS, 0, ZB_CHANNEL_CHANGE_MARGIN_DB) == 20);
+    CHECK(zb_channel_rank(energy_dbm, ALL_CHANNELS, ranked) == ZB_CHANNEL_COUNT);
+    CHECK(ranked[0] == 20);
+    /* 15 and 17 both score -40 - 15 = -55 and keep channel order, 16
+     * itself is last. */
+    CHECK(ranked[ZB_CHANNEL_COUNT - 3] == 15);
+    CHECK(ranked[ZB_CHANNEL_COUNT - 2] == 17);
+    CHECK(ranked[ZB_CHANNEL_COUNT - 1] == 16);
+
+    /* A neighbour exactly ZB_CHANNEL_ADJACENT_REJECTION_DB louder
+     * scores the same as the channel itself, so 11 and 26 tie and
+     * channel order picks 11. One dB more and 11 loses. */
+    uint32_t mask = (1UL << 11) | (1UL << 26);
+    fill(energy_dbm, -100);
+    *energy_of(energy_dbm, 11) = -80;
+    *energy_of(energy_dbm, 26) = -80;
+    *energy_of(energy_dbm, 12) = -80 + ZB_CHANNEL_ADJACENT_REJECTION_DB;
+    CHECK(zb_channel_select(energy_dbm, mask, 0, ZB_CHANNEL_CHANGE_MARGIN_DB) == 11);
+    *energy_of(energy_dbm, 12) = -80 + ZB_CHANNEL_ADJACENT_REJECTION_DB + 1;
+    CHECK(zb_channel_select(energy_dbm, mask, 0, ZB_CHANNEL_CHANGE_MARGIN_DB) == 26);
+}
+
+/*--------------------------------------------------------------
+ * test_change_margin()
+ *------------------------------------------------------------*/
+
+static void test_change_margin(void)
+{
+    int8_t energy_dbm[ZB_CHANNEL_COUNT];
+    uint32_t mask = (1UL << 15) | (1UL << 20);
+    fill(energy_dbm, -100);
+    *energy_of(energy_dbm, 15) = -80;
+
+    /* One dB short of the margin, stay. */
+    *energy_of(energy_dbm, 20) = -80 - (ZB_CHANNEL_CHANGE_MARGIN_DB - 1);
+    CHECK(zb_channel_select(energy_dbm, mask, 15, ZB_CHANNEL_CHANGE_MARGIN_DB) == 15);
+    /* Before a network is formed there is nothing to stay on. */
+    CHECK(zb_channel_select(energy_dbm, mask, 0, ZB_CHANNEL_CHANGE_MARGIN_DB) == 20);
+    /* Nor when the current channel was not measured. */
+    CHECK(zb_channel_select(energy_dbm, 1UL << 20, 15, ZB_CHANNEL_CHANGE_MARGIN_DB) == 20);
+    /* Without a margin, any improvement moves. */
+    CHECK(zb_channel_select(energy_dbm, mask, 15, 0) == 20);
+
+    /* The full margin, move. */
+    *energy_of(energy_dbm, 20) = -80 - ZB_CHANNEL_CHANGE_MARGIN_DB;
+    CHECK(zb_channel_select(energy_dbm, mask, 15, ZB_CHANNEL_CHANGE_MARGIN_DB) == 20);
+}
+
+/*--------------------------------------------------------------
+ * test_edges()
+ *------------------------------------------------------------*/
+
+static void test_edges(void)
+{
+    int8_t energy_dbm[ZB_CHANNEL_COUNT];
+    uint8_t ranked[ZB_CHANNEL_COUNT];
+
+    /* Nothing measured, or only channels outside 11-26. */
+    fill(energy_dbm, -90);
+    CHECK(zb_channel_select(energy_dbm, 0, 15, ZB_CHANNEL_CHANGE_MARGIN_DB) == 0);
+    CHECK(zb_channel_select(energy_dbm, (1UL << ZB_CHANNEL_FIRST) - 1, 15, ZB_CHANNEL_CHANGE_MARGIN_DB) == 0);
+    CHECK(zb_channel_rank(energy_dbm, 0, ranked) == 0);
+
+    /* All equal, channel order. */
+    CHECK(zb_channel_rank(energy_dbm, ALL_CHANNELS, ranked) == ZB_CHANNEL_COUNT);
+    for (int i = 0; i < ZB_CHANNEL_COUNT; i++)
+    {
+        CHECK(ranked[i] == ZB_CHANNEL_FIRST + i);
+    }
+    CHECK(zb_channel_select(energy_dbm, ALL_CHANNELS, 0, ZB_CHANNEL_CHANGE_MARGIN_DB) == ZB_CHANNEL_FIRST);
+
+    /* The ends of the int8_t range do not overflow the scores. */
+    fill(energy_dbm, INT8_MIN);
+    *energy_of(energy_dbm, 13) = INT8_MAX;
+    CHECK(zb_channel_rank(energy_dbm, ALL_CHANNELS, ranked) == ZB_CHANNEL_COUNT);
+    CHECK(ranked[0] == 11);
+    CHECK(ranked[ZB_CHANNEL_COUNT - 1] == 13);
+    CHECK(zb_channel_select(energy_dbm, ALL_CHANNELS, 13, ZB_CHANNEL_CHANGE_MARGIN_DB) == 11);
+}
+
+/*--------------------------------------------------------------
+ * main()
+ *------------------------------------------------------------*/
+
+int main(void)
+{
+    test_recorded_scans();
+    test_adjacent_penalty();
+    test_change_margin();
+    test_edges();
+    if (s_failures)
+    {
+        printf("%d checks failed\n", s_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -10,6 +10,10 @@
 # INCLUDES
 ################################################################
 
+import math
+import struct
+import zlib
+
 from PyQt6.QtCore import *
 from PyQt6.QtGui import *
 from PyQt6.QtSerialPort import *
@@ -23,6 +27,49 @@ size_1 = 32
 size_2 = 64
 size_3 = 256
 
+# Zigbee channels, and the energy range drawn for them, in dBm.
+channel_first = 11
+channel_last = 26
+channel_energy_min = -100
+channel_energy_max = 0
+
+# Topology records, see zb_topology.h on the leader.
+topology_record_size = 9
+topology_neighbor = 0
+topology_route = 1
+topology_route_record = 2
+topology_ring_spacing = 80
+topology_node_size = 36
+
+# Latency stages and histogram buckets, see zb_latency.h on the
+# leader. Bucket n counts samples under (1 << n) ms.
+latency_stages = ["uart_to_submit", "submit_to_confirm", "receive_to_led", "end_to_end", "round_trip"]
+latency_histogram_stage = "end_to_end"
+latency_buckets = 13
+
+# Follower images, see zb_ota_server.h and zb_ota_upload.h on the
+# leader. The image is wrapped in a Zigbee OTA file here and sent in
+# frames, a few at a time.
+ota_file_identifier = 0x0BEEF11E
+ota_header_version = 0x0100
+ota_header_size = 56
+ota_manufacturer_code = 0x131B
+ota_image_type = 0x1011
+ota_stack_version = 0x0002
+ota_header_string = b"ESP32-C6 follower"
+ota_tag_upgrade_image = 0x0000
+ota_frame_start = 0xA5
+ota_chunk_size = 512
+ota_window = 3
+ota_retry_ms = 2000
+ota_max_retries = 5
+
+# The capacity test the button runs, see zb_stress.h on the leader:
+# toggles per second and toggles in all, round robin over every
+# follower.
+stress_rate = 50
+stress_count = 500
+
 ################################################################
 # WINDOW
 ################################################################
@@ -93,8 +140,21 @@ class window(QMainWindow):
         self.QPushButton_leader_yellow_task = QPushButton("Leader Yellow Task")
         self.QPushButton_leader_green_task = QPushButton("Leader Green Task")
         self.QPushButton_leader_rust_task = QPushButton("Leader Rust Task")
+        self.QPushButton_leader_channel_scan = QPushButton("Leader Channel Scan")
+        self.QPushButton_leader_topology = QPushButton("Leader Topology")
+        self.QPushButton_leader_latency = QPushButton("Leader Latency")
+        self.QPushButton_leader_permit_join = QPushButton("Leader Permit Join")
+        self.QPushButton_leader_stress = QPushButton("Leader Stress")
+        self.QLabel_leader_stress = QLabel("No stress test yet.")
         self.QLabel_follower_commands = QLabel("Follower Commands")
         self.QPushButton_follower_toggle_led = QPushButton("Follower Toggle LED")
+        self.QPushButton_follower_on = QPushButton("Follower On")
+        self.QPushButton_follower_off = QPushButton("Follower Off")
+        self.QPushButton_follower_state = QPushButton("Follower State")
+        self.QLabel_follower_state = QLabel("No state yet.")
+        self.QPushButton_follower_ota = QPushButton("Follower OTA Upload")
+        self.QProgressBar_follower_ota = QProgressBar()
+        self.QLabel_follower_ota = QLabel("No OTA yet.")
         self.QLabel_custom_command = QLabel("Custom Command")
         self.QLineEdit_custom_command = QLineEdit()
         self.QPushButton_custom_command = QPushButton("Send Custom Command")
@@ -107,12 +167,25 @@ class window(QMainWindow):
         self.QLayout_commands.addWidget(self.QPushButton_leader_yellow_task, 2, 0)
         self.QLayout_commands.addWidget(self.QPushButton_leader_green_task, 3, 0)
         self.QLayout_commands.addWidget(self.QPushButton_leader_rust_task, 4, 0)
+        self.QLayout_commands.addWidget(self.QPushButton_leader_channel_scan, 5, 0)
+        self.QLayout_commands.addWidget(self.QPushButton_leader_topology, 6, 0)
+        self.QLayout_commands.addWidget(self.QPushButton_leader_latency, 7, 0)
+        self.QLayout_commands.addWidget(self.QPushButton_leader_permit_join, 8, 0)
+        self.QLayout_commands.addWidget(self.QPushButton_leader_stress, 9, 0)
+        self.QLayout_commands.addWidget(self.QLabel_leader_stress, 9, 1)
         self.QLayout_commands.addWidget(self.QLabel_follower_commands, 0, 1)
         self.QLayout_commands.addWidget(self.QPushButton_follower_toggle_led, 1, 1)
-        self.QLayout_commands.addWidget(self.QLabel_custom_command, 5, 0, 1, 2)
-        self.QLayout_commands.addWidget(self.QLineEdit_custom_command, 6, 0, 1, 2)
-        self.QLayout_commands.addWidget(self.QPushButton_custom_command, 7, 0, 1, 2)
-        self.QLayout_commands.addWidget(self.QCheckBox_clear_on_send, 8, 0, 1, 2)
+        self.QLayout_commands.addWidget(self.QPushButton_follower_on, 2, 1)
+        self.QLayout_commands.addWidget(self.QPushButton_follower_off, 3, 1)
+        self.QLayout_commands.addWidget(self.QPushButton_follower_state, 4, 1)
+        self.QLayout_commands.addWidget(self.QLabel_follower_state, 5, 1)
+        self.QLayout_commands.addWidget(self.QPushButton_follower_ota, 6, 1)
+        self.QLayout_commands.addWidget(self.QProgressBar_follower_ota, 7, 1)
+        self.QLayout_commands.addWidget(self.QLabel_follower_ota, 8, 1)
+        self.QLayout_commands.addWidget(self.QLabel_custom_command, 10, 0, 1, 2)
+        self.QLayout_commands.addWidget(self.QLineEdit_custom_command, 11, 0, 1, 2)
+        self.QLayout_commands.addWidget(self.QPushButton_custom_command, 12, 0, 1, 2)
+        self.QLayout_commands.addWidget(self.QCheckBox_clear_on_send, 13, 0, 1, 2)
 
         # Create widget.
         self.QWidget_commands = QWidget()
@@ -128,8 +201,31 @@ class window(QMainWindow):
         self.QPushButton_leader_green_task.setCursor(Qt.CursorShape.PointingHandCursor)
         self.QPushButton_leader_rust_task.setFixedHeight(size_1)
         self.QPushButton_leader_rust_task.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_leader_channel_scan.setFixedHeight(size_1)
+        self.QPushButton_leader_channel_scan.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_leader_topology.setFixedHeight(size_1)
+        self.QPushButton_leader_topology.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_leader_latency.setFixedHeight(size_1)
+        self.QPushButton_leader_latency.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_leader_permit_join.setFixedHeight(size_1)
+        self.QPushButton_leader_permit_join.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_leader_stress.setFixedHeight(size_1)
+        self.QPushButton_leader_stress.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QLabel_leader_stress.setAlignment(Qt.AlignmentFlag.AlignCenter)
         self.QPushButton_follower_toggle_led.setFixedHeight(size_1)
         self.QPushButton_follower_toggle_led.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_follower_on.setFixedHeight(size_1)
+        self.QPushButton_follower_on.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_follower_off.setFixedHeight(size_1)
+        self.QPushButton_follower_off.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QPushButton_follower_state.setFixedHeight(size_1)
+        self.QPushButton_follower_state.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QLabel_follower_state.setAlignment(Qt.AlignmentFlag.AlignCenter)
+        self.QPushButton_follower_ota.setFixedHeight(size_1)
+        self.QPushButton_follower_ota.setCursor(Qt.CursorShape.PointingHandCursor)
+        self.QProgressBar_follower_ota.setFixedHeight(size_1)
+        self.QProgressBar_follower_ota.setValue(0)
+        self.QLabel_follower_ota.setAlignment(Qt.AlignmentFlag.AlignCenter)
         self.QLineEdit_custom_command.setFixedHeight(size_1)
         self.QLineEdit_custom_command.setPlaceholderText("Enter custom command here...\n")
         self.QPushButton_custom_command.setCursor(Qt.CursorShape.PointingHandCursor)
@@ -141,10 +237,124 @@ class window(QMainWindow):
         self.QPushButton_leader_yellow_task.clicked.connect(lambda: self.send_command("leader_yellow_task"))
         self.QPushButton_leader_green_task.clicked.connect(lambda: self.send_command("leader_green_task"))
         self.QPushButton_leader_rust_task.clicked.connect(lambda: self.send_command("leader_rust_task"))
+        self.QPushButton_leader_channel_scan.clicked.connect(lambda: self.send_command("leader_channel_scan"))
+        self.QPushButton_leader_topology.clicked.connect(lambda: self.send_command("leader_topology"))
+        # 100 toggles of the first follower.
+        self.QPushButton_leader_latency.clicked.connect(lambda: self.send_command("leader_latency 0 100"))
+        # After a reboot the leader only lets new followers join when asked.
+        self.QPushButton_leader_permit_join.clicked.connect(lambda: self.send_command("leader_permit_join 180"))
+        self.QPushButton_leader_stress.clicked.connect(lambda: self.send_command(f"leader_stress {stress_rate} {stress_count}"))
         self.QPushButton_follower_toggle_led.clicked.connect(lambda: self.send_command("follower_toggle_led"))
+        # The first follower. The leader answers state queries from its
+        # cache, without asking the follower.
+        self.QPushButton_follower_on.clicked.connect(lambda: self.send_command("follower_on 0"))
+        self.QPushButton_follower_off.clicked.connect(lambda: self.send_command("follower_off 0"))
+        self.QPushButton_follower_state.clicked.connect(lambda: self.send_command("follower_state 0"))
+        self.QPushButton_follower_ota.clicked.connect(self.start_ota_upload)
         self.QLineEdit_custom_command.returnPressed.connect(lambda: self.send_custom_command(self.QLineEdit_custom_command.text()))
         self.QPushButton_custom_command.clicked.connect(lambda: self.send_custom_command(self.QLineEdit_custom_command.text()))
 
+        #---------------------------------------------------------------
+        # Channels widget.
+        #---------------------------------------------------------------
+
+        # Create items. One bar per channel, filled by the leader's
+        # "CHANNEL_SCAN" lines.
+        self.QLabel_channel_scan = QLabel("No scan yet.")
+        self.QProgressBars_channels = {}
+        self.QLabels_channels = {}
+        for channel in range(channel_first, channel_last + 1):
+            self.QProgressBars_channels[channel] = QProgressBar()
+            self.QLabels_channels[channel] = QLabel(str(channel))
+
+        # Create layout.
+        self.QLayout_channels = QGridLayout()
+        self.QLayout_channels.addWidget(self.QLabel_channel_scan, 0, 0, 1, channel_last - channel_first + 1)
+        for channel in range(channel_first, channel_last + 1):
+            self.QLayout_channels.addWidget(self.QProgressBars_channels[channel], 1, channel - channel_first)
+            self.QLayout_channels.addWidget(self.QLabels_channels[channel], 2, channel - channel_first)
+
+        # Create widget.
+        self.QWidget_channels = QWidget()
+        self.QWidget_channels.setLayout(self.QLayout_channels)
+        self.QWidget_channels.setProperty("css_class", "QWidget_large")
+
+        # Style.
+        for channel in range(channel_first, channel_last + 1):
+            self.QProgressBars_channels[channel].setOrientation(Qt.Orientation.Vertical)
+            self.QProgressBars_channels[channel].setRange(channel_energy_min, channel_energy_max)
+            self.QProgressBars_channels[channel].setValue(channel_energy_min)
+            self.QProgressBars_channels[channel].setTextVisible(False)
+            self.QProgressBars_channels[channel].setFixedHeight(size_2)
+            self.QLabels_channels[channel].setAlignment(Qt.AlignmentFlag.AlignCenter)
+
+        #---------------------------------------------------------------
+        # Topology widget.
+        #---------------------------------------------------------------
+
+        # Create items. Drawn from the leader's "TOPOLOGY" lines.
+        self.QLabel_topology = QLabel("No topology yet.")
+        self.QGraphicsScene_topology = QGraphicsScene()
+        self.QGraphicsView_topology = QGraphicsView(self.QGraphicsScene_topology)
+
+        # Create layout.
+        self.QLayout_topology = QGridLayout()
+        self.QLayout_topology.addWidget(self.QLabel_topology, 0, 0)
+        self.QLayout_topology.addWidget(self.QGraphicsView_topology, 1, 0)
+
+        # Create widget.
+        self.QWidget_topology = QWidget()
+        self.QWidget_topology.setLayout(self.QLayout_topology)
+        self.QWidget_topology.setProperty("css_class", "QWidget_large")
+
+        # Style.
+        self.QGraphicsView_topology.setFixedHeight(size_3)
+        self.QGraphicsView_topology.setRenderHint(QPainter.RenderHint.Antialiasing)
+
+        # Records of the walk being received, keyed by (kind, address).
+        self.topology_leader = 0x0000
+        self.topology_records = {}
+
+        #---------------------------------------------------------------
+        # Latency widget.
+        #---------------------------------------------------------------
+
+        # Create items. Filled by the leader's "LATENCY" lines, one row
+        # per stage and a histogram of one of them.
+        self.QLabel_latency = QLabel("No measurement yet.")
+        self.QLabels_latency_header = [QLabel(text) for text in ["Stage", "n", "p50 (ms)", "p95 (ms)", "p99 (ms)", "Max (ms)"]]
+        self.QLabels_latency = {}
+        for stage in latency_stages:
+            self.QLabels_latency[stage] = [QLabel(stage)] + [QLabel("-") for _ in range(5)]
+        self.QProgressBars_latency = [QProgressBar() for _ in range(latency_buckets)]
+        self.QLabels_latency_buckets = [QLabel(f"<{1 << bucket}") for bucket in range(latency_buckets - 1)] + [QLabel("more")]
+
+        # Create layout.
+        self.QLayout_latency = QGridLayout()
+        self.QLayout_latency.addWidget(self.QLabel_latency, 0, 0, 1, latency_buckets)
+        for column, QLabel_header in enumerate(self.QLabels_latency_header):
+            self.QLayout_latency.addWidget(QLabel_header, 1, column * 2, 1, 2)
+        for row, stage in enumerate(latency_stages):
+            for column, QLabel_value in enumerate(self.QLabels_latency[stage]):
+                self.QLayout_latency.addWidget(QLabel_value, row + 2, column * 2, 1, 2)
+        for bucket in range(latency_buckets):
+            self.QLayout_latency.addWidget(self.QProgressBars_latency[bucket], len(latency_stages) + 2, bucket)
+            self.QLayout_latency.addWidget(self.QLabels_latency_buckets[bucket], len(latency_stages) + 3, bucket)
+
+        # Create widget.
+        self.QWidget_latency = QWidget()
+        self.QWidget_latency.setLayout(self.QLayout_latency)
+        self.QWidget_latency.setProperty("css_class", "QWidget_large")
+
+        # Style.
+        for bucket in range(latency_buckets):
+            self.QProgressBars_latency[bucket].setOrientation(Qt.Orientation.Vertical)
+            self.QProgressBars_latency[bucket].setRange(0, 1)
+            self.QProgressBars_latency[bucket].setValue(0)
+            self.QProgressBars_latency[bucket].setTextVisible(False)
+            self.QProgressBars_latency[bucket].setFixedHeight(size_2)
+            self.QLabels_latency_buckets[bucket].setAlignment(Qt.AlignmentFlag.AlignCenter)
+
         #---------------------------------------------------------------
         # Terminal widget.
         #---------------------------------------------------------------
@@ -188,6 +398,12 @@ class window(QMainWindow):
         self.QLabel_port.setProperty("css_class", "QLabel_large")
         self.QLabel_commands = QLabel("Commands")
         self.QLabel_commands.setProperty("css_class", "QLabel_large")
+        self.QLabel_channels = QLabel("Channels")
+        self.QLabel_channels.setProperty("css_class", "QLabel_large")
+        self.QLabel_topology_title = QLabel("Topology")
+        self.QLabel_topology_title.setProperty("css_class", "QLabel_large")
+        self.QLabel_latency_title = QLabel("Latency")
+        self.QLabel_latency_title.setProperty("css_class", "QLabel_large")
         self.QLabel_terminal = QLabel("Terminal")
         self.QLabel_terminal.setProperty("css_class", "QLabel_large")
 
@@ -197,8 +413,14 @@ class window(QMainWindow):
         self.QLayout_central.addWidget(self.QWidget_port, 1, 0)
         self.QLayout_central.addWidget(self.QLabel_commands, 2, 0)
         self.QLayout_central.addWidget(self.QWidget_commands, 3, 0)
-        self.QLayout_central.addWidget(self.QLabel_terminal, 4, 0)
-        self.QLayout_central.addWidget(self.QWidget_terminal, 5, 0)
+        self.QLayout_central.addWidget(self.QLabel_channels, 4, 0)
+        self.QLayout_central.addWidget(self.QWidget_channels, 5, 0)
+        self.QLayout_central.addWidget(self.QLabel_topology_title, 6, 0)
+        self.QLayout_central.addWidget(self.QWidget_topology, 7, 0)
+        self.QLayout_central.addWidget(self.QLabel_latency_title, 8, 0)
+        self.QLayout_central.addWidget(self.QWidget_latency, 9, 0)
+        self.QLayout_central.addWidget(self.QLabel_terminal, 10, 0)
+        self.QLayout_central.addWidget(self.QWidget_terminal, 11, 0)
 
         # Create widget.
         self.QWidget_central = QWidget()
@@ -206,6 +428,25 @@ class window(QMainWindow):
         self.QWidget_central.setProperty("css_class", "QWidget_central")
         self.setCentralWidget(self.QWidget_central)
 
+        #---------------------------------------------------------------
+        # OTA upload.
+        #---------------------------------------------------------------
+
+        # The Zigbee OTA file being sent, and the frames the leader has
+        # and the next one to send.
+        self.ota_file = None
+        self.ota_frames = 0
+        self.ota_acked = 0
+        self.ota_next = 0
+        self.ota_retries = 0
+        self.ota_results = {}
+
+        # Sends the unacknowledged frames again when the leader goes
+        # quiet.
+        self.ota_timer = QTimer(self)
+        self.ota_timer.setSingleShot(True)
+        self.ota_timer.timeout.connect(self.retry_ota_upload)
+
         #---------------------------------------------------------------
         # Create a serial port.
         #---------------------------------------------------------------
@@ -281,6 +522,9 @@ class window(QMainWindow):
             self.timer = QTimer(self)
             self.timer.timeout.connect(self.read_from_port)
             self.timer.start(10)
+
+            # Give the leader the time of day, for its Time cluster.
+            self.send_command(f"leader_time {QDateTime.currentSecsSinceEpoch()}")
         # If connection failed.
         else:
             error_message = self.serial_port.errorString()
@@ -316,6 +560,378 @@ class window(QMainWindow):
             data = self.serial_port.readLine().data().decode()
             port_name = self.serial_port.portName()
             self.insert_into_terminal(f"{port_name}: {data}")
+            if "CHANNEL_SCAN" in data:
+                self.update_channels(data)
+            elif "TOPOLOGY" in data:
+                self.update_topology(data)
+            elif "LATENCY" in data:
+                self.update_latency(data)
+            elif "FOLLOWER_STATE" in data:
+                self.update_follower_state(data)
+            elif "OTA_" in data:
+                self.update_ota(data)
+            elif "STRESS" in data:
+                self.update_stress(data)
+
+    #===============================================================
+    # update_channels()
+    #===============================================================
+
+    def update_channels(self, line):
+        # Parse "CHANNEL_SCAN current=<n> best=<n> energy=<dBm>,...".
+        fields = {}
+        for field in line[line.index("CHANNEL_SCAN"):].split()[1:]:
+            if "=" in field:
+                key, value = field.split("=", 1)
+                fields[key] = value
+        try:
+            current = int(fields["current"])
+            best = int(fields["best"])
+            energies = [int(energy) for energy in fields["energy"].split(",")]
+        except (KeyError, ValueError):
+            self.insert_into_terminal("GUI: Could not parse channel scan.\n")
+            return
+
+        # Update the bars. Unmeasured channels read -128 and stay empty.
+        for channel, energy in zip(range(channel_first, channel_last + 1), energies):
+            QProgressBar_channel = self.QProgressBars_channels[channel]
+            QProgressBar_channel.setValue(max(channel_energy_min, min(channel_energy_max, energy)))
+            QProgressBar_channel.setToolTip(f"Channel {channel}: {energy} dBm")
+            if channel == current:
+                QProgressBar_channel.setProperty("css_class", "QProgressBar_current")
+            elif channel == best:
+                QProgressBar_channel.setProperty("css_class", "QProgressBar_best")
+            else:
+                QProgressBar_channel.setProperty("css_class", "")
+            # Re-apply the style sheet for the new property.
+            QProgressBar_channel.style().unpolish(QProgressBar_channel)
+            QProgressBar_channel.style().polish(QProgressBar_channel)
+
+        time = QTime.currentTime().toString("hh:mm:ss")
+        self.QLabel_channel_scan.setText(f"Current channel {current}, best channel {best}, scanned at {time}.")
+
+    #===============================================================
+    # update_topology()
+    #===============================================================
+
+    def update_topology(self, line):
+        # Lines are "TOPOLOGY_BEGIN leader=<addr>", "TOPOLOGY <hex>"
+        # and "TOPOLOGY_END records=<n>". The log tag also contains
+        # "TOPOLOGY", so look at whole words only.
+        words = line.split()
+        if "TOPOLOGY_BEGIN" in words:
+            self.topology_records = {}
+            for word in words:
+                if word.startswith("leader="):
+                    self.topology_leader = int(word[len("leader="):], 16)
+        elif "TOPOLOGY" in words:
+            try:
+                data = bytes.fromhex(words[words.index("TOPOLOGY") + 1])
+            except (IndexError, ValueError):
+                self.insert_into_terminal("GUI: Could not parse topology.\n")
+                return
+            for i in range(0, len(data) - topology_record_size + 1, topology_record_size):
+                record = data[i:i + topology_record_size]
+                kind = record[0]
+                address = int.from_bytes(record[1:3], "little")
+                # A record logged twice (the table changed mid-walk)
+                # simply replaces the first one.
+                self.topology_records[(kind, address)] = {
+                    "via": int.from_bytes(record[3:5], "little"),
+                    "relationship": record[5],
+                    "lqi": record[6],
+                    "cost": record[7],
+                    "age": record[8],
+                }
+        elif "TOPOLOGY_END" in words:
+            self.draw_topology()
+
+    #===============================================================
+    # draw_topology()
+    #===============================================================
+
+    def draw_topology(self):
+        # Find the parent of every device, the link it is closest to
+        # the leader through: a neighbour hangs off the leader, others
+        # off the first relay of their route record, or failing that
+        # off the next hop of their route.
+        parents = {}
+        for kind in (topology_route, topology_route_record, topology_neighbor):
+            for (record_kind, address), record in self.topology_records.items():
+                if record_kind == kind and address != self.topology_leader:
+                    parents[address] = (record["via"], record)
+
+        # Depth is the number of hops to the leader.
+        depths = {self.topology_leader: 0}
+        def depth_of(address, seen):
+            if address in depths:
+                return depths[address]
+            if address in seen or address not in parents:
+                return 1
+            seen.add(address)
+            depths[address] = depth_of(parents[address][0], seen) + 1
+            return depths[address]
+        for address in parents:
+            depth_of(address, set())
+
+        # Place every depth on its own ring around the leader.
+        rings = {}
+        for address, depth in depths.items():
+            rings.setdefault(depth, []).append(address)
+        positions = {}
+        for depth, addresses in rings.items():
+            for i, address in enumerate(sorted(addresses)):
+                angle = 2 * math.pi * i / len(addresses)
+                radius = depth * topology_ring_spacing
+                positions[address] = QPointF(radius * math.cos(angle), radius * math.sin(angle))
+
+        # Draw links under the devices, green for a good LQI, red for a
+        # bad one, dashed if the link is only known from routing.
+        self.QGraphicsScene_topology.clear()
+        for address, (via, record) in parents.items():
+            if address not in positions or via not in positions:
+                continue
+            lqi = record["lqi"]
+            pen = QPen(QColor.fromHsl(int(120 * lqi / 255), 160, 100) if lqi else QColor.fromHsl(0, 0, 100), 2)
+            if lqi == 0:
+                pen.setStyle(Qt.PenStyle.DashLine)
+            line = self.QGraphicsScene_topology.addLine(QLineF(positions[via], positions[address]), pen)
+            line.setToolTip(f"0x{address:04x} via 0x{via:04x}: LQI {lqi}, cost {record['cost']}, age {record['age']}")
+
+        # Draw devices.
+        for address, position in positions.items():
+            colour = QColor.fromHsl(210, 60, 100) if address == self.topology_leader else QColor.fromHsl(0, 0, 230)
+            node = self.QGraphicsScene_topology.addEllipse(position.x() - topology_node_size / 2, position.y() - topology_node_size / 2,
+                                                           topology_node_size, topology_node_size, QPen(QColor.fromHsl(0, 0, 40)), QBrush(colour))
+            node.setToolTip(f"0x{address:04x}, {depths[address]} hop(s)")
+            text = self.QGraphicsScene_topology.addSimpleText(f"{address:04x}")
+            text.setPos(position.x() - text.boundingRect().width() / 2, position.y() - text.boundingRect().height() / 2)
+
+        time = QTime.currentTime().toString("hh:mm:ss")
+        self.QLabel_topology.setText(f"{len(positions) - 1} device(s), {len(self.topology_records)} record(s), at {time}.")
+
+    #===============================================================
+    # update_latency()
+    #===============================================================
+
+    def update_latency(self, line):
+        # Lines are "LATENCY <stage> n=<n> p50=<us> p95=<us> p99=<us>
+        # max=<us> hist=<count>,..." and "LATENCY_END n=<n> lost=<n>".
+        # The log tag also contains "LATENCY", so look at whole words.
+        words = line.split()
+        fields = {}
+        for word in words:
+            if "=" in word:
+                key, value = word.split("=", 1)
+                fields[key] = value
+        if "LATENCY_END" in words:
+            time = QTime.currentTime().toString("hh:mm:ss")
+            self.QLabel_latency.setText(f"{fields.get('n', '?')} command(s), {fields.get('lost', '?')} lost, at {time}.")
+            return
+        if "LATENCY" not in words:
+            return
+        try:
+            stage = words[words.index("LATENCY") + 1]
+            values = [int(fields[key]) for key in ["n", "p50", "p95", "p99", "max"]]
+            buckets = [int(count) for count in fields["hist"].split(",")]
+        except (IndexError, KeyError, ValueError):
+            self.insert_into_terminal("GUI: Could not parse latency.\n")
+            return
+        if stage not in self.QLabels_latency:
+            return
+
+        # Percentiles, in ms.
+        self.QLabels_latency[stage][1].setText(str(values[0]))
+        for column, value in enumerate(values[1:]):
+            self.QLabels_latency[stage][column + 2].setText(f"{value / 1000:.1f}")
+
+        # Histogram.
+        if stage == latency_histogram_stage:
+            highest = max(buckets + [1])
+            for bucket, count in enumerate(buckets[:latency_buckets]):
+                self.QProgressBars_latency[bucket].setRange(0, highest)
+                self.QProgressBars_latency[bucket].setValue(count)
+                self.QProgressBars_latency[bucket].setToolTip(f"{count} sample(s)")
+
+    #===============================================================
+    # update_stress()
+    #===============================================================
+
+    def update_stress(self, line):
+        # Lines are "STRESS rate=<per s> attempted=<n> ... delivered=<n>
+        # ... delivered_per_s=<n> loss_pct=<%> p50=<us> p95=<us> p99=<us>
+        # max=<us>". The log tag also contains "STRESS", so look at
+        # whole words.
+        words = line.split()
+        if "STRESS" not in words:
+            return
+        fields = {}
+        for word in words:
+            if "=" in word:
+                key, value = word.split("=", 1)
+                fields[key] = value
+        try:
+            text = (f"{fields['delivered']}/{fields['expected']} delivered at {fields['delivered_per_s']}/s, "
+                    f"{fields['loss_pct']}% lost, p50 {int(fields['p50']) / 1000:.1f} ms, p99 {int(fields['p99']) / 1000:.1f} ms.")
+        except (KeyError, ValueError):
+            self.insert_into_terminal("GUI: Could not parse stress test.\n")
+            return
+        self.QLabel_leader_stress.setText(text)
+        self.QLabel_leader_stress.setToolTip(line.strip())
+
+    #===============================================================
+    # update_follower_state()
+    #===============================================================
+
+    def update_follower_state(self, line):
+        # Lines are "FOLLOWER_STATE id=<id> on_off=<on|off|unknown>
+        # effect=<name> age_s=<s> lookup_us=<us>".
+        fields = {}
+        for word in line.split():
+            if "=" in word:
+                key, value = word.split("=", 1)
+                fields[key] = value
+        try:
+            text = (f"Follower {fields['id']}: {fields['on_off']}, {fields['effect']}, "
+                    f"reported {fields['age_s']} s ago, answered in {fields['lookup_us']} us.")
+        except KeyError:
+            self.insert_into_terminal("GUI: Could not parse follower state.\n")
+            return
+        self.QLabel_follower_state.setText(text)
+
+    #===============================================================
+    # start_ota_upload()
+    #===============================================================
+
+    def start_ota_upload(self):
+        # Check if port is still open.
+        if not self.serial_port.isOpen():
+            self.insert_into_terminal("GUI: No ports connected.\n")
+            return
+
+        # Get the follower image and the version to give it, which
+        # must be the LIGHT_OTA_FILE_VERSION it was built with.
+        path, _ = QFileDialog.getOpenFileName(self, "Follower Image", "", "Images (*.bin)")
+        if path == "":
+            return
+        text, ok = QInputDialog.getText(self, "Follower Image", "File version (hex):", text="00000002")
+        if not ok:
+            return
+        try:
+            file_version = int(text, 16)
+            with open(path, "rb") as file:
+                image = file.read()
+        except (OSError, ValueError) as error:
+            self.insert_into_terminal(f"GUI: Could not read the image: {error}.\n")
+            return
+
+        # Wrap it in a Zigbee OTA file: the header, then the image as
+        # the one tag.
+        total_size = ota_header_size + 6 + len(image)
+        header = struct.pack("<IHHHHHIH32sI", ota_file_identifier, ota_header_version, ota_header_size, 0,
+                             ota_manufacturer_code, ota_image_type, file_version, ota_stack_version,
+                             ota_header_string, total_size)
+        self.ota_file = header + struct.pack("<HI", ota_tag_upgrade_image, len(image)) + image
+        self.ota_frames = (len(self.ota_file) + ota_chunk_size - 1) // ota_chunk_size
+        self.ota_acked = 0
+        self.ota_next = 0
+        self.ota_retries = 0
+        self.ota_results = {}
+        self.QProgressBar_follower_ota.setRange(0, self.ota_frames)
+        self.QProgressBar_follower_ota.setValue(0)
+        self.QLabel_follower_ota.setText("Erasing the staging area...")
+
+        # The leader answers "OTA_UPLOAD ready" once it is erased.
+        self.send_command(f"leader_ota_upload {len(self.ota_file)}")
+
+    #===============================================================
+    # send_ota_frames()
+    #===============================================================
+
+    def send_ota_frames(self):
+        # Keep up to a window of frames in flight.
+        while self.ota_next < self.ota_frames and self.ota_next < self.ota_acked + ota_window:
+            payload = self.ota_file[self.ota_next * ota_chunk_size:(self.ota_next + 1) * ota_chunk_size]
+            body = struct.pack("<HH", self.ota_next, len(payload)) + payload
+            frame = bytes([ota_frame_start]) + body + struct.pack("<I", zlib.crc32(body))
+            self.serial_port.write(frame)
+            self.ota_next += 1
+        self.ota_timer.start(ota_retry_ms)
+
+    #===============================================================
+    # retry_ota_upload()
+    #===============================================================
+
+    def retry_ota_upload(self):
+        if self.ota_file is None:
+            return
+        self.ota_retries += 1
+        if self.ota_retries > ota_max_retries or not self.serial_port.isOpen():
+            self.QLabel_follower_ota.setText("Upload failed, the leader stopped answering.")
+            self.ota_file = None
+            return
+        self.ota_next = self.ota_acked
+        self.send_ota_frames()
+
+    #===============================================================
+    # update_ota()
+    #===============================================================
+
+    def update_ota(self, line):
+        # Lines are "OTA_UPLOAD <ready|done|failed|aborted> ...",
+        # "OTA_ACK seq=<n>", "OTA_NAK seq=<n>", "OTA_DONE short=<addr>
+        # id=<id> ms=<ms> bytes=<n> concurrent=<n> max_concurrent=<n>"
+        # and "OTA_STATUS ...". The log tags also contain "OTA_", so
+        # look at whole words.
+        words = line.split()
+        fields = {}
+        for word in words:
+            if "=" in word:
+                key, value = word.split("=", 1)
+                fields[key] = value
+        try:
+            if "OTA_ACK" in words and self.ota_file is not None:
+                # Everything up to the frame is written.
+                seq = int(fields["seq"])
+                if seq >= self.ota_acked:
+                    self.ota_acked = seq + 1
+                    self.ota_next = max(self.ota_next, self.ota_acked)
+                    self.ota_retries = 0
+                self.QProgressBar_follower_ota.setValue(self.ota_acked)
+                if self.ota_acked < self.ota_frames:
+                    self.send_ota_frames()
+                else:
+                    self.ota_timer.stop()
+            elif "OTA_NAK" in words and self.ota_file is not None:
+                # Send again from the frame the leader is missing.
+                seq = int(fields["seq"])
+                self.ota_acked = max(self.ota_acked, seq)
+                self.ota_next = seq
+                self.send_ota_frames()
+            elif "OTA_UPLOAD" in words:
+                state = words[words.index("OTA_UPLOAD") + 1]
+                if state == "ready" and self.ota_file is not None:
+                    self.QLabel_follower_ota.setText("Uploading...")
+                    self.send_ota_frames()
+                elif state == "done":
+                    self.ota_file = None
+                    self.ota_timer.stop()
+                    self.QLabel_follower_ota.setText(f"Staged in {int(fields['ms']) / 1000:.1f} s, followers notified.")
+                elif state in ("failed", "aborted"):
+                    self.ota_file = None
+                    self.ota_timer.stop()
+                    self.QLabel_follower_ota.setText(f"Upload {state}.")
+            elif "OTA_DONE" in words:
+                # One line per follower, the latest last.
+                self.ota_results[fields["short"]] = (f"Follower {fields['id']}: {int(fields['bytes'])} bytes in "
+                                                     f"{int(fields['ms']) / 1000:.1f} s, {fields['concurrent']} at once "
+                                                     f"(max {fields['max_concurrent']}).")
+                self.QLabel_follower_ota.setText("\n".join(self.ota_results.values()))
+            elif "OTA_STATUS" in words:
+                self.QLabel_follower_ota.setText(f"{fields['done']} done, {fields['aborted']} aborted, {fields['active']} "
+                                                 f"active (max {fields['max_concurrent']}).")
+        except (IndexError, KeyError, ValueError):
+            self.insert_into_terminal("GUI: Could not parse OTA.\n")
 
     #===============================================================
     # send_command()
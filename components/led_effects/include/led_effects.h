@@ -0,0 +1,180 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: A timer-driven LED effects engine. Effects are
+ * rendered in fixed point (Q16.16 for time, Q8.8 for intensity) on
+ * a periodic timer at a configurable frame rate. If rendering falls
+ * behind, late frames are skipped instead of queued. */
+
+#pragma once
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "led_strip.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define LED_EFFECTS_DEFAULT_FPS 50
+#define LED_EFFECTS_MAX_FPS 200
+#define LED_EFFECTS_DEFAULT_COLOR 255
+#define LED_EFFECTS_DEFAULT_PERIOD_MS 2000
+
+/* Size of an effect when it is sent as a command payload. */
+#define LED_EFFECTS_PARAMS_WIRE_SIZE 7
+
+/*##############################################################
+ * TYPEDEFS
+ *############################################################*/
+
+typedef enum
+{
+    LED_EFFECT_NONE = 0,
+    LED_EFFECT_SOLID,
+    LED_EFFECT_FADE,
+    LED_EFFECT_BREATHE,
+    LED_EFFECT_RAINBOW,
+    LED_EFFECT_CHASE,
+    LED_EFFECT_STROBE,
+    LED_EFFECT_COUNT
+} led_effect_type_t;
+
+typedef struct
+{
+    led_effect_type_t type;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    /* Overall intensity from 0 (0%) to 255 (100%). */
+    uint8_t brightness;
+    /* Length of one effect cycle (or of the whole fade). */
+    uint16_t period_ms;
+} led_effect_params_t;
+
+typedef struct
+{
+    led_strip_handle_t strip;
+    uint32_t led_count;
+    uint32_t fps;
+    UBaseType_t task_priority;
+} led_effects_config_t;
+
+typedef struct
+{
+    uint32_t target_fps;
+    /* Frames per second measured over the last second, times 100. */
+    uint32_t achieved_fps_x100;
+    uint32_t frames_rendered;
+    uint32_t frames_skipped;
+    /* Time to render and refresh one frame. */
+    uint32_t last_render_us;
+    uint32_t max_render_us;
+} led_effects_stats_t;
+
+/*##############################################################
+ * FUNCTION PROTOTYPES
+ *############################################################*/
+
+/*--------------------------------------------------------------
+ * led_effects_init()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Create the frame timer and the render task. No effect runs
+ * until led_effects_start() is called.
+ *
+ * @param config The strip to draw on and how often to draw it.
+ */
+esp_err_t led_effects_init(const led_effects_config_t *config);
+
+/*--------------------------------------------------------------
+ * led_effects_start()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Start an effect, replacing the one that is running.
+ *
+ * @note Fades start from the colour of the last rendered frame.
+ */
+esp_err_t led_effects_start(const led_effect_params_t *params);
+
+/*--------------------------------------------------------------
+ * led_effects_stop()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Stop the running effect. When this returns the engine no
+ * longer touches the strip, so the caller may draw on it directly.
+ */
+void led_effects_stop(void);
+
+/*--------------------------------------------------------------
+ * led_effects_is_running()
+ *------------------------------------------------------------*/
+
+bool led_effects_is_running(void);
+
+/*--------------------------------------------------------------
+ * led_effects_set_fps()
+ *------------------------------------------------------------*/
+
+esp_err_t led_effects_set_fps(uint32_t fps);
+
+/*--------------------------------------------------------------
+ * led_effects_get_stats()
+ *------------------------------------------------------------*/
+
+void led_effects_get_stats(led_effects_stats_t *stats);
+
+/*--------------------------------------------------------------
+ * led_effects_type_to_string()
+ *------------------------------------------------------------*/
+
+const char *led_effects_type_to_string(led_effect_type_t type);
+
+/*--------------------------------------------------------------
+ * led_effects_params_from_string()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Parse "<name> [red green blue [brightness [period_ms]]]",
+ * for example "breathe 0 0 255 64 3000". Missing values are set to
+ * their defaults.
+ */
+esp_err_t led_effects_params_from_string(const char *string, led_effect_params_t *params);
+
+/*--------------------------------------------------------------
+ * led_effects_params_to_bytes()
+ *------------------------------------------------------------*/
+
+/**
+ * @brief Pack an effect into LED_EFFECTS_PARAMS_WIRE_SIZE bytes so
+ * that it can be sent over Zigbee.
+ */
+void led_effects_params_to_bytes(const led_effect_params_t *params, uint8_t *bytes);
+
+/*--------------------------------------------------------------
+ * led_effects_params_from_bytes()
+ *------------------------------------------------------------*/
+
+esp_err_t led_effects_params_from_bytes(const uint8_t *bytes, uint16_t size, led_effect_params_t *params);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
@@ -0,0 +1,537 @@
+/*##############################################################
+ * FILE INFO
+ *############################################################*/
+
+/* Author: Travis Fredrickson.
+ * Date: 2026-10-19.
+ * Description: A timer-driven LED effects engine. */
+
+/* How frames are paced:
+ *     - A periodic `esp_timer` gives the render task a notification
+ *       every frame.
+ *     - The render task takes *all* pending notifications at once. If
+ *       more than one was pending, the task fell behind, and the extra
+ *       frames are counted as skipped instead of being drawn late.
+ *     - Every frame is drawn from the time since the effect started,
+ *       so skipping frames never slows an effect down. */
+
+/*##############################################################
+ * INCLUDES
+ *############################################################*/
+
+/*==============================================================
+ * Standard.
+ *============================================================*/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+/*==============================================================
+ * ESP.
+ *============================================================*/
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+/*==============================================================
+ * FreeRTOS.
+ *============================================================*/
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+/*==============================================================
+ * User.
+ *============================================================*/
+
+#include "led_effects.h"
+
+/*##############################################################
+ * DEFINES
+ *############################################################*/
+
+#define LED_EFFECTS_TASK_STACK_DEPTH 3072
+
+/* Fixed point. Time within a cycle is Q16.16 (0x10000 = one whole
+ * cycle). Intensity is Q8.8 (0x100 = 100%). */
+#define Q16_ONE 0x10000UL
+#define Q8_ONE 0x100UL
+
+/* Fraction of a strobe cycle during which the LEDs are on. */
+#define STROBE_DUTY_Q16 (Q16_ONE / 8)
+
+/* Number of LEDs in the tail behind the head of a chase. */
+#define CHASE_TAIL_LENGTH 4
+
+/*##############################################################
+ * CONSTANTS
+ *############################################################*/
+
+static const char *TAG = "LED_EFFECTS";
+
+static const char *effect_names[LED_EFFECT_COUNT] = {
+    [LED_EFFECT_NONE] = "none",
+    [LED_EFFECT_SOLID] = "solid",
+    [LED_EFFECT_FADE] = "fade",
+    [LED_EFFECT_BREATHE] = "breathe",
+    [LED_EFFECT_RAINBOW] = "rainbow",
+    [LED_EFFECT_CHASE] = "chase",
+    [LED_EFFECT_STROBE] = "strobe",
+};
+
+/*##############################################################
+ * GLOBAL VARIABLES
+ *############################################################*/
+
+static led_effects_config_t s_config;
+static esp_timer_handle_t s_frame_timer = NULL;
+static TaskHandle_t s_render_task_handle = NULL;
+
+/* Guards everything below it. Held while a frame is drawn. */
+static SemaphoreHandle_t s_mutex = NULL;
+static led_effect_params_t s_params;
+static int64_t s_start_us;
+static uint8_t s_from[3];
+static uint8_t s_last[3];
+static led_effects_stats_t s_stats;
+static int64_t s_fps_window_start_us;
+static uint32_t s_fps_window_frames;
+
+/*##############################################################
+ * FUNCTIONS
+ *############################################################*/
+
+/*==============================================================
+ * Fixed point.
+ *============================================================*/
+
+/*--------------------------------------------------------------
+ * scale_q8()
+ *------------------------------------------------------------*/
+
+static inline uint8_t scale_q8(uint8_t value, uint32_t scale_q8)
+{
+    return (uint8_t)(((uint32_t)value * scale_q8) >> 8);
+}
+
+/*--------------------------------------------------------------
+ * cycle_phase_q16()
+ *------------------------------------------------------------*/
+
+/* Where we are within the current cycle, from 0 to Q16_ONE - 1. */
+static inline uint32_t cycle_phase_q16(int64_t elapsed_us, uint32_t period_us)
+{
+    return (uint32_t)((((uint64_t)elapsed_us % period_us) << 16) / period_us);
+}
+
+/*--------------------------------------------------------------
+ * hue_to_rgb()
+ *------------------------------------------------------------*/
+
+/* Integer colour wheel: 0 is red, 85 is green and 170 is blue. */
+static void hue_to_rgb(uint8_t hue, uint8_t brightness, uint8_t *red, uint8_t *green, uint8_t *blue)
+{
+    uint8_t rising = (uint8_t)((hue % 85) * 3);
+    uint8_t falling = 255 - rising;
+    if (hue < 85)
+    {
+        *red = falling;
+        *green = rising;
+        *blue = 0;
+    }
+    else if (hue < 170)
+    {
+        *red = 0;
+        *green = falling;
+        *blue = rising;
+    }
+    else
+    {
+        *red = rising;
+        *green = 0;
+        *blue = falling;
+    }
+    *red = scale_q8(*red, brightness + 1);
+    *green = scale_q8(*green, brightness + 1);
+    *blue = scale_q8(*blue, brightness + 1);
+}
+
+/*==============================================================
+ * Rendering.
+ *============================================================*/
+
+/*--------------------------------------------------------------
+ * render_frame()
+ *------------------------------------------------------------*/
+
+/* Draws one frame. Returns true if the effect has finished and the
+ * frame timer can be stopped. Must be called with `s_mutex` held. */
+static bool render_frame(int64_t now_us)
+{
+    const led_effect_params_t *p = &s_params;
+    const uint32_t count = s_config.led_count;
+    const uint32_t period_us = (uint32_t)(p->period_ms ? p->period_ms : 1) * 1000;
+    const int64_t elapsed_us = now_us - s_start_us;
+    const uint32_t phase_q16 = cycle_phase_q16(elapsed_us, period_us);
+    const uint32_t level_q8 = (uint32_t)p->brightness + 1;
+    uint8_t base[3] = {
+        scale_q8(p->red, level_q8),
+        scale_q8(p->green, level_q8),
+        scale_q8(p->blue, level_q8),
+    };
+    bool is_finished = false;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t rgb[3] = {0, 0, 0};
+        switch (p->type)
+        {
+        case LED_EFFECT_SOLID:
+            memcpy(rgb, base, sizeof(rgb));
+            is_finished = true;
+            break;
+        case LED_EFFECT_FADE:
+        {
+            /* Linear interpolation from `s_from` to `base`. */
+            uint32_t t_q16 = elapsed_us >= period_us ? Q16_ONE : (uint32_t)(((uint64_t)elapsed_us << 16) / period_us);
+            for (int c = 0; c < 3; c++)
+            {
+                int32_t delta = (int32_t)base[c] - (int32_t)s_from[c];
+                rgb[c] = (uint8_t)((int32_t)s_from[c] + ((delta * (int32_t)t_q16) >> 16));
+            }
+            is_finished = (t_q16 == Q16_ONE);
+            break;
+        }
+        case LED_EFFECT_BREATHE:
+        {
+            /* Triangle wave, squared so it looks smooth to the eye. */
+            uint32_t triangle_q8 = (phase_q16 < Q16_ONE / 2 ? phase_q16 : (Q16_ONE - 1) - phase_q16) >> 7;
+            uint32_t breath_q8 = (triangle_q8 * triangle_q8) >> 8;
+            for (int c = 0; c < 3; c++)
+            {
+                rgb[c] = scale_q8(base[c], breath_q8);
+            }
+            break;
+        }
+        case LED_EFFECT_RAINBOW:
+        {
+            uint8_t hue = (uint8_t)((phase_q16 >> 8) + (i * 256) / count);
+            hue_to_rgb(hue, p->brightness, &rgb[0], &rgb[1], &rgb[2]);
+            break;
+        }
+        case LED_EFFECT_CHASE:
+        {
+            uint32_t head = (uint32_t)(((uint64_t)phase_q16 * count) >> 16);
+            uint32_t distance = (head + count - i) % count;
+            if (distance < CHASE_TAIL_LENGTH)
+            {
+                /* Each LED in the tail is a quarter as bright as the
+                 * one in front of it. */
+                uint32_t tail_q8 = Q8_ONE >> (2 * distance);
+                for (int c = 0; c < 3; c++)
+                {
+                    rgb[c] = scale_q8(base[c], tail_q8);
+                }
+            }
+            break;
+        }
+        case LED_EFFECT_STROBE:
+            if (phase_q16 < STROBE_DUTY_Q16)
+            {
+                memcpy(rgb, base, sizeof(rgb));
+            }
+            break;
+        case LED_EFFECT_NONE:
+        default:
+            is_finished = true;
+            break;
+        }
+        if (i == 0)
+        {
+            memcpy(s_last, rgb, sizeof(s_last));
+        }
+        led_strip_set_pixel(s_config.strip, i, rgb[0], rgb[1], rgb[2]);
+    }
+    led_strip_refresh(s_config.strip);
+    return is_finished;
+}
+
+/*--------------------------------------------------------------
+ * update_stats()
+ *------------------------------------------------------------*/
+
+/* Must be called with `s_mutex` held. */
+static void update_stats(int64_t start_us, int64_t end_us, uint32_t skipped)
+{
+    uint32_t render_us = (uint32_t)(end_us - start_us);
+    s_stats.frames_rendered++;
+    s_stats.frames_skipped += skipped;
+    s_stats.last_render_us = render_us;
+    if (render_us > s_stats.max_render_us)
+    {
+        s_stats.max_render_us = render_us;
+    }
+
+    /* Achieved FPS is measured over windows of about one second. */
+    s_fps_window_frames++;
+    int64_t window_us = end_us - s_fps_window_start_us;
+    if (window_us >= 1000000)
+    {
+        s_stats.achieved_fps_x100 = (uint32_t)(((uint64_t)s_fps_window_frames * 100 * 1000000) / window_us);
+        s_fps_window_frames = 0;
+        s_fps_window_start_us = end_us;
+    }
+}
+
+/*--------------------------------------------------------------
+ * frame_timer_cb()
+ *------------------------------------------------------------*/
+
+static void frame_timer_cb(void *arg)
+{
+    xTaskNotifyGive(s_render_task_handle);
+}
+
+/*--------------------------------------------------------------
+ * render_task()
+ *------------------------------------------------------------*/
+
+static void render_task(void *pvParameter)
+{
+    /* Loop forever. */
+    for (;;)
+    {
+        /* Take every pending frame at once. All but one are skipped. */
+        uint32_t pending = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        if (s_params.type != LED_EFFECT_NONE)
+        {
+            int64_t start_us = esp_timer_get_time();
+            bool is_finished = render_frame(start_us);
+            update_stats(start_us, esp_timer_get_time(), pending - 1);
+            if (is_finished)
+            {
+                /* Nothing left to animate, so stop waking up. */
+                esp_timer_stop(s_frame_timer);
+            }
+        }
+        xSemaphoreGive(s_mutex);
+    }
+
+    /* It should never reach here. */
+    vTaskDelete(NULL);
+}
+
+/*==============================================================
+ * Public.
+ *============================================================*/
+
+/*--------------------------------------------------------------
+ * led_effects_init()
+ *------------------------------------------------------------*/
+
+esp_err_t led_effects_init(const led_effects_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->strip && config->led_count, ESP_ERR_INVALID_ARG, TAG, "Invalid config");
+    ESP_RETURN_ON_FALSE(s_mutex == NULL, ESP_ERR_INVALID_STATE, TAG, "Already initialized");
+    s_config = *config;
+    if (s_config.fps == 0 || s_config.fps > LED_EFFECTS_MAX_FPS)
+    {
+        s_config.fps = LED_EFFECTS_DEFAULT_FPS;
+    }
+    s_stats.target_fps = s_config.fps;
+
+    s_mutex = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(s_mutex, ESP_ERR_NO_MEM, TAG, "Failed to create mutex");
+    BaseType_t created = xTaskCreate(
+        &render_task,
+        "led_effects",
+        LED_EFFECTS_TASK_STACK_DEPTH,
+        NULL,
+        s_config.task_priority,
+        &s_render_task_handle);
+    ESP_RETURN_ON_FALSE(created == pdPASS, ESP_ERR_NO_MEM, TAG, "Failed to create render task");
+    const esp_timer_create_args_t timer_args = {
+        .callback = &frame_timer_cb,
+        .name = "led_effects",
+    };
+    return esp_timer_create(&timer_args, &s_frame_timer);
+}
+
+/*--------------------------------------------------------------
+ * led_effects_start()
+ *------------------------------------------------------------*/
+
+esp_err_t led_effects_start(const led_effect_params_t *params)
+{
+    ESP_RETURN_ON_FALSE(s_mutex, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE(params && params->type < LED_EFFECT_COUNT, ESP_ERR_INVALID_ARG, TAG, "Invalid effect");
+    if (params->type == LED_EFFECT_NONE)
+    {
+        led_effects_stop();
+        return ESP_OK;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_timer_stop(s_frame_timer);
+    memcpy(s_from, s_last, sizeof(s_from));
+    s_params = *params;
+    s_start_us = esp_timer_get_time();
+    s_fps_window_start_us = s_start_us;
+    s_fps_window_frames = 0;
+    esp_err_t ret = esp_timer_start_periodic(s_frame_timer, 1000000 / s_config.fps);
+    xSemaphoreGive(s_mutex);
+
+    /* Draw the first frame now instead of one period from now. */
+    xTaskNotifyGive(s_render_task_handle);
+    ESP_LOGI(TAG, "Started effect \"%s\" at %" PRIu32 " FPS.", led_effects_type_to_string(params->type), s_config.fps);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * led_effects_stop()
+ *------------------------------------------------------------*/
+
+void led_effects_stop(void)
+{
+    if (s_mutex == NULL)
+    {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    esp_timer_stop(s_frame_timer);
+    s_params.type = LED_EFFECT_NONE;
+    xSemaphoreGive(s_mutex);
+}
+
+/*--------------------------------------------------------------
+ * led_effects_is_running()
+ *------------------------------------------------------------*/
+
+bool led_effects_is_running(void)
+{
+    return s_frame_timer && esp_timer_is_active(s_frame_timer);
+}
+
+/*--------------------------------------------------------------
+ * led_effects_set_fps()
+ *------------------------------------------------------------*/
+
+esp_err_t led_effects_set_fps(uint32_t fps)
+{
+    ESP_RETURN_ON_FALSE(s_mutex, ESP_ERR_INVALID_STATE, TAG, "Not initialized");
+    ESP_RETURN_ON_FALSE(fps > 0 && fps <= LED_EFFECTS_MAX_FPS, ESP_ERR_INVALID_ARG, TAG, "FPS must be 1 to %d", LED_EFFECTS_MAX_FPS);
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    s_config.fps = fps;
+    s_stats.target_fps = fps;
+    if (esp_timer_is_active(s_frame_timer))
+    {
+        esp_timer_stop(s_frame_timer);
+        ret = esp_timer_start_periodic(s_frame_timer, 1000000 / fps);
+    }
+    xSemaphoreGive(s_mutex);
+    return ret;
+}
+
+/*--------------------------------------------------------------
+ * led_effects_get_stats()
+ *------------------------------------------------------------*/
+
+void led_effects_get_stats(led_effects_stats_t *stats)
+{
+    if (s_mutex == NULL)
+    {
+        memset(stats, 0, sizeof(*stats));
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    *stats = s_stats;
+    xSemaphoreGive(s_mutex);
+}
+
+/*--------------------------------------------------------------
+ * led_effects_type_to_string()
+ *------------------------------------------------------------*/
+
+const char *led_effects_type_to_string(led_effect_type_t type)
+{
+    return type < LED_EFFECT_COUNT ? effect_names[type] : "invalid";
+}
+
+/*--------------------------------------------------------------
+ * led_effects_params_from_string()
+ *------------------------------------------------------------*/
+
+esp_err_t led_effects_params_from_string(const char *string, led_effect_params_t *params)
+{
+    char name[16];
+    unsigned red = LED_EFFECTS_DEFAULT_COLOR;
+    unsigned green = LED_EFFECTS_DEFAULT_COLOR;
+    unsigned blue = LED_EFFECTS_DEFAULT_COLOR;
+    unsigned brightness = 255;
+    unsigned period_ms = LED_EFFECTS_DEFAULT_PERIOD_MS;
+
+    ESP_RETURN_ON_FALSE(string && params, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    int fields = sscanf(string, "%15s %u %u %u %u %u", name, &red, &green, &blue, &brightness, &period_ms);
+    ESP_RETURN_ON_FALSE(fields >= 1, ESP_ERR_INVALID_ARG, TAG, "Missing effect name");
+    ESP_RETURN_ON_FALSE(fields == 1 || fields >= 4, ESP_ERR_INVALID_ARG, TAG, "Give all of red, green and blue");
+    ESP_RETURN_ON_FALSE(red <= 255 && green <= 255 && blue <= 255 && brightness <= 255,
+                        ESP_ERR_INVALID_ARG, TAG, "Colors and brightness must be 0 to 255");
+    ESP_RETURN_ON_FALSE(period_ms > 0 && period_ms <= UINT16_MAX, ESP_ERR_INVALID_ARG, TAG, "Invalid period");
+
+    params->type = LED_EFFECT_COUNT;
+    for (int type = 0; type < LED_EFFECT_COUNT; type++)
+    {
+        if (strcasecmp(name, effect_names[type]) == 0)
+        {
+            params->type = (led_effect_type_t)type;
+            break;
+        }
+    }
+    ESP_RETURN_ON_FALSE(params->type < LED_EFFECT_COUNT, ESP_ERR_NOT_FOUND, TAG, "Unknown effect \"%s\"", name);
+    params->red = (uint8_t)red;
+    params->green = (uint8_t)green;
+    params->blue = (uint8_t)blue;
+    params->brightness = (uint8_t)brightness;
+    params->period_ms = (uint16_t)period_ms;
+    return ESP_OK;
+}
+
+/*--------------------------------------------------------------
+ * led_effects_params_to_bytes()
+ *------------------------------------------------------------*/
+
+void led_effects_params_to_bytes(const led_effect_params_t *params, uint8_t *bytes)
+{
+    bytes[0] = (uint8_t)params->type;
+    bytes[1] = params->red;
+    bytes[2] = params->green;
+    bytes[3] = params->blue;
+    bytes[4] = params->brightness;
+    /* Little endian, like the rest of Zigbee. */
+    bytes[5] = (uint8_t)(params->period_ms & 0xFF);
+    bytes[6] = (uint8_t)(params->period_ms >> 8);
+}
+
+/*--------------------------------------------------------------
+ * led_effects_params_from_bytes()
+ *------------------------------------------------------------*/
+
+esp_err_t led_effects_params_from_bytes(const uint8_t *bytes, uint16_t size, led_effect_params_t *params)
+{
+    ESP_RETURN_ON_FALSE(bytes && params, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(size >= LED_EFFECTS_PARAMS_WIRE_SIZE, ESP_ERR_INVALID_SIZE, TAG, "Payload too short (%u bytes)", size);
+    ESP_RETURN_ON_FALSE(bytes[0] < LED_EFFECT_COUNT, ESP_ERR_INVALID_ARG, TAG, "Unknown effect %u", bytes[0]);
+    params->type = (led_effect_type_t)bytes[0];
+    params->red = bytes[1];
+    params->green = bytes[2];
+    params->blue = bytes[3];
+    params->brightness = bytes[4];
+    params->period_ms = (uint16_t)(bytes[5] | (bytes[6] << 8));
+    return ESP_OK;
+}
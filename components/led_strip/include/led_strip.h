@@ -95,6 +95,38 @@ esp_err_t led_strip_refresh(led_strip_handle_t strip);
  */
 esp_err_t led_strip_clear(led_strip_handle_t strip);
 
+/**
+ * @brief Set the global brightness of the LED strip
+ *
+ * @note Brightness and gamma are folded into a 256-entry lookup table that is applied while the pixels are encoded,
+ *       so the values given to `led_strip_set_pixel` are kept as they are and dimming does not rewrite them.
+ * @note Takes effect on the next `led_strip_refresh`. A frame already being sent by another task keeps the old value.
+ *
+ * @param strip: LED strip
+ * @param brightness: 0 (off) to 255 (full, the default)
+ *
+ * @return
+ *      - ESP_OK: Set brightness successfully
+ *      - ESP_ERR_INVALID_ARG: Set brightness failed because of invalid parameters
+ *      - ESP_ERR_NOT_SUPPORTED: The backend does not support color correction
+ */
+esp_err_t led_strip_set_brightness(led_strip_handle_t strip, uint8_t brightness);
+
+/**
+ * @brief Set the gamma correction of the LED strip
+ *
+ * @note Takes effect on the next `led_strip_refresh`. A frame already being sent by another task keeps the old value.
+ *
+ * @param strip: LED strip
+ * @param gamma: gamma exponent, 1.0 (the default) means linear, 2.2 - 2.8 suits most WS2812 LEDs
+ *
+ * @return
+ *      - ESP_OK: Set gamma successfully
+ *      - ESP_ERR_INVALID_ARG: Set gamma failed because of invalid parameters
+ *      - ESP_ERR_NOT_SUPPORTED: The backend does not support color correction
+ */
+esp_err_t led_strip_set_gamma(led_strip_handle_t strip, float gamma);
+
 /**
  * @brief Free LED strip resources
  *
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <stdbool.h>
 #include <stdint.h>
 #include "esp_err.h"
 #include "led_strip_types.h"
@@ -34,6 +35,21 @@ typedef struct {
     } flags;                    /*!< Extra driver flags */
 } led_strip_rmt_config_t;
 
+/**
+ * @brief LED strip RMT statistics
+ */
+typedef struct {
+    uint32_t frames;             /*!< Number of refreshes */
+    uint32_t refills;            /*!< Refill interrupts over all frames, 0 when the whole frame fits in the channel memory or DMA buffer */
+    uint32_t underruns;          /*!< Refills that came after the channel memory had run dry, each one is a likely glitch */
+    uint32_t last_encode_calls;  /*!< Encoder calls in the last frame, 1 + refill interrupts */
+    uint32_t last_encode_cycles; /*!< CPU cycles spent in the encoder in the last frame */
+    uint32_t max_encode_cycles;  /*!< Largest `last_encode_cycles` seen */
+    uint32_t last_frame_us;      /*!< Time from starting the last transmission until it finished */
+    uint32_t mem_block_symbols;  /*!< Channel memory (or DMA buffer) size in use */
+    bool with_dma;               /*!< Whether the channel really uses DMA */
+} led_strip_rmt_stats_t;
+
 /**
  * @brief Create LED strip based on RMT TX channel
  *
@@ -48,6 +64,20 @@ typedef struct {
  */
 esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip);
 
+/**
+ * @brief Get the refill, underrun and encoder profile of an RMT LED strip
+ *
+ * @note Compare a build with `flags.with_dma` set to one without it to see the CPU time DMA saves.
+ *
+ * @param strip: LED strip created by `led_strip_new_rmt_device`
+ * @param stats: returned statistics
+ *
+ * @return
+ *      - ESP_OK: get statistics successfully
+ *      - ESP_ERR_INVALID_ARG: get statistics failed because the strip is not an RMT LED strip
+ */
+esp_err_t led_strip_rmt_get_stats(led_strip_handle_t strip, led_strip_rmt_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -88,6 +88,30 @@ struct led_strip_t {
      *      - ESP_FAIL: Free resources failed because error occurred
      */
     esp_err_t (*del)(led_strip_t *strip);
+
+    /**
+     * @brief Set the global brightness, applied while encoding
+     *
+     * @param strip: LED strip
+     * @param brightness: 0 (off) to 255 (full)
+     *
+     * @return
+     *      - ESP_OK: Set brightness successfully
+     *      - ESP_FAIL: Set brightness failed because some other error occurred
+     */
+    esp_err_t (*set_brightness)(led_strip_t *strip, uint8_t brightness);
+
+    /**
+     * @brief Set the gamma correction, applied while encoding
+     *
+     * @param strip: LED strip
+     * @param gamma: gamma exponent, 1.0 means linear
+     *
+     * @return
+     *      - ESP_OK: Set gamma successfully
+     *      - ESP_ERR_INVALID_ARG: Set gamma failed because it is out of range
+     */
+    esp_err_t (*set_gamma)(led_strip_t *strip, float gamma);
 };
 
 #ifdef __cplusplus
@@ -87,6 +87,20 @@ esp_err_t led_strip_clear(led_strip_handle_t strip)
     return strip->clear(strip);
 }
 
+esp_err_t led_strip_set_brightness(led_strip_handle_t strip, uint8_t brightness)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->set_brightness, ESP_ERR_NOT_SUPPORTED, TAG, "brightness not supported by this backend");
+    return strip->set_brightness(strip, brightness);
+}
+
+esp_err_t led_strip_set_gamma(led_strip_handle_t strip, float gamma)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->set_gamma, ESP_ERR_NOT_SUPPORTED, TAG, "gamma not supported by this backend");
+    return strip->set_gamma(strip, gamma);
+}
+
 esp_err_t led_strip_del(led_strip_handle_t strip)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
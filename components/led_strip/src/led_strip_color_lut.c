@@ -0,0 +1,63 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <math.h>
+#include "esp_check.h"
+#include "led_strip_color_lut.h"
+
+#define LED_STRIP_GAMMA_MIN 0.1f
+#define LED_STRIP_GAMMA_MAX 5.0f
+
+static const char *TAG = "led_strip_lut";
+
+void led_strip_color_lut_init(led_strip_color_lut_t *lut)
+{
+    for (int i = 0; i < LED_STRIP_COLOR_LUT_SIZE; i++) {
+        lut->table[i] = (uint8_t)i;
+    }
+    lut->brightness = 255;
+    lut->gamma = 1.0f;
+    lut->is_identity = true;
+}
+
+esp_err_t led_strip_color_lut_update(led_strip_color_lut_t *lut, uint8_t brightness, float gamma)
+{
+    ESP_RETURN_ON_FALSE(lut, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(gamma >= LED_STRIP_GAMMA_MIN && gamma <= LED_STRIP_GAMMA_MAX, ESP_ERR_INVALID_ARG, TAG,
+                        "gamma out of range");
+    bool is_identity = true;
+    for (int i = 0; i < LED_STRIP_COLOR_LUT_SIZE; i++) {
+        // gamma first, then scale, so dimming keeps the shape of the curve
+        float corrected = powf(i / 255.0f, gamma) * brightness + 0.5f;
+        lut->table[i] = corrected > 255.0f ? 255 : (uint8_t)corrected;
+        is_identity &= (lut->table[i] == i);
+    }
+    lut->brightness = brightness;
+    lut->gamma = gamma;
+    lut->is_identity = is_identity;
+    return ESP_OK;
+}
+
+void led_strip_color_luts_init(led_strip_color_luts_t *luts)
+{
+    led_strip_color_lut_init(&luts->slots[0]);
+    atomic_init(&luts->active, &luts->slots[0]);
+    atomic_init(&luts->in_use, NULL);
+}
+
+esp_err_t led_strip_color_luts_update(led_strip_color_luts_t *luts, uint8_t brightness, float gamma)
+{
+    ESP_RETURN_ON_FALSE(luts, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    const led_strip_color_lut_t *active = atomic_load(&luts->active);
+    const led_strip_color_lut_t *in_use = atomic_load(&luts->in_use);
+    // with three tables there is always one that is neither published nor being read by a frame
+    led_strip_color_lut_t *next = NULL;
+    for (int i = 0; i < LED_STRIP_COLOR_LUT_SLOTS && !next; i++) {
+        if (&luts->slots[i] != active && &luts->slots[i] != in_use) {
+            next = &luts->slots[i];
+        }
+    }
+    ESP_RETURN_ON_ERROR(led_strip_color_lut_update(next, brightness, gamma), TAG, "build lookup table failed");
+    atomic_store(&luts->active, next);
+    return ESP_OK;
+}
@@ -0,0 +1,125 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_STRIP_COLOR_LUT_SIZE 256
+// the table being published, the one a frame may still be reading, and one to build the next change in
+#define LED_STRIP_COLOR_LUT_SLOTS 3
+
+/**
+ * @brief Brightness and gamma correction, folded into one lookup table
+ *
+ * @note The table is applied by the backend while it encodes the pixel buffer,
+ *       so the pixel buffer itself always holds the linear values set by the user.
+ */
+typedef struct {
+    uint8_t table[LED_STRIP_COLOR_LUT_SIZE]; /*!< Linear channel value -> value sent to the LED */
+    uint8_t brightness;                      /*!< Global brightness, 0 (off) to 255 (full) */
+    float gamma;                             /*!< Gamma exponent, 1.0 means linear */
+    bool is_identity;                        /*!< table[i] == i, so backends may skip the lookup */
+} led_strip_color_lut_t;
+
+/**
+ * @brief Lookup tables that can be changed while a frame is being encoded
+ *
+ * @note A change is built in a table no frame is reading, then published with one pointer store,
+ *       so an encoder never sees a half written table. The encoder holds on to the table it took
+ *       at the start of a frame until the frame's pixels are encoded.
+ */
+typedef struct {
+    led_strip_color_lut_t slots[LED_STRIP_COLOR_LUT_SLOTS];
+    _Atomic(const led_strip_color_lut_t *) active; /*!< Table for the next frame */
+    _Atomic(const led_strip_color_lut_t *) in_use; /*!< Table of the frame being encoded, NULL between frames */
+} led_strip_color_luts_t;
+
+/**
+ * @brief Initialize a lookup table that leaves colors unchanged (full brightness, linear)
+ *
+ * @param lut Lookup table
+ */
+void led_strip_color_lut_init(led_strip_color_lut_t *lut);
+
+/**
+ * @brief Rebuild the lookup table for a new brightness and gamma
+ *
+ * @param lut Lookup table
+ * @param brightness Global brightness, 0 (off) to 255 (full)
+ * @param gamma Gamma exponent, 1.0 means linear
+ * @return
+ *      - ESP_OK: Lookup table rebuilt
+ *      - ESP_ERR_INVALID_ARG: Gamma out of range
+ */
+esp_err_t led_strip_color_lut_update(led_strip_color_lut_t *lut, uint8_t brightness, float gamma);
+
+/**
+ * @brief Initialize the lookup tables, publishing one that leaves colors unchanged
+ *
+ * @param luts Lookup tables
+ */
+void led_strip_color_luts_init(led_strip_color_luts_t *luts);
+
+/**
+ * @brief Build a table for a new brightness and gamma and publish it for the next frame
+ *
+ * @note Only one task may change the tables at a time, frames may be encoded meanwhile.
+ *
+ * @param luts Lookup tables
+ * @param brightness Global brightness, 0 (off) to 255 (full)
+ * @param gamma Gamma exponent, 1.0 means linear
+ * @return
+ *      - ESP_OK: New table published
+ *      - ESP_ERR_INVALID_ARG: Gamma out of range, the published table is left as it was
+ */
+esp_err_t led_strip_color_luts_update(led_strip_color_luts_t *luts, uint8_t brightness, float gamma);
+
+/**
+ * @brief Get the table the next frame will be encoded with
+ */
+static inline const led_strip_color_lut_t *led_strip_color_luts_active(led_strip_color_luts_t *luts)
+{
+    return atomic_load(&luts->active);
+}
+
+/**
+ * @brief Take the published table for a new frame, it is not changed until `led_strip_color_luts_release`
+ */
+static inline const led_strip_color_lut_t *led_strip_color_luts_acquire(led_strip_color_luts_t *luts)
+{
+    const led_strip_color_lut_t *lut;
+    // a change published between the load and the store could have picked this table to build in, so load again
+    do {
+        lut = atomic_load(&luts->active);
+        atomic_store(&luts->in_use, lut);
+    } while (lut != atomic_load(&luts->active));
+    return lut;
+}
+
+/**
+ * @brief Let go of the table taken by `led_strip_color_luts_acquire`
+ */
+static inline void led_strip_color_luts_release(led_strip_color_luts_t *luts)
+{
+    atomic_store(&luts->in_use, NULL);
+}
+
+/**
+ * @brief Look up the value to send to the LED for one channel
+ */
+static inline uint8_t led_strip_color_lut_apply(const led_strip_color_lut_t *lut, uint8_t value)
+{
+    return lut->table[value];
+}
+
+#ifdef __cplusplus
+}
+#endif
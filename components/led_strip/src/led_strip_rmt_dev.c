@@ -8,6 +8,8 @@
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
 #include "driver/rmt_tx.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
@@ -21,6 +23,8 @@
 #else
 #define LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS 48
 #endif
+// with DMA the "memory block" is a buffer in RAM, big enough for ~40 RGB pixels per refill
+#define LED_STRIP_RMT_DEFAULT_DMA_MEM_BLOCK_SYMBOLS 1024
 
 static const char *TAG = "led_strip_rmt";
 
@@ -30,9 +34,36 @@ typedef struct {
     rmt_encoder_handle_t strip_encoder;
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
+    led_strip_color_luts_t color_luts;
+    led_strip_rmt_stats_t stats;
+    int64_t start_us;
+    volatile int64_t done_us; // written from the RMT interrupt when the transmission finishes
     uint8_t pixel_buf[];
 } led_strip_rmt_obj;
 
+static bool led_strip_rmt_on_trans_done(rmt_channel_handle_t tx_chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = (led_strip_rmt_obj *)user_ctx;
+    rmt_strip->done_us = esp_timer_get_time();
+    return false;
+}
+
+static void led_strip_rmt_update_stats(led_strip_rmt_obj *rmt_strip)
+{
+    led_strip_encoder_stats_t encoder_stats;
+    rmt_led_strip_encoder_get_stats(rmt_strip->strip_encoder, &encoder_stats);
+    led_strip_rmt_stats_t *stats = &rmt_strip->stats;
+    stats->frames++;
+    stats->refills += encoder_stats.encode_calls > 0 ? encoder_stats.encode_calls - 1 : 0;
+    stats->underruns += encoder_stats.underruns;
+    stats->last_encode_calls = encoder_stats.encode_calls;
+    stats->last_encode_cycles = encoder_stats.encode_cycles;
+    if (encoder_stats.encode_cycles > stats->max_encode_cycles) {
+        stats->max_encode_cycles = encoder_stats.encode_cycles;
+    }
+    stats->last_frame_us = (uint32_t)(rmt_strip->done_us - rmt_strip->start_us);
+}
+
 static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -70,10 +101,22 @@ static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
     };
 
     ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
+    rmt_strip->start_us = esp_timer_get_time();
     ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, rmt_strip->pixel_buf,
                                      rmt_strip->strip_len * rmt_strip->bytes_per_pixel, &tx_conf), TAG, "transmit pixels by RMT failed");
     ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
     ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    led_strip_rmt_update_stats(rmt_strip);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_rmt_get_stats(led_strip_handle_t strip, led_strip_rmt_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(strip && stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    // only strips made by this backend carry RMT statistics
+    ESP_RETURN_ON_FALSE(strip->refresh == led_strip_rmt_refresh, ESP_ERR_INVALID_ARG, TAG, "not an RMT LED strip");
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    *stats = rmt_strip->stats;
     return ESP_OK;
 }
 
@@ -85,6 +128,18 @@ static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
     return led_strip_rmt_refresh(strip);
 }
 
+static esp_err_t led_strip_rmt_set_brightness(led_strip_t *strip, uint8_t brightness)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    return led_strip_color_luts_update(&rmt_strip->color_luts, brightness, led_strip_color_luts_active(&rmt_strip->color_luts)->gamma);
+}
+
+static esp_err_t led_strip_rmt_set_gamma(led_strip_t *strip, float gamma)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    return led_strip_color_luts_update(&rmt_strip->color_luts, led_strip_color_luts_active(&rmt_strip->color_luts)->brightness, gamma);
+}
+
 static esp_err_t led_strip_rmt_del(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -117,7 +172,15 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     if (rmt_config->clk_src) {
         clk_src = rmt_config->clk_src;
     }
-    size_t mem_block_symbols = LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS;
+    bool with_dma = rmt_config->flags.with_dma;
+#if !SOC_RMT_SUPPORT_DMA
+    if (with_dma) {
+        // e.g. ESP32-C6, fall back to ping-pong refills rather than failing to create the channel
+        ESP_LOGW(TAG, "RMT DMA not supported on this target, using the channel memory instead");
+        with_dma = false;
+    }
+#endif
+    size_t mem_block_symbols = with_dma ? LED_STRIP_RMT_DEFAULT_DMA_MEM_BLOCK_SYMBOLS : LED_STRIP_RMT_DEFAULT_MEM_BLOCK_SYMBOLS;
     // override the default value if the user sets it
     if (rmt_config->mem_block_symbols) {
         mem_block_symbols = rmt_config->mem_block_symbols;
@@ -128,14 +191,24 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
         .mem_block_symbols = mem_block_symbols,
         .resolution_hz = resolution,
         .trans_queue_depth = LED_STRIP_RMT_DEFAULT_TRANS_QUEUE_SIZE,
-        .flags.with_dma = rmt_config->flags.with_dma,
+        .flags.with_dma = with_dma,
         .flags.invert_out = led_config->flags.invert_out,
     };
     ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&rmt_chan_config, &rmt_strip->rmt_chan), err, TAG, "create RMT TX channel failed");
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = led_strip_rmt_on_trans_done,
+    };
+    ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_strip->rmt_chan, &cbs, rmt_strip), err, TAG, "register RMT callbacks failed");
+    rmt_strip->stats.mem_block_symbols = mem_block_symbols;
+    rmt_strip->stats.with_dma = with_dma;
 
+    // the encoder reads the lookup table while encoding, so it must be ready before the first refresh
+    led_strip_color_luts_init(&rmt_strip->color_luts);
     led_strip_encoder_config_t strip_encoder_conf = {
         .resolution = resolution,
-        .led_model = led_config->led_model
+        .led_model = led_config->led_model,
+        .color_luts = &rmt_strip->color_luts,
+        .mem_block_symbols = mem_block_symbols,
     };
     ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
 
@@ -147,6 +220,8 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
     rmt_strip->base.refresh = led_strip_rmt_refresh;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
+    rmt_strip->base.set_brightness = led_strip_rmt_set_brightness;
+    rmt_strip->base.set_gamma = led_strip_rmt_set_gamma;
 
     *ret_strip = &rmt_strip->base;
     return ESP_OK;
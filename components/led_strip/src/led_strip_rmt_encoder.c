@@ -0,0 +1,277 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "esp_check.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "led_strip_rmt_encoder.h"
+
+static const char *TAG = "led_rmt_encoder";
+
+// WS2812 and SK6812 datasheets allow +/-150ns on every high and low time
+#define LED_STRIP_TIMING_TOLERANCE_NS 150
+// RMT symbol durations are 15 bits wide
+#define LED_STRIP_MAX_SYMBOL_TICKS 0x7FFF
+// pixel bytes looked up in the color table at a time, a few refills' worth without DMA
+#define LED_STRIP_ENCODER_CHUNK_BYTES 32
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *copy_encoder;
+    int state;
+    rmt_symbol_word_t reset_code;
+    led_strip_color_luts_t *color_luts;
+    const led_strip_color_lut_t *color_lut; // table of the current transaction, NULL when the pixels go out unchanged
+    bool in_trans;
+    size_t chunk_offset; // where the chunk starts in the pixels
+    size_t chunk_size;   // 0 until the next chunk is looked up
+    uint8_t chunk[LED_STRIP_ENCODER_CHUNK_BYTES]; // pixels after the color lookup table
+    uint32_t underrun_cycles; // a refill later than this after the previous one means the channel memory ran dry
+    uint32_t last_call_cycles;
+    led_strip_encoder_stats_t stats;
+} rmt_led_strip_encoder_t;
+
+// encode the pixels through the color table, a chunk at a time, so no corrected copy of the whole frame is needed
+static size_t rmt_led_strip_encode_corrected(rmt_led_strip_encoder_t *led_encoder, rmt_channel_handle_t channel, const uint8_t *data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_encoder_handle_t bytes_encoder = led_encoder->bytes_encoder;
+    rmt_encode_state_t session_state = 0;
+    rmt_encode_state_t state = 0;
+    size_t encoded_symbols = 0;
+    while (led_encoder->chunk_offset < data_size && !(state & RMT_ENCODING_MEM_FULL)) {
+        if (!led_encoder->chunk_size) {
+            size_t size = data_size - led_encoder->chunk_offset;
+            size = size < LED_STRIP_ENCODER_CHUNK_BYTES ? size : LED_STRIP_ENCODER_CHUNK_BYTES;
+            for (size_t i = 0; i < size; i++) {
+                led_encoder->chunk[i] = led_strip_color_lut_apply(led_encoder->color_lut, data[led_encoder->chunk_offset + i]);
+            }
+            led_encoder->chunk_size = size;
+        }
+        // the bytes encoder keeps its place in the chunk across refills, so the chunk stays as it is until it is done
+        encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, led_encoder->chunk, led_encoder->chunk_size, &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            led_encoder->chunk_offset += led_encoder->chunk_size;
+            led_encoder->chunk_size = 0;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+        }
+    }
+    if (led_encoder->chunk_offset >= data_size) {
+        led_encoder->chunk_offset = 0;
+        state |= RMT_ENCODING_COMPLETE;
+    }
+    *ret_state = state;
+    return encoded_symbols;
+}
+
+static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    rmt_encoder_handle_t bytes_encoder = led_encoder->bytes_encoder;
+    rmt_encoder_handle_t copy_encoder = led_encoder->copy_encoder;
+    rmt_encode_state_t session_state = 0;
+    rmt_encode_state_t state = 0;
+    size_t encoded_symbols = 0;
+    uint32_t start_cycles = esp_cpu_get_cycle_count();
+    if (!led_encoder->in_trans) {
+        // first call of a new transaction, the whole frame is encoded with the table published now
+        memset(&led_encoder->stats, 0, sizeof(led_encoder->stats));
+        led_encoder->in_trans = true;
+        if (led_encoder->color_luts) {
+            led_encoder->color_lut = led_strip_color_luts_acquire(led_encoder->color_luts);
+            if (led_encoder->color_lut->is_identity) {
+                led_strip_color_luts_release(led_encoder->color_luts);
+                led_encoder->color_lut = NULL;
+            }
+        }
+    } else if (start_cycles - led_encoder->last_call_cycles > led_encoder->underrun_cycles) {
+        led_encoder->stats.underruns++;
+    }
+    led_encoder->last_call_cycles = start_cycles;
+    led_encoder->stats.encode_calls++;
+    switch (led_encoder->state) {
+    case 0: // send RGB data
+        if (led_encoder->color_lut) {
+            encoded_symbols += rmt_led_strip_encode_corrected(led_encoder, channel, primary_data, data_size, &session_state);
+        } else {
+            encoded_symbols += bytes_encoder->encode(bytes_encoder, channel, primary_data, data_size, &session_state);
+        }
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            if (led_encoder->color_lut) {
+                led_strip_color_luts_release(led_encoder->color_luts);
+                led_encoder->color_lut = NULL;
+            }
+            led_encoder->state = 1; // switch to next state when current encoding session finished
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out; // yield if there's no free space for encoding artifacts
+        }
+    // fall-through
+    case 1: // send reset code
+        encoded_symbols += copy_encoder->encode(copy_encoder, channel, &led_encoder->reset_code,
+                                                sizeof(led_encoder->reset_code), &session_state);
+        if (session_state & RMT_ENCODING_COMPLETE) {
+            led_encoder->state = 0; // back to the initial encoding session
+            led_encoder->in_trans = false;
+            state |= RMT_ENCODING_COMPLETE;
+        }
+        if (session_state & RMT_ENCODING_MEM_FULL) {
+            state |= RMT_ENCODING_MEM_FULL;
+            goto out; // yield if there's no free space for encoding artifacts
+        }
+    }
+out:
+    led_encoder->stats.encode_cycles += esp_cpu_get_cycle_count() - start_cycles;
+    *ret_state = state;
+    return encoded_symbols;
+}
+
+void rmt_led_strip_encoder_get_stats(rmt_encoder_handle_t encoder, led_strip_encoder_stats_t *stats)
+{
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    *stats = led_encoder->stats;
+}
+
+// convert a duration to the nearest whole number of RMT ticks
+static uint32_t rmt_led_strip_ns_to_ticks(uint32_t ns, uint32_t resolution)
+{
+    return ((uint64_t)ns * resolution + 500000000) / 1000000000;
+}
+
+// check that a duration, after rounding to whole RMT ticks, is still within the LED's tolerance
+static bool rmt_led_strip_timing_ok(uint32_t ticks, uint32_t resolution, uint32_t nominal_ns)
+{
+    uint64_t actual_ns = (uint64_t)ticks * 1000000000 / resolution;
+    uint64_t error_ns = actual_ns > nominal_ns ? actual_ns - nominal_ns : nominal_ns - actual_ns;
+    return ticks > 0 && error_ns <= LED_STRIP_TIMING_TOLERANCE_NS;
+}
+
+static esp_err_t rmt_led_strip_check_timing(const rmt_bytes_encoder_config_t *config, uint32_t resolution, uint32_t t1h_ns, uint32_t t1l_ns)
+{
+    // T0H and T0L are the same for every supported model
+    ESP_RETURN_ON_FALSE(rmt_led_strip_timing_ok(config->bit0.duration0, resolution, 300), ESP_ERR_INVALID_ARG, TAG,
+                        "T0H out of tolerance at %"PRIu32"Hz", resolution);
+    ESP_RETURN_ON_FALSE(rmt_led_strip_timing_ok(config->bit0.duration1, resolution, 900), ESP_ERR_INVALID_ARG, TAG,
+                        "T0L out of tolerance at %"PRIu32"Hz", resolution);
+    ESP_RETURN_ON_FALSE(rmt_led_strip_timing_ok(config->bit1.duration0, resolution, t1h_ns), ESP_ERR_INVALID_ARG, TAG,
+                        "T1H out of tolerance at %"PRIu32"Hz", resolution);
+    ESP_RETURN_ON_FALSE(rmt_led_strip_timing_ok(config->bit1.duration1, resolution, t1l_ns), ESP_ERR_INVALID_ARG, TAG,
+                        "T1L out of tolerance at %"PRIu32"Hz", resolution);
+    return ESP_OK;
+}
+
+static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    rmt_del_encoder(led_encoder->bytes_encoder);
+    rmt_del_encoder(led_encoder->copy_encoder);
+    free(led_encoder);
+    return ESP_OK;
+}
+
+static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
+{
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+    rmt_encoder_reset(led_encoder->bytes_encoder);
+    rmt_encoder_reset(led_encoder->copy_encoder);
+    led_encoder->state = 0;
+    led_encoder->in_trans = false;
+    led_encoder->chunk_offset = 0;
+    led_encoder->chunk_size = 0;
+    if (led_encoder->color_lut) {
+        led_strip_color_luts_release(led_encoder->color_luts);
+        led_encoder->color_lut = NULL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    led_encoder->base.encode = rmt_encode_led_strip;
+    led_encoder->base.del = rmt_del_led_strip_encoder;
+    led_encoder->base.reset = rmt_led_strip_encoder_reset;
+    led_encoder->color_luts = config->color_luts;
+    rmt_bytes_encoder_config_t bytes_encoder_config;
+    if (config->led_model == LED_MODEL_SK6812) {
+        bytes_encoder_config = (rmt_bytes_encoder_config_t) {
+            .bit0 = {
+                .level0 = 1,
+                .duration0 = rmt_led_strip_ns_to_ticks(300, config->resolution), // T0H=0.3us
+                .level1 = 0,
+                .duration1 = rmt_led_strip_ns_to_ticks(900, config->resolution), // T0L=0.9us
+            },
+            .bit1 = {
+                .level0 = 1,
+                .duration0 = rmt_led_strip_ns_to_ticks(600, config->resolution), // T1H=0.6us
+                .level1 = 0,
+                .duration1 = rmt_led_strip_ns_to_ticks(600, config->resolution), // T1L=0.6us
+            },
+            .flags.msb_first = 1 // SK6812 transfer bit order: G7...G0R7...R0B7...B0(W7...W0)
+        };
+        ESP_GOTO_ON_ERROR(rmt_led_strip_check_timing(&bytes_encoder_config, config->resolution, 600, 600), err, TAG, "invalid SK6812 timing");
+    } else if (config->led_model == LED_MODEL_WS2812) {
+        // different led strip might have its own timing requirements, following parameter is for WS2812
+        bytes_encoder_config = (rmt_bytes_encoder_config_t) {
+            .bit0 = {
+                .level0 = 1,
+                .duration0 = rmt_led_strip_ns_to_ticks(300, config->resolution), // T0H=0.3us
+                .level1 = 0,
+                .duration1 = rmt_led_strip_ns_to_ticks(900, config->resolution), // T0L=0.9us
+            },
+            .bit1 = {
+                .level0 = 1,
+                .duration0 = rmt_led_strip_ns_to_ticks(900, config->resolution), // T1H=0.9us
+                .level1 = 0,
+                .duration1 = rmt_led_strip_ns_to_ticks(300, config->resolution), // T1L=0.3us
+            },
+            .flags.msb_first = 1 // WS2812 transfer bit order: G7...G0R7...R0B7...B0
+        };
+        ESP_GOTO_ON_ERROR(rmt_led_strip_check_timing(&bytes_encoder_config, config->resolution, 900, 300), err, TAG, "invalid WS2812 timing");
+    } else {
+        assert(false);
+    }
+    ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create bytes encoder failed");
+    rmt_copy_encoder_config_t copy_encoder_config = {};
+    ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder), err, TAG, "create copy encoder failed");
+
+    // the channel drains its whole memory in mem_block_symbols bit times (1.2us for both WS2812 and SK6812),
+    // the refill interrupt comes when half of it is sent, so a gap longer than the whole memory is an underrun
+    uint32_t drain_us = config->mem_block_symbols * 12 / 10;
+    led_encoder->underrun_cycles = config->mem_block_symbols ? drain_us * esp_rom_get_cpu_ticks_per_us() : UINT32_MAX;
+
+    uint32_t reset_ticks = rmt_led_strip_ns_to_ticks(280 * 1000 / 2, config->resolution); // reset code duration defaults to 280us to accomodate WS2812B-V5
+    ESP_GOTO_ON_FALSE(reset_ticks > 0 && reset_ticks <= LED_STRIP_MAX_SYMBOL_TICKS, ESP_ERR_INVALID_ARG, err, TAG,
+                      "reset code does not fit in one RMT symbol at %"PRIu32"Hz", config->resolution);
+    led_encoder->reset_code = (rmt_symbol_word_t) {
+        .level0 = 0,
+        .duration0 = reset_ticks,
+        .level1 = 0,
+        .duration1 = reset_ticks,
+    };
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    if (led_encoder) {
+        if (led_encoder->bytes_encoder) {
+            rmt_del_encoder(led_encoder->bytes_encoder);
+        }
+        if (led_encoder->copy_encoder) {
+            rmt_del_encoder(led_encoder->copy_encoder);
+        }
+        free(led_encoder);
+    }
+    return ret;
+}
@@ -0,0 +1,60 @@
+/*
+ * SPDX-FileCopyrightText: 2022 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "driver/rmt_encoder.h"
+#include "led_strip_types.h"
+#include "led_strip_color_lut.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of led strip encoder configuration
+ */
+typedef struct {
+    uint32_t resolution;   /*!< Encoder resolution, in Hz */
+    led_model_t led_model; /*!< LED model */
+    led_strip_color_luts_t *color_luts; /*!< Brightness and gamma applied while encoding, NULL to send pixels unchanged */
+    size_t mem_block_symbols; /*!< Size of the channel memory (or DMA buffer) the encoder refills, used to detect underruns */
+} led_strip_encoder_config_t;
+
+/**
+ * @brief Profile of the last transaction of a led strip encoder
+ */
+typedef struct {
+    uint32_t encode_calls;  /*!< Times the encoder was called, the first call plus one per refill interrupt */
+    uint32_t encode_cycles; /*!< CPU cycles spent inside the encoder */
+    uint32_t underruns;     /*!< Refills that came later than the channel memory takes to drain */
+} led_strip_encoder_stats_t;
+
+/**
+ * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols
+ *
+ * @param[in] config Encoder configuration
+ * @param[out] ret_encoder Returned encoder handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating led strip encoder
+ *      - ESP_OK if creating encoder successfully
+ */
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+
+/**
+ * @brief Get the profile of the last transaction
+ *
+ * @note Only valid once the transaction is done, e.g. after `rmt_tx_wait_all_done`
+ *
+ * @param[in] encoder Encoder created by `rmt_new_led_strip_encoder`
+ * @param[out] stats Returned profile
+ */
+void rmt_led_strip_encoder_get_stats(rmt_encoder_handle_t encoder, led_strip_encoder_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,7 @@
 #include "soc/spi_periph.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
+#include "led_strip_color_lut.h"
 #include "hal/spi_hal.h"
 
 #define LED_STRIP_SPI_DEFAULT_RESOLUTION (2.5 * 1000 * 1000) // 2.5MHz resolution
@@ -28,7 +29,9 @@ typedef struct {
     spi_device_handle_t spi_device;
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
-    uint8_t pixel_buf[];
+    led_strip_color_luts_t color_luts;
+    uint8_t *spi_buf;     // pixels encoded as SPI bits, refilled on every refresh
+    uint8_t pixel_buf[];  // linear pixels, in the order they are sent out
 } led_strip_spi_obj;
 
 // please make sure to zero-initialize the buf before calling this function
@@ -51,14 +54,13 @@ static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uin
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
     ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
-    // LED_PIXEL_FORMAT_GRB takes 72bits(9bytes)
-    uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
-    __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
-    __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+    uint32_t start = index * spi_strip->bytes_per_pixel;
+    // In the order of GRB, as LED strip like WS2812 sends out pixels in this order
+    spi_strip->pixel_buf[start + 0] = green & 0xFF;
+    spi_strip->pixel_buf[start + 1] = red & 0xFF;
+    spi_strip->pixel_buf[start + 2] = blue & 0xFF;
     if (spi_strip->bytes_per_pixel > 3) {
-        __led_strip_spi_bit(0, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
+        spi_strip->pixel_buf[start + 3] = 0;
     }
     return ESP_OK;
 }
@@ -68,15 +70,12 @@ static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
     ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
     ESP_RETURN_ON_FALSE(spi_strip->bytes_per_pixel == 4, ESP_ERR_INVALID_ARG, TAG, "wrong LED pixel format, expected 4 bytes per pixel");
-    // LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
-    uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+    uint8_t *buf_start = spi_strip->pixel_buf + index * 4;
     // SK6812 component order is GRBW
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
-    __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
-    __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
-    __led_strip_spi_bit(white, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
-
+    *buf_start = green & 0xFF;
+    *++buf_start = red & 0xFF;
+    *++buf_start = blue & 0xFF;
+    *++buf_start = white & 0xFF;
     return ESP_OK;
 }
 
@@ -86,8 +85,20 @@ static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
     spi_transaction_t tx_conf;
     memset(&tx_conf, 0, sizeof(tx_conf));
 
+    // encode the pixels into SPI bits, applying brightness and gamma on the way
+    // LED_PIXEL_FORMAT_GRB takes 72bits(9bytes) per pixel, LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
+    uint32_t pixel_bytes = spi_strip->strip_len * spi_strip->bytes_per_pixel;
+    memset(spi_strip->spi_buf, 0, pixel_bytes * SPI_BYTES_PER_COLOR_BYTE);
+    uint8_t *buf = spi_strip->spi_buf;
+    const led_strip_color_lut_t *lut = led_strip_color_luts_acquire(&spi_strip->color_luts);
+    for (uint32_t index = 0; index < pixel_bytes; index++) {
+        __led_strip_spi_bit(led_strip_color_lut_apply(lut, spi_strip->pixel_buf[index]), buf);
+        buf += SPI_BYTES_PER_COLOR_BYTE;
+    }
+    led_strip_color_luts_release(&spi_strip->color_luts);
+
     tx_conf.length = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BITS_PER_COLOR_BYTE;
-    tx_conf.tx_buffer = spi_strip->pixel_buf;
+    tx_conf.tx_buffer = spi_strip->spi_buf;
     tx_conf.rx_buffer = NULL;
     ESP_RETURN_ON_ERROR(spi_device_transmit(spi_strip->spi_device, &tx_conf), TAG, "transmit pixels by SPI failed");
 
@@ -98,16 +109,22 @@ static esp_err_t led_strip_spi_clear(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
     //Write zero to turn off all leds
-    memset(spi_strip->pixel_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    uint8_t *buf = spi_strip->pixel_buf;
-    for (int index = 0; index < spi_strip->strip_len * spi_strip->bytes_per_pixel; index++) {
-        __led_strip_spi_bit(0, buf);
-        buf += SPI_BYTES_PER_COLOR_BYTE;
-    }
-
+    memset(spi_strip->pixel_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel);
     return led_strip_spi_refresh(strip);
 }
 
+static esp_err_t led_strip_spi_set_brightness(led_strip_t *strip, uint8_t brightness)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    return led_strip_color_luts_update(&spi_strip->color_luts, brightness, led_strip_color_luts_active(&spi_strip->color_luts)->gamma);
+}
+
+static esp_err_t led_strip_spi_set_gamma(led_strip_t *strip, float gamma)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    return led_strip_color_luts_update(&spi_strip->color_luts, led_strip_color_luts_active(&spi_strip->color_luts)->brightness, gamma);
+}
+
 static esp_err_t led_strip_spi_del(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
@@ -115,6 +132,7 @@ static esp_err_t led_strip_spi_del(led_strip_t *strip)
     ESP_RETURN_ON_ERROR(spi_bus_remove_device(spi_strip->spi_device), TAG, "delete spi device failed");
     ESP_RETURN_ON_ERROR(spi_bus_free(spi_strip->spi_host), TAG, "free spi bus failed");
 
+    free(spi_strip->spi_buf);
     free(spi_strip);
     return ESP_OK;
 }
@@ -138,9 +156,12 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
         // DMA buffer must be placed in internal SRAM
         mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
     }
-    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE, mem_caps);
-
+    spi_strip = calloc(1, sizeof(led_strip_spi_obj) + led_config->max_leds * bytes_per_pixel);
     ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
+    // only the encoded buffer is handed to the SPI driver, so only it needs to be DMA capable
+    spi_strip->spi_buf = heap_caps_calloc(1, led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE, mem_caps);
+    ESP_GOTO_ON_FALSE(spi_strip->spi_buf, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip buffer");
+    led_strip_color_luts_init(&spi_strip->color_luts);
 
     spi_strip->spi_host = spi_config->spi_bus;
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -194,6 +215,8 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     spi_strip->base.refresh = led_strip_spi_refresh;
     spi_strip->base.clear = led_strip_spi_clear;
     spi_strip->base.del = led_strip_spi_del;
+    spi_strip->base.set_brightness = led_strip_spi_set_brightness;
+    spi_strip->base.set_gamma = led_strip_spi_set_gamma;
 
     *ret_strip = &spi_strip->base;
     return ESP_OK;
@@ -205,6 +228,7 @@ err:
         if (spi_strip->spi_host) {
             spi_bus_free(spi_strip->spi_host);
         }
+        free(spi_strip->spi_buf);
         free(spi_strip);
     }
     return ret;
@@ -0,0 +1,34 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "test_host.h"
+
+typedef struct {
+    const char *name;
+    void (*run)(void);
+} test_suite_t;
+
+static const test_suite_t s_suites[] = {
+    {"color_lut", test_color_lut},
+    {"rmt_encoder", test_rmt_encoder},
+    {"spi", test_spi},
+};
+
+int test_failures;
+
+// runs the suite named on the command line, or all of them
+int main(int argc, char **argv)
+{
+    for (size_t i = 0; i < sizeof(s_suites) / sizeof(s_suites[0]); i++) {
+        if (argc < 2 || strcmp(argv[1], s_suites[i].name) == 0) {
+            s_suites[i].run();
+        }
+    }
+    if (test_failures) {
+        printf("%d checks failed\n", test_failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,14 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Host stand-in for the ESP-IDF header of the same name, the cycle count is driven by the test
+#pragma once
+
+#include <stdint.h>
+
+extern uint32_t mock_cpu_cycle_count;
+
+static inline uint32_t esp_cpu_get_cycle_count(void)
+{
+    return mock_cpu_cycle_count;
+}
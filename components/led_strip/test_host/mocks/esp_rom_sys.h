@@ -0,0 +1,20 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Host stand-in for the ESP-IDF header of the same name
+#pragma once
+
+#include <stdint.h>
+
+// ESP32-C6 CPU clock
+#define MOCK_CPU_TICKS_PER_US 160
+
+static inline uint32_t esp_rom_get_cpu_ticks_per_us(void)
+{
+    return MOCK_CPU_TICKS_PER_US;
+}
+
+static inline void esp_rom_delay_us(uint32_t us)
+{
+    (void)us;
+}
@@ -0,0 +1,178 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "esp_cpu.h"
+#include "esp_rom_sys.h"
+#include "mock_rmt.h"
+
+// gives up on an encoder that never completes
+#define MOCK_RMT_MAX_ENCODE_CALLS 100000
+
+typedef struct {
+    rmt_encoder_t base;
+    rmt_bytes_encoder_config_t config;
+    size_t bit_pos;
+} mock_bytes_encoder_t;
+
+typedef struct {
+    rmt_encoder_t base;
+    size_t symbol_pos;
+} mock_copy_encoder_t;
+
+uint32_t mock_cpu_cycle_count;
+
+static bool mock_rmt_write(rmt_channel_handle_t channel, rmt_symbol_word_t symbol)
+{
+    if (!channel->mem_free) {
+        return false;
+    }
+    channel->mem_free--;
+    if (channel->count < channel->capacity) {
+        channel->symbols[channel->count++] = symbol;
+    } else {
+        channel->overflow = true;
+    }
+    return true;
+}
+
+static size_t mock_encode_bytes(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    mock_bytes_encoder_t *bytes_encoder = __containerof(encoder, mock_bytes_encoder_t, base);
+    const uint8_t *data = primary_data;
+    size_t encoded_symbols = 0;
+    *ret_state = RMT_ENCODING_RESET;
+    while (bytes_encoder->bit_pos < data_size * 8) {
+        uint8_t byte = data[bytes_encoder->bit_pos / 8];
+        uint8_t bit = bytes_encoder->bit_pos % 8;
+        bool one = byte & (1 << (bytes_encoder->config.flags.msb_first ? 7 - bit : bit));
+        if (!mock_rmt_write(channel, one ? bytes_encoder->config.bit1 : bytes_encoder->config.bit0)) {
+            *ret_state |= RMT_ENCODING_MEM_FULL;
+            return encoded_symbols;
+        }
+        bytes_encoder->bit_pos++;
+        encoded_symbols++;
+    }
+    bytes_encoder->bit_pos = 0;
+    *ret_state |= RMT_ENCODING_COMPLETE;
+    if (!channel->mem_free) {
+        *ret_state |= RMT_ENCODING_MEM_FULL;
+    }
+    return encoded_symbols;
+}
+
+static size_t mock_encode_copy(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
+{
+    mock_copy_encoder_t *copy_encoder = __containerof(encoder, mock_copy_encoder_t, base);
+    const rmt_symbol_word_t *symbols = primary_data;
+    size_t encoded_symbols = 0;
+    *ret_state = RMT_ENCODING_RESET;
+    while (copy_encoder->symbol_pos < data_size / sizeof(rmt_symbol_word_t)) {
+        if (!mock_rmt_write(channel, symbols[copy_encoder->symbol_pos])) {
+            *ret_state |= RMT_ENCODING_MEM_FULL;
+            return encoded_symbols;
+        }
+        copy_encoder->symbol_pos++;
+        encoded_symbols++;
+    }
+    copy_encoder->symbol_pos = 0;
+    *ret_state |= RMT_ENCODING_COMPLETE;
+    if (!channel->mem_free) {
+        *ret_state |= RMT_ENCODING_MEM_FULL;
+    }
+    return encoded_symbols;
+}
+
+static esp_err_t mock_reset_bytes(rmt_encoder_t *encoder)
+{
+    __containerof(encoder, mock_bytes_encoder_t, base)->bit_pos = 0;
+    return ESP_OK;
+}
+
+static esp_err_t mock_reset_copy(rmt_encoder_t *encoder)
+{
+    __containerof(encoder, mock_copy_encoder_t, base)->symbol_pos = 0;
+    return ESP_OK;
+}
+
+static esp_err_t mock_del_bytes(rmt_encoder_t *encoder)
+{
+    free(__containerof(encoder, mock_bytes_encoder_t, base));
+    return ESP_OK;
+}
+
+static esp_err_t mock_del_copy(rmt_encoder_t *encoder)
+{
+    free(__containerof(encoder, mock_copy_encoder_t, base));
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_bytes_encoder(const rmt_bytes_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    mock_bytes_encoder_t *bytes_encoder = calloc(1, sizeof(mock_bytes_encoder_t));
+    if (!bytes_encoder) {
+        return ESP_ERR_NO_MEM;
+    }
+    bytes_encoder->base.encode = mock_encode_bytes;
+    bytes_encoder->base.reset = mock_reset_bytes;
+    bytes_encoder->base.del = mock_del_bytes;
+    bytes_encoder->config = *config;
+    *ret_encoder = &bytes_encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    (void)config;
+    mock_copy_encoder_t *copy_encoder = calloc(1, sizeof(mock_copy_encoder_t));
+    if (!copy_encoder) {
+        return ESP_ERR_NO_MEM;
+    }
+    copy_encoder->base.encode = mock_encode_copy;
+    copy_encoder->base.reset = mock_reset_copy;
+    copy_encoder->base.del = mock_del_copy;
+    *ret_encoder = &copy_encoder->base;
+    return ESP_OK;
+}
+
+esp_err_t rmt_del_encoder(rmt_encoder_handle_t encoder)
+{
+    return encoder->del(encoder);
+}
+
+esp_err_t rmt_encoder_reset(rmt_encoder_handle_t encoder)
+{
+    return encoder->reset(encoder);
+}
+
+void mock_rmt_channel_init(rmt_channel_handle_t channel, rmt_symbol_word_t *symbols, size_t capacity)
+{
+    memset(channel, 0, sizeof(*channel));
+    channel->symbols = symbols;
+    channel->capacity = capacity;
+}
+
+uint32_t mock_rmt_transmit(rmt_channel_handle_t channel, rmt_encoder_handle_t encoder, const void *data, size_t data_size,
+                           size_t mem_block_symbols)
+{
+    channel->mem_free = mem_block_symbols;
+    for (uint32_t calls = 1; calls <= MOCK_RMT_MAX_ENCODE_CALLS; calls++) {
+        rmt_encode_state_t state = RMT_ENCODING_RESET;
+        encoder->encode(encoder, channel, data, data_size, &state);
+        if (state & RMT_ENCODING_COMPLETE) {
+            return calls;
+        }
+        // the refill interrupt comes once half of the memory is sent, 1.2us per symbol
+        channel->mem_free += mem_block_symbols / 2;
+        if (channel->mem_free > mem_block_symbols) {
+            channel->mem_free = mem_block_symbols;
+        }
+        mock_cpu_cycle_count += mem_block_symbols / 2 * 12 / 10 * MOCK_CPU_TICKS_PER_US;
+        if (channel->on_refill) {
+            channel->on_refill(channel->on_refill_arg);
+        }
+    }
+    return 0;
+}
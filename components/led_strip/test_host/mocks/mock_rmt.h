@@ -0,0 +1,34 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Mock RMT TX channel: records every symbol the encoders write, and calls the encoder the way the driver does
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/rmt_encoder.h"
+
+struct rmt_channel_t {
+    rmt_symbol_word_t *symbols; // everything sent so far
+    size_t capacity;
+    size_t count;
+    size_t mem_free;            // room left in the channel memory for the current encoder call
+    bool overflow;              // an encoder wrote more than `capacity` symbols
+    void (*on_refill)(void *arg); // called before every refill, e.g. to change something mid-frame
+    void *on_refill_arg;
+};
+
+/**
+ * @brief Start recording into `symbols`
+ */
+void mock_rmt_channel_init(rmt_channel_handle_t channel, rmt_symbol_word_t *symbols, size_t capacity);
+
+/**
+ * @brief Send one transaction: the encoder gets the whole channel memory on the first call, and half of it on each
+ *        refill interrupt after, until it reports RMT_ENCODING_COMPLETE
+ *
+ * @return Encoder calls, 0 if the encoder never completed
+ */
+uint32_t mock_rmt_transmit(rmt_channel_handle_t channel, rmt_encoder_handle_t encoder, const void *data, size_t data_size,
+                           size_t mem_block_symbols);
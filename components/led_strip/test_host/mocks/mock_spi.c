@@ -0,0 +1,78 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "soc/spi_periph.h"
+#include "mock_spi.h"
+
+struct spi_device_t {
+    int clock_speed_hz;
+};
+
+const spi_signal_conn_t spi_periph_signal[] = {
+    {.spid_out = 0},
+    {.spid_out = 1},
+};
+
+static uint8_t *s_tx_buf;
+static size_t s_tx_bits;
+
+esp_err_t spi_bus_initialize(spi_host_device_t host_id, const spi_bus_config_t *bus_config, spi_dma_chan_t dma_chan)
+{
+    (void)host_id;
+    (void)bus_config;
+    (void)dma_chan;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host_id)
+{
+    (void)host_id;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host_id, const spi_device_interface_config_t *dev_config, spi_device_handle_t *handle)
+{
+    (void)host_id;
+    struct spi_device_t *device = calloc(1, sizeof(struct spi_device_t));
+    if (!device) {
+        return ESP_ERR_NO_MEM;
+    }
+    device->clock_speed_hz = dev_config->clock_speed_hz;
+    *handle = device;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle)
+{
+    free(handle);
+    return ESP_OK;
+}
+
+esp_err_t spi_device_get_actual_freq(spi_device_handle_t handle, int *freq_khz)
+{
+    (void)handle;
+    *freq_khz = MOCK_SPI_FREQ_KHZ;
+    return ESP_OK;
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans_desc)
+{
+    (void)handle;
+    size_t bytes = (trans_desc->length + 7) / 8;
+    uint8_t *buf = realloc(s_tx_buf, bytes ? bytes : 1);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(buf, trans_desc->tx_buffer, bytes);
+    s_tx_buf = buf;
+    s_tx_bits = trans_desc->length;
+    return ESP_OK;
+}
+
+const uint8_t *mock_spi_last_tx(size_t *length_bits)
+{
+    *length_bits = s_tx_bits;
+    return s_tx_buf;
+}
@@ -0,0 +1,19 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Mock SPI bus: keeps a copy of the last transaction sent on MOSI
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/spi_master.h"
+
+// the SPI backend runs the bus at 2.5MHz, one SPI bit is 400ns
+#define MOCK_SPI_FREQ_KHZ 2500
+
+/**
+ * @brief Last transaction sent, NULL if none
+ *
+ * @param[out] length_bits Its length, in bits
+ */
+const uint8_t *mock_spi_last_tx(size_t *length_bits);
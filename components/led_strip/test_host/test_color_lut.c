@@ -0,0 +1,138 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "led_strip_color_lut.h"
+#include "test_host.h"
+
+// the table is built in float, compared here against double, so allow one step of rounding difference
+static void check_table(const led_strip_color_lut_t *lut, uint8_t brightness, double gamma)
+{
+    int worst = 0;
+    for (int i = 0; i < LED_STRIP_COLOR_LUT_SIZE; i++) {
+        int expected = (int)(pow(i / 255.0, gamma) * brightness + 0.5);
+        int error = abs(led_strip_color_lut_apply(lut, (uint8_t)i) - expected);
+        worst = error > worst ? error : worst;
+        if (i > 0) {
+            TEST_CHECK(lut->table[i] >= lut->table[i - 1]);
+        }
+    }
+    TEST_CHECK(worst <= 1);
+    TEST_CHECK(lut->table[0] == 0);
+    TEST_CHECK(lut->table[255] == brightness);
+    TEST_CHECK(lut->brightness == brightness);
+}
+
+static void test_identity(void)
+{
+    led_strip_color_lut_t lut;
+    led_strip_color_lut_init(&lut);
+    TEST_CHECK(lut.is_identity);
+    check_table(&lut, 255, 1.0);
+    // back to identity from something else
+    TEST_CHECK(led_strip_color_lut_update(&lut, 100, 2.2f) == ESP_OK);
+    TEST_CHECK(!lut.is_identity);
+    TEST_CHECK(led_strip_color_lut_update(&lut, 255, 1.0f) == ESP_OK);
+    TEST_CHECK(lut.is_identity);
+    for (int i = 0; i < LED_STRIP_COLOR_LUT_SIZE; i++) {
+        TEST_CHECK(lut.table[i] == i);
+    }
+}
+
+static void test_brightness(void)
+{
+    led_strip_color_lut_t lut;
+    led_strip_color_lut_init(&lut);
+    TEST_CHECK(led_strip_color_lut_update(&lut, 128, 1.0f) == ESP_OK);
+    TEST_CHECK(!lut.is_identity);
+    check_table(&lut, 128, 1.0);
+    TEST_CHECK(lut.table[255] == 128);
+    TEST_CHECK(lut.table[100] == 50);
+    // off
+    TEST_CHECK(led_strip_color_lut_update(&lut, 0, 1.0f) == ESP_OK);
+    for (int i = 0; i < LED_STRIP_COLOR_LUT_SIZE; i++) {
+        TEST_CHECK(lut.table[i] == 0);
+    }
+}
+
+static void test_gamma(void)
+{
+    led_strip_color_lut_t lut;
+    led_strip_color_lut_init(&lut);
+    TEST_CHECK(led_strip_color_lut_update(&lut, 255, 2.2f) == ESP_OK);
+    TEST_CHECK(!lut.is_identity);
+    check_table(&lut, 255, 2.2);
+    // gamma above 1 only ever darkens
+    for (int i = 0; i < LED_STRIP_COLOR_LUT_SIZE; i++) {
+        TEST_CHECK(lut.table[i] <= i);
+    }
+    TEST_CHECK(led_strip_color_lut_update(&lut, 255, 0.5f) == ESP_OK);
+    check_table(&lut, 255, 0.5);
+}
+
+static void test_combined(void)
+{
+    led_strip_color_lut_t lut;
+    led_strip_color_lut_init(&lut);
+    TEST_CHECK(led_strip_color_lut_update(&lut, 64, 2.8f) == ESP_OK);
+    check_table(&lut, 64, 2.8);
+    TEST_CHECK(lut.gamma == 2.8f);
+}
+
+static void test_invalid_gamma(void)
+{
+    led_strip_color_lut_t lut;
+    led_strip_color_lut_init(&lut);
+    TEST_CHECK(led_strip_color_lut_update(&lut, 128, 2.2f) == ESP_OK);
+    led_strip_color_lut_t before = lut;
+    TEST_CHECK(led_strip_color_lut_update(&lut, 255, 0.05f) == ESP_ERR_INVALID_ARG);
+    TEST_CHECK(led_strip_color_lut_update(&lut, 255, 6.0f) == ESP_ERR_INVALID_ARG);
+    TEST_CHECK(led_strip_color_lut_update(NULL, 255, 1.0f) == ESP_ERR_INVALID_ARG);
+    // a refused update leaves the table as it was
+    TEST_CHECK(memcmp(&lut, &before, sizeof(lut)) == 0);
+}
+
+// changes never write the published table or the one a frame holds, so both stay whole however many come
+static void test_luts_swap(void)
+{
+    led_strip_color_luts_t luts;
+    led_strip_color_luts_init(&luts);
+    TEST_CHECK(led_strip_color_luts_active(&luts)->is_identity);
+    TEST_CHECK(atomic_load(&luts.in_use) == NULL);
+
+    TEST_CHECK(led_strip_color_luts_update(&luts, 96, 2.2f) == ESP_OK);
+    const led_strip_color_lut_t *held = led_strip_color_luts_acquire(&luts);
+    TEST_CHECK(held == led_strip_color_luts_active(&luts));
+    TEST_CHECK(atomic_load(&luts.in_use) == held);
+    led_strip_color_lut_t held_before = *held;
+    for (int i = 0; i < 10; i++) {
+        const led_strip_color_lut_t *published = led_strip_color_luts_active(&luts);
+        led_strip_color_lut_t published_before = *published;
+        TEST_CHECK(led_strip_color_luts_update(&luts, (uint8_t)(i * 25), 1.0f + i * 0.2f) == ESP_OK);
+        const led_strip_color_lut_t *next = led_strip_color_luts_active(&luts);
+        TEST_CHECK(next != published && next != held);
+        TEST_CHECK(next->brightness == (uint8_t)(i * 25));
+        // the table it replaced was not touched while it was being built
+        TEST_CHECK(memcmp(published, &published_before, sizeof(published_before)) == 0);
+    }
+    TEST_CHECK(memcmp(held, &held_before, sizeof(held_before)) == 0);
+    led_strip_color_luts_release(&luts);
+    TEST_CHECK(atomic_load(&luts.in_use) == NULL);
+
+    // a refused change leaves the published table in place
+    const led_strip_color_lut_t *published = led_strip_color_luts_active(&luts);
+    TEST_CHECK(led_strip_color_luts_update(&luts, 255, 9.0f) == ESP_ERR_INVALID_ARG);
+    TEST_CHECK(led_strip_color_luts_active(&luts) == published);
+}
+
+void test_color_lut(void)
+{
+    test_identity();
+    test_brightness();
+    test_gamma();
+    test_combined();
+    test_invalid_gamma();
+    test_luts_swap();
+}
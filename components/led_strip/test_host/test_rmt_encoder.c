@@ -0,0 +1,244 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <time.h>
+#include "esp_cpu.h"
+#include "led_strip_rmt_encoder.h"
+#include "mock_rmt.h"
+#include "test_host.h"
+#include "waveform.h"
+
+// ESP32-C6 RMT channel memory, the default without DMA
+#define TEST_MEM_BLOCK_SYMBOLS 48
+// every byte value once, so every bit pattern goes through the encoder
+#define TEST_FRAME_BYTES 256
+#define BENCH_PIXELS 1024
+#define BENCH_FRAMES 50
+
+static rmt_symbol_word_t s_symbols[BENCH_PIXELS * 4 * 8 + 16];
+static waveform_t s_waveform;
+
+static esp_err_t new_encoder(led_model_t model, uint32_t resolution, rmt_encoder_handle_t *ret_encoder)
+{
+    led_strip_encoder_config_t config = {
+        .resolution = resolution,
+        .led_model = model,
+        .mem_block_symbols = TEST_MEM_BLOCK_SYMBOLS,
+    };
+    return rmt_new_led_strip_encoder(&config, ret_encoder);
+}
+
+// send one frame through the mock channel and rebuild the line's waveform from it
+static uint32_t send_frame(rmt_encoder_handle_t encoder, const uint8_t *data, size_t size, uint32_t resolution)
+{
+    struct rmt_channel_t channel;
+    mock_rmt_channel_init(&channel, s_symbols, sizeof(s_symbols) / sizeof(s_symbols[0]));
+    uint32_t calls = mock_rmt_transmit(&channel, encoder, data, size, TEST_MEM_BLOCK_SYMBOLS);
+    TEST_CHECK(!channel.overflow);
+    waveform_init(&s_waveform);
+    waveform_add_rmt(&s_waveform, s_symbols, channel.count, resolution);
+    return calls;
+}
+
+static void test_timing(led_model_t model, const led_timing_t *timing, uint32_t resolution)
+{
+    uint8_t data[TEST_FRAME_BYTES];
+    for (int i = 0; i < TEST_FRAME_BYTES; i++) {
+        data[i] = (uint8_t)i;
+    }
+    rmt_encoder_handle_t encoder = NULL;
+    TEST_CHECK(new_encoder(model, resolution, &encoder) == ESP_OK);
+    if (!encoder) {
+        return;
+    }
+    // twice, the second frame must not depend on what the first left behind
+    for (int frame = 0; frame < 2; frame++) {
+        uint32_t calls = send_frame(encoder, data, sizeof(data), resolution);
+        uint8_t decoded[TEST_FRAME_BYTES];
+        waveform_decode_t result;
+        waveform_decode(&s_waveform, timing, true, decoded, sizeof(decoded), &result);
+        printf("rmt %s at %uHz: bits=%zu worst_error=%.1fns reset=%.1fus violations=%u encode_calls=%u\n",
+               timing->name, resolution, result.bits, result.worst_error_ps / 1000.0, result.reset_ps / 1000000.0,
+               result.violations, calls);
+        TEST_CHECK(calls > 1); // the frame does not fit in the channel memory, so it takes refills
+        TEST_CHECK(result.violations == 0);
+        TEST_CHECK(result.bits == sizeof(data) * 8);
+        TEST_CHECK(memcmp(decoded, data, sizeof(data)) == 0);
+        led_strip_encoder_stats_t stats;
+        rmt_led_strip_encoder_get_stats(encoder, &stats);
+        TEST_CHECK(stats.encode_calls == calls);
+        TEST_CHECK(stats.underruns == 0);
+    }
+    rmt_del_encoder(encoder);
+}
+
+// send one frame, calling `on_refill` before every refill
+static void send_frame_with_refill_hook(rmt_encoder_handle_t encoder, const uint8_t *data, size_t size, uint32_t resolution,
+                                        void (*on_refill)(void *arg), void *arg)
+{
+    struct rmt_channel_t channel;
+    mock_rmt_channel_init(&channel, s_symbols, sizeof(s_symbols) / sizeof(s_symbols[0]));
+    channel.on_refill = on_refill;
+    channel.on_refill_arg = arg;
+    TEST_CHECK(mock_rmt_transmit(&channel, encoder, data, size, TEST_MEM_BLOCK_SYMBOLS) > 1);
+    TEST_CHECK(!channel.overflow);
+    waveform_init(&s_waveform);
+    waveform_add_rmt(&s_waveform, s_symbols, channel.count, resolution);
+}
+
+// decode the last frame and check every byte went through `lut`
+static void check_corrected(const uint8_t *data, size_t size, const led_strip_color_lut_t *lut)
+{
+    static uint8_t decoded[BENCH_PIXELS * 3];
+    waveform_decode_t result;
+    waveform_decode(&s_waveform, &waveform_ws2812, true, decoded, size, &result);
+    TEST_CHECK(result.violations == 0);
+    TEST_CHECK(result.bits == size * 8);
+    size_t wrong = 0;
+    for (size_t i = 0; i < size; i++) {
+        wrong += decoded[i] != led_strip_color_lut_apply(lut, data[i]);
+    }
+    TEST_CHECK(wrong == 0);
+}
+
+// changes brightness twice on the first refill of a frame
+static void change_mid_frame(void *arg)
+{
+    led_strip_color_luts_t *luts = arg;
+    static bool changed;
+    if (!changed) {
+        TEST_CHECK(led_strip_color_luts_update(luts, 255, 1.0f) == ESP_OK);
+        TEST_CHECK(led_strip_color_luts_update(luts, 32, 1.0f) == ESP_OK);
+        changed = true;
+    }
+}
+
+// brightness and gamma are looked up a chunk at a time while encoding, and must hold across the refills
+static void test_color_lut_encoding(void)
+{
+    static uint8_t data[BENCH_PIXELS * 3];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 37);
+    }
+    static uint8_t original[sizeof(data)];
+    memcpy(original, data, sizeof(data));
+    static led_strip_color_luts_t luts;
+    led_strip_color_luts_init(&luts);
+    TEST_CHECK(led_strip_color_luts_update(&luts, 96, 2.2f) == ESP_OK);
+    led_strip_color_lut_t lut = *led_strip_color_luts_active(&luts);
+    led_strip_encoder_config_t config = {
+        .resolution = 10 * 1000 * 1000,
+        .led_model = LED_MODEL_WS2812,
+        .color_luts = &luts,
+        .mem_block_symbols = TEST_MEM_BLOCK_SYMBOLS,
+    };
+    rmt_encoder_handle_t encoder = NULL;
+    TEST_CHECK(rmt_new_led_strip_encoder(&config, &encoder) == ESP_OK);
+    if (!encoder) {
+        return;
+    }
+
+    // sizes around the chunk, and a whole 1024 pixel frame: nothing goes out uncorrected
+    const size_t sizes[] = {1, 31, 32, 33, TEST_FRAME_BYTES, sizeof(data)};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        send_frame(encoder, data, sizes[i], config.resolution);
+        check_corrected(data, sizes[i], &lut);
+    }
+    // the pixel buffer keeps the linear values
+    TEST_CHECK(memcmp(data, original, sizeof(data)) == 0);
+    // the table is let go of once the pixels are encoded
+    TEST_CHECK(atomic_load(&luts.in_use) == NULL);
+
+    // a change published during a frame, even two of them, shows from the next frame
+    send_frame_with_refill_hook(encoder, data, TEST_FRAME_BYTES, config.resolution, change_mid_frame, &luts);
+    check_corrected(data, TEST_FRAME_BYTES, &lut);
+    lut = *led_strip_color_luts_active(&luts);
+    TEST_CHECK(lut.brightness == 32);
+    send_frame(encoder, data, TEST_FRAME_BYTES, config.resolution);
+    check_corrected(data, TEST_FRAME_BYTES, &lut);
+
+    // back to identity, the pixels are encoded straight from the buffer
+    TEST_CHECK(led_strip_color_luts_update(&luts, 255, 1.0f) == ESP_OK);
+    send_frame(encoder, data, TEST_FRAME_BYTES, config.resolution);
+    uint8_t decoded[TEST_FRAME_BYTES];
+    waveform_decode_t result;
+    waveform_decode(&s_waveform, &waveform_ws2812, true, decoded, sizeof(decoded), &result);
+    TEST_CHECK(result.violations == 0);
+    TEST_CHECK(memcmp(decoded, data, sizeof(decoded)) == 0);
+
+    // a frame reset half way through lets go of its table and starts the next one from the first pixel
+    TEST_CHECK(led_strip_color_luts_update(&luts, 200, 2.2f) == ESP_OK);
+    lut = *led_strip_color_luts_active(&luts);
+    struct rmt_channel_t channel;
+    mock_rmt_channel_init(&channel, s_symbols, sizeof(s_symbols) / sizeof(s_symbols[0]));
+    channel.mem_free = TEST_MEM_BLOCK_SYMBOLS;
+    rmt_encode_state_t state;
+    encoder->encode(encoder, &channel, data, TEST_FRAME_BYTES, &state);
+    TEST_CHECK(state == RMT_ENCODING_MEM_FULL);
+    TEST_CHECK(atomic_load(&luts.in_use) != NULL);
+    rmt_encoder_reset(encoder);
+    TEST_CHECK(atomic_load(&luts.in_use) == NULL);
+    send_frame(encoder, data, TEST_FRAME_BYTES, config.resolution);
+    check_corrected(data, TEST_FRAME_BYTES, &lut);
+    rmt_del_encoder(encoder);
+}
+
+static void test_rejected(led_model_t model, uint32_t resolution)
+{
+    rmt_encoder_handle_t encoder = NULL;
+    TEST_CHECK(new_encoder(model, resolution, &encoder) == ESP_ERR_INVALID_ARG);
+    TEST_CHECK(encoder == NULL);
+}
+
+static double elapsed_us(const struct timespec *start, const struct timespec *end)
+{
+    return (end->tv_sec - start->tv_sec) * 1e6 + (end->tv_nsec - start->tv_nsec) / 1e3;
+}
+
+// host CPU time says little about the ESP32-C6, the wire time and the encoder calls per frame carry over as they are
+static void bench_frame(void)
+{
+    static uint8_t data[BENCH_PIXELS * 3];
+    for (size_t i = 0; i < sizeof(data); i++) {
+        data[i] = (uint8_t)(i * 37);
+    }
+    rmt_encoder_handle_t encoder = NULL;
+    TEST_CHECK(new_encoder(LED_MODEL_WS2812, 10 * 1000 * 1000, &encoder) == ESP_OK);
+    if (!encoder) {
+        return;
+    }
+    uint32_t calls = 0;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        calls = send_frame(encoder, data, sizeof(data), 10 * 1000 * 1000);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint8_t decoded[sizeof(data)];
+    waveform_decode_t result;
+    waveform_decode(&s_waveform, &waveform_ws2812, true, decoded, sizeof(decoded), &result);
+    TEST_CHECK(result.violations == 0);
+    double wire_us = result.total_ps / 1e6;
+    printf("BENCH backend=rmt pixels=%d mem_block_symbols=%d encode_calls=%u host_encode_us=%.1f wire_us=%.1f max_fps=%.1f\n",
+           BENCH_PIXELS, TEST_MEM_BLOCK_SYMBOLS, calls, elapsed_us(&start, &end) / BENCH_FRAMES, wire_us, 1e6 / wire_us);
+    rmt_del_encoder(encoder);
+}
+
+void test_rmt_encoder(void)
+{
+    // 10MHz is the driver's default, 3.2MHz only passes with the durations rounded to the nearest tick
+    const uint32_t resolutions[] = {3200 * 1000, 8 * 1000 * 1000, 10 * 1000 * 1000, 40 * 1000 * 1000, 80 * 1000 * 1000};
+    for (size_t i = 0; i < sizeof(resolutions) / sizeof(resolutions[0]); i++) {
+        test_timing(LED_MODEL_WS2812, &waveform_ws2812, resolutions[i]);
+        test_timing(LED_MODEL_SK6812, &waveform_sk6812, resolutions[i]);
+    }
+    test_color_lut_encoding();
+    // pulses round to nothing, or a whole tick is more than the tolerance
+    test_rejected(LED_MODEL_WS2812, 1000 * 1000);
+    test_rejected(LED_MODEL_WS2812, 2 * 1000 * 1000);
+    test_rejected(LED_MODEL_SK6812, 2 * 1000 * 1000);
+    // the reset code no longer fits in one symbol
+    test_rejected(LED_MODEL_WS2812, 240 * 1000 * 1000);
+    bench_frame();
+}
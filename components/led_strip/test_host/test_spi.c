@@ -0,0 +1,147 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include <time.h>
+#include "led_strip.h"
+#include "led_strip_color_lut.h"
+#include "mock_spi.h"
+#include "test_host.h"
+#include "waveform.h"
+
+#define TEST_LEDS 86
+#define BENCH_PIXELS 1024
+#define BENCH_FRAMES 50
+
+static waveform_t s_waveform;
+
+static led_strip_handle_t new_strip(uint32_t max_leds)
+{
+    led_strip_config_t led_config = {
+        .strip_gpio_num = 8,
+        .max_leds = max_leds,
+        .led_pixel_format = LED_PIXEL_FORMAT_GRB,
+        .led_model = LED_MODEL_WS2812,
+    };
+    led_strip_spi_config_t spi_config = {
+        .clk_src = SPI_CLK_SRC_DEFAULT,
+        .spi_bus = SPI2_HOST,
+    };
+    led_strip_handle_t strip = NULL;
+    TEST_CHECK(led_strip_new_spi_device(&led_config, &spi_config, &strip) == ESP_OK);
+    return strip;
+}
+
+static void decode_last_tx(uint8_t *decoded, size_t size, waveform_decode_t *result)
+{
+    size_t bits = 0;
+    const uint8_t *tx = mock_spi_last_tx(&bits);
+    waveform_init(&s_waveform);
+    if (tx) {
+        waveform_add_spi(&s_waveform, tx, bits, MOCK_SPI_FREQ_KHZ * 1000);
+    }
+    // the bus idles low after the transaction, that is the reset
+    waveform_decode(&s_waveform, &waveform_ws2812, false, decoded, size, result);
+}
+
+// the SPI backend has one waveform, 3 SPI bits per LED bit at 2.5MHz, made for WS2812
+static void test_timing(void)
+{
+    led_strip_handle_t strip = new_strip(TEST_LEDS);
+    if (!strip) {
+        return;
+    }
+    uint8_t expected[TEST_LEDS * 3];
+    for (uint32_t i = 0; i < TEST_LEDS; i++) {
+        uint8_t red = (uint8_t)(i * 3), green = (uint8_t)(i * 3 + 1), blue = (uint8_t)(i * 3 + 2);
+        TEST_CHECK(led_strip_set_pixel(strip, i, red, green, blue) == ESP_OK);
+        // sent in GRB order
+        expected[i * 3 + 0] = green;
+        expected[i * 3 + 1] = red;
+        expected[i * 3 + 2] = blue;
+    }
+    TEST_CHECK(led_strip_refresh(strip) == ESP_OK);
+    uint8_t decoded[TEST_LEDS * 3];
+    waveform_decode_t result;
+    decode_last_tx(decoded, sizeof(decoded), &result);
+    printf("spi WS2812 at %dkHz: bits=%zu worst_error=%.1fns violations=%u\n",
+           MOCK_SPI_FREQ_KHZ, result.bits, result.worst_error_ps / 1000.0, result.violations);
+    TEST_CHECK(result.violations == 0);
+    TEST_CHECK(result.bits == sizeof(expected) * 8);
+    TEST_CHECK(memcmp(decoded, expected, sizeof(expected)) == 0);
+    TEST_CHECK(led_strip_del(strip) == ESP_OK);
+}
+
+// the SPI backend runs the pixels through the table as it encodes the SPI bits on refresh
+static void test_brightness_gamma(void)
+{
+    led_strip_handle_t strip = new_strip(TEST_LEDS);
+    if (!strip) {
+        return;
+    }
+    uint8_t linear[TEST_LEDS * 3];
+    for (uint32_t i = 0; i < TEST_LEDS; i++) {
+        uint8_t red = (uint8_t)(i * 3), green = (uint8_t)(i * 3 + 1), blue = (uint8_t)(i * 3 + 2);
+        led_strip_set_pixel(strip, i, red, green, blue);
+        linear[i * 3 + 0] = green;
+        linear[i * 3 + 1] = red;
+        linear[i * 3 + 2] = blue;
+    }
+    TEST_CHECK(led_strip_set_brightness(strip, 128) == ESP_OK);
+    TEST_CHECK(led_strip_set_gamma(strip, 2.2f) == ESP_OK);
+    led_strip_color_lut_t lut;
+    led_strip_color_lut_init(&lut);
+    led_strip_color_lut_update(&lut, 128, 2.2f);
+
+    uint8_t decoded[TEST_LEDS * 3];
+    waveform_decode_t result;
+    TEST_CHECK(led_strip_refresh(strip) == ESP_OK);
+    decode_last_tx(decoded, sizeof(decoded), &result);
+    TEST_CHECK(result.violations == 0);
+    for (size_t i = 0; i < sizeof(linear); i++) {
+        TEST_CHECK(decoded[i] == led_strip_color_lut_apply(&lut, linear[i]));
+    }
+
+    // the pixel buffer kept the linear values, so undoing the correction gives them back
+    TEST_CHECK(led_strip_set_brightness(strip, 255) == ESP_OK);
+    TEST_CHECK(led_strip_set_gamma(strip, 1.0f) == ESP_OK);
+    TEST_CHECK(led_strip_refresh(strip) == ESP_OK);
+    decode_last_tx(decoded, sizeof(decoded), &result);
+    TEST_CHECK(memcmp(decoded, linear, sizeof(linear)) == 0);
+    TEST_CHECK(led_strip_set_gamma(strip, 9.0f) == ESP_ERR_INVALID_ARG);
+    led_strip_del(strip);
+}
+
+static void bench_frame(void)
+{
+    led_strip_handle_t strip = new_strip(BENCH_PIXELS);
+    if (!strip) {
+        return;
+    }
+    for (uint32_t i = 0; i < BENCH_PIXELS; i++) {
+        led_strip_set_pixel(strip, i, i & 0xFF, (i * 7) & 0xFF, (i * 13) & 0xFF);
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int frame = 0; frame < BENCH_FRAMES; frame++) {
+        led_strip_refresh(strip);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    static uint8_t decoded[BENCH_PIXELS * 3];
+    waveform_decode_t result;
+    decode_last_tx(decoded, sizeof(decoded), &result);
+    TEST_CHECK(result.violations == 0);
+    // without the reset, which the caller has to leave between refreshes
+    double wire_us = result.total_ps / 1e6;
+    double host_us = ((end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3) / BENCH_FRAMES;
+    printf("BENCH backend=spi pixels=%d host_encode_us=%.1f wire_us=%.1f max_fps=%.1f\n",
+           BENCH_PIXELS, host_us, wire_us, 1e6 / (wire_us + waveform_ws2812.reset_ns / 1e3));
+    led_strip_del(strip);
+}
+
+void test_spi(void)
+{
+    test_timing();
+    test_brightness_gamma();
+    bench_frame();
+}
@@ -0,0 +1,111 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <string.h>
+#include "waveform.h"
+
+#define PS_PER_NS 1000ULL
+#define PS_PER_S 1000000000000ULL
+
+// WS2812B-V5 needs 280us of reset, older parts 50us
+const led_timing_t waveform_ws2812 = {
+    .name = "WS2812", .t0h_ns = 300, .t0l_ns = 900, .t1h_ns = 900, .t1l_ns = 300, .tolerance_ns = 150, .reset_ns = 280000,
+};
+
+const led_timing_t waveform_sk6812 = {
+    .name = "SK6812", .t0h_ns = 300, .t0l_ns = 900, .t1h_ns = 600, .t1l_ns = 600, .tolerance_ns = 150, .reset_ns = 80000,
+};
+
+static void waveform_append(waveform_t *waveform, bool level, uint64_t ps)
+{
+    if (!ps) {
+        return;
+    }
+    if (waveform->count && waveform->runs[waveform->count - 1].level == level) {
+        waveform->runs[waveform->count - 1].ps += ps;
+        return;
+    }
+    if (waveform->count == WAVEFORM_MAX_RUNS) {
+        waveform->overflow = true;
+        return;
+    }
+    waveform->runs[waveform->count++] = (waveform_run_t) {
+        .level = level,
+        .ps = ps,
+    };
+}
+
+static uint64_t waveform_distance(uint64_t a, uint64_t b)
+{
+    return a > b ? a - b : b - a;
+}
+
+void waveform_init(waveform_t *waveform)
+{
+    waveform->count = 0;
+    waveform->overflow = false;
+}
+
+void waveform_add_rmt(waveform_t *waveform, const rmt_symbol_word_t *symbols, size_t count, uint32_t resolution)
+{
+    for (size_t i = 0; i < count; i++) {
+        waveform_append(waveform, symbols[i].level0, symbols[i].duration0 * PS_PER_S / resolution);
+        waveform_append(waveform, symbols[i].level1, symbols[i].duration1 * PS_PER_S / resolution);
+    }
+}
+
+void waveform_add_spi(waveform_t *waveform, const uint8_t *data, size_t bits, uint32_t freq_hz)
+{
+    for (size_t i = 0; i < bits; i++) {
+        waveform_append(waveform, data[i / 8] & (0x80 >> (i % 8)), PS_PER_S / freq_hz);
+    }
+}
+
+void waveform_decode(const waveform_t *waveform, const led_timing_t *timing, bool require_reset,
+                     uint8_t *bytes, size_t max_bytes, waveform_decode_t *result)
+{
+    uint64_t tolerance_ps = timing->tolerance_ns * PS_PER_NS;
+    memset(result, 0, sizeof(*result));
+    memset(bytes, 0, max_bytes);
+    size_t i = 0;
+    // the line idles low before the frame
+    if (i < waveform->count && !waveform->runs[i].level) {
+        result->total_ps += waveform->runs[i].ps;
+        i++;
+    }
+    for (; i + 1 < waveform->count; i += 2) {
+        uint64_t high_ps = waveform->runs[i].ps;
+        uint64_t low_ps = waveform->runs[i + 1].ps;
+        result->total_ps += high_ps + low_ps;
+        // the LED tells the bits apart by the high time alone
+        bool one = waveform_distance(high_ps, timing->t1h_ns * PS_PER_NS) < waveform_distance(high_ps, timing->t0h_ns * PS_PER_NS);
+        uint64_t nominal_high_ps = (one ? timing->t1h_ns : timing->t0h_ns) * PS_PER_NS;
+        uint64_t nominal_low_ps = (one ? timing->t1l_ns : timing->t0l_ns) * PS_PER_NS;
+        uint64_t high_error_ps = waveform_distance(high_ps, nominal_high_ps);
+        result->worst_error_ps = high_error_ps > result->worst_error_ps ? high_error_ps : result->worst_error_ps;
+        if (high_error_ps > tolerance_ps) {
+            result->violations++;
+        }
+        if (i + 2 < waveform->count) {
+            uint64_t low_error_ps = waveform_distance(low_ps, nominal_low_ps);
+            result->worst_error_ps = low_error_ps > result->worst_error_ps ? low_error_ps : result->worst_error_ps;
+            if (low_error_ps > tolerance_ps) {
+                result->violations++;
+            }
+        } else {
+            // the last bit's low time runs into the reset
+            result->reset_ps = low_ps;
+            if (require_reset ? low_ps < timing->reset_ns * PS_PER_NS : low_ps + tolerance_ps < nominal_low_ps) {
+                result->violations++;
+            }
+        }
+        if (one && result->bits / 8 < max_bytes) {
+            bytes[result->bits / 8] |= 0x80 >> (result->bits % 8);
+        }
+        result->bits++;
+    }
+    // a high time with no low after it is a frame cut short
+    if (i < waveform->count || waveform->overflow) {
+        result->violations++;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// The level on the LED data line over time, rebuilt from what a backend sent, and decoded the way an LED reads it
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "driver/rmt_types.h"
+
+#define WAVEFORM_MAX_RUNS 65536
+
+/**
+ * @brief Datasheet timing of an LED model, in ns
+ */
+typedef struct {
+    const char *name;
+    uint32_t t0h_ns;
+    uint32_t t0l_ns;
+    uint32_t t1h_ns;
+    uint32_t t1l_ns;
+    uint32_t tolerance_ns; // allowed on each of the four above
+    uint32_t reset_ns;     // least low time that latches the frame
+} led_timing_t;
+
+extern const led_timing_t waveform_ws2812;
+extern const led_timing_t waveform_sk6812;
+
+/**
+ * @brief A stretch of the line at one level, in ps so that ticks of any resolution are exact enough
+ */
+typedef struct {
+    bool level;
+    uint64_t ps;
+} waveform_run_t;
+
+typedef struct {
+    waveform_run_t runs[WAVEFORM_MAX_RUNS];
+    size_t count;
+    bool overflow;
+} waveform_t;
+
+typedef struct {
+    size_t bits;               // data bits read
+    uint32_t violations;       // high or low times outside the tolerance, and a missing reset
+    uint64_t worst_error_ps;   // largest distance of a high or low time from its nominal value
+    uint64_t reset_ps;         // low time after the last bit
+    uint64_t total_ps;         // whole frame, reset included
+} waveform_decode_t;
+
+void waveform_init(waveform_t *waveform);
+
+/**
+ * @brief Append RMT symbols sent at `resolution` Hz
+ */
+void waveform_add_rmt(waveform_t *waveform, const rmt_symbol_word_t *symbols, size_t count, uint32_t resolution);
+
+/**
+ * @brief Append a SPI MOSI bit stream, MSB first, sent at `freq_hz`
+ */
+void waveform_add_spi(waveform_t *waveform, const uint8_t *data, size_t bits, uint32_t freq_hz);
+
+/**
+ * @brief Read the bits out of the waveform, MSB first, and check every high and low time against `timing`
+ *
+ * @param require_reset Whether the frame must end with a reset, a SPI transaction leaves the line idle low instead
+ */
+void waveform_decode(const waveform_t *waveform, const led_timing_t *timing, bool require_reset,
+                     uint8_t *bytes, size_t max_bytes, waveform_decode_t *result);